@@ -0,0 +1,125 @@
+/*
+    Author: agent
+    Created: 2026.10.19
+
+    Tiled execution 예제.
+    같은 네트워크를 전체 tensor로 실행할 때와 tile 단위로 실행할 때의 peak memory를 비교한다.
+    Tile 실행에서는 입력을 reader callback으로 tile 단위로 읽어오고 (file, sensor 등), 출력은 sink callback으로 내보낸다.
+    - batch_norm_2d만 있는 네트워크: height 방향으로 tile (spatial tiling)
+    - linear가 포함된 네트워크: batch 방향으로 tile (batch tiling)
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <math.h>
+#include "tensor.h"
+#include "op_linear.h"
+#include "op_norm.h"
+#include "executor.h"
+
+typedef struct {
+    double checksum;
+} demo_ctx_t;
+
+// Synthetic input (e.g. pixel of a sensor frame)
+static float demo_input_value(uint32_t n, uint32_t c, uint32_t h, uint32_t w) {
+    return (float)((n * 31 + c * 17 + h * 7 + w * 3) % 100) / 100.0f;
+}
+
+static int demo_reader(void *ctx, tensor_t *tile, executor_tile_t *region) {
+    for (uint32_t n = 0; n < tile->shape[0]; n++) {
+        for (uint32_t c = 0; c < tile->shape[1]; c++) {
+            for (uint32_t h = 0; h < tile->shape[2]; h++) {
+                for (uint32_t w = 0; w < tile->shape[3]; w++) {
+                    tile->data[tensor_convert_nd_to_1d_index(tile, (uint32_t[]){n, c, h, w})].float32 = demo_input_value(region->batch_offset + n, c, region->row_offset + h, w);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static int demo_sink(void *ctx, tensor_t *tile, executor_tile_t *region) {
+    demo_ctx_t *demo = (demo_ctx_t *)ctx;
+    for (uint32_t i = 0; i < tile->num_elements; i++) {
+        demo->checksum += tile->data[i].float32;
+    }
+    return 0;
+}
+
+static batch_norm_t *demo_batch_norm(uint32_t channels) {
+    tensor_t *mean = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *var = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *epsilon = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *gamma = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *beta = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    for (int i = 0; i < channels; i++) {
+        mean->data[i].float32 = 0.1f * i;
+        var->data[i].float32 = 1.0f + 0.05f * i;
+        epsilon->data[i].float32 = 1e-5f;
+        gamma->data[i].float32 = 1.0f - 0.01f * i;
+        beta->data[i].float32 = 0.02f * i;
+    }
+    return batch_norm_create(mean, var, epsilon, gamma, beta);
+}
+
+static void demo_compare(executor_t *executor, uint32_t *shape, uint32_t tile_size) {
+    uint64_t baseline = tensor_get_global_data_memory();   // weights
+
+    // Whole tensor
+    tensor_reset_global_data_peak_memory();
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, 4, shape, (void *)0);
+    for (uint32_t i = 0; i < input->num_elements; i++) {
+        uint32_t w = i % shape[3];
+        uint32_t h = (i / shape[3]) % shape[2];
+        uint32_t c = (i / (shape[3] * shape[2])) % shape[1];
+        uint32_t n = i / (shape[3] * shape[2] * shape[1]);
+        input->data[i].float32 = demo_input_value(n, c, h, w);
+    }
+    tensor_t *output = executor_run(executor, input);
+    demo_ctx_t whole = {0};
+    demo_sink(&whole, output, &(executor_tile_t){0, 0});
+    tensor_free(input);
+    tensor_free(output);
+    uint64_t whole_peak = tensor_get_global_data_peak_memory() - baseline;
+
+    // Tiled
+    tensor_reset_global_data_peak_memory();
+    demo_ctx_t tiled = {0};
+    executor_run_tiled(executor, TENSOR_FLOAT32, 4, shape, tile_size, demo_reader, demo_sink, &tiled);
+    uint64_t tiled_peak = tensor_get_global_data_peak_memory() - baseline;
+
+    printf(">> input (%d, %d, %d, %d), tile size %d\r\n", shape[0], shape[1], shape[2], shape[3], tile_size);
+    printf(">>   whole tensor: peak activation memory %" PRIu64 " bytes, checksum %f\r\n", whole_peak, whole.checksum);
+    printf(">>   tiled       : peak activation memory %" PRIu64 " bytes, checksum %f\r\n", tiled_peak, tiled.checksum);
+}
+
+int main() {
+    printf(">> Demo: Spatial tiling (batch_norm_2d -> batch_norm_2d)\r\n");
+    executor_t *spatial = executor_create();
+    executor_add_batch_norm_2d(spatial, demo_batch_norm(16));
+    executor_add_batch_norm_2d(spatial, demo_batch_norm(16));
+    demo_compare(spatial, (uint32_t[]){2, 16, 128, 128}, 8);
+    executor_free(spatial, 1);
+
+    printf(">> Demo: Batch tiling (batch_norm_2d -> flatten -> linear)\r\n");
+    tensor_t *weight = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){10, 8 * 16 * 16}, (void *)0);
+    tensor_t *bias = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){10}, (void *)0);
+    for (int i = 0; i < weight->num_elements; i++) {
+        weight->data[i].float32 = (float)(i % 13) / 13.0f - 0.5f;
+    }
+    for (int i = 0; i < bias->num_elements; i++) {
+        bias->data[i].float32 = 0.1f * i;
+    }
+    executor_t *batch = executor_create();
+    executor_add_batch_norm_2d(batch, demo_batch_norm(8));
+    executor_add_flatten(batch);
+    executor_add_linear(batch, linear_create(weight, bias));
+    demo_compare(batch, (uint32_t[]){64, 8, 16, 16}, 4);
+    executor_free(batch, 1);
+
+    tensor_print_global_data_memory();
+    printf(">> Done\r\n");
+    return 0;
+}
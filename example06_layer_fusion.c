@@ -0,0 +1,112 @@
+/*
+    Author: agent
+    Created: 2026.10.19
+
+    Layer fusion 예제.
+    같은 네트워크를 layer 단위로 실행할 때와 fusion해서 실행할 때의 latency와 memory traffic을 비교한다.
+    memory traffic은 실행 중에 memory에 쓰여진 activation의 크기 (executor->activation_bytes)로 측정한다.
+    - linear -> BN1d -> ReLU -> linear -> BN1d -> ReLU -> linear: row 단위로 depth-first 실행
+    - BN2d -> ReLU -> BN2d -> ReLU: 한 번의 pass로 실행
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <math.h>
+#include <time.h>
+#include "tensor.h"
+#include "op_linear.h"
+#include "op_norm.h"
+#include "executor.h"
+
+#define DEMO_REPEAT 5
+
+static batch_norm_t *demo_batch_norm(uint32_t channels) {
+    tensor_t *mean = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *var = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *gamma = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *beta = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    for (int i = 0; i < channels; i++) {
+        mean->data[i].float32 = 0.01f * (i % 7);
+        var->data[i].float32 = 1.0f + 0.01f * (i % 5);
+        gamma->data[i].float32 = 1.0f - 0.001f * (i % 11);
+        beta->data[i].float32 = 0.02f * (i % 3) - 0.01f;
+    }
+    return batch_norm_create(mean, var, NULL, gamma, beta);
+}
+
+static linear_t *demo_linear(uint32_t in_features, uint32_t out_features) {
+    tensor_t *weight = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){out_features, in_features}, (void *)0);
+    tensor_t *bias = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){out_features}, (void *)0);
+    for (int i = 0; i < weight->num_elements; i++) {
+        weight->data[i].float32 = ((float)(i % 17) - 8.0f) / (8.0f * in_features);
+    }
+    for (int i = 0; i < bias->num_elements; i++) {
+        bias->data[i].float32 = 0.01f * (i % 5);
+    }
+    return linear_create(weight, bias);
+}
+
+static void demo_compare(executor_t *executor, tensor_t *input) {
+    double ms[2];
+    uint64_t bytes[2];
+    tensor_t *outputs[2];
+    for (int fusion = 0; fusion < 2; fusion++) {
+        executor_set_fusion(executor, fusion);
+        outputs[fusion] = executor_run(executor, input);   // Warm up
+        clock_t start = clock();
+        for (int r = 0; r < DEMO_REPEAT; r++) {
+            tensor_t *output = executor_run(executor, input);
+            tensor_free(output);
+        }
+        ms[fusion] = 1000.0 * (double)(clock() - start) / CLOCKS_PER_SEC / DEMO_REPEAT;
+        bytes[fusion] = executor->activation_bytes;
+    }
+    float max_diff = 0.0f;
+    for (int i = 0; i < outputs[0]->num_elements; i++) {
+        float diff = fabsf(outputs[0]->data[i].float32 - outputs[1]->data[i].float32);
+        if (diff > max_diff) max_diff = diff;
+    }
+    printf(">>   unfused: %8.3f ms, activation bytes written %" PRIu64 "\r\n", ms[0], bytes[0]);
+    printf(">>   fused  : %8.3f ms, activation bytes written %" PRIu64 "\r\n", ms[1], bytes[1]);
+    printf(">>   max abs diff: %e\r\n", max_diff);
+    tensor_free(outputs[0]);
+    tensor_free(outputs[1]);
+}
+
+int main() {
+    printf(">> Demo: linear -> BN1d -> ReLU -> linear -> BN1d -> ReLU -> linear, input (64, 512)\r\n");
+    executor_t *mlp = executor_create();
+    executor_add_linear(mlp, demo_linear(512, 1024));
+    executor_add_batch_norm_1d(mlp, demo_batch_norm(1024));
+    executor_add_relu(mlp);
+    executor_add_linear(mlp, demo_linear(1024, 1024));
+    executor_add_batch_norm_1d(mlp, demo_batch_norm(1024));
+    executor_add_relu(mlp);
+    executor_add_linear(mlp, demo_linear(1024, 10));
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){64, 512}, (void *)0);
+    for (int i = 0; i < input->num_elements; i++) {
+        input->data[i].float32 = (float)(i % 23) / 23.0f;
+    }
+    demo_compare(mlp, input);
+    tensor_free(input);
+    executor_free(mlp, 1);
+
+    printf(">> Demo: BN2d -> ReLU -> BN2d -> ReLU, input (8, 32, 64, 64)\r\n");
+    executor_t *pointwise = executor_create();
+    executor_add_batch_norm_2d(pointwise, demo_batch_norm(32));
+    executor_add_relu(pointwise);
+    executor_add_batch_norm_2d(pointwise, demo_batch_norm(32));
+    executor_add_relu(pointwise);
+    input = tensor_create(TENSOR_FLOAT32, 4, (uint32_t[]){8, 32, 64, 64}, (void *)0);
+    for (int i = 0; i < input->num_elements; i++) {
+        input->data[i].float32 = (float)(i % 29) / 29.0f - 0.5f;
+    }
+    demo_compare(pointwise, input);
+    tensor_free(input);
+    executor_free(pointwise, 1);
+
+    tensor_print_global_data_memory();
+    printf(">> Done\r\n");
+    return 0;
+}
@@ -0,0 +1,165 @@
+/*
+    Author: agent
+    Created: 2026.10.19
+
+    Pooling 예제.
+    ResNet의 뒷부분에서 사용되는 shape으로 max_pool_2d, avg_pool_2d, global_avg_pool_2d를 실행한다.
+    - 단순한 reference 구현 (tensor_convert_nd_to_1d_index 사용)과 결과 및 latency를 비교한다.
+    - BN2d -> ReLU -> global_avg_pool_2d를 fusion했을 때와 하지 않았을 때를 비교한다.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <float.h>
+#include <math.h>
+#include <time.h>
+#include "tensor.h"
+#include "op_norm.h"
+#include "op_pool.h"
+#include "executor.h"
+
+#define DEMO_REPEAT 20
+
+// Reference pooling: straightforward loops over the padded window
+static tensor_t *reference_pool(tensor_t *input, pool2d_t *pool, uint8_t is_max) {
+    uint32_t oh_size = (input->shape[2] + 2 * pool->padding_h - pool->kernel_h) / pool->stride_h + 1;
+    uint32_t ow_size = (input->shape[3] + 2 * pool->padding_w - pool->kernel_w) / pool->stride_w + 1;
+    tensor_t *output = tensor_create(TENSOR_FLOAT32, 4, (uint32_t[]){input->shape[0], input->shape[1], oh_size, ow_size}, (void *)0);
+    for (uint32_t n = 0; n < input->shape[0]; n++) {
+        for (uint32_t c = 0; c < input->shape[1]; c++) {
+            for (uint32_t oh = 0; oh < oh_size; oh++) {
+                for (uint32_t ow = 0; ow < ow_size; ow++) {
+                    float result = is_max ? -FLT_MAX : 0.0f;
+                    for (uint32_t i = 0; i < pool->kernel_h; i++) {
+                        for (uint32_t j = 0; j < pool->kernel_w; j++) {
+                            int32_t h = (int32_t)(oh * pool->stride_h + i) - (int32_t)pool->padding_h;
+                            int32_t w = (int32_t)(ow * pool->stride_w + j) - (int32_t)pool->padding_w;
+                            if (h < 0 || w < 0 || h >= input->shape[2] || w >= input->shape[3]) continue;
+                            float v = input->data[tensor_convert_nd_to_1d_index(input, (uint32_t[]){n, c, h, w})].float32;
+                            if (is_max) result = (v > result) ? v : result;
+                            else result += v;
+                        }
+                    }
+                    if (!is_max) result /= (float)(pool->kernel_h * pool->kernel_w);
+                    output->data[tensor_convert_nd_to_1d_index(output, (uint32_t[]){n, c, oh, ow})].float32 = result;
+                }
+            }
+        }
+    }
+    return output;
+}
+
+static tensor_t *reference_global_avg_pool(tensor_t *input) {
+    tensor_t *output = tensor_create(TENSOR_FLOAT32, 4, (uint32_t[]){input->shape[0], input->shape[1], 1, 1}, (void *)0);
+    for (uint32_t n = 0; n < input->shape[0]; n++) {
+        for (uint32_t c = 0; c < input->shape[1]; c++) {
+            float sum = 0.0f;
+            for (uint32_t h = 0; h < input->shape[2]; h++) {
+                for (uint32_t w = 0; w < input->shape[3]; w++) {
+                    sum += input->data[tensor_convert_nd_to_1d_index(input, (uint32_t[]){n, c, h, w})].float32;
+                }
+            }
+            output->data[n * input->shape[1] + c].float32 = sum / (float)(input->shape[2] * input->shape[3]);
+        }
+    }
+    return output;
+}
+
+static tensor_t *demo_input(uint32_t *shape) {
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, 4, shape, (void *)0);
+    for (uint32_t i = 0; i < input->num_elements; i++) {
+        input->data[i].float32 = (float)((i * 7919) % 1000) / 500.0f - 1.0f;
+    }
+    return input;
+}
+
+static float demo_max_diff(tensor_t *a, tensor_t *b) {
+    float max_diff = 0.0f;
+    for (uint32_t i = 0; i < a->num_elements; i++) {
+        float diff = fabsf(a->data[i].float32 - b->data[i].float32);
+        if (diff > max_diff) max_diff = diff;
+    }
+    return max_diff;
+}
+
+// mode: 0 - max_pool_2d, 1 - avg_pool_2d, 2 - global_avg_pool_2d
+static void demo_pool(const char *name, uint32_t *shape, pool2d_t *pool, int mode) {
+    tensor_t *input = demo_input(shape);
+    clock_t start = clock();
+    tensor_t *expected = (mode == 2) ? reference_global_avg_pool(input) : reference_pool(input, pool, mode == 0);
+    double reference_ms = 1000.0 * (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    tensor_t *output = (mode == 2) ? global_avg_pool_2d(input) : (mode == 0) ? max_pool_2d(input, pool) : avg_pool_2d(input, pool);
+    start = clock();
+    for (int r = 0; r < DEMO_REPEAT; r++) {
+        if (mode == 2) global_avg_pool_2d_out(input, output);
+        else if (mode == 0) max_pool_2d_out(input, pool, output);
+        else avg_pool_2d_out(input, pool, output);
+    }
+    double kernel_ms = 1000.0 * (double)(clock() - start) / CLOCKS_PER_SEC / DEMO_REPEAT;
+
+    printf(">> %s (%d, %d, %d, %d) -> (%d, %d, %d, %d)\r\n", name, shape[0], shape[1], shape[2], shape[3], output->shape[0], output->shape[1], output->shape[2], output->shape[3]);
+    printf(">>   reference %8.3f ms, kernel %8.3f ms, max abs diff %e\r\n", reference_ms, kernel_ms, demo_max_diff(expected, output));
+    tensor_free(input);
+    tensor_free(expected);
+    tensor_free(output);
+}
+
+static void demo_fused_tail(uint32_t *shape) {
+    // BN2d -> ReLU -> global_avg_pool_2d
+    uint32_t channels = shape[1];
+    tensor_t *mean = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *var = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *gamma = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *beta = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    for (int i = 0; i < channels; i++) {
+        mean->data[i].float32 = 0.01f * (i % 7);
+        var->data[i].float32 = 1.0f + 0.01f * (i % 5);
+        gamma->data[i].float32 = 1.0f;
+        beta->data[i].float32 = 0.0f;
+    }
+    executor_t *executor = executor_create();
+    executor_add_batch_norm_2d(executor, batch_norm_create(mean, var, NULL, gamma, beta));
+    executor_add_relu(executor);
+    executor_add_global_avg_pool_2d(executor);
+
+    tensor_t *input = demo_input(shape);
+    tensor_t *outputs[2];
+    double ms[2];
+    uint64_t bytes[2];
+    for (int fusion = 0; fusion < 2; fusion++) {
+        executor_set_fusion(executor, fusion);
+        outputs[fusion] = executor_run(executor, input);
+        clock_t start = clock();
+        for (int r = 0; r < DEMO_REPEAT; r++) {
+            tensor_free(executor_run(executor, input));
+        }
+        ms[fusion] = 1000.0 * (double)(clock() - start) / CLOCKS_PER_SEC / DEMO_REPEAT;
+        bytes[fusion] = executor->activation_bytes;
+    }
+    printf(">> BN2d -> ReLU -> global_avg_pool_2d (%d, %d, %d, %d)\r\n", shape[0], shape[1], shape[2], shape[3]);
+    printf(">>   unfused %8.3f ms (activation bytes %" PRIu64 "), fused %8.3f ms (activation bytes %" PRIu64 "), max abs diff %e\r\n",
+           ms[0], bytes[0], ms[1], bytes[1], demo_max_diff(outputs[0], outputs[1]));
+    tensor_free(outputs[0]);
+    tensor_free(outputs[1]);
+    tensor_free(input);
+    executor_free(executor, 1);
+}
+
+int main() {
+    pool2d_t *stem_pool = pool2d_create(3, 2, 1);  // ResNet stem: MaxPool2d(3, 2, 1)
+    pool2d_t *down_pool = pool2d_create(2, 2, 0);  // ResNet-D shortcut: AvgPool2d(2, 2)
+
+    demo_pool("max_pool_2d(3, 2, 1)", (uint32_t[]){1, 64, 112, 112}, stem_pool, 0);
+    demo_pool("avg_pool_2d(2, 2, 0)", (uint32_t[]){1, 256, 56, 56}, down_pool, 1);
+    demo_pool("global_avg_pool_2d", (uint32_t[]){1, 512, 7, 7}, NULL, 2);
+    demo_pool("global_avg_pool_2d", (uint32_t[]){8, 2048, 7, 7}, NULL, 2);
+    demo_fused_tail((uint32_t[]){8, 2048, 7, 7});
+
+    pool2d_free(stem_pool);
+    pool2d_free(down_pool);
+    tensor_print_global_data_memory();
+    printf(">> Done\r\n");
+    return 0;
+}
@@ -0,0 +1,188 @@
+/*
+    Author: agent
+    Created: 2026.10.19
+
+    Element-wise 연산과 residual add 예제.
+    - NumPy 방식의 broadcasting 결과를 단순한 reference 구현과 비교한다 (transpose된 tensor 포함).
+    - ResNet의 skip connection 크기에서 새로 할당하는 add와 in-place add, thread 수에 따른 latency를 비교한다.
+    - executor에서 residual add를 BN / linear의 epilogue로 fusion했을 때와 하지 않았을 때를 비교한다.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <math.h>
+#include <time.h>
+#include "tensor.h"
+#include "op_linear.h"
+#include "op_norm.h"
+#include "op_elementwise.h"
+#include "executor.h"
+#include "parallel.h"
+
+#define DEMO_REPEAT 10
+
+static double demo_now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void demo_fill(tensor_t *tensor, uint32_t seed) {
+    for (uint32_t i = 0; i < tensor->num_elements; i++) {
+        tensor->data[i].float32 = (float)(((i + seed) * 2654435761u) % 1000) / 500.0f - 1.0f;
+    }
+}
+
+static float demo_max_diff(tensor_t *a, tensor_t *b) {
+    float max_diff = 0.0f;
+    for (uint32_t i = 0; i < a->num_elements; i++) {
+        float diff = fabsf(a->data[i].float32 - b->data[i].float32);
+        if (diff > max_diff) max_diff = diff;
+    }
+    return max_diff;
+}
+
+static void demo_broadcast() {
+    // (2, 3, 4) - (3, 1) and (4, 3)^T - (3, 4), checked against index-by-index loops
+    tensor_t *a = tensor_create(TENSOR_FLOAT32, 3, (uint32_t[]){2, 3, 4}, (void *)0);
+    tensor_t *b = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){3, 1}, (void *)0);
+    demo_fill(a, 1);
+    demo_fill(b, 2);
+    tensor_t *output = elementwise_sub(a, b);
+    float max_diff = 0.0f;
+    for (uint32_t i = 0; i < 2; i++) {
+        for (uint32_t j = 0; j < 3; j++) {
+            for (uint32_t k = 0; k < 4; k++) {
+                float expected = a->data[tensor_convert_nd_to_1d_index(a, (uint32_t[]){i, j, k})].float32 - b->data[j].float32;
+                float diff = fabsf(expected - output->data[tensor_convert_nd_to_1d_index(output, (uint32_t[]){i, j, k})].float32);
+                if (diff > max_diff) max_diff = diff;
+            }
+        }
+    }
+    printf(">> broadcast (2, 3, 4) - (3, 1): max abs diff %e\r\n", max_diff);
+    tensor_free(a);
+    tensor_free(b);
+    tensor_free(output);
+
+    a = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){4, 3}, (void *)0);
+    b = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){3, 4}, (void *)0);
+    demo_fill(a, 3);
+    demo_fill(b, 4);
+    tensor_transpose(a, 0, 1);
+    output = elementwise_max(a, b);
+    max_diff = 0.0f;
+    for (uint32_t i = 0; i < 3; i++) {
+        for (uint32_t j = 0; j < 4; j++) {
+            float va = a->data[tensor_convert_nd_to_1d_index(a, (uint32_t[]){i, j})].float32;
+            float vb = b->data[tensor_convert_nd_to_1d_index(b, (uint32_t[]){i, j})].float32;
+            float diff = fabsf(((va > vb) ? va : vb) - output->data[i * 4 + j].float32);
+            if (diff > max_diff) max_diff = diff;
+        }
+    }
+    printf(">> max((4, 3)^T, (3, 4)): max abs diff %e\r\n", max_diff);
+    tensor_free(a);
+    tensor_free(b);
+    tensor_free(output);
+}
+
+static void demo_skip_connection(uint32_t *shape) {
+    tensor_t *a = tensor_create(TENSOR_FLOAT32, 4, shape, (void *)0);
+    tensor_t *b = tensor_create(TENSOR_FLOAT32, 4, shape, (void *)0);
+    tensor_t *scale = tensor_create(TENSOR_FLOAT32, 4, (uint32_t[]){1, shape[1], 1, 1}, (void *)0);
+    demo_fill(a, 5);
+    demo_fill(b, 6);
+    demo_fill(scale, 7);
+    printf(">> (%d, %d, %d, %d)\r\n", shape[0], shape[1], shape[2], shape[3]);
+
+    uint32_t max_threads = parallel_get_num_threads();
+    for (uint32_t threads = 1; threads <= max_threads; threads *= 2) {
+        parallel_set_num_threads(threads);
+        tensor_t *output = elementwise_add(a, b);
+        double start = demo_now_ms();
+        for (int r = 0; r < DEMO_REPEAT; r++) tensor_free(elementwise_add(a, b));
+        double alloc_ms = (demo_now_ms() - start) / DEMO_REPEAT;
+
+        start = demo_now_ms();
+        for (int r = 0; r < DEMO_REPEAT; r++) elementwise_add_inplace(output, b);
+        double inplace_ms = (demo_now_ms() - start) / DEMO_REPEAT;
+
+        start = demo_now_ms();
+        for (int r = 0; r < DEMO_REPEAT; r++) elementwise_out(ELEMENTWISE_MUL, a, scale, output);
+        double broadcast_ms = (demo_now_ms() - start) / DEMO_REPEAT;
+
+        printf(">>   %2d threads: add %7.3f ms, add in-place %7.3f ms, mul by (1, C, 1, 1) %7.3f ms\r\n", threads, alloc_ms, inplace_ms, broadcast_ms);
+        tensor_free(output);
+    }
+    parallel_set_num_threads(max_threads);
+    tensor_free(a);
+    tensor_free(b);
+    tensor_free(scale);
+}
+
+static batch_norm_t *demo_batch_norm(uint32_t channels) {
+    tensor_t *mean = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *var = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *gamma = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *beta = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    for (int i = 0; i < channels; i++) {
+        mean->data[i].float32 = 0.01f * (i % 7);
+        var->data[i].float32 = 1.0f + 0.01f * (i % 5);
+        gamma->data[i].float32 = 1.0f;
+        beta->data[i].float32 = 0.01f * (i % 3);
+    }
+    return batch_norm_create(mean, var, NULL, gamma, beta);
+}
+
+static void demo_executor(const char *name, executor_t *executor, tensor_t *input) {
+    tensor_t *outputs[2];
+    double ms[2];
+    for (int fusion = 0; fusion < 2; fusion++) {
+        executor_set_fusion(executor, fusion);
+        outputs[fusion] = executor_run(executor, input);
+        double start = demo_now_ms();
+        for (int r = 0; r < DEMO_REPEAT; r++) tensor_free(executor_run(executor, input));
+        ms[fusion] = (demo_now_ms() - start) / DEMO_REPEAT;
+    }
+    printf(">> %s\r\n", name);
+    printf(">>   unfused %8.3f ms, fused %8.3f ms, activation bytes %" PRIu64 " (fused), max abs diff %e\r\n", ms[0], ms[1], executor->activation_bytes, demo_max_diff(outputs[0], outputs[1]));
+    tensor_free(outputs[0]);
+    tensor_free(outputs[1]);
+}
+
+int main() {
+    demo_broadcast();
+    demo_skip_connection((uint32_t[]){8, 64, 56, 56});
+    demo_skip_connection((uint32_t[]){8, 512, 7, 7});
+
+    // BN2d -> (+ input) -> ReLU
+    executor_t *block = executor_create();
+    executor_add_batch_norm_2d(block, demo_batch_norm(64));
+    executor_add_residual(block, -1);
+    executor_add_relu(block);
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, 4, (uint32_t[]){8, 64, 56, 56}, (void *)0);
+    demo_fill(input, 8);
+    demo_executor("BN2d -> residual add -> ReLU (8, 64, 56, 56)", block, input);
+    tensor_free(input);
+    executor_free(block, 1);
+
+    // linear -> BN1d -> (+ input) -> ReLU
+    tensor_t *weight = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){512, 512}, (void *)0);
+    tensor_t *bias = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){512}, (void *)0);
+    demo_fill(weight, 9);
+    demo_fill(bias, 10);
+    block = executor_create();
+    executor_add_linear(block, linear_create(weight, bias));
+    executor_add_batch_norm_1d(block, demo_batch_norm(512));
+    executor_add_residual(block, -1);
+    executor_add_relu(block);
+    input = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){64, 512}, (void *)0);
+    demo_fill(input, 11);
+    demo_executor("linear -> BN1d -> residual add -> ReLU (64, 512)", block, input);
+    tensor_free(input);
+    executor_free(block, 1);
+
+    tensor_print_global_data_memory();
+    printf(">> Done\r\n");
+    return 0;
+}
@@ -0,0 +1,214 @@
+/*
+    Author: agent
+    Created: 2026.10.19
+
+    Classifier head (softmax, argmax, top-k) 예제.
+    - fast_expf의 상대 오차를 libm exp와 비교한다.
+    - softmax / log-softmax를 libm expf를 쓰는 scalar loop와 비교한다 (latency, 최대 오차).
+    - linear 후 logits을 application 코드에서 후처리하는 방식과 fused linear_argmax / linear_topk를 비교한다.
+      class 수 10 ~ 50000, fused 방식은 (batch_size x classes) tensor를 만들지 않으므로 peak memory도 함께 출력한다.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "tensor.h"
+#include "fast_math.h"
+#include "op_linear.h"
+#include "op_softmax.h"
+
+#define DEMO_REPEAT 10
+#define DEMO_BATCH 8
+#define DEMO_FEATURES 256
+#define DEMO_TOPK 5
+
+static double demo_now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void demo_fill(tensor_t *tensor, uint32_t seed, float scale) {
+    for (uint32_t i = 0; i < tensor->num_elements; i++) {
+        tensor->data[i].float32 = ((float)(((i + seed) * 2654435761u) % 1000) / 500.0f - 1.0f) * scale;
+    }
+}
+
+static void demo_exp_error() {
+    double max_rel_error = 0.0;
+    float worst = 0.0f;
+    for (float x = -87.0f; x < 88.5f; x += 0.001f) {
+        double expected = exp((double)x);
+        double rel_error = fabs((double)fast_expf(x) - expected) / expected;
+        if (rel_error > max_rel_error) {
+            max_rel_error = rel_error;
+            worst = x;
+        }
+    }
+    printf(">> fast_expf: max relative error %e (%.2f ULP) at x = %f\r\n", max_rel_error, max_rel_error / ldexp(1.0, -23), worst);
+}
+
+// Application-style post-processing with libm
+static void demo_reference_softmax(tensor_t *logits, tensor_t *output) {
+    const uint32_t rows = logits->shape[0], cols = logits->shape[1];
+    for (uint32_t i = 0; i < rows; i++) {
+        float max = logits->data[i * cols].float32;
+        for (uint32_t j = 1; j < cols; j++) {
+            if (logits->data[i * cols + j].float32 > max) max = logits->data[i * cols + j].float32;
+        }
+        float sum = 0.0f;
+        for (uint32_t j = 0; j < cols; j++) {
+            output->data[i * cols + j].float32 = expf(logits->data[i * cols + j].float32 - max);
+            sum += output->data[i * cols + j].float32;
+        }
+        for (uint32_t j = 0; j < cols; j++) {
+            output->data[i * cols + j].float32 /= sum;
+        }
+    }
+}
+
+static void demo_reference_topk(tensor_t *probs, uint32_t row, int64_t *indices) {
+    // Repeated scans, as the post-processing loops did
+    const uint32_t cols = probs->shape[1];
+    for (uint32_t t = 0; t < DEMO_TOPK; t++) {
+        int64_t best = -1;
+        for (uint32_t j = 0; j < cols; j++) {
+            uint8_t taken = 0;
+            for (uint32_t u = 0; u < t; u++) taken |= (indices[u] == j);
+            if (!taken && (best < 0 || probs->data[row * cols + j].float32 > probs->data[row * cols + best].float32)) best = j;
+        }
+        indices[t] = best;
+    }
+}
+
+static void demo_softmax(uint32_t classes) {
+    tensor_t *logits = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){DEMO_BATCH, classes}, (void *)0);
+    tensor_t *reference = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){DEMO_BATCH, classes}, (void *)0);
+    tensor_t *output = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){DEMO_BATCH, classes}, (void *)0);
+    demo_fill(logits, classes, 20.0f);
+
+    double start = demo_now_ms();
+    for (int r = 0; r < DEMO_REPEAT; r++) demo_reference_softmax(logits, reference);
+    double reference_ms = (demo_now_ms() - start) / DEMO_REPEAT;
+
+    start = demo_now_ms();
+    for (int r = 0; r < DEMO_REPEAT; r++) softmax_out(logits, output);
+    double softmax_ms = (demo_now_ms() - start) / DEMO_REPEAT;
+    float max_diff = 0.0f;
+    for (uint32_t i = 0; i < output->num_elements; i++) {
+        float diff = fabsf(output->data[i].float32 - reference->data[i].float32);
+        if (diff > max_diff) max_diff = diff;
+    }
+
+    start = demo_now_ms();
+    for (int r = 0; r < DEMO_REPEAT; r++) log_softmax_out(logits, output);
+    double log_softmax_ms = (demo_now_ms() - start) / DEMO_REPEAT;
+    float max_log_diff = 0.0f;
+    for (uint32_t i = 0; i < output->num_elements; i++) {
+        if (reference->data[i].float32 < 1e-30f) continue;
+        float diff = fabsf(output->data[i].float32 - logf(reference->data[i].float32));
+        if (diff > max_log_diff) max_log_diff = diff;
+    }
+
+    printf(">>   softmax (%d, %5d): scalar libm %8.3f ms, softmax %8.3f ms (max abs diff %.2e), log_softmax %8.3f ms (max abs diff %.2e)\r\n",
+        DEMO_BATCH, classes, reference_ms, softmax_ms, max_diff, log_softmax_ms, max_log_diff);
+    tensor_free(logits);
+    tensor_free(reference);
+    tensor_free(output);
+}
+
+static void demo_head(uint32_t classes) {
+    tensor_t *weight = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){classes, DEMO_FEATURES}, (void *)0);
+    tensor_t *bias = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){classes}, (void *)0);
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){DEMO_BATCH, DEMO_FEATURES}, (void *)0);
+    demo_fill(weight, 1, 0.1f);
+    demo_fill(bias, 2, 0.1f);
+    demo_fill(input, classes, 1.0f);
+    linear_t *head = linear_create(weight, bias);
+    int64_t reference_indices[DEMO_BATCH][DEMO_TOPK];
+    float reference_probs[DEMO_BATCH][DEMO_TOPK];
+
+    // linear -> softmax -> scan in application code
+    tensor_reset_global_data_peak_memory();
+    uint64_t base_memory = tensor_get_global_data_memory();
+    double start = demo_now_ms();
+    for (int r = 0; r < DEMO_REPEAT; r++) {
+        tensor_t *logits = linear(input, head);
+        tensor_t *probs = tensor_create(TENSOR_FLOAT32, 2, logits->shape, (void *)0);
+        demo_reference_softmax(logits, probs);
+        for (uint32_t i = 0; i < DEMO_BATCH; i++) {
+            demo_reference_topk(probs, i, reference_indices[i]);
+            for (uint32_t t = 0; t < DEMO_TOPK; t++) reference_probs[i][t] = probs->data[i * classes + reference_indices[i][t]].float32;
+        }
+        tensor_free(logits);
+        tensor_free(probs);
+    }
+    double reference_ms = (demo_now_ms() - start) / DEMO_REPEAT;
+    uint64_t reference_peak = tensor_get_global_data_peak_memory() - base_memory;
+
+    // linear -> argmax (op)
+    start = demo_now_ms();
+    for (int r = 0; r < DEMO_REPEAT; r++) {
+        tensor_t *logits = linear(input, head);
+        tensor_free(argmax(logits));
+        tensor_free(logits);
+    }
+    double unfused_argmax_ms = (demo_now_ms() - start) / DEMO_REPEAT;
+
+    // Fused
+    tensor_reset_global_data_peak_memory();
+    tensor_t *indices = linear_argmax(input, head);
+    start = demo_now_ms();
+    for (int r = 0; r < DEMO_REPEAT; r++) tensor_free(linear_argmax(input, head));
+    double argmax_ms = (demo_now_ms() - start) / DEMO_REPEAT;
+    uint32_t argmax_mismatch = 0;
+    for (uint32_t i = 0; i < DEMO_BATCH; i++) argmax_mismatch += (indices->data[i].int64 != reference_indices[i][0]);
+    tensor_free(indices);
+
+    tensor_t *topk_indices;
+    tensor_t *topk_values = linear_topk(input, head, DEMO_TOPK, &topk_indices);
+    uint64_t fused_peak = tensor_get_global_data_peak_memory() - base_memory;
+    tensor_free(topk_values);
+    tensor_free(topk_indices);
+    start = demo_now_ms();
+    for (int r = 0; r < DEMO_REPEAT; r++) {
+        topk_values = linear_topk(input, head, DEMO_TOPK, &topk_indices);
+        if (r + 1 < DEMO_REPEAT) {
+            tensor_free(topk_values);
+            tensor_free(topk_indices);
+        }
+    }
+    double topk_ms = (demo_now_ms() - start) / DEMO_REPEAT;
+    uint32_t topk_mismatch = 0;
+    float max_prob_diff = 0.0f;
+    for (uint32_t i = 0; i < DEMO_BATCH; i++) {
+        for (uint32_t t = 0; t < DEMO_TOPK; t++) {
+            topk_mismatch += (topk_indices->data[i * DEMO_TOPK + t].int64 != reference_indices[i][t]);
+            float diff = fabsf(topk_values->data[i * DEMO_TOPK + t].float32 - reference_probs[i][t]);
+            if (diff > max_prob_diff) max_prob_diff = diff;
+        }
+    }
+    tensor_free(topk_values);
+    tensor_free(topk_indices);
+
+    printf(">>   head (%d, %d) -> %5d: linear+scalar top-%d %8.3f ms (peak %8" PRIu64 " bytes), linear+argmax %8.3f ms, linear_argmax %8.3f ms, linear_topk %8.3f ms (peak %" PRIu64 " bytes)\r\n",
+        DEMO_BATCH, DEMO_FEATURES, classes, DEMO_TOPK, reference_ms, reference_peak, unfused_argmax_ms, argmax_ms, topk_ms, fused_peak);
+    printf(">>     argmax mismatch %d / %d, top-%d index mismatch %d / %d, max prob diff %.2e\r\n",
+        argmax_mismatch, DEMO_BATCH, DEMO_TOPK, topk_mismatch, DEMO_BATCH * DEMO_TOPK, max_prob_diff);
+    linear_free(head, 1);
+    tensor_free(input);
+}
+
+int main() {
+    const uint32_t classes[] = {10, 100, 1000, 10000, 50000};
+    demo_exp_error();
+    for (uint32_t c = 0; c < sizeof(classes) / sizeof(classes[0]); c++) demo_softmax(classes[c]);
+    for (uint32_t c = 0; c < sizeof(classes) / sizeof(classes[0]); c++) demo_head(classes[c]);
+
+    tensor_print_global_data_memory();
+    printf(">> Done\r\n");
+    return 0;
+}
@@ -0,0 +1,217 @@
+/*
+    Author: agent
+    Created: 2026.10.19
+
+    LayerNorm, GroupNorm 예제.
+    - double로 계산한 two-pass reference와 비교한 최대 오차 (평균이 큰 입력 포함).
+      E[x^2] - E[x]^2 방식의 one-pass 계산은 평균이 크면 분산이 크게 틀어지는 것도 함께 출력한다.
+    - float two-pass (mean -> var -> normalize, 3번 읽기) 구현과 single-pass Welford 구현의 latency, thread 수에 따른 latency를 비교한다.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "tensor.h"
+#include "op_norm.h"
+#include "parallel.h"
+
+#define DEMO_REPEAT 5
+
+static double demo_now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void demo_fill(tensor_t *tensor, uint32_t seed, float offset) {
+    for (uint32_t i = 0; i < tensor->num_elements; i++) {
+        tensor->data[i].float32 = offset + (float)(((i + seed) * 2654435761u) % 1000) / 500.0f - 1.0f;
+    }
+}
+
+// Reference: rows of size n, gamma / beta index = (element index / channel_size) % params.
+// double: exact two-pass in double. naive: one pass of sum and sum of squares in float.
+static void demo_reference(tensor_t *input, tensor_t *output, uint32_t n, uint32_t channel_size, uint32_t params, tensor_t *gamma, tensor_t *beta, uint8_t naive) {
+    const uint32_t rows = input->num_elements / n;
+    for (uint32_t r = 0; r < rows; r++) {
+        const tensor_data_t *x = input->data + r * n;
+        double mean = 0.0, var = 0.0;
+        if (naive) {
+            float sum = 0.0f, sum_sq = 0.0f;
+            for (uint32_t j = 0; j < n; j++) {
+                sum += x[j].float32;
+                sum_sq += x[j].float32 * x[j].float32;
+            }
+            mean = sum / n;
+            var = sum_sq / n - (float)mean * (float)mean;
+            if (var < 0.0) var = 0.0;
+        } else {
+            for (uint32_t j = 0; j < n; j++) mean += x[j].float32;
+            mean /= n;
+            for (uint32_t j = 0; j < n; j++) var += (x[j].float32 - mean) * (x[j].float32 - mean);
+            var /= n;
+        }
+        const double rstd = 1.0 / sqrt(var + 1e-5);
+        for (uint32_t j = 0; j < n; j++) {
+            const uint32_t p = (r * n + j) / channel_size % params;
+            output->data[r * n + j].float32 = (float)((x[j].float32 - mean) * rstd * gamma->data[p].float32 + beta->data[p].float32);
+        }
+    }
+}
+
+// Float two-pass implementation: mean pass, variance pass, normalize pass
+static void demo_two_pass(tensor_t *input, tensor_t *output, uint32_t n, uint32_t channel_size, uint32_t params, tensor_t *gamma, tensor_t *beta) {
+    const uint32_t rows = input->num_elements / n;
+    for (uint32_t r = 0; r < rows; r++) {
+        const tensor_data_t *x = input->data + r * n;
+        float mean = 0.0f, var = 0.0f;
+        for (uint32_t j = 0; j < n; j++) mean += x[j].float32;
+        mean /= n;
+        for (uint32_t j = 0; j < n; j++) var += (x[j].float32 - mean) * (x[j].float32 - mean);
+        var /= n;
+        const float rstd = 1.0f / sqrtf(var + 1e-5f);
+        for (uint32_t j = 0; j < n; j++) {
+            const uint32_t p = (r * n + j) / channel_size % params;
+            output->data[r * n + j].float32 = (x[j].float32 - mean) * rstd * gamma->data[p].float32 + beta->data[p].float32;
+        }
+    }
+}
+
+static float demo_max_diff(tensor_t *a, tensor_t *b) {
+    float max_diff = 0.0f;
+    for (uint32_t i = 0; i < a->num_elements; i++) {
+        float diff = fabsf(a->data[i].float32 - b->data[i].float32);
+        if (diff > max_diff) max_diff = diff;
+    }
+    return max_diff;
+}
+
+static tensor_t *demo_param(uint32_t size, uint32_t seed) {
+    tensor_t *param = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){size}, (void *)0);
+    demo_fill(param, seed, 1.0f);
+    return param;
+}
+
+// layer_norm_weight or group_norm_weight is NULL
+static void demo_norm(const char *name, tensor_t *input, layer_norm_t *layer_norm_weight, group_norm_t *group_norm_weight) {
+    uint32_t n, channel_size, params;
+    tensor_t *gamma, *beta;
+    if (layer_norm_weight != (layer_norm_t *) NULL) {
+        n = layer_norm_weight->normalized_size;
+        channel_size = 1;
+        params = n;
+        gamma = layer_norm_weight->gamma;
+        beta = layer_norm_weight->beta;
+    } else {
+        channel_size = input->num_elements / input->shape[0] / input->shape[1];
+        n = group_norm_weight->num_channels / group_norm_weight->num_groups * channel_size;
+        params = group_norm_weight->num_channels;
+        gamma = group_norm_weight->gamma;
+        beta = group_norm_weight->beta;
+    }
+    tensor_t *reference = tensor_create(TENSOR_FLOAT32, input->ndim, input->shape, (void *)0);
+    tensor_t *output = tensor_create(TENSOR_FLOAT32, input->ndim, input->shape, (void *)0);
+    printf(">> %s\r\n", name);
+
+    // Accuracy, with mean 0 and with mean 1000 (std ~0.58)
+    const float offsets[] = {0.0f, 1000.0f};
+    for (int o = 0; o < 2; o++) {
+        demo_fill(input, 3, offsets[o]);
+        demo_reference(input, reference, n, channel_size, params, gamma, beta, 0);
+        if (layer_norm_weight != (layer_norm_t *) NULL) layer_norm_out(input, layer_norm_weight, output);
+        else group_norm_out(input, group_norm_weight, output);
+        float welford_diff = demo_max_diff(output, reference);
+        demo_two_pass(input, output, n, channel_size, params, gamma, beta);
+        float two_pass_diff = demo_max_diff(output, reference);
+        demo_reference(input, output, n, channel_size, params, gamma, beta, 1);
+        float naive_diff = demo_max_diff(output, reference);
+        printf(">>   mean %6.1f: max abs diff to double reference: single-pass Welford %.2e, float two-pass %.2e, float E[x^2]-E[x]^2 %.2e\r\n",
+            offsets[o], welford_diff, two_pass_diff, naive_diff);
+    }
+
+    // Latency
+    demo_fill(input, 3, 0.0f);
+    double start = demo_now_ms();
+    for (int r = 0; r < DEMO_REPEAT; r++) demo_two_pass(input, output, n, channel_size, params, gamma, beta);
+    printf(">>   float two-pass %8.3f ms\r\n", (demo_now_ms() - start) / DEMO_REPEAT);
+    uint32_t max_threads = parallel_get_num_threads();
+    for (uint32_t threads = 1; threads <= max_threads; threads *= 2) {
+        parallel_set_num_threads(threads);
+        start = demo_now_ms();
+        for (int r = 0; r < DEMO_REPEAT; r++) {
+            if (layer_norm_weight != (layer_norm_t *) NULL) layer_norm_out(input, layer_norm_weight, output);
+            else group_norm_out(input, group_norm_weight, output);
+        }
+        double out_ms = (demo_now_ms() - start) / DEMO_REPEAT;
+        start = demo_now_ms();
+        for (int r = 0; r < DEMO_REPEAT; r++) {
+            if (layer_norm_weight != (layer_norm_t *) NULL) layer_norm_out(input, layer_norm_weight, input);
+            else group_norm_out(input, group_norm_weight, input);
+        }
+        double inplace_ms = (demo_now_ms() - start) / DEMO_REPEAT;
+        printf(">>   %2d threads: single-pass %8.3f ms, in-place %8.3f ms\r\n", threads, out_ms, inplace_ms);
+    }
+    parallel_set_num_threads(max_threads);
+    tensor_free(reference);
+    tensor_free(output);
+}
+
+int main() {
+    // LayerNorm(768) of ViT-B tokens (8 x 197 x 768)
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, 3, (uint32_t[]){8, 197, 768}, (void *)0);
+    layer_norm_t *ln = layer_norm_create(768, demo_param(768, 1), demo_param(768, 2), 1e-5f);
+    demo_norm("LayerNorm(768), (8, 197, 768)", input, ln, NULL);
+    layer_norm_free(ln, 1);
+    tensor_free(input);
+
+    // LayerNorm((16, 16)) over the last two axes (64 x 32 x 16 x 16)
+    input = tensor_create(TENSOR_FLOAT32, 4, (uint32_t[]){64, 32, 16, 16}, (void *)0);
+    tensor_t *gamma = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){16, 16}, (void *)0);
+    tensor_t *beta = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){16, 16}, (void *)0);
+    demo_fill(gamma, 4, 1.0f);
+    demo_fill(beta, 5, 0.0f);
+    ln = layer_norm_create(256, gamma, beta, 1e-5f);
+    demo_norm("LayerNorm((16, 16)), (64, 32, 16, 16)", input, ln, NULL);
+    layer_norm_free(ln, 1);
+    tensor_free(input);
+
+    // GroupNorm(32, 256) (8 x 256 x 56 x 56)
+    input = tensor_create(TENSOR_FLOAT32, 4, (uint32_t[]){8, 256, 56, 56}, (void *)0);
+    group_norm_t *gn = group_norm_create(32, 256, demo_param(256, 6), demo_param(256, 7), 1e-5f);
+    demo_norm("GroupNorm(32, 256), (8, 256, 56, 56)", input, NULL, gn);
+    group_norm_free(gn, 1);
+    tensor_free(input);
+
+    // Transposed input: LayerNorm(64) of (64 x 128)^T
+    input = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){64, 128}, (void *)0);
+    demo_fill(input, 8, 3.0f);
+    tensor_transpose(input, 0, 1);
+    ln = layer_norm_create(64, demo_param(64, 9), demo_param(64, 10), 1e-5f);
+    tensor_t *output = layer_norm(input, ln);
+    float max_diff = 0.0f;
+    for (uint32_t i = 0; i < 128; i++) {
+        double mean = 0.0, var = 0.0;
+        for (uint32_t j = 0; j < 64; j++) mean += input->data[tensor_convert_nd_to_1d_index(input, (uint32_t[]){i, j})].float32;
+        mean /= 64;
+        for (uint32_t j = 0; j < 64; j++) {
+            double d = input->data[tensor_convert_nd_to_1d_index(input, (uint32_t[]){i, j})].float32 - mean;
+            var += d * d;
+        }
+        var /= 64;
+        for (uint32_t j = 0; j < 64; j++) {
+            double x = input->data[tensor_convert_nd_to_1d_index(input, (uint32_t[]){i, j})].float32;
+            double expected = (x - mean) / sqrt(var + 1e-5) * ln->gamma->data[j].float32 + ln->beta->data[j].float32;
+            float diff = fabsf((float)expected - output->data[i * 64 + j].float32);
+            if (diff > max_diff) max_diff = diff;
+        }
+    }
+    printf(">> LayerNorm(64), (64, 128)^T: max abs diff %.2e\r\n", max_diff);
+    tensor_free(output);
+    layer_norm_free(ln, 1);
+    tensor_free(input);
+
+    tensor_print_global_data_memory();
+    printf(">> Done\r\n");
+    return 0;
+}
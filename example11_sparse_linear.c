@@ -0,0 +1,152 @@
+/*
+    Author: agent
+    Created: 2026.10.19
+
+    Sparse / block-sparse linear 예제.
+    - density (0.05 ~ 1.0)에 따라 dense linear (autotuner가 고른 kernel)와 CSR, 1x4, 4x4 block-sparse linear의 latency를 비교한다 (SpMV: batch 1, SpMM: batch 32).
+      weight memory는 tensor의 global memory counter로 측정한다.
+    - sparse_calibrate_crossover로 이 machine에서의 crossover density를 측정한다.
+    - 80% pruning된 layer를 dispatcher로 실행하고 dense 결과와 비교한다.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "tensor.h"
+#include "op_linear.h"
+#include "op_sparse.h"
+#include "autotune.h"
+
+#define DEMO_REPEAT 5
+#define DEMO_OUT 1024
+#define DEMO_IN 1024
+
+static double demo_now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void demo_fill(tensor_t *tensor, uint32_t seed) {
+    for (uint32_t i = 0; i < tensor->num_elements; i++) {
+        tensor->data[i].float32 = (float)(((i + seed) * 2654435761u) % 1000) / 500.0f - 1.0f;
+    }
+}
+
+// Zero the weights outside the kept blocks. Block size (block_rows x block_cols), 1x1 is unstructured pruning.
+static void demo_prune(tensor_t *weight, uint32_t block_rows, uint32_t block_cols, float density) {
+    const uint32_t out = weight->shape[0], in = weight->shape[1];
+    for (uint32_t row = 0; row < out; row++) {
+        for (uint32_t col = 0; col < in; col++) {
+            const uint32_t block = (row / block_rows) * ((in + block_cols - 1) / block_cols) + col / block_cols;
+            if (((block * 2654435761u) >> 8) % 1000 >= (uint32_t)(density * 1000.0f)) weight->data[row * in + col].float32 = 0.0f;
+        }
+    }
+}
+
+static float demo_max_diff(tensor_t *a, tensor_t *b) {
+    float max_diff = 0.0f;
+    for (uint32_t i = 0; i < a->num_elements; i++) {
+        float diff = fabsf(a->data[i].float32 - b->data[i].float32);
+        if (diff > max_diff) max_diff = diff;
+    }
+    return max_diff;
+}
+
+static double demo_time(tensor_t *input, linear_t *dense, sparse_linear_t *sparse, tensor_t *output) {
+    double start = demo_now_ms();
+    for (int r = 0; r < DEMO_REPEAT; r++) {
+        if (sparse != (sparse_linear_t *) NULL) sparse_linear_out(input, sparse, output);
+        else linear_tuned_out(input, dense, output);
+    }
+    return (demo_now_ms() - start) / DEMO_REPEAT;
+}
+
+static void demo_sweep(uint32_t batch_size) {
+    const char *names[] = {"CSR", "1x4", "4x4"};
+    const uint32_t block_rows[] = {1, 1, 4};
+    const uint32_t block_cols[] = {1, 4, 4};
+    const float densities[] = {0.05f, 0.1f, 0.2f, 0.3f, 0.5f, 0.7f, 1.0f};
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){batch_size, DEMO_IN}, (void *)0);
+    tensor_t *output = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){batch_size, DEMO_OUT}, (void *)0);
+    tensor_t *reference = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){batch_size, DEMO_OUT}, (void *)0);
+    demo_fill(input, 1);
+    printf(">> (%d x %d) x (%d x %d)^T, %s\r\n", batch_size, DEMO_IN, DEMO_OUT, DEMO_IN, (batch_size == 1) ? "SpMV" : "SpMM");
+
+    for (uint32_t f = 0; f < 3; f++) {
+        for (uint32_t d = 0; d < sizeof(densities) / sizeof(densities[0]); d++) {
+            uint64_t base_memory = tensor_get_global_data_memory();
+            tensor_t *weight = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){DEMO_OUT, DEMO_IN}, (void *)0);
+            tensor_t *bias = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){DEMO_OUT}, (void *)0);
+            demo_fill(weight, 2);
+            demo_fill(bias, 3);
+            demo_prune(weight, block_rows[f], block_cols[f], densities[d]);
+            linear_t *dense = linear_create(weight, bias);
+            uint64_t dense_bytes = tensor_get_global_data_memory() - base_memory;
+
+            base_memory = tensor_get_global_data_memory();
+            sparse_linear_t *sparse = sparse_linear_create(dense, (sparse_format_t)f, 0.0f);
+            uint64_t sparse_bytes = tensor_get_global_data_memory() - base_memory;
+
+            double dense_ms = demo_time(input, dense, NULL, reference);
+            double sparse_ms = demo_time(input, dense, sparse, output);
+            printf(">>   %s density %.2f (stored %.2f): dense %7.3f ms, sparse %7.3f ms (x%5.2f), weight bytes %8lu -> %8lu, max abs diff %.2e\r\n",
+                names[f], densities[d], sparse_linear_density(sparse), dense_ms, sparse_ms, dense_ms / sparse_ms, dense_bytes, sparse_bytes, demo_max_diff(output, reference));
+            sparse_linear_free(sparse);
+            linear_free(dense, 1);
+        }
+    }
+    tensor_free(input);
+    tensor_free(output);
+    tensor_free(reference);
+}
+
+int main() {
+    demo_sweep(1);
+    demo_sweep(32);
+
+    const char *names[] = {"CSR", "1x4", "4x4"};
+    for (uint32_t f = 0; f < 3; f++) {
+        float spmv_default = sparse_get_crossover_density((sparse_format_t)f, 1);
+        float spmm_default = sparse_get_crossover_density((sparse_format_t)f, 32);
+        float spmv = sparse_calibrate_crossover((sparse_format_t)f, DEMO_OUT, DEMO_IN, 1);
+        float spmm = sparse_calibrate_crossover((sparse_format_t)f, DEMO_OUT, DEMO_IN, 32);
+        printf(">> %s crossover density: SpMV default %.2f, measured %.2f / SpMM default %.2f, measured %.2f\r\n", names[f], spmv_default, spmv, spmm_default, spmm);
+        sparse_set_crossover_density((sparse_format_t)f, 1, spmv_default);
+        sparse_set_crossover_density((sparse_format_t)f, 32, spmm_default);
+    }
+
+    // Pruned layer (80% zeros, unstructured) through the dispatcher
+    tensor_t *weight = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){DEMO_OUT, DEMO_IN}, (void *)0);
+    tensor_t *bias = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){DEMO_OUT}, (void *)0);
+    demo_fill(weight, 4);
+    demo_fill(bias, 5);
+    demo_prune(weight, 1, 1, 0.2f);
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){8, DEMO_IN}, (void *)0);
+    demo_fill(input, 6);
+    linear_t *dense = linear_create(weight, bias);
+    tensor_t *reference = linear(input, dense);
+    tensor_t *single = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){1, DEMO_IN}, input->data);   // First row (view)
+    tensor_t *single_reference = linear_out(single, dense, tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){1, DEMO_OUT}, (void *)0));
+    for (uint32_t f = 0; f < 3; f++) {
+        sparse_dispatch_t *dispatch = sparse_dispatch_create(dense, (sparse_format_t)f, 0.0f);
+        tensor_t *output = sparse_dispatch_linear(input, dispatch);
+        tensor_t *single_output = sparse_dispatch_linear(single, dispatch);
+        printf(">> dispatcher %s: density %.2f, SpMV -> %s, SpMM -> %s, max abs diff %.2e, %.2e\r\n", names[f], dispatch->density,
+            dispatch->use_sparse[0] ? "sparse" : "dense", dispatch->use_sparse[1] ? "sparse" : "dense",
+            demo_max_diff(single_output, single_reference), demo_max_diff(output, reference));
+        tensor_free(output);
+        tensor_free(single_output);
+        sparse_dispatch_free(dispatch, 0);
+    }
+    tensor_free(single);
+    tensor_free(single_reference);
+    tensor_free(reference);
+    tensor_free(input);
+    linear_free(dense, 1);
+
+    tensor_print_global_data_memory();
+    printf(">> Done\r\n");
+    return 0;
+}
@@ -0,0 +1,216 @@
+/*
+    Author: agent
+    Created: 2026.10.19
+
+    Ahead-of-time C code generation 예제.
+    - executor로 만든 MLP, pooling 네트워크를 codegen_emit으로 C 파일로 만들고, cc로 compile해서 dlopen으로 불러온다.
+    - interpreter (executor_run, fusion 0 / 1)와 생성된 model_infer의 latency, 결과 차이를 비교한다.
+    - code size (.text), weight (const .rodata), activation buffer 크기를 비교한다.
+      interpreter의 code size는 src의 op, executor, tensor 파일들을 같은 option으로 compile해서 측정한다.
+    생성 파일과 object는 DEMO_DIR에 쓰고, repository root에서 실행한다. (Linux, cc와 size가 필요)
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <dlfcn.h>
+#include "tensor.h"
+#include "op_linear.h"
+#include "op_norm.h"
+#include "op_pool.h"
+#include "executor.h"
+#include "codegen.h"
+
+#define DEMO_REPEAT 200
+#define DEMO_DIR "/tmp"
+#define DEMO_CC "cc -O2"
+
+typedef void (*demo_infer_t)(const float *input, float *output);
+
+static double demo_now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void demo_fill(tensor_t *tensor, uint32_t seed, float scale) {
+    for (uint32_t i = 0; i < tensor->num_elements; i++) {
+        tensor->data[i].float32 = scale * ((float)(((i + seed) * 2654435761u) % 1000) / 500.0f - 1.0f);
+    }
+}
+
+static batch_norm_t *demo_batch_norm(uint32_t channels) {
+    tensor_t *mean = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *var = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *gamma = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *beta = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    for (int i = 0; i < channels; i++) {
+        mean->data[i].float32 = 0.01f * (i % 7);
+        var->data[i].float32 = 1.0f + 0.01f * (i % 5);
+        gamma->data[i].float32 = 1.0f - 0.001f * (i % 11);
+        beta->data[i].float32 = 0.02f * (i % 3) - 0.01f;
+    }
+    return batch_norm_create(mean, var, NULL, gamma, beta);
+}
+
+static linear_t *demo_linear(uint32_t in_features, uint32_t out_features, uint32_t seed) {
+    tensor_t *weight = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){out_features, in_features}, (void *)0);
+    tensor_t *bias = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){out_features}, (void *)0);
+    demo_fill(weight, seed, 2.0f / sqrtf((float)in_features));
+    demo_fill(bias, seed + 1, 0.1f);
+    return linear_create(weight, bias);
+}
+
+// .text and .rodata bytes of an object file, from "size -A". Returns -1 if size failed.
+static int demo_section_size(const char *object, uint64_t *text, uint64_t *rodata) {
+    char command[512], line[256], section[128];
+    unsigned long bytes;
+    snprintf(command, sizeof(command), "size -A %s", object);
+    FILE *pipe = popen(command, "r");
+    if (pipe == (FILE *) NULL) return -1;
+    *text = 0;
+    *rodata = 0;
+    int found = 0;
+    while (fgets(line, sizeof(line), pipe) != NULL) {
+        if (sscanf(line, "%127s %lu", section, &bytes) != 2) continue;
+        if (strncmp(section, ".text", 5) == 0) { *text += bytes; found = 1; }
+        if (strncmp(section, ".rodata", 7) == 0) *rodata += bytes;
+    }
+    return (pclose(pipe) == 0 && found) ? 0 : -1;
+}
+
+static void demo_interpreter_size() {
+    const char *sources[] = {"tensor", "op_linear", "op_norm", "op_activation", "op_pool", "op_elementwise", "executor", "parallel"};
+    uint64_t total = 0;
+    for (int i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+        char command[512], object[256];
+        uint64_t text, rodata;
+        snprintf(object, sizeof(object), "%s/res_c_%s.o", DEMO_DIR, sources[i]);
+        snprintf(command, sizeof(command), "%s -Iinc -c src/%s.c -o %s", DEMO_CC, sources[i], object);
+        if (system(command) != 0 || demo_section_size(object, &text, &rodata) != 0) {
+            printf(">> interpreter code size: skipped (run from the repository root)\r\n");
+            return;
+        }
+        total += text;
+    }
+    printf(">> interpreter code size (.text of tensor, op_*, executor, parallel): %" PRIu64 " bytes\r\n", total);
+}
+
+static void demo_compare(const char *name, executor_t *executor, uint32_t ndim, uint32_t *shape) {
+    char path[256], object[256], library[256], command[1024];
+    codegen_info_t info;
+    printf(">> %s, input ", name);
+    for (uint32_t i = 0; i < ndim; i++) printf((i == 0) ? "(%d" : " x %d", shape[i]);
+    printf(")\r\n");
+
+    // Generate and compile
+    snprintf(path, sizeof(path), "%s/res_c_%s.c", DEMO_DIR, name);
+    snprintf(object, sizeof(object), "%s/res_c_%s.o", DEMO_DIR, name);
+    snprintf(library, sizeof(library), "%s/res_c_%s.so", DEMO_DIR, name);
+    double start = demo_now_ms();
+    if (codegen_emit_file(executor, ndim, shape, name, path, &info) != 0) return;
+    double generate_ms = demo_now_ms() - start;
+    const int length = snprintf(command, sizeof(command), "%s -fPIC -c %s -o %s && %s -shared %s -o %s", DEMO_CC, path, object, DEMO_CC, object, library);
+    if (length < 0 || length >= (int)sizeof(command)) {
+        printf(">>   compile command is too long\r\n");
+        return;
+    }
+    start = demo_now_ms();
+    if (system(command) != 0) {
+        printf(">>   compile failed: %s\r\n", command);
+        return;
+    }
+    double compile_ms = demo_now_ms() - start;
+    void *handle = dlopen(library, RTLD_NOW);
+    char symbol[64];
+    snprintf(symbol, sizeof(symbol), "%s_infer", name);
+    demo_infer_t infer = (handle != NULL) ? (demo_infer_t)dlsym(handle, symbol) : NULL;
+    if (infer == NULL) {
+        printf(">>   dlopen failed: %s\r\n", dlerror());
+        if (handle != NULL) dlclose(handle);
+        return;
+    }
+    printf(">>   %s: %d kernels, generated in %.1f ms, compiled in %.1f ms\r\n", path, info.num_kernels, generate_ms, compile_ms);
+
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, ndim, shape, (void *)0);
+    demo_fill(input, 7, 1.0f);
+    float *x = (float *)malloc(info.input_size * sizeof(float));
+    float *y = (float *)malloc(info.output_size * sizeof(float));
+    for (uint32_t i = 0; i < info.input_size; i++) x[i] = input->data[i].float32;
+
+    // Interpreter
+    tensor_t *reference = (tensor_t *) NULL;
+    for (int fusion = 0; fusion < 2; fusion++) {
+        executor_set_fusion(executor, fusion);
+        tensor_t *output = executor_run(executor, input);   // Warm up
+        start = demo_now_ms();
+        for (int r = 0; r < DEMO_REPEAT; r++) tensor_free(executor_run(executor, input));
+        printf(">>   interpreter (fusion %d): %8.4f ms, activation bytes written %" PRIu64 "\r\n", fusion, (demo_now_ms() - start) / DEMO_REPEAT, executor->activation_bytes);
+        if (fusion == 0) reference = output;
+        else tensor_free(output);
+    }
+
+    // Generated
+    infer(x, y);
+    start = demo_now_ms();
+    for (int r = 0; r < DEMO_REPEAT; r++) infer(x, y);
+    double generated_ms = (demo_now_ms() - start) / DEMO_REPEAT;
+    float max_diff = 0.0f;
+    for (uint32_t i = 0; i < info.output_size; i++) {
+        float diff = fabsf(y[i] - reference->data[i].float32);
+        if (diff > max_diff) max_diff = diff;
+    }
+    printf(">>   generated            : %8.4f ms, static activation buffer %" PRIu64 " bytes, max abs diff %.2e\r\n", generated_ms, info.activation_bytes, max_diff);
+
+    uint64_t text, rodata;
+    if (demo_section_size(object, &text, &rodata) == 0) {
+        printf(">>   generated code size %" PRIu64 " bytes (.text), const weights %" PRIu64 " bytes (.rodata %" PRIu64 ")\r\n", text, info.weight_bytes, rodata);
+    }
+
+    dlclose(handle);
+    free(x);
+    free(y);
+    tensor_free(reference);
+    tensor_free(input);
+}
+
+int main() {
+    // MLP: linear -> BN1d -> ReLU -> linear -> ReLU -> (+ output of layer 2) -> linear
+    executor_t *mlp = executor_create();
+    executor_add_linear(mlp, demo_linear(784, 512, 1));
+    executor_add_batch_norm_1d(mlp, demo_batch_norm(512));
+    executor_add_relu(mlp);
+    executor_add_linear(mlp, demo_linear(512, 512, 3));
+    executor_add_relu(mlp);
+    executor_add_residual(mlp, 2);
+    executor_add_linear(mlp, demo_linear(512, 10, 5));
+    demo_compare("mlp", mlp, 2, (uint32_t[]){1, 784});
+    demo_compare("mlp_batch8", mlp, 2, (uint32_t[]){8, 784});
+    executor_free(mlp, 1);
+
+    // Pooling network: BN2d -> ReLU -> MaxPool(2) -> BN2d -> ReLU -> AvgPool(3, 1, 1) -> (+ output of layer 4)
+    //                  -> global average pool -> flatten -> linear
+    executor_t *net = executor_create();
+    executor_add_batch_norm_2d(net, demo_batch_norm(32));
+    executor_add_relu(net);
+    executor_add_max_pool_2d(net, pool2d_create(2, 2, 0));
+    executor_add_batch_norm_2d(net, demo_batch_norm(32));
+    executor_add_relu(net);
+    executor_add_avg_pool_2d(net, pool2d_create(3, 1, 1));
+    executor_add_residual(net, 4);
+    executor_add_global_avg_pool_2d(net);
+    executor_add_flatten(net);
+    executor_add_linear(net, demo_linear(32, 10, 7));
+    demo_compare("pool_net", net, 4, (uint32_t[]){1, 32, 64, 64});
+    executor_free(net, 1);
+
+    demo_interpreter_size();
+
+    tensor_print_global_data_memory();
+    printf(">> Done\r\n");
+    return 0;
+}
@@ -0,0 +1,142 @@
+/*
+    Author: agent
+    Created: 2026.10.19
+
+    Autotuner 예제.
+    - 여러 linear shape을 AUTOTUNE_ON으로 tuning하고 (후보: direct, GEMV, 2 / 4 / 8 row tile x thread 수), tuning 시간을 출력한다.
+    - 기본 linear_out, heuristic, tuning된 configuration의 latency와 speedup을 비교한다.
+    - cache를 파일로 저장하고 다시 불러온 뒤 (다음 실행과 같음) AUTOTUNE_CACHED로 실행해서 cache hit rate를 출력한다.
+      cache에 없는 shape은 heuristic을 사용한다.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "tensor.h"
+#include "op_linear.h"
+#include "autotune.h"
+#include "parallel.h"
+
+#define DEMO_REPEAT 10
+#define DEMO_CACHE "/tmp/res_c_autotune.txt"
+
+static double demo_now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void demo_fill(tensor_t *tensor, uint32_t seed) {
+    for (uint32_t i = 0; i < tensor->num_elements; i++) {
+        tensor->data[i].float32 = (float)(((i + seed) * 2654435761u) % 1000) / 500.0f - 1.0f;
+    }
+}
+
+static float demo_max_diff(tensor_t *a, tensor_t *b) {
+    float max_diff = 0.0f;
+    for (uint32_t i = 0; i < a->num_elements; i++) {
+        float diff = fabsf(a->data[i].float32 - b->data[i].float32);
+        if (diff > max_diff) max_diff = diff;
+    }
+    return max_diff;
+}
+
+static const char *demo_config_name(linear_config_t config, char *buffer, size_t size) {
+    const char *names[] = {"direct", "gemv", "tiled"};
+    if (config.algo == LINEAR_ALGO_TILED) snprintf(buffer, size, "%s %d, %d threads", names[config.algo], config.tile_rows, config.threads);
+    else snprintf(buffer, size, "%s, %d threads", names[config.algo], config.threads);
+    return buffer;
+}
+
+// default: config is NULL, linear_out
+static double demo_time(tensor_t *input, linear_t *linear_weight, tensor_t *output, linear_config_t *config) {
+    double start = demo_now_ms();
+    for (int r = 0; r < DEMO_REPEAT; r++) {
+        if (config == (linear_config_t *) NULL) linear_out(input, linear_weight, output);
+        else linear_out_config(input, linear_weight, output, config);
+    }
+    return (demo_now_ms() - start) / DEMO_REPEAT;
+}
+
+typedef struct {
+    tensor_t *input;
+    linear_t *linear_weight;
+    tensor_t *output;
+} demo_layer_t;
+
+static demo_layer_t demo_layer(uint32_t batch_size, uint32_t in_features, uint32_t out_features, uint32_t seed) {
+    demo_layer_t layer;
+    layer.input = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){batch_size, in_features}, (void *)0);
+    tensor_t *weight = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){out_features, in_features}, (void *)0);
+    tensor_t *bias = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){out_features}, (void *)0);
+    demo_fill(layer.input, seed);
+    demo_fill(weight, seed + 1);
+    demo_fill(bias, seed + 2);
+    layer.linear_weight = linear_create(weight, bias);
+    layer.output = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){batch_size, out_features}, (void *)0);
+    return layer;
+}
+
+static void demo_layer_free(demo_layer_t *layer) {
+    tensor_free(layer->input);
+    tensor_free(layer->output);
+    linear_free(layer->linear_weight, 1);
+}
+
+static void demo_print_stats(const char *name) {
+    autotune_stats_t stats;
+    autotune_get_stats(&stats);
+    printf(">> %s: lookups %d, cache hits %d (%.0f%%), tuned %d keys (%d candidates) in %.1f ms\r\n", name, stats.lookups, stats.hits,
+        (stats.lookups > 0) ? 100.0 * stats.hits / stats.lookups : 0.0, stats.tuned, stats.candidates, stats.tuning_ms);
+}
+
+int main() {
+    // (batch_size, in_features, out_features)
+    const uint32_t shapes[][3] = {{1, 784, 512}, {1, 4096, 1024}, {4, 512, 512}, {8, 784, 512}, {32, 512, 512}, {64, 256, 1000}, {3, 1000, 10}};
+    const uint32_t num_shapes = sizeof(shapes) / sizeof(shapes[0]);
+    char name[64];
+    printf(">> %d threads\r\n", parallel_get_num_threads());
+
+    // First run: tune every shape
+    remove(DEMO_CACHE);
+    printf(">> cache entries loaded from %s: %d\r\n", DEMO_CACHE, autotune_load(DEMO_CACHE));
+    autotune_set_mode(AUTOTUNE_ON);
+    autotune_reset_stats();
+    for (uint32_t s = 0; s < num_shapes; s++) {
+        demo_layer_t layer = demo_layer(shapes[s][0], shapes[s][1], shapes[s][2], s);
+        tensor_t *reference = linear(layer.input, layer.linear_weight);
+        linear_tuned_out(layer.input, layer.linear_weight, layer.output);
+        linear_config_t tuned = autotune_linear_config(layer.input, layer.linear_weight, layer.output);
+        linear_config_t heuristic = autotune_linear_heuristic(shapes[s][0], shapes[s][1], shapes[s][2]);
+
+        double default_ms = demo_time(layer.input, layer.linear_weight, layer.output, NULL);
+        double heuristic_ms = demo_time(layer.input, layer.linear_weight, layer.output, &heuristic);
+        double tuned_ms = demo_time(layer.input, layer.linear_weight, layer.output, &tuned);
+        printf(">> (%3d x %4d) x (%4d x %4d)^T: default %8.3f ms, heuristic %8.3f ms (x%5.2f, %s)\r\n", shapes[s][0], shapes[s][1], shapes[s][2], shapes[s][1],
+            default_ms, heuristic_ms, default_ms / heuristic_ms, demo_config_name(heuristic, name, sizeof(name)));
+        printf(">>                                 tuned   %8.3f ms (x%5.2f, %s), max abs diff %.2e\r\n",
+            tuned_ms, default_ms / tuned_ms, demo_config_name(tuned, name, sizeof(name)), demo_max_diff(layer.output, reference));
+        tensor_free(reference);
+        demo_layer_free(&layer);
+    }
+    demo_print_stats("first run (AUTOTUNE_ON)");
+    autotune_save(DEMO_CACHE);
+
+    // Next run: the cache is loaded at startup, nothing is tuned. The last shape is not in the cache (heuristic).
+    autotune_clear();
+    printf(">> cache entries loaded from %s: %d\r\n", DEMO_CACHE, autotune_load(DEMO_CACHE));
+    autotune_set_mode(AUTOTUNE_CACHED);
+    autotune_reset_stats();
+    for (uint32_t s = 0; s <= num_shapes; s++) {
+        demo_layer_t layer = (s < num_shapes) ? demo_layer(shapes[s][0], shapes[s][1], shapes[s][2], s) : demo_layer(16, 300, 200, s);
+        for (int r = 0; r < DEMO_REPEAT; r++) linear_tuned_out(layer.input, layer.linear_weight, layer.output);
+        demo_layer_free(&layer);
+    }
+    demo_print_stats("next run (AUTOTUNE_CACHED, one shape not in the cache)");
+
+    linear_free_pack();
+    tensor_print_global_data_memory();
+    printf(">> Done\r\n");
+    return 0;
+}
@@ -0,0 +1,189 @@
+/*
+    Author: agent
+    Created: 2026.10.19
+
+    Shared model 예제.
+    - 하나의 model (weight 1벌)을 N개의 thread가 각자의 session으로 동시에 실행한다. (N = 1, 2, 4, 8)
+    - thread마다 weight를 복사한 executor를 실행하는 경우와 throughput (inferences/s), memory (weight + activation)를 비교한다.
+    - session의 결과가 executor_run과 같은지 확인하고, model을 먼저 release해도 session이 끝날 때까지 model이 유지되는지 확인한다.
+    op 내부의 parallel_for는 1 thread로 두고, 병렬성은 session 단위로만 사용한다.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include "tensor.h"
+#include "op_linear.h"
+#include "op_norm.h"
+#include "executor.h"
+#include "model.h"
+#include "parallel.h"
+
+#define DEMO_REPEAT 200
+#define DEMO_MAX_THREADS 8
+#define DEMO_BATCH 4
+
+static double demo_now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void demo_fill(tensor_t *tensor, uint32_t seed, float scale) {
+    for (uint32_t i = 0; i < tensor->num_elements; i++) {
+        tensor->data[i].float32 = scale * ((float)(((i + seed) * 2654435761u) % 1000) / 500.0f - 1.0f);
+    }
+}
+
+static batch_norm_t *demo_batch_norm(uint32_t channels) {
+    tensor_t *mean = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *var = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *gamma = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *beta = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    for (int i = 0; i < channels; i++) {
+        mean->data[i].float32 = 0.01f * (i % 7);
+        var->data[i].float32 = 1.0f + 0.01f * (i % 5);
+        gamma->data[i].float32 = 1.0f - 0.001f * (i % 11);
+        beta->data[i].float32 = 0.02f * (i % 3) - 0.01f;
+    }
+    return batch_norm_create(mean, var, NULL, gamma, beta);
+}
+
+static linear_t *demo_linear(uint32_t in_features, uint32_t out_features, uint32_t seed) {
+    tensor_t *weight = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){out_features, in_features}, (void *)0);
+    tensor_t *bias = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){out_features}, (void *)0);
+    demo_fill(weight, seed, 2.0f / sqrtf((float)in_features));
+    demo_fill(bias, seed + 1, 0.1f);
+    return linear_create(weight, bias);
+}
+
+// MLP: linear -> BN1d -> ReLU -> linear -> ReLU -> (+ output of layer 2) -> linear, fused
+static executor_t *demo_mlp() {
+    executor_t *executor = executor_create();
+    executor_add_linear(executor, demo_linear(784, 1024, 1));
+    executor_add_batch_norm_1d(executor, demo_batch_norm(1024));
+    executor_add_relu(executor);
+    executor_add_linear(executor, demo_linear(1024, 1024, 3));
+    executor_add_relu(executor);
+    executor_add_residual(executor, 2);
+    executor_add_linear(executor, demo_linear(1024, 10, 5));
+    executor_set_fusion(executor, 1);
+    return executor;
+}
+
+typedef struct {
+    session_t *session;     // Shared: session of the model
+    executor_t *executor;   // Copies: executor of the thread
+    tensor_t *input;
+    uint32_t failures;
+} demo_worker_t;
+
+static void *demo_worker(void *arg) {
+    demo_worker_t *worker = (demo_worker_t *)arg;
+    for (int r = 0; r < DEMO_REPEAT; r++) {
+        if (worker->session != (session_t *) NULL) {
+            if (session_run(worker->session, worker->input) == (tensor_t *) NULL) worker->failures++;
+        } else {
+            tensor_t *output = executor_run(worker->executor, worker->input);
+            if (output == (tensor_t *) NULL) worker->failures++;
+            else tensor_free(output);
+        }
+    }
+    return NULL;
+}
+
+// Run the workers on their own threads. Returns inferences per second.
+static double demo_run_threads(demo_worker_t *workers, uint32_t num_threads) {
+    pthread_t threads[DEMO_MAX_THREADS];
+    double start = demo_now_ms();
+    for (uint32_t t = 0; t < num_threads; t++) pthread_create(&threads[t], NULL, demo_worker, &workers[t]);
+    for (uint32_t t = 0; t < num_threads; t++) pthread_join(threads[t], NULL);
+    double elapsed_ms = demo_now_ms() - start;
+    return (double)num_threads * DEMO_REPEAT * DEMO_BATCH * 1000.0 / elapsed_ms;
+}
+
+static void demo_shared(uint32_t num_threads, tensor_t *input) {
+    // One model, a session per thread
+    uint64_t base = tensor_get_global_data_memory();
+    model_t *model = model_create(demo_mlp(), 1);
+    uint64_t weight_bytes = tensor_get_global_data_memory() - base;
+    demo_worker_t workers[DEMO_MAX_THREADS];
+    for (uint32_t t = 0; t < num_threads; t++) {
+        workers[t].session = session_create(model, input->ndim, input->shape);
+        workers[t].executor = (executor_t *) NULL;
+        workers[t].input = input;
+        workers[t].failures = 0;
+    }
+    uint64_t activation_bytes = tensor_get_global_data_memory() - base - weight_bytes;
+    model_release(model);   // The sessions keep the model alive
+
+    tensor_reset_global_data_peak_memory();
+    double throughput = demo_run_threads(workers, num_threads);
+    uint64_t peak = tensor_get_global_data_peak_memory() - base;
+    uint32_t failures = 0;
+    for (uint32_t t = 0; t < num_threads; t++) {
+        failures += workers[t].failures;
+        session_free(workers[t].session);
+    }
+    printf(">> %d threads, shared model: %8.0f inferences/s, weights %8lu bytes (x1), session buffers %7lu bytes, peak %8lu bytes, failures %d\r\n",
+        num_threads, throughput, weight_bytes, activation_bytes, peak, failures);
+}
+
+static void demo_copies(uint32_t num_threads, tensor_t *input) {
+    // A copy of the weights per thread, executor_run
+    uint64_t base = tensor_get_global_data_memory();
+    demo_worker_t workers[DEMO_MAX_THREADS];
+    for (uint32_t t = 0; t < num_threads; t++) {
+        workers[t].session = (session_t *) NULL;
+        workers[t].executor = demo_mlp();
+        executor_prepare(workers[t].executor);
+        workers[t].input = input;
+        workers[t].failures = 0;
+    }
+    uint64_t weight_bytes = tensor_get_global_data_memory() - base;
+
+    tensor_reset_global_data_peak_memory();
+    double throughput = demo_run_threads(workers, num_threads);
+    uint64_t peak = tensor_get_global_data_peak_memory() - base;
+    uint32_t failures = 0;
+    for (uint32_t t = 0; t < num_threads; t++) {
+        failures += workers[t].failures;
+        executor_free(workers[t].executor, 1);
+    }
+    printf(">> %d threads, weight copies: %8.0f inferences/s, weights %8lu bytes (x%d), peak %8lu bytes, failures %d\r\n",
+        num_threads, throughput, weight_bytes, num_threads, peak, failures);
+}
+
+int main() {
+    parallel_set_num_threads(1);
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){DEMO_BATCH, 784}, (void *)0);
+    demo_fill(input, 7, 1.0f);
+
+    // Session output vs executor_run
+    model_t *model = model_create(demo_mlp(), 1);
+    session_t *session = session_create(model, input->ndim, input->shape);
+    tensor_t *reference = executor_run(model->executor, input);     // Single thread, before the model is shared
+    tensor_t *output = session_run(session, input);
+    float max_diff = 0.0f;
+    for (uint32_t i = 0; i < reference->num_elements; i++) {
+        float diff = fabsf(output->data[i].float32 - reference->data[i].float32);
+        if (diff > max_diff) max_diff = diff;
+    }
+    printf(">> session vs executor_run: max abs diff %.2e, %d groups, refcount %d\r\n", max_diff, model->executor->num_groups, model_get_refcount(model));
+    tensor_free(reference);
+    model_release(model);
+    printf(">> after model_release: refcount %d (held by the session)\r\n", model_get_refcount(session->model));
+    session_free(session);
+
+    for (uint32_t num_threads = 1; num_threads <= DEMO_MAX_THREADS; num_threads *= 2) {
+        demo_shared(num_threads, input);
+        demo_copies(num_threads, input);
+    }
+
+    tensor_free(input);
+    tensor_print_global_data_memory();
+    printf(">> Done\r\n");
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*
+    Author: agent
+    Created: 2026.10.19
+
+    Layer pipeline 예제.
+    - sensor frame stream을 가정한 네트워크 (BN2d, ReLU, pooling, residual, linear)를 stage 1 / 2 / 3 / 4개의 pipeline으로 실행한다.
+    - 측정한 group별 cost로 나눈 stage (group 범위, cost, core)를 출력한다.
+    - single thread (session_run)와 frames per second, frame latency (push부터 pop까지, 평균 / 최대)를 비교하고,
+      결과가 single thread와 같은지 확인한다.
+    한 thread가 frame을 push하고, main thread가 pop한다. op 내부의 parallel_for는 1 thread로 둔다.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "tensor.h"
+#include "op_linear.h"
+#include "op_norm.h"
+#include "op_pool.h"
+#include "executor.h"
+#include "model.h"
+#include "pipeline.h"
+#include "parallel.h"
+
+#define DEMO_FRAMES 200
+#define DEMO_CHANNELS 16
+#define DEMO_SIZE 64
+
+static double demo_now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void demo_fill(tensor_t *tensor, uint32_t seed, float scale) {
+    for (uint32_t i = 0; i < tensor->num_elements; i++) {
+        tensor->data[i].float32 = scale * ((float)(((i + seed) * 2654435761u) % 1000) / 500.0f - 1.0f);
+    }
+}
+
+static batch_norm_t *demo_batch_norm(uint32_t channels) {
+    tensor_t *mean = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *var = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *gamma = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *beta = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    for (int i = 0; i < channels; i++) {
+        mean->data[i].float32 = 0.01f * (i % 7);
+        var->data[i].float32 = 1.0f + 0.01f * (i % 5);
+        gamma->data[i].float32 = 1.0f - 0.001f * (i % 11);
+        beta->data[i].float32 = 0.02f * (i % 3) - 0.01f;
+    }
+    return batch_norm_create(mean, var, NULL, gamma, beta);
+}
+
+static linear_t *demo_linear(uint32_t in_features, uint32_t out_features, uint32_t seed) {
+    tensor_t *weight = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){out_features, in_features}, (void *)0);
+    tensor_t *bias = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){out_features}, (void *)0);
+    demo_fill(weight, seed, 2.0f / sqrtf((float)in_features));
+    demo_fill(bias, seed + 1, 0.1f);
+    return linear_create(weight, bias);
+}
+
+// BN2d -> ReLU -> MaxPool(2) -> BN2d -> ReLU -> AvgPool(3, 1, 1) -> (+ output of layer 4) -> flatten
+// -> linear -> ReLU -> linear -> ReLU -> linear. Without fusion, every layer is a group.
+static executor_t *demo_net() {
+    const uint32_t features = DEMO_CHANNELS * (DEMO_SIZE / 2) * (DEMO_SIZE / 2);
+    executor_t *executor = executor_create();
+    executor_add_batch_norm_2d(executor, demo_batch_norm(DEMO_CHANNELS));
+    executor_add_relu(executor);
+    executor_add_max_pool_2d(executor, pool2d_create(2, 2, 0));
+    executor_add_batch_norm_2d(executor, demo_batch_norm(DEMO_CHANNELS));
+    executor_add_relu(executor);
+    executor_add_avg_pool_2d(executor, pool2d_create(3, 1, 1));
+    executor_add_residual(executor, 4);
+    executor_add_flatten(executor);
+    executor_add_linear(executor, demo_linear(features, 256, 1));
+    executor_add_relu(executor);
+    executor_add_linear(executor, demo_linear(256, 256, 3));
+    executor_add_relu(executor);
+    executor_add_linear(executor, demo_linear(256, 10, 5));
+    return executor;
+}
+
+typedef struct {
+    pipeline_t *pipeline;
+    tensor_t **frames;
+    double *push_ms;        // Time each frame was pushed (with the wait for a free slot)
+} demo_producer_t;
+
+static void *demo_producer(void *arg) {
+    demo_producer_t *producer = (demo_producer_t *)arg;
+    for (int i = 0; i < DEMO_FRAMES; i++) {
+        producer->push_ms[i] = demo_now_ms();
+        pipeline_push(producer->pipeline, producer->frames[i % 4]);
+    }
+    return NULL;
+}
+
+int main() {
+    parallel_set_num_threads(1);
+    const uint32_t shape[4] = {1, DEMO_CHANNELS, DEMO_SIZE, DEMO_SIZE};
+    tensor_t *frames[4];
+    for (int i = 0; i < 4; i++) {
+        frames[i] = tensor_create(TENSOR_FLOAT32, 4, (uint32_t *)shape, (void *)0);
+        demo_fill(frames[i], 11 * i + 7, 1.0f);
+    }
+    model_t *model = model_create(demo_net(), 1);
+    printf(">> %d groups, %d cores\r\n", model->executor->num_groups, (int)sysconf(_SC_NPROCESSORS_ONLN));
+
+    // Single thread
+    session_t *session = session_create(model, 4, (uint32_t *)shape);
+    tensor_t *references[4];
+    for (int i = 0; i < 4; i++) {
+        tensor_t *output = session_run(session, frames[i]);
+        references[i] = tensor_create(TENSOR_FLOAT32, output->ndim, output->shape, (void *)0);
+        tensor_data_set(references[i], output->data);
+    }
+    double start = demo_now_ms();
+    for (int i = 0; i < DEMO_FRAMES; i++) session_run(session, frames[i % 4]);
+    double single_ms = (demo_now_ms() - start) / DEMO_FRAMES;
+    printf(">> single thread   : %7.1f frames/s, latency %.3f ms\r\n", 1000.0 / single_ms, single_ms);
+    session_free(session);
+
+    tensor_t *output = tensor_create(TENSOR_FLOAT32, references[0]->ndim, references[0]->shape, (void *)0);
+    double push_ms[DEMO_FRAMES];
+    for (uint32_t num_stages = 1; num_stages <= 4; num_stages++) {
+        pipeline_t *pipeline = pipeline_create(model, 4, (uint32_t *)shape, num_stages, 2 * num_stages);
+        if (pipeline == (pipeline_t *) NULL) break;
+        for (uint32_t s = 0; s < pipeline->num_stages; s++) {
+            pipeline_stage_t *stage = &pipeline->stages[s];
+            printf(">>   stage %d: groups [%2d, %2d), cost %.3f ms, core %d\r\n", s, stage->first, stage->end, stage->cost_ms, stage->core);
+        }
+
+        demo_producer_t producer = {pipeline, frames, push_ms};
+        pthread_t thread;
+        start = demo_now_ms();
+        pthread_create(&thread, NULL, demo_producer, &producer);
+        double latency_sum = 0.0, latency_max = 0.0;
+        float max_diff = 0.0f;
+        for (int i = 0; i < DEMO_FRAMES; i++) {
+            pipeline_pop(pipeline, output);
+            double latency = demo_now_ms() - push_ms[i];
+            latency_sum += latency;
+            if (latency > latency_max) latency_max = latency;
+            for (uint32_t k = 0; k < output->num_elements; k++) {
+                float diff = fabsf(output->data[k].float32 - references[i % 4]->data[k].float32);
+                if (diff > max_diff) max_diff = diff;
+            }
+        }
+        double total_ms = demo_now_ms() - start;
+        pthread_join(thread, NULL);
+        printf(">> %d stage pipeline: %7.1f frames/s (x%.2f), latency %.3f ms (max %.3f ms), max abs diff %.2e\r\n", pipeline->num_stages,
+            DEMO_FRAMES * 1000.0 / total_ms, single_ms * DEMO_FRAMES / total_ms, latency_sum / DEMO_FRAMES, latency_max, max_diff);
+        pipeline_free(pipeline);
+    }
+
+    tensor_free(output);
+    for (int i = 0; i < 4; i++) {
+        tensor_free(frames[i]);
+        tensor_free(references[i]);
+    }
+    model_release(model);
+    tensor_print_global_data_memory();
+    printf(">> Done\r\n");
+    return 0;
+}
@@ -0,0 +1,230 @@
+/*
+    Author: agent
+    Created: 2026.10.19
+
+    Fixed-point (Q15 / Q31) 예제.
+    - float <-> Q15 / Q31 변환의 최대 오차를 확인한다. (반올림이므로 2^-(frac_bits + 1) 이하)
+    - linear -> BN1d -> ReLU -> linear MLP를 float, int16 (Q15 계열), int32 (Q31 계열) activation으로 실행하고
+      layer별 최대 오차, SQNR (dB), argmax 일치율을 float 결과와 비교한다.
+      layer 출력의 frac_bits는 float 결과의 최대 절댓값으로 정한다. (calibration)
+    - 4D BN2d를 integer multiply-shift로 실행하고 float batch_norm_2d와 비교한다.
+    - float linear와 int16 linear의 cycle / MAC을 비교한다. (x86은 rdtsc, 그 외는 ns)
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "tensor.h"
+#include "op_linear.h"
+#include "op_norm.h"
+#include "op_activation.h"
+#include "op_fixed.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define DEMO_UNIT "cycles"
+#else
+#define DEMO_UNIT "ns"
+#endif
+
+#define DEMO_REPEAT 20
+#define DEMO_BATCH 32
+
+static uint64_t demo_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+static void demo_fill(tensor_t *tensor, uint32_t seed, float scale) {
+    for (uint32_t i = 0; i < tensor->num_elements; i++) {
+        tensor->data[i].float32 = scale * ((float)(((i + seed) * 2654435761u) % 1000) / 500.0f - 1.0f);
+    }
+}
+
+static batch_norm_t *demo_batch_norm(uint32_t channels) {
+    tensor_t *mean = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *var = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *gamma = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *beta = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    for (int i = 0; i < channels; i++) {
+        mean->data[i].float32 = 0.05f * (i % 7) - 0.1f;
+        var->data[i].float32 = 0.5f + 0.1f * (i % 5);
+        gamma->data[i].float32 = 1.0f - 0.05f * (i % 11);
+        beta->data[i].float32 = 0.02f * (i % 3) - 0.01f;
+    }
+    return batch_norm_create(mean, var, NULL, gamma, beta);
+}
+
+static linear_t *demo_linear(uint32_t in_features, uint32_t out_features, uint32_t seed) {
+    tensor_t *weight = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){out_features, in_features}, (void *)0);
+    tensor_t *bias = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){out_features}, (void *)0);
+    demo_fill(weight, seed, 1.0f / sqrtf((float)in_features));
+    demo_fill(bias, seed + 1, 0.1f);
+    return linear_create(weight, bias);
+}
+
+// Max abs error and SQNR (dB) of the fixed-point tensor against the float reference
+static void demo_compare(const char *name, tensor_t *fixed, tensor_t *reference) {
+    tensor_t *value = fixed_to_float(fixed);
+    double signal = 0.0, noise = 0.0, max_diff = 0.0;
+    for (uint32_t i = 0; i < value->num_elements; i++) {
+        double diff = (double)value->data[i].float32 - reference->data[i].float32;
+        signal += (double)reference->data[i].float32 * reference->data[i].float32;
+        noise += diff * diff;
+        if (fabs(diff) > max_diff) max_diff = fabs(diff);
+    }
+    printf(">>   %-14s Q%-2d: max abs diff %.2e, SQNR %5.1f dB\r\n", name, fixed->frac_bits, max_diff, (noise > 0.0) ? 10.0 * log10(signal / noise) : 999.0);
+    tensor_free(value);
+}
+
+static uint32_t demo_argmax_agree(tensor_t *fixed, tensor_t *reference) {
+    const uint32_t rows = reference->shape[0];
+    const uint32_t cols = reference->shape[1];
+    uint32_t agree = 0;
+    for (uint32_t r = 0; r < rows; r++) {
+        uint32_t a = 0, b = 0;
+        for (uint32_t c = 1; c < cols; c++) {
+            int64_t value = (fixed->type == TENSOR_INT16) ? fixed->data[r * cols + c].int16 : fixed->data[r * cols + c].int32;
+            int64_t best = (fixed->type == TENSOR_INT16) ? fixed->data[r * cols + a].int16 : fixed->data[r * cols + a].int32;
+            if (value > best) a = c;
+            if (reference->data[r * cols + c].float32 > reference->data[r * cols + b].float32) b = c;
+        }
+        if (a == b) agree++;
+    }
+    return agree;
+}
+
+static void demo_conversion() {
+    tensor_t *x = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){4096}, (void *)0);
+    demo_fill(x, 3, 0.999f);
+    const tensor_type_t types[2] = {TENSOR_INT16, TENSOR_INT32};
+    const uint8_t frac_bits[2] = {FIXED_Q15, FIXED_Q31};
+    for (int t = 0; t < 2; t++) {
+        tensor_t *q = fixed_from_float(x, types[t], frac_bits[t]);
+        tensor_t *y = fixed_to_float(q);
+        double max_diff = 0.0;
+        for (uint32_t i = 0; i < x->num_elements; i++) {
+            double diff = fabs((double)y->data[i].float32 - x->data[i].float32);
+            if (diff > max_diff) max_diff = diff;
+        }
+        printf(">> float -> Q%d -> float: max abs diff %.2e (bound %.2e, float32 rounding included)\r\n", frac_bits[t], max_diff, ldexp(1.0, -(frac_bits[t] + 1)));
+        tensor_free(q);
+        tensor_free(y);
+    }
+    tensor_free(x);
+}
+
+static void demo_mlp(tensor_type_t type) {
+    linear_t *linear1 = demo_linear(256, 256, 1);
+    batch_norm_t *batch_norm = demo_batch_norm(256);
+    linear_t *linear2 = demo_linear(256, 10, 3);
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){DEMO_BATCH, 256}, (void *)0);
+    demo_fill(input, 5, 1.0f);
+
+    // Float reference
+    tensor_t *h1 = linear(input, linear1);
+    tensor_t *h2 = batch_norm_1d(h1, batch_norm);
+    tensor_t *h3 = relu(h2);
+    tensor_t *y = linear(h3, linear2);
+
+    // Fixed point: the Q format of every activation from the float reference (calibration)
+    fixed_linear_t *fixed1 = fixed_linear_from_float(linear1);
+    fixed_batch_norm_t *fixed_bn = fixed_batch_norm_from_float(batch_norm, fixed_frac_bits_for(h2, type));
+    fixed_linear_t *fixed2 = fixed_linear_from_float(linear2);
+    tensor_t *q0 = fixed_from_float(input, type, fixed_frac_bits_for(input, type));
+    tensor_t *q1 = fixed_linear(q0, fixed1, type, fixed_frac_bits_for(h1, type));
+    tensor_t *q2 = fixed_batch_norm(q1, fixed_bn, type);
+    tensor_t *q3 = relu(q2);
+    tensor_t *q4 = fixed_linear(q3, fixed2, type, fixed_frac_bits_for(y, type));
+
+    uint8_t bn_min = FIXED_Q31, bn_max = 0;     // BN multiplier Q format of each channel
+    for (uint32_t c = 0; c < fixed_bn->multiplier->num_elements; c++) {
+        if (fixed_bn->multiplier_frac_bits[c] < bn_min) bn_min = fixed_bn->multiplier_frac_bits[c];
+        if (fixed_bn->multiplier_frac_bits[c] > bn_max) bn_max = fixed_bn->multiplier_frac_bits[c];
+    }
+    printf(">> MLP with %s activations (weights int16 Q%d / Q%d, BN multiplier Q%d to Q%d per channel):\r\n", (type == TENSOR_INT16) ? "int16" : "int32",
+        fixed1->weight->frac_bits, fixed2->weight->frac_bits, bn_min, bn_max);
+    demo_compare("input", q0, input);
+    demo_compare("linear", q1, h1);
+    demo_compare("batch_norm_1d", q2, h2);
+    demo_compare("relu", q3, h3);
+    demo_compare("linear", q4, y);
+    printf(">>   argmax agrees with float: %d / %d\r\n", demo_argmax_agree(q4, y), DEMO_BATCH);
+
+    tensor_t *tensors[] = {input, h1, h2, h3, y, q0, q1, q2, q3, q4};
+    for (int i = 0; i < sizeof(tensors) / sizeof(tensors[0]); i++) tensor_free(tensors[i]);
+    fixed_linear_free(fixed1, 1);
+    fixed_linear_free(fixed2, 1);
+    fixed_batch_norm_free(fixed_bn);
+    linear_free(linear1, 1);
+    linear_free(linear2, 1);
+    batch_free(batch_norm, 1);
+}
+
+static void demo_batch_norm_2d() {
+    batch_norm_t *batch_norm = demo_batch_norm(16);
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, 4, (uint32_t[]){2, 16, 32, 32}, (void *)0);
+    demo_fill(input, 9, 1.0f);
+    tensor_t *reference = batch_norm_2d(input, batch_norm);
+    fixed_batch_norm_t *fixed_bn = fixed_batch_norm_from_float(batch_norm, fixed_frac_bits_for(reference, TENSOR_INT16));
+    tensor_t *q = fixed_from_float(input, TENSOR_INT16, FIXED_Q15 - 1);
+    tensor_t *output = fixed_batch_norm(q, fixed_bn, TENSOR_INT16);
+    printf(">> BN2d (2 x 16 x 32 x 32), int16 multiply-shift:\r\n");
+    demo_compare("batch_norm_2d", output, reference);
+    tensor_free(input);
+    tensor_free(reference);
+    tensor_free(q);
+    tensor_free(output);
+    fixed_batch_norm_free(fixed_bn);
+    batch_free(batch_norm, 1);
+}
+
+static void demo_benchmark(uint32_t batch_size, uint32_t in_features, uint32_t out_features) {
+    linear_t *linear_weight = demo_linear(in_features, out_features, 1);
+    fixed_linear_t *fixed = fixed_linear_from_float(linear_weight);
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){batch_size, in_features}, (void *)0);
+    demo_fill(input, 2, 1.0f);
+    tensor_t *output = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){batch_size, out_features}, (void *)0);
+    tensor_t *q_input = fixed_from_float(input, TENSOR_INT16, fixed_frac_bits_for(input, TENSOR_INT16));
+    tensor_t *q_output = tensor_create(TENSOR_INT16, 2, (uint32_t[]){batch_size, out_features}, (void *)0);
+    q_output->frac_bits = 12;
+    const double macs = (double)batch_size * in_features * out_features * DEMO_REPEAT;
+    linear_config_t configs[2] = {{LINEAR_ALGO_DIRECT, 1, 1}, {LINEAR_ALGO_GEMV, 1, 1}};
+
+    printf(">> (%d x %d) x (%d x %d)^T, %s / MAC:", batch_size, in_features, out_features, in_features, DEMO_UNIT);
+    for (int c = 0; c < 2; c++) {
+        linear_out_config(input, linear_weight, output, &configs[c]);
+        uint64_t start = demo_ticks();
+        for (int r = 0; r < DEMO_REPEAT; r++) linear_out_config(input, linear_weight, output, &configs[c]);
+        printf(" float %s %.3f,", (c == 0) ? "direct" : "gemv", (double)(demo_ticks() - start) / macs);
+    }
+    fixed_linear_out(q_input, fixed, q_output);
+    uint64_t start = demo_ticks();
+    for (int r = 0; r < DEMO_REPEAT; r++) fixed_linear_out(q_input, fixed, q_output);
+    printf(" int16 %.3f\r\n", (double)(demo_ticks() - start) / macs);
+
+    tensor_free(input);
+    tensor_free(output);
+    tensor_free(q_input);
+    tensor_free(q_output);
+    fixed_linear_free(fixed, 1);
+    linear_free(linear_weight, 1);
+}
+
+int main() {
+    demo_conversion();
+    demo_mlp(TENSOR_INT16);
+    demo_mlp(TENSOR_INT32);
+    demo_batch_norm_2d();
+    demo_benchmark(1, 1024, 1024);
+    demo_benchmark(8, 784, 512);
+
+    tensor_print_global_data_memory();
+    printf(">> Done\r\n");
+    return 0;
+}
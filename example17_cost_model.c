@@ -0,0 +1,156 @@
+/*
+    Author: agent
+    Created: 2026.10.19
+
+    Roofline cost model 예제.
+    - MLP와 pooling 네트워크의 layer별 FLOPs, bytes, arithmetic intensity, weight, 예측 latency를 실행하지 않고 계산한다.
+    - 기본 profile (Cortex-M7 급 MCU)로 frame deadline과 SRAM 크기를 만족하는지 확인한다.
+    - cost_model_calibrate로 현재 machine의 profile을 측정하고, layer별 예측 latency를 실제 실행 시간 (session_run_groups)과 비교한다.
+    - 예측한 activation peak를 executor_run의 tensor_get_global_data_peak_memory, session의 buffer 크기와 비교한다.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <math.h>
+#include <time.h>
+#include "tensor.h"
+#include "op_linear.h"
+#include "op_norm.h"
+#include "op_pool.h"
+#include "executor.h"
+#include "model.h"
+#include "cost_model.h"
+
+#define DEMO_REPEAT 20
+#define DEMO_DEADLINE_MS 50.0
+#define DEMO_SRAM_BYTES (512 * 1024)
+
+static const char *demo_layer_names[] = {"linear", "batch_norm_1d", "batch_norm_2d", "relu", "residual_add",
+                                         "max_pool_2d", "avg_pool_2d", "global_avg_pool", "flatten"};
+
+static double demo_now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void demo_fill(tensor_t *tensor, uint32_t seed, float scale) {
+    for (uint32_t i = 0; i < tensor->num_elements; i++) {
+        tensor->data[i].float32 = scale * ((float)(((i + seed) * 2654435761u) % 1000) / 500.0f - 1.0f);
+    }
+}
+
+static batch_norm_t *demo_batch_norm(uint32_t channels) {
+    tensor_t *mean = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *var = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *gamma = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    tensor_t *beta = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, (void *)0);
+    for (int i = 0; i < channels; i++) {
+        mean->data[i].float32 = 0.01f * (i % 7);
+        var->data[i].float32 = 1.0f + 0.01f * (i % 5);
+        gamma->data[i].float32 = 1.0f - 0.001f * (i % 11);
+        beta->data[i].float32 = 0.02f * (i % 3) - 0.01f;
+    }
+    return batch_norm_create(mean, var, NULL, gamma, beta);
+}
+
+static linear_t *demo_linear(uint32_t in_features, uint32_t out_features, uint32_t seed) {
+    tensor_t *weight = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){out_features, in_features}, (void *)0);
+    tensor_t *bias = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){out_features}, (void *)0);
+    demo_fill(weight, seed, 2.0f / sqrtf((float)in_features));
+    demo_fill(bias, seed + 1, 0.1f);
+    return linear_create(weight, bias);
+}
+
+static void demo_analyze(const char *name, executor_t *executor, uint32_t ndim, uint32_t *shape, machine_profile_t *mcu, machine_profile_t *host) {
+    model_cost_t cost;
+    printf(">> %s, input", name);
+    for (uint32_t i = 0; i < ndim; i++) printf((i == 0) ? " (%d" : " x %d", shape[i]);
+    printf(")\r\n");
+
+    // Board check with the MCU profile
+    if (cost_model_estimate(executor, ndim, shape, COST_PLAN_SESSION, mcu, &cost) != 0) return;
+    cost_model_print(&cost);
+    printf(">> MCU profile: %.2f ms (deadline %.0f ms: %s), weights + session activations %" PRIu64 " bytes (SRAM %d bytes: %s)\r\n",
+        cost.predicted_ms, DEMO_DEADLINE_MS, (cost.predicted_ms <= DEMO_DEADLINE_MS) ? "ok" : "missed",
+        cost.weight_bytes + cost.activation_peak, DEMO_SRAM_BYTES, (cost.weight_bytes + cost.activation_peak <= DEMO_SRAM_BYTES) ? "fits" : "does not fit");
+    cost_model_free(&cost);
+
+    // Predicted vs measured on this machine, layer by layer (without fusion, a group is a layer)
+    cost_model_estimate(executor, ndim, shape, COST_PLAN_SESSION, host, &cost);
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, ndim, shape, (void *)0);
+    demo_fill(input, 3, 1.0f);
+    model_t *model = model_create(executor, 0);
+    session_t *session = session_create(model, ndim, shape);
+    session_run(session, input);
+    printf(">> host profile, layer: predicted ms / measured ms\r\n");
+    double measured_total = 0.0;
+    for (uint32_t g = 0; g < executor->num_groups; g++) {
+        double best = 1e30;
+        for (int r = 0; r < DEMO_REPEAT; r++) {
+            double start = demo_now_ms();
+            session_run_groups(session, input, g, g + 1);
+            double ms = demo_now_ms() - start;
+            if (ms < best) best = ms;
+        }
+        measured_total += best;
+        uint32_t l = executor->groups[g].first;
+        printf(">>   %2d %-15s %9.4f / %9.4f\r\n", l, demo_layer_names[cost.layers[l].type], cost.layers[l].predicted_ms, best);
+    }
+    printf(">>   total              %9.4f / %9.4f\r\n", cost.predicted_ms, measured_total);
+    printf(">> session activations: predicted %" PRIu64 " bytes, allocated %" PRIu64 " bytes\r\n", cost.activation_peak, session->activation_bytes);
+    session_free(session);
+    model_release(model);
+    cost_model_free(&cost);
+
+    // executor_run plan: predicted activation peak vs the measured peak
+    cost_model_estimate(executor, ndim, shape, COST_PLAN_EXECUTOR_RUN, host, &cost);
+    uint64_t base = tensor_get_global_data_memory();
+    tensor_reset_global_data_peak_memory();
+    tensor_t *output = executor_run(executor, input);
+    printf(">> executor_run activations: predicted peak %" PRIu64 " bytes, measured peak %" PRIu64 " bytes\r\n", cost.activation_peak, tensor_get_global_data_peak_memory() - base);
+    tensor_free(output);
+    tensor_free(input);
+    cost_model_free(&cost);
+}
+
+int main() {
+    machine_profile_t mcu = cost_model_default_profile();
+    machine_profile_t host;
+    double start = demo_now_ms();
+    cost_model_calibrate(&host);
+    printf(">> calibrated in %.1f ms: peak %.2f GFLOP/s, bandwidth %.2f GB/s, overhead %.2f us\r\n", demo_now_ms() - start, host.peak_gflops, host.bandwidth_gbps, host.overhead_us);
+
+    // MLP: linear -> BN1d -> ReLU -> linear -> ReLU -> (+ output of layer 2) -> linear
+    executor_t *mlp = executor_create();
+    executor_add_linear(mlp, demo_linear(784, 256, 1));
+    executor_add_batch_norm_1d(mlp, demo_batch_norm(256));
+    executor_add_relu(mlp);
+    executor_add_linear(mlp, demo_linear(256, 256, 3));
+    executor_add_relu(mlp);
+    executor_add_residual(mlp, 2);
+    executor_add_linear(mlp, demo_linear(256, 10, 5));
+    demo_analyze("mlp", mlp, 2, (uint32_t[]){8, 784}, &mcu, &host);
+    executor_free(mlp, 1);
+
+    // Pooling network: BN2d -> ReLU -> MaxPool(2) -> BN2d -> ReLU -> AvgPool(3, 1, 1) -> (+ output of layer 4)
+    //                  -> global average pool -> flatten -> linear
+    executor_t *net = executor_create();
+    executor_add_batch_norm_2d(net, demo_batch_norm(16));
+    executor_add_relu(net);
+    executor_add_max_pool_2d(net, pool2d_create(2, 2, 0));
+    executor_add_batch_norm_2d(net, demo_batch_norm(16));
+    executor_add_relu(net);
+    executor_add_avg_pool_2d(net, pool2d_create(3, 1, 1));
+    executor_add_residual(net, 4);
+    executor_add_global_avg_pool_2d(net);
+    executor_add_flatten(net);
+    executor_add_linear(net, demo_linear(16, 10, 7));
+    demo_analyze("pool_net", net, 4, (uint32_t[]){1, 16, 64, 64}, &mcu, &host);
+    executor_free(net, 1);
+
+    tensor_print_global_data_memory();
+    printf(">> Done\r\n");
+    return 0;
+}
@@ -0,0 +1,168 @@
+/*
+    Author: agent
+    Created: 2026.10.19
+
+    Fast math (fast_math.h) 예제.
+    - fast_expf, fast_tanhf, fast_sigmoidf, fast_rsqrtf의 두 tier (accurate, approx) 오차를 float 전체 범위에서 측정한다.
+      모든 bit pattern을 DEMO_ULP_STRIDE 간격으로 보고, double libm 결과를 float로 반올림한 값과의 ULP 거리, 상대 오차, 절대 오차를 출력한다.
+    - 범위 밖 입력 (exp overflow -> +inf, underflow -> 0)이 libm과 같은지 확인한다.
+    - array 함수 (fast_math_exp 등)의 처리량을 libm (expf, tanhf, 1 / (1 + expf(-x)), 1 / sqrtf)과 비교한다.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <float.h>
+#include <math.h>
+#include <time.h>
+#include "tensor.h"
+#include "fast_math.h"
+
+#define DEMO_ULP_STRIDE 257         // Odd step over the 2^32 bit patterns, so every exponent and many mantissas are covered
+#define DEMO_SIZE 4096
+#define DEMO_REPEAT 200
+
+typedef struct {
+    const char *name;
+    uint32_t ulp;                   // Max ULP distance from the correctly rounded result
+    double rel;                     // Max relative error
+    double abs;                     // Max absolute error
+    float worst;                    // Input of the max ULP distance
+    uint32_t special;               // +inf / 0 results that differ from libm
+    uint32_t flushed;               // libm result below FLT_MIN (denormal): fast math returns 0
+} demo_error_t;
+
+static double demo_now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Float bits as an integer that is ordered like the float: the ULP distance is the difference
+static int64_t demo_ordered(float value) {
+    fast_math_bits_t bits;
+    bits.f = value;
+    return (bits.u & 0x80000000u) ? -(int64_t)(bits.u & 0x7fffffffu) : (int64_t)bits.u;
+}
+
+static void demo_check(demo_error_t *error, float x, float result, double expected) {
+    const float rounded = (float)expected;
+    if (isinf(rounded) || rounded == 0.0f) {
+        if (result != rounded) error->special++;
+        return;
+    }
+    if (fabsf(rounded) < FLT_MIN) {
+        if (result == 0.0f) {
+            error->flushed++;
+            return;
+        }
+    }
+    int64_t ulp = demo_ordered(result) - demo_ordered(rounded);
+    if (ulp < 0) ulp = -ulp;
+    if (isnan(result) || isinf(result)) ulp = UINT32_MAX;
+    const double abs_error = fabs((double)result - expected);
+    if (ulp > error->ulp) {
+        error->ulp = (ulp > UINT32_MAX) ? UINT32_MAX : (uint32_t)ulp;
+        error->worst = x;
+    }
+    if (abs_error / fabs(expected) > error->rel) error->rel = abs_error / fabs(expected);
+    if (abs_error > error->abs) error->abs = abs_error;
+}
+
+static void demo_print_error(demo_error_t *error) {
+    printf(">>   %-20s max %8u ULP (x = %-13g) rel %.2e  abs %.2e  special %u  flushed %u\r\n",
+        error->name, error->ulp, error->worst, error->rel, error->abs, error->special, error->flushed);
+}
+
+static void demo_sweep() {
+    demo_error_t errors[8] = {
+        {"fast_expf"}, {"fast_expf_approx"}, {"fast_tanhf"}, {"fast_tanhf_approx"},
+        {"fast_sigmoidf"}, {"fast_sigmoidf_approx"}, {"fast_rsqrtf"}, {"fast_rsqrtf_approx"}
+    };
+    uint32_t samples = 0;
+    for (uint64_t b = 0; b <= UINT32_MAX; b += DEMO_ULP_STRIDE) {
+        fast_math_bits_t bits;
+        bits.u = (uint32_t)b;
+        const float x = bits.f;
+        if (isnan(x)) continue;
+        samples++;
+
+        const double expected_exp = exp((double)x);
+        demo_check(&errors[0], x, fast_expf(x), expected_exp);
+        demo_check(&errors[1], x, fast_expf_approx(x), expected_exp);
+        const double expected_tanh = tanh((double)x);
+        demo_check(&errors[2], x, fast_tanhf(x), expected_tanh);
+        demo_check(&errors[3], x, fast_tanhf_approx(x), expected_tanh);
+        const double expected_sigmoid = 1.0 / (1.0 + exp(-(double)x));
+        demo_check(&errors[4], x, fast_sigmoidf(x), expected_sigmoid);
+        demo_check(&errors[5], x, fast_sigmoidf_approx(x), expected_sigmoid);
+        if (x >= FLT_MIN && !isinf(x)) {    // rsqrt: positive normal floats
+            const double expected_rsqrt = 1.0 / sqrt((double)x);
+            demo_check(&errors[6], x, fast_rsqrtf(x), expected_rsqrt);
+            demo_check(&errors[7], x, fast_rsqrtf_approx(x), expected_rsqrt);
+        }
+    }
+    printf(">> error over %u inputs (every %d-th float bit pattern, NaN skipped)\r\n", samples, DEMO_ULP_STRIDE);
+    for (int i = 0; i < 8; i++) demo_print_error(&errors[i]);
+}
+
+typedef float (*demo_libm_t)(float);
+typedef void (*demo_array_t)(const float *, float *, uint32_t, fast_math_tier_t);
+
+static float demo_libm_sigmoid(float x) {
+    return 1.0f / (1.0f + expf(-x));
+}
+
+static float demo_libm_rsqrt(float x) {
+    return 1.0f / sqrtf(x);
+}
+
+static double demo_time_libm(demo_libm_t f, const float *input, float *output) {
+    double best = 1e30;
+    for (int r = 0; r < DEMO_REPEAT; r++) {
+        double start = demo_now_ms();
+        for (uint32_t i = 0; i < DEMO_SIZE; i++) output[i] = f(input[i]);
+        double ms = demo_now_ms() - start;
+        if (ms < best) best = ms;
+    }
+    return best * 1e6 / DEMO_SIZE;    // ns per element
+}
+
+static double demo_time_array(demo_array_t f, fast_math_tier_t tier, const float *input, float *output) {
+    double best = 1e30;
+    for (int r = 0; r < DEMO_REPEAT; r++) {
+        double start = demo_now_ms();
+        f(input, output, DEMO_SIZE, tier);
+        double ms = demo_now_ms() - start;
+        if (ms < best) best = ms;
+    }
+    return best * 1e6 / DEMO_SIZE;
+}
+
+static void demo_throughput(const char *name, demo_libm_t libm, demo_array_t array, float low, float high) {
+    static float input[DEMO_SIZE];
+    static float output[DEMO_SIZE];
+    for (uint32_t i = 0; i < DEMO_SIZE; i++) {
+        input[i] = low + (high - low) * (float)((i * 2654435761u) % DEMO_SIZE) / DEMO_SIZE;
+    }
+    const double libm_ns = demo_time_libm(libm, input, output);
+    const double accurate_ns = demo_time_array(array, FAST_MATH_ACCURATE, input, output);
+    const double approx_ns = demo_time_array(array, FAST_MATH_APPROX, input, output);
+    printf(">>   %-8s [%g, %g]  libm %6.2f ns  accurate %6.2f ns (x%.1f)  approx %6.2f ns (x%.1f)\r\n",
+        name, low, high, libm_ns, accurate_ns, libm_ns / accurate_ns, approx_ns, libm_ns / approx_ns);
+}
+
+int main() {
+    double start = demo_now_ms();
+    demo_sweep();
+    printf(">> sweep took %.0f ms\r\n", demo_now_ms() - start);
+
+    printf(">> throughput, %d elements, ns per element (speedup vs libm)\r\n", DEMO_SIZE);
+    demo_throughput("exp", expf, fast_math_exp, -10.0f, 10.0f);
+    demo_throughput("tanh", tanhf, fast_math_tanh, -5.0f, 5.0f);
+    demo_throughput("sigmoid", demo_libm_sigmoid, fast_math_sigmoid, -10.0f, 10.0f);
+    demo_throughput("rsqrt", demo_libm_rsqrt, fast_math_rsqrt, 1e-3f, 1e3f);
+
+    tensor_print_global_data_memory();
+    printf(">> Done\r\n");
+    return 0;
+}
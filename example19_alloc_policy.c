@@ -0,0 +1,258 @@
+/*
+    Author: agent
+    Created: 2026.10.19
+
+    Allocation policy (alloc.h) 예제.
+    - 같은 크기 (DEMO_ROWS x DEMO_COLS)의 weight tensor를 policy별 (malloc, aligned, 4K pages, huge pages, interleave, bind)로 만들고
+      실제로 받은 memory 종류, NUMA 적용 여부, data 주소 정렬, AnonHugePages 증가량을 출력한다.
+    - random pointer chasing (access마다 다른 page: 4K page에서는 TLB miss)의 latency, 순차 읽기 bandwidth,
+      DTLB miss 수 (perf_event_open, 사용할 수 없으면 n/a)를 비교한다.
+    - 없는 node에 bind하거나 reserved huge page가 없을 때 오류 없이 fallback하는지 확인한다.
+    - alloc_replica_create로 node별 복사본을 만들고, 현재 thread의 node 복사본으로 linear를 실행한다.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "tensor.h"
+#include "op_linear.h"
+#include "alloc.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+#endif
+
+#define DEMO_ROWS 2048
+#define DEMO_COLS 2048                  // 4M elements, 32MB of tensor_data_t: 8192 4K pages, 16 huge pages
+#define DEMO_CHASE_STEPS (2 * 1024 * 1024)
+#define DEMO_REPEAT 3
+
+static volatile int64_t demo_sink;     // Keeps the benchmark loops
+
+static double demo_now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void demo_print_file(const char *name, const char *path) {
+    char line[256] = "n/a\n";
+    FILE *file = fopen(path, "r");
+    if (file != NULL) {
+        if (fgets(line, sizeof(line), file) == NULL) strcpy(line, "n/a\n");
+        fclose(file);
+    }
+    printf(">> %s: %s", name, line);
+    if (line[strlen(line) - 1] != '\n') printf("\r\n");
+}
+
+// AnonHugePages of the process (kB), -1 if not available
+static long demo_anon_huge_kb() {
+    long kb = -1;
+    FILE *file = fopen("/proc/self/smaps_rollup", "r");
+    if (file == NULL) return -1;
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1) break;
+    }
+    fclose(file);
+    return kb;
+}
+
+// DTLB load misses of this thread (user space). -1 if the counter is not available (ex. VM without PMU).
+static int demo_tlb_counter_open() {
+#if defined(__linux__) && defined(SYS_perf_event_open)
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+static void demo_tlb_counter_start(int fd) {
+#if defined(__linux__)
+    if (fd < 0) return;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+}
+
+static long long demo_tlb_counter_stop(int fd) {
+    long long count = -1;
+#if defined(__linux__)
+    if (fd < 0) return -1;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd, &count, sizeof(count)) != sizeof(count)) count = -1;
+#endif
+    return count;
+}
+
+// data[i].int64 is the next index: one random cycle over every element (Sattolo), so each access is a new line and page
+static void demo_fill_chain(tensor_t *tensor) {
+    const uint32_t n = tensor->num_elements;
+    for (uint32_t i = 0; i < n; i++) tensor->data[i].int64 = i;
+    uint64_t state = 88172645463325252ull;
+    for (uint32_t i = n - 1; i > 0; i--) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        const uint32_t j = (uint32_t)(state % i);
+        const int64_t tmp = tensor->data[i].int64;
+        tensor->data[i].int64 = tensor->data[j].int64;
+        tensor->data[j].int64 = tmp;
+    }
+}
+
+static void demo_run(const char *name, alloc_policy_t *policy, int tlb_fd) {
+    alloc_set_policy(policy);
+    const long huge_before = demo_anon_huge_kb();
+    tensor_t *tensor = tensor_create(TENSOR_INT64, 2, (uint32_t[]){DEMO_ROWS, DEMO_COLS}, (void *)0);
+    alloc_set_policy(NULL);
+    const alloc_info_t info = alloc_get_info(tensor);
+
+    double start = demo_now_ms();
+    demo_fill_chain(tensor);
+    const double fill_ms = demo_now_ms() - start;
+    const long huge_after = demo_anon_huge_kb();
+
+    // Pointer chasing: latency of dependent loads
+    double chase_ns = 1e30;
+    long long misses = -1;
+    int64_t index = 0;
+    for (int r = 0; r < DEMO_REPEAT; r++) {
+        demo_tlb_counter_start(tlb_fd);
+        start = demo_now_ms();
+        for (uint32_t s = 0; s < DEMO_CHASE_STEPS; s++) index = tensor->data[index].int64;
+        const double ns = (demo_now_ms() - start) * 1e6 / DEMO_CHASE_STEPS;
+        const long long count = demo_tlb_counter_stop(tlb_fd);
+        if (ns < chase_ns) {
+            chase_ns = ns;
+            misses = count;
+        }
+    }
+
+    // Sequential read
+    double read_gbps = 0.0;
+    int64_t sum = 0;
+    for (int r = 0; r < DEMO_REPEAT; r++) {
+        start = demo_now_ms();
+        for (uint32_t i = 0; i < tensor->num_elements; i++) sum += tensor->data[i].int64;
+        const double gbps = tensor->num_elements * sizeof(tensor_data_t) / ((demo_now_ms() - start) * 1e6);
+        if (gbps > read_gbps) read_gbps = gbps;
+    }
+
+    printf(">>   %-18s %-8s numa %-11s 2MB offset %7lu  huge +%6ld kB  fill %6.1f ms  chase %6.1f ns",
+        name, alloc_kind_name(info.kind),
+        (info.numa == ALLOC_NUMA_INTERLEAVE) ? "interleave" : (info.numa == ALLOC_NUMA_BIND) ? "bind" : "first-touch",
+        (unsigned long)((uintptr_t)tensor->data & (uintptr_t)(ALLOC_HUGE_PAGE_SIZE - 1)),
+        (huge_before >= 0 && huge_after >= 0) ? huge_after - huge_before : -1L, fill_ms, chase_ns);
+    if (misses >= 0) printf("  dTLB miss %5.3f/access", (double)misses / DEMO_CHASE_STEPS);
+    else printf("  dTLB miss n/a");
+    printf("  read %5.2f GB/s\r\n", read_gbps);
+    demo_sink = sum + index;
+    tensor_free(tensor);
+}
+
+static void demo_replica() {
+    tensor_t *weight = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){DEMO_COLS, DEMO_COLS}, (void *)0);
+    tensor_t *bias = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){DEMO_COLS}, (void *)0);
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){8, DEMO_COLS}, (void *)0);
+    for (uint32_t i = 0; i < weight->num_elements; i++) weight->data[i].float32 = (float)((i * 2654435761u) % 1000) / 1000.0f - 0.5f;
+    for (uint32_t i = 0; i < bias->num_elements; i++) bias->data[i].float32 = 0.01f * (i % 7);
+    for (uint32_t i = 0; i < input->num_elements; i++) input->data[i].float32 = (float)((i * 40503u) % 100) / 100.0f;
+
+    alloc_policy_t huge = {ALLOC_PAGE_HUGE, ALLOC_NUMA_DEFAULT, 0, 1024 * 1024};
+    alloc_set_policy(&huge);
+    alloc_replica_t *replica = alloc_replica_create(weight);
+    alloc_set_policy(NULL);
+    tensor_t *local = alloc_replica_local(replica);
+    const alloc_info_t info = alloc_get_info(local);
+    printf(">> replica: %d copies, this thread runs on node %d, its copy: %s, numa %s node %d\r\n", replica->num_nodes,
+        alloc_current_node(), alloc_kind_name(info.kind), (info.numa == ALLOC_NUMA_BIND) ? "bind" : "first-touch", info.node);
+
+    linear_t *shared = linear_create(weight, bias);
+    linear_t *copied = linear_create(local, bias);
+    tensor_t *expected = linear(input, shared);
+    double best_shared = 1e30, best_local = 1e30;
+    tensor_t *output = NULL;
+    for (int r = 0; r < DEMO_REPEAT; r++) {
+        double start = demo_now_ms();
+        tensor_t *out = linear(input, shared);
+        double ms = demo_now_ms() - start;
+        if (ms < best_shared) best_shared = ms;
+        tensor_free(out);
+        start = demo_now_ms();
+        out = linear(input, copied);
+        ms = demo_now_ms() - start;
+        if (ms < best_local) best_local = ms;
+        if (output != NULL) tensor_free(output);
+        output = out;
+    }
+    float max_diff = 0.0f;
+    for (uint32_t i = 0; i < output->num_elements; i++) {
+        const float diff = fabsf(output->data[i].float32 - expected->data[i].float32);
+        if (diff > max_diff) max_diff = diff;
+    }
+    printf(">> linear 8 x %d -> %d: original weight (malloc) %.2f ms, local copy %.2f ms, max diff %g\r\n",
+        DEMO_COLS, DEMO_COLS, best_shared, best_local, max_diff);
+
+    tensor_free(output);
+    tensor_free(expected);
+    linear_free(shared, 0);
+    linear_free(copied, 0);
+    alloc_replica_free(replica);
+    tensor_free(weight);
+    tensor_free(bias);
+    tensor_free(input);
+}
+
+int main() {
+    printf(">> NUMA nodes: %d\r\n", alloc_num_nodes());
+    demo_print_file("THP", "/sys/kernel/mm/transparent_hugepage/enabled");
+    demo_print_file("reserved huge pages", "/proc/sys/vm/nr_hugepages");
+
+    const int tlb_fd = demo_tlb_counter_open();
+    printf(">> %d x %d int64 tensor (%d MB), chase %d dependent loads\r\n", DEMO_ROWS, DEMO_COLS,
+        (int)((uint64_t)DEMO_ROWS * DEMO_COLS * sizeof(tensor_data_t) >> 20), DEMO_CHASE_STEPS);
+    alloc_policy_t policies[] = {
+        {ALLOC_PAGE_DEFAULT, ALLOC_NUMA_DEFAULT, 0, 0},
+        {ALLOC_PAGE_ALIGNED, ALLOC_NUMA_DEFAULT, 0, 0},
+        {ALLOC_PAGE_MAP, ALLOC_NUMA_DEFAULT, 0, 0},
+        {ALLOC_PAGE_HUGE, ALLOC_NUMA_DEFAULT, 0, 0},
+        {ALLOC_PAGE_HUGE, ALLOC_NUMA_INTERLEAVE, 0, 0},
+        {ALLOC_PAGE_HUGE, ALLOC_NUMA_BIND, 0, 0},
+        {ALLOC_PAGE_HUGE, ALLOC_NUMA_BIND, 1, 0},        // Node 1: first touch on a single-node machine
+    };
+    const char *names[] = {"malloc", "aligned", "4K pages", "huge", "huge + interleave", "huge + bind 0", "huge + bind 1"};
+    for (int p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) demo_run(names[p], &policies[p], tlb_fd);
+#if defined(__linux__)
+    if (tlb_fd >= 0) close(tlb_fd);
+#endif
+
+    // min_bytes: small tensors keep malloc
+    alloc_policy_t large_only = {ALLOC_PAGE_HUGE, ALLOC_NUMA_INTERLEAVE, 0, 1024 * 1024};
+    alloc_set_policy(&large_only);
+    tensor_t *small = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){256}, (void *)0);
+    alloc_set_policy(NULL);
+    printf(">> min_bytes 1MB: a 256-element tensor gets %s\r\n", alloc_kind_name(alloc_get_info(small).kind));
+    tensor_free(small);
+
+    demo_replica();
+
+    tensor_print_global_data_memory();
+    printf(">> Done\r\n");
+    return 0;
+}
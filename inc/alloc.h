@@ -0,0 +1,105 @@
+/*
+Author: agent
+Created: 2026.10.19
+Copyright 2026
+
+This file is a header file for the allocation policy of tensor data.
+tensor_create allocates the data with alloc_data, following the policy set by alloc_set_policy:
+- page: ALLOC_PAGE_DEFAULT (malloc), ALLOC_PAGE_ALIGNED (64 bytes, a cache line), ALLOC_PAGE_MAP (own 4K pages, mmap)
+  or ALLOC_PAGE_HUGE (2MB pages: fewer TLB misses on large weights).
+- numa: where the pages are placed on a multi-socket machine. ALLOC_NUMA_DEFAULT (first touch: the node of the
+  thread that writes the page first), ALLOC_NUMA_INTERLEAVE (pages round robin over the nodes, so the threads of
+  every socket see the same average latency) or ALLOC_NUMA_BIND (a node). Needs own pages, so it implies ALLOC_PAGE_MAP.
+- min_bytes: the policy is used for buffers of at least min_bytes, smaller buffers use malloc.
+Under the default policy (and below min_bytes) the data is a plain malloc, so a tensor costs nothing more than before.
+The other buffers have a header of ALLOC_HEADER_SIZE bytes before the data (what they got, how to free them).
+Read-only weights can be replicated per node with alloc_replica_create, and each thread uses the copy of its node.
+
+Each step falls back when it is not available, without an error: MAP_HUGETLB needs reserved huge pages
+(/proc/sys/vm/nr_hugepages), otherwise transparent huge pages are requested with madvise (needs THP "madvise" or
+"always"), otherwise 4K pages. mbind fails on kernels without NUMA (or in containers without the permission), then the
+pages are placed by first touch. Without mmap (ex. STM32), the buffers are 64-byte aligned malloc.
+alloc_get_info tells what the data of a tensor got.
+*/
+#ifndef _ALLOC_H
+#define _ALLOC_H
+
+#include <stdint.h>
+#include "tensor.h"
+
+#if !defined(RES_C_NO_MMAP) && defined(__linux__)
+#define ALLOC_USE_MMAP 1
+#else
+#define ALLOC_USE_MMAP 0
+#endif
+
+#define ALLOC_ALIGNMENT 64                          // Cache line
+#define ALLOC_HEADER_SIZE 64                        // Header before the data (multiple of ALLOC_ALIGNMENT)
+#define ALLOC_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define ALLOC_MAX_NODES 64
+
+typedef enum {
+    ALLOC_PAGE_DEFAULT,
+    ALLOC_PAGE_ALIGNED,
+    ALLOC_PAGE_MAP,
+    ALLOC_PAGE_HUGE
+} alloc_page_t;
+
+typedef enum {
+    ALLOC_NUMA_DEFAULT,
+    ALLOC_NUMA_INTERLEAVE,
+    ALLOC_NUMA_BIND
+} alloc_numa_t;
+
+typedef struct {
+    alloc_page_t page;
+    alloc_numa_t numa;
+    uint32_t node;              // ALLOC_NUMA_BIND: node of the pages
+    uint64_t min_bytes;
+} alloc_policy_t;
+
+// What a buffer got
+typedef enum {
+    ALLOC_KIND_MALLOC,
+    ALLOC_KIND_ALIGNED,         // 64-byte aligned malloc
+    ALLOC_KIND_MAP,             // 4K pages
+    ALLOC_KIND_HUGETLB,         // Reserved 2MB pages (MAP_HUGETLB)
+    ALLOC_KIND_THP              // 2MB aligned, transparent huge pages requested (madvise)
+} alloc_kind_t;
+
+typedef struct {
+    alloc_kind_t kind;
+    alloc_numa_t numa;          // NUMA policy applied (ALLOC_NUMA_DEFAULT if mbind was not used or failed)
+    uint32_t node;
+} alloc_info_t;
+
+// One copy per node
+typedef struct {
+    uint32_t num_nodes;
+    tensor_t **tensors;         // tensors[node]
+} alloc_replica_t;
+
+// Policy. Set it before the tensors are created, not while other threads create tensors. NULL: default (malloc).
+alloc_policy_t alloc_default_policy();
+void alloc_set_policy(alloc_policy_t *policy);
+alloc_policy_t alloc_get_policy();
+
+// Allocate bytes with the policy (at least 16-byte aligned). *is_malloc: 1 - plain malloc without a header (default
+// policy or below min_bytes), free with free(). 0 - free with alloc_free only.
+void *alloc_data(uint64_t bytes, uint8_t *is_malloc);
+void alloc_free(void *data);
+// What the data of the tensor got. A tensor that does not own its data: ALLOC_KIND_MALLOC (unknown).
+alloc_info_t alloc_get_info(tensor_t *tensor);
+const char *alloc_kind_name(alloc_kind_t kind);
+
+// NUMA nodes of the machine (1 without NUMA), and the node of the CPU the calling thread runs on
+uint32_t alloc_num_nodes();
+uint32_t alloc_current_node();
+
+// Copy a tensor to each node (ALLOC_NUMA_BIND, pages of the policy: huge pages with ALLOC_PAGE_HUGE). The copies are
+// owned by the replica. Use the copies read-only: writes are not propagated.
+alloc_replica_t *alloc_replica_create(tensor_t *tensor);
+tensor_t *alloc_replica_local(alloc_replica_t *replica);    // Copy of the node of the calling thread
+void alloc_replica_free(alloc_replica_t *replica);
+
+#endif // _ALLOC_H
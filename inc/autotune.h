@@ -0,0 +1,64 @@
+/*
+Author: agent
+Created: 2026.10.19
+Copyright 2026
+
+This file is a header file for the kernel autotuner.
+An op has several kernel configurations (algorithm, tile size, number of threads), and the fastest one depends on the
+shape and the machine. The tuned ops look up the configuration by the key (op, type, shape, number of threads):
+- AUTOTUNE_ON: a key that is not in the cache is tuned. Every candidate configuration is run on the given tensors,
+  and the fastest one is stored in the cache.
+- AUTOTUNE_CACHED (default): a key that is not in the cache uses a heuristic.
+- AUTOTUNE_OFF: the heuristic is always used.
+The cache can be saved to a text file and loaded at startup, so the tuning is done once per machine.
+Cache file: a line per entry, lines starting with '#' are comments.
+    <op> <type> <shape 0> <shape 1> <shape 2> <threads> <algo> <tile_rows> <threads used> <time ms>
+    ex) linear float32 8 784 512 4 tiled 8 4 0.1532    (batch_size, in_features, out_features)
+*/
+#ifndef _AUTOTUNE_H
+#define _AUTOTUNE_H
+
+#include "tensor.h"
+#include "op_linear.h"
+
+#define AUTOTUNE_MAX_ENTRIES 1024
+#define AUTOTUNE_REPEAT 3                   // Runs of each candidate. The fastest run is used.
+#define AUTOTUNE_PARALLEL_THRESHOLD 65536   // Heuristic: multiply-adds per thread
+
+typedef enum {
+    AUTOTUNE_OFF,
+    AUTOTUNE_CACHED,
+    AUTOTUNE_ON
+} autotune_mode_t;
+
+typedef struct {
+    uint32_t lookups;       // Configurations asked by the tuned ops
+    uint32_t hits;          // Found in the cache
+    uint32_t tuned;         // Keys tuned
+    uint32_t candidates;    // Configurations timed while tuning
+    double tuning_ms;       // Time spent tuning
+} autotune_stats_t;
+
+void autotune_set_mode(autotune_mode_t mode);
+autotune_mode_t autotune_get_mode();
+
+// Cache. autotune_load adds (or replaces) the entries of the file and returns the number of entries read,
+// -1 if the file cannot be opened. autotune_save returns 0 on success, -1 on error.
+int autotune_load(const char *path);
+int autotune_save(const char *path);
+void autotune_clear();
+uint32_t autotune_get_num_entries();
+
+void autotune_get_stats(autotune_stats_t *stats);
+void autotune_reset_stats();
+
+// Configuration of linear for the shape, without the cache
+linear_config_t autotune_linear_heuristic(uint32_t batch_size, uint32_t in_features, uint32_t out_features);
+// Configuration of linear for the tensors, by the mode. Tuning writes the output tensor.
+linear_config_t autotune_linear_config(tensor_t *input, linear_t *linear_weight, tensor_t *output);
+
+// Same as linear() / linear_out() with the tuned configuration
+tensor_t *linear_tuned(tensor_t *input, linear_t *linear_weight);
+tensor_t *linear_tuned_out(tensor_t *input, linear_t *linear_weight, tensor_t *output);
+
+#endif // _AUTOTUNE_H
@@ -0,0 +1,40 @@
+/*
+Author: agent
+Created: 2026.10.19
+Copyright 2026
+
+This file is a header file for the ahead-of-time C code generator.
+codegen_emit writes a standalone C source file for an executor and a fixed input shape (float32 only).
+The generated file does not include this library and does not call malloc:
+- every layer is a kernel function with the shapes written as constants, so the compiler can unroll and vectorize
+  the loops, and no shape or type is checked at runtime.
+- the weights are const float arrays (flash on MCU). A batch_norm_1d right after a linear is folded into its weight
+  and bias, and the point-wise layers (batch_norm, relu, residual add) are applied in the epilogue of the previous kernel.
+- the activations are in a single static buffer, planned at generation time: two ping-pong halves, each as large as
+  the largest activation written to it, plus a slot for each output kept for a residual add.
+- the entry point is void <name>_infer(const float *input, float *output).
+  <NAME>_INPUT_SIZE and <NAME>_OUTPUT_SIZE are the number of floats of the input and the output.
+*/
+#ifndef _CODEGEN_H
+#define _CODEGEN_H
+
+#include <stdio.h>
+#include "tensor.h"
+#include "executor.h"
+
+typedef struct {
+    uint32_t input_size;        // Number of floats of the input
+    uint32_t output_size;       // Number of floats of the output
+    uint32_t num_kernels;       // Number of generated kernel functions
+    uint64_t weight_bytes;      // Bytes of the const arrays
+    uint64_t activation_bytes;  // Bytes of the static activation buffer
+} codegen_info_t;
+
+// Write the C source of the executor for the input shape (ndim x shape) to the file.
+// name: prefix of the generated symbols (C identifier). ex) "model" -> model_infer
+// info: filled when it is not NULL.
+// Returns 0 on success, -1 on error (nothing is written).
+int codegen_emit(executor_t *executor, uint32_t ndim, uint32_t *shape, const char *name, FILE *file, codegen_info_t *info);
+int codegen_emit_file(executor_t *executor, uint32_t ndim, uint32_t *shape, const char *name, const char *path, codegen_info_t *info);
+
+#endif // _CODEGEN_H
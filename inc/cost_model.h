@@ -0,0 +1,72 @@
+/*
+Author: agent
+Created: 2026.10.19
+Copyright 2026
+
+This file is a header file for the roofline cost model.
+cost_model_estimate walks the layers of an executor for an input shape, without running it, and reports per layer
+and in total:
+- FLOPs (a multiply-add is 2) and bytes moved (input, weights and output read or written once; float32 data is
+  stored as tensor_data_t, so an element moves sizeof(tensor_data_t) bytes). With fusion, the activations inside
+  a fused group stay in cache and are not counted.
+- arithmetic intensity (FLOPs / byte) and the predicted latency from a machine profile (roofline):
+  max(FLOPs / peak FLOP/s, bytes / bandwidth), plus a fixed overhead per group (a kernel call).
+- weight bytes, and the activation peak of the chosen memory plan. Both are counted like tensor_get_data_memory,
+  so they can be checked against tensor_get_global_data_peak_memory.
+cost_model_calibrate fits the machine profile from benchmark runs on the current machine: a cached linear for
+the peak FLOP/s, a large relu for the bandwidth and a tiny relu for the overhead.
+*/
+#ifndef _COST_MODEL_H
+#define _COST_MODEL_H
+
+#include "tensor.h"
+#include "executor.h"
+
+#define COST_MODEL_CALIBRATE_REPEAT 5   // Runs of each benchmark. The fastest run is used.
+
+typedef struct {
+    double peak_gflops;         // Peak GFLOP/s
+    double bandwidth_gbps;      // Memory bandwidth (GB/s)
+    double overhead_us;         // Fixed cost of a group (us)
+} machine_profile_t;
+
+// Memory plan of the activations
+typedef enum {
+    COST_PLAN_EXECUTOR_RUN,     // executor_run: each output is allocated, freed after the next group (kept outputs at the end)
+    COST_PLAN_SESSION           // session_create (model.h): two ping-pong buffers, a buffer per kept output and the scratch
+} cost_plan_t;
+
+typedef struct {
+    layer_type_t type;
+    uint32_t group;             // Group of the plan
+    uint64_t flops;
+    uint64_t bytes;             // Bytes moved
+    uint64_t weight_bytes;
+    uint64_t output_bytes;      // Size of the output (tensor_get_data_memory)
+    double intensity;           // FLOPs / byte
+    double predicted_ms;
+    uint8_t memory_bound;       // 1 - bytes / bandwidth is larger than FLOPs / peak
+} layer_cost_t;
+
+typedef struct {
+    uint32_t num_layers;
+    layer_cost_t *layers;
+    uint64_t flops;
+    uint64_t bytes;
+    uint64_t weight_bytes;
+    uint64_t activation_peak;   // Bytes of activations alive at once (the input is not counted)
+    double intensity;
+    double predicted_ms;
+} model_cost_t;
+
+// Default: a Cortex-M7 class MCU {0.2 GFLOP/s, 0.4 GB/s, 5 us}. Use the numbers of the board, or calibrate on the machine.
+machine_profile_t cost_model_default_profile();
+int cost_model_calibrate(machine_profile_t *profile);
+
+// Estimate the cost of the executor for the input shape (float32). Builds the plan of the executor (fusion setting).
+// cost->layers is allocated, free with cost_model_free. Returns 0 on success, -1 on error.
+int cost_model_estimate(executor_t *executor, uint32_t ndim, uint32_t *shape, cost_plan_t plan, machine_profile_t *profile, model_cost_t *cost);
+void cost_model_free(model_cost_t *cost);
+void cost_model_print(model_cost_t *cost);
+
+#endif // _COST_MODEL_H
@@ -0,0 +1,132 @@
+/*
+Author: agent
+Created: 2026.10.19
+Copyright 2026
+
+This file is a header file for the layer executor.
+The executor holds a chain of layers (linear, batch_norm_1d/2d, relu, pooling, residual add, flatten) and runs them in order.
+A residual add adds the kept output of an earlier layer (skip connection).
+executor_run runs the chain on a whole tensor.
+executor_run_tiled runs the chain tile by tile, so only tile-sized working buffers are allocated.
+The input tiles are pulled from a reader callback and the output tiles are pushed to a sink callback.
+
+The layers are run in groups. Without fusion, every layer is a group by itself and writes its whole output to memory.
+With fusion (executor_set_fusion), consecutive layers are run as a single group (float32 only):
+- linear followed by batch_norm_1d, relu, residual add and more linear layers is computed depth-first,
+  EXECUTOR_FUSE_ROWS rows at a time. batch_norm_1d, relu and residual add are applied in the epilogue of the linear
+  before the result is stored, and the intermediate rows stay in two small scratch buffers (cache). A session (model.h)
+  owns the scratch buffers, otherwise each run of the group allocates them.
+- point-wise layers (batch_norm_1d/2d, relu, residual add) are applied in a single pass over the data,
+  EXECUTOR_FUSE_CHUNK elements at a time. A following global_avg_pool_2d is fused into the pass,
+  so the point-wise output is reduced without being stored.
+*/
+#ifndef _EXECUTOR_H
+#define _EXECUTOR_H
+
+#include "tensor.h"
+#include "op_linear.h"
+#include "op_norm.h"
+#include "op_activation.h"
+#include "op_pool.h"
+
+#define EXECUTOR_MAX_NDIM 4
+#define EXECUTOR_FUSE_ROWS 4    // Number of rows computed at once by a fused linear group
+#define EXECUTOR_FUSE_CHUNK 256 // Number of elements computed at once by a fused point-wise group
+
+typedef enum {
+    LAYER_LINEAR,
+    LAYER_BATCH_NORM_1D,
+    LAYER_BATCH_NORM_2D,
+    LAYER_RELU,
+    LAYER_RESIDUAL_ADD,
+    LAYER_MAX_POOL_2D,
+    LAYER_AVG_POOL_2D,
+    LAYER_GLOBAL_AVG_POOL_2D,
+    LAYER_FLATTEN
+} layer_type_t;
+
+typedef struct {
+    layer_type_t type;
+    void *op;       // linear_t *, batch_norm_t *, pool2d_t *, residual_t *, or NULL
+} layer_t;
+
+typedef struct {
+    int32_t source;     // Index of the layer whose output is added. -1: input of the executor
+} residual_t;
+
+// Consecutive layers that are run together
+typedef struct {
+    uint32_t first;     // Index of the first layer
+    uint32_t count;     // Number of layers
+    uint32_t scratch_elements;  // Elements of each scratch buffer of a fused linear group, otherwise 0
+} layer_group_t;
+
+typedef struct {
+    uint32_t num_layers;
+    uint32_t capacity;
+    layer_t *layers;
+
+    // Execution plan. Rebuilt before a run when the layers or the fusion setting are changed.
+    uint8_t fusion;             // 1 - fuse consecutive layers
+    uint8_t plan_ready;
+    uint32_t num_groups;
+    layer_group_t *groups;
+    tensor_t **folded;          // Folded batch norm of each batch norm layer (2 x channels), otherwise NULL
+    uint32_t scratch_elements;  // Largest scratch_elements of the groups
+    uint8_t *keep_output;       // keep_output[l + 1]: the output of layer l is used by a residual add. [0]: executor input
+    tensor_t **saved;           // Kept outputs during a run, same index as keep_output
+    tensor_t *scratch[2];       // Scratch buffers of scratch_elements given by the caller (session), NULL: allocated by the run
+
+    uint64_t activation_bytes;  // Bytes of activations written to memory by the last run
+} executor_t;
+
+// Location of a tile in the whole input (or output) tensor.
+// Batch tiling: tile is (count x ...) starting at batch_offset, row_offset is 0.
+// Spatial tiling: tile is (1 x channels x count x width) starting at (batch_offset, row_offset).
+// The number of batch items (or rows) in the tile is in the tile tensor's shape.
+typedef struct {
+    uint32_t batch_offset;
+    uint32_t row_offset;
+} executor_tile_t;
+
+// Reader fills the tile tensor with the input data of the region. Returns 0 on success.
+typedef int (*executor_reader_t)(void *ctx, tensor_t *tile, executor_tile_t *region);
+// Sink consumes the output tile of the region. Returns 0 on success.
+typedef int (*executor_sink_t)(void *ctx, tensor_t *tile, executor_tile_t *region);
+
+// Create and free
+executor_t *executor_create();
+void executor_free(executor_t *executor, uint8_t deep);
+
+// Append layers
+executor_t *executor_add_linear(executor_t *executor, linear_t *linear_weight);
+executor_t *executor_add_batch_norm_1d(executor_t *executor, batch_norm_t *batch_norm_weight);
+executor_t *executor_add_batch_norm_2d(executor_t *executor, batch_norm_t *batch_norm_weight);
+executor_t *executor_add_relu(executor_t *executor);
+executor_t *executor_add_residual(executor_t *executor, int32_t source);
+executor_t *executor_add_max_pool_2d(executor_t *executor, pool2d_t *pool);
+executor_t *executor_add_avg_pool_2d(executor_t *executor, pool2d_t *pool);
+executor_t *executor_add_global_avg_pool_2d(executor_t *executor);
+executor_t *executor_add_flatten(executor_t *executor);
+
+// Fusion. 0 - run layer by layer (default), 1 - fuse consecutive layers
+void executor_set_fusion(executor_t *executor, uint8_t fusion);
+
+// Shape inference. Returns 0 on success, -1 on error.
+int executor_infer_shape(executor_t *executor, uint32_t ndim, uint32_t *shape, uint32_t *out_ndim, uint32_t *out_shape);
+// Output shape of the single layer at index layer
+int executor_infer_layer_shape(executor_t *executor, uint32_t layer, uint32_t ndim, uint32_t *shape, uint32_t *out_ndim, uint32_t *out_shape);
+
+// Build the execution plan now (otherwise it is built by the first run). A run does not change the plan,
+// so the layers and the plan can be shared by several sessions (model.h) once it is built.
+void executor_prepare(executor_t *executor);
+// Run the group of the plan into output. The output shape must be the one the group infers for the input, otherwise an
+// error is returned (a 1D input is a (1 x n) row). The kept outputs read by the group must be in executor->saved.
+tensor_t *executor_run_group_out(executor_t *executor, uint32_t group, tensor_t *input, tensor_t *output);
+
+// Run
+tensor_t *executor_run(executor_t *executor, tensor_t *input);
+int executor_run_tiled(executor_t *executor, tensor_type_t type, uint32_t ndim, uint32_t *shape, uint32_t tile_size,
+                       executor_reader_t reader, executor_sink_t sink, void *ctx);
+
+#endif // _EXECUTOR_H
@@ -0,0 +1,193 @@
+/*
+Author: agent
+Created: 2026.10.19
+Copyright 2026
+
+This file is a header file for fast approximations of math functions.
+The functions are static inline and branch-free, so loops that call them can be vectorized by the compiler.
+Range checks are done with integer masks on the bits: with the default -ftrapping-math, gcc does not if-convert
+float compares, and a loop with a float compare is not vectorized. Use contiguous float arrays (not tensor_data_t) in the loop.
+
+Each function has two tiers (fast_math_tier_t): ACCURATE (a few ULP) and APPROX (about 13 bits, faster).
+The errors below are measured over the full float range (example18_fast_math.c). NaN is not supported.
+
+fast_expf: exp(x) = 2^n * exp(r), n = round(x / ln2), |r| <= ln2 / 2.
+exp(r) is a degree-6 minimax polynomial (Cephes expf coefficients).
+Max relative error: 2^-22 (about 2 ULP) for x in [-87.3, 88.7]. x < -87.3 returns 0, x > 88.7 returns +inf.
+fast_expf_approx: same, exp(r) is a degree-3 minimax polynomial. Max relative error 7.5e-5.
+
+fast_tanhf: |x| < 0.625: odd polynomial (Cephes tanhf coefficients), else 1 - 2 / (exp(2|x|) + 1). Max error 1 ULP.
+fast_tanhf_approx: linear interpolation in a table of tanh on [0, 8] (step 1/32), 1 above. Max absolute error 1e-4.
+The table lookup is a gather, so the loop is vectorized only on targets with gather instructions (AVX2).
+
+fast_sigmoidf(_approx): 1 / (1 + exp(-x)) with fast_expf(_approx): 2 ULP (approx: relative error 7.5e-5).
+Results below FLT_MIN (x < -87.3) are 0.
+
+fast_rsqrtf: 1 / sqrt(x). Initial guess from the bits (0x5f375a86 - (bits >> 1), relative error 3.4e-2),
+then 3 Newton steps y = y * (1.5 - 0.5 * x * y * y), which double the correct bits each: 3 ULP.
+fast_rsqrtf_approx: 2 Newton steps. Max relative error 4.7e-6 (73 ULP).
+x must be a positive normal float: 0, denormals, +inf and negative x are not supported.
+
+fast_math_exp, fast_math_tanh, fast_math_sigmoid, fast_math_rsqrt apply a function to an array with the chosen tier.
+*/
+#ifndef _FAST_MATH_H
+#define _FAST_MATH_H
+
+#include <stdint.h>
+
+#define FAST_MATH_LOG2E 1.44269504088896341f
+#define FAST_MATH_LN2_HI 0.693359375f           // ln2 = LN2_HI + LN2_LO. LN2_HI has few bits, so n * LN2_HI is exact.
+#define FAST_MATH_LN2_LO -2.12194440e-4f
+#define FAST_MATH_EXP_MIN_BITS 0x42aeac50u    // 87.3365448f = -ln(FLT_MIN), sign bit cleared
+#define FAST_MATH_EXP_MAX_BITS 0x42b17218u    // 88.7228394f = ln(FLT_MAX)
+#define FAST_MATH_TANH_POLY_BITS 0x3f200000u  // 0.625f
+#define FAST_MATH_TANH_TABLE_SIZE 256           // Intervals of the tanh table
+#define FAST_MATH_TANH_TABLE_SCALE 32.0f        // Intervals per unit: the table covers [0, 8]
+#define FAST_MATH_TANH_TABLE_MAX_BITS 0x41000000u  // 8.0f
+#define FAST_MATH_RSQRT_MAGIC 0x5f375a86u
+
+typedef enum {
+    FAST_MATH_ACCURATE,     // A few ULP
+    FAST_MATH_APPROX        // About 13 bits (rsqrt: 17 bits)
+} fast_math_tier_t;
+
+typedef union {
+    float f;
+    uint32_t u;
+} fast_math_bits_t;
+
+extern const float fast_math_tanh_table[FAST_MATH_TANH_TABLE_SIZE + 1];   // tanh(i / 32), src/fast_math.c
+
+// exp(x) = 2^n * exp(r): the range reduction and the scaling are shared by the tiers, approx selects the polynomial.
+// approx is a constant in the callers, so the unused polynomial is removed.
+static inline float fast_expf_tier(float x, const int approx) {
+    const float round_magic = 12582912.0f;    // 1.5 * 2^23. Adding it rounds to the nearest integer.
+
+    // Out of range: |x| above the limit of its sign. x is clamped to the limit, and the result is replaced at the end.
+    fast_math_bits_t in;
+    in.f = x;
+    const uint32_t sign = in.u & 0x80000000u;
+    const uint32_t limit = sign ? FAST_MATH_EXP_MIN_BITS : FAST_MATH_EXP_MAX_BITS;
+    const uint32_t mask = 0u - (uint32_t)((in.u & 0x7fffffffu) > limit);
+    in.u = (in.u & ~mask) | ((sign | limit) & mask);
+    x = in.f;
+
+    // x = n * ln2 + r
+    const float n = (x * FAST_MATH_LOG2E + round_magic) - round_magic;
+    float r = x - n * FAST_MATH_LN2_HI;
+    r = r - n * FAST_MATH_LN2_LO;
+
+    float y;
+    if (approx) {
+        // exp(r) = c0 + c1 * r + c2 * r^2 + c3 * r^3 (minimax on [-ln2 / 2, ln2 / 2], relative error)
+        float p = 1.6566842348e-1f;
+        p = p * r + 5.0496326418e-1f;
+        p = p * r + 1.0001641858e+0f;
+        y = p * r + 9.9992807354e-1f;
+    } else {
+        // exp(r) = 1 + r + r^2 * p(r)
+        float p = 1.9875691500e-4f;
+        p = p * r + 1.3981999507e-3f;
+        p = p * r + 8.3334519073e-3f;
+        p = p * r + 4.1665795894e-2f;
+        p = p * r + 1.6666665459e-1f;
+        p = p * r + 5.0000001201e-1f;
+        y = p * r * r + r + 1.0f;
+    }
+
+    // y * 2^n. 2^n is built in two halves, so n = 128 (x near ln(FLT_MAX)) does not overflow the exponent.
+    const int32_t k = (int32_t)n;
+    fast_math_bits_t half, rest, out;
+    half.u = (uint32_t)((k >> 1) + 127) << 23;
+    rest.u = (uint32_t)((k - (k >> 1)) + 127) << 23;
+    out.f = y * half.f * rest.f;
+    out.u = (out.u & ~mask) | ((sign ? 0u : 0x7f800000u) & mask);   // 0 (underflow) or +inf (overflow)
+    return out.f;
+}
+
+static inline float fast_expf(float x) {
+    return fast_expf_tier(x, 0);
+}
+
+static inline float fast_expf_approx(float x) {
+    return fast_expf_tier(x, 1);
+}
+
+static inline float fast_tanhf(float x) {
+    fast_math_bits_t in, small, large;
+    in.f = x;
+    const uint32_t sign = in.u & 0x80000000u;
+    const uint32_t mask = 0u - (uint32_t)((in.u & 0x7fffffffu) < FAST_MATH_TANH_POLY_BITS);
+
+    // |x| < 0.625: tanh(x) = x + x * s * p(s), s = x^2
+    const float s = x * x;
+    float p = -5.70498872745e-3f;
+    p = p * s + 2.06390887954e-2f;
+    p = p * s - 5.37397155531e-2f;
+    p = p * s + 1.33314422036e-1f;
+    p = p * s - 3.33332819422e-1f;
+    small.f = p * s * x + x;
+
+    // |x| >= 0.625: tanh(|x|) = 1 - 2 / (exp(2|x|) + 1). exp overflows to +inf for |x| > 44.4, and the result is 1.
+    in.u &= 0x7fffffffu;
+    large.f = 1.0f - 2.0f / (fast_expf(in.f + in.f) + 1.0f);
+    large.u |= sign;
+
+    small.u = (small.u & mask) | (large.u & ~mask);
+    return small.f;
+}
+
+static inline float fast_tanhf_approx(float x) {
+    fast_math_bits_t in, out;
+    in.f = x;
+    const uint32_t sign = in.u & 0x80000000u;
+    in.u &= 0x7fffffffu;
+    const uint32_t mask = 0u - (uint32_t)(in.u >= FAST_MATH_TANH_TABLE_MAX_BITS);
+    in.u = (in.u & ~mask) | (FAST_MATH_TANH_TABLE_MAX_BITS & mask);   // |x| >= 8: the last entry
+
+    // tanh(|x|) = table[i] + f * (table[i + 1] - table[i]), |x| * 32 = i + f. At |x| = 8, i is the last interval.
+    const float t = in.f * FAST_MATH_TANH_TABLE_SCALE;
+    int32_t i = (int32_t)t;
+    i -= (int32_t)(i == FAST_MATH_TANH_TABLE_SIZE);
+    const float f = t - (float)i;
+    const float lo = fast_math_tanh_table[i];
+    out.f = lo + f * (fast_math_tanh_table[i + 1] - lo);
+    out.u |= sign;
+    return out.f;
+}
+
+static inline float fast_sigmoidf(float x) {
+    return 1.0f / (1.0f + fast_expf(-x));
+}
+
+static inline float fast_sigmoidf_approx(float x) {
+    return 1.0f / (1.0f + fast_expf_approx(-x));
+}
+
+static inline float fast_rsqrtf_tier(float x, const int steps) {
+    fast_math_bits_t in;
+    in.f = x;
+    in.u = FAST_MATH_RSQRT_MAGIC - (in.u >> 1);
+    const float half = 0.5f * x;
+    float y = in.f;
+    for (int i = 0; i < steps; i++) {
+        y = y * (1.5f - half * y * y);
+    }
+    return y;
+}
+
+static inline float fast_rsqrtf(float x) {
+    return fast_rsqrtf_tier(x, 3);
+}
+
+static inline float fast_rsqrtf_approx(float x) {
+    return fast_rsqrtf_tier(x, 2);
+}
+
+// Array versions: output[i] = f(input[i]) for n elements. output can be the input itself (in-place).
+void fast_math_exp(const float *input, float *output, uint32_t n, fast_math_tier_t tier);
+void fast_math_tanh(const float *input, float *output, uint32_t n, fast_math_tier_t tier);
+void fast_math_sigmoid(const float *input, float *output, uint32_t n, fast_math_tier_t tier);
+void fast_math_rsqrt(const float *input, float *output, uint32_t n, fast_math_tier_t tier);
+
+#endif // _FAST_MATH_H
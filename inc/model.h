@@ -0,0 +1,64 @@
+/*
+Author: agent
+Created: 2026.10.19
+Copyright 2026
+
+This file is a header file for the shared model and the inference sessions.
+A model wraps an executor whose layers and plan (groups, folded batch norm) are built once and then only read,
+so a single copy of the weights can serve several threads at the same time.
+- model_create builds the plan. The model is reference counted: model_retain / model_release,
+  and the last release frees the model (and the executor with its weights when the model owns it).
+  The executor must not be changed (executor_add_*, executor_set_fusion) or run directly while the model is used.
+- a session is the per-thread state of a model (float32): the kept outputs of the residual adds, the activation buffers
+  for a fixed input shape and the scratch of the fused linear groups, allocated by session_create (two ping-pong buffers,
+  a buffer per kept output and two scratch buffers). Batch norm is folded by the plan. So session_run does not allocate
+  tensor data, except batch_norm_1d/2d on a transposed input (folded at each call). Each thread runs its own session
+  without locks.
+  A session holds a reference to the model, so the model can be released while sessions are running.
+*/
+#ifndef _MODEL_H
+#define _MODEL_H
+
+#include "tensor.h"
+#include "executor.h"
+
+typedef struct {
+    executor_t *executor;
+    uint8_t own;                // 1 - the executor and the ops of its layers are freed with the model
+    uint32_t refcount;
+    uint64_t weight_bytes;      // Bytes of the weights and the folded batch norm (shared by the sessions)
+} model_t;
+
+typedef struct {
+    model_t *model;
+    executor_t executor;        // Copy of the model's executor_t: the layers and the plan are shared, saved and scratch are the session's own
+    uint32_t input_ndim;
+    uint32_t input_shape[EXECUTOR_MAX_NDIM];
+    tensor_t input_row;         // A 1D input runs as a (1 x n) row, like executor_run: view of the input of the last run
+    uint32_t input_row_shape[2];
+    uint32_t input_row_transpose[2];
+    tensor_t *buffers[2];       // Ping-pong activation buffers
+    tensor_t **kept;            // [l + 1]: buffer of the output of layer l kept for a residual add, otherwise NULL
+    tensor_t **outputs;         // [g]: output of group g, a view of a buffer
+    uint64_t activation_bytes;  // Bytes of the buffers of the session (scratch included)
+} session_t;
+
+// Create and free. own: 1 - the last release frees the executor with executor_free(executor, 1),
+// 0 - the executor is freed by the caller after the last release. The reference count of a new model is 1.
+model_t *model_create(executor_t *executor, uint8_t own);
+model_t *model_retain(model_t *model);
+void model_release(model_t *model);
+uint32_t model_get_refcount(model_t *model);
+
+// Session for the input shape (ndim x shape). The session holds a reference to the model.
+// A 1D shape (n) is run as a (1 x n) batch, like executor_run, so the outputs are 2D.
+session_t *session_create(model_t *model, uint32_t ndim, uint32_t *shape);
+void session_free(session_t *session);
+// Run the model on input (the shape of the session). The output is owned by the session and is valid until the next run.
+tensor_t *session_run(session_t *session, tensor_t *input);
+// Run only the groups [first, end) of the plan, ex. a stage of a pipeline (pipeline.h).
+// input is used only when first is 0, otherwise the groups read the output of group first - 1 kept by the session.
+// Returns the output of group end - 1.
+tensor_t *session_run_groups(session_t *session, tensor_t *input, uint32_t first, uint32_t end);
+
+#endif // _MODEL_H
@@ -0,0 +1,10 @@
+#ifndef _OP_ACTIVATION_H
+#define _OP_ACTIVATION_H
+
+#include "tensor.h"
+
+// Element-wise activations. Any shape. output can be the input itself (in-place).
+tensor_t *relu(tensor_t *input);
+tensor_t *relu_out(tensor_t *input, tensor_t *output);
+
+#endif // _OP_ACTIVATION_H
@@ -0,0 +1,33 @@
+#ifndef _OP_ELEMENTWISE_H
+#define _OP_ELEMENTWISE_H
+
+#include "tensor.h"
+
+#define ELEMENTWISE_MAX_NDIM 8
+#define ELEMENTWISE_PARALLEL_THRESHOLD 65536   // Number of output elements above which the op is multithreaded
+
+typedef enum {
+    ELEMENTWISE_ADD,
+    ELEMENTWISE_SUB,
+    ELEMENTWISE_MUL,
+    ELEMENTWISE_MAX,
+    ELEMENTWISE_MIN
+} elementwise_op_t;
+
+// output = a (op) b, with NumPy-style broadcasting.
+// The shapes are aligned from the last axis. Each pair of sizes must be equal, or one of them must be 1.
+// a and b can be transposed. Types must be the same (int64 or float32).
+tensor_t *elementwise(elementwise_op_t op, tensor_t *a, tensor_t *b);
+// output must have the broadcast shape. output can be a (or b) itself when it has the broadcast shape.
+tensor_t *elementwise_out(elementwise_op_t op, tensor_t *a, tensor_t *b, tensor_t *output);
+
+tensor_t *elementwise_add(tensor_t *a, tensor_t *b);
+tensor_t *elementwise_sub(tensor_t *a, tensor_t *b);
+tensor_t *elementwise_mul(tensor_t *a, tensor_t *b);
+tensor_t *elementwise_max(tensor_t *a, tensor_t *b);
+tensor_t *elementwise_min(tensor_t *a, tensor_t *b);
+
+// In-place accumulate: a = a + b. b is broadcast to the shape of a. No allocation (ex. skip connection).
+tensor_t *elementwise_add_inplace(tensor_t *a, tensor_t *b);
+
+#endif // _OP_ELEMENTWISE_H
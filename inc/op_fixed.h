@@ -0,0 +1,58 @@
+#ifndef _OP_FIXED_H
+#define _OP_FIXED_H
+
+#include "tensor.h"
+#include "op_linear.h"
+#include "op_norm.h"
+
+// Fixed-point (Q format) ops for targets without FPU. The data of an int16 / int32 tensor is value * 2^frac_bits
+// (tensor->frac_bits), ex) Q15: int16 with 15 fraction bits, [-1, 1). Rounding is to nearest, and every result is
+// saturated to the range of the output type. No float is used at runtime.
+#define FIXED_Q15 15
+#define FIXED_Q31 31
+
+// Conversion. fixed_from_float_out uses the type and frac_bits of the output.
+tensor_t *fixed_from_float(tensor_t *input, tensor_type_t type, uint8_t frac_bits);
+tensor_t *fixed_from_float_out(tensor_t *input, tensor_t *output);
+tensor_t *fixed_to_float(tensor_t *input);
+tensor_t *fixed_to_float_out(tensor_t *input, tensor_t *output);
+// Largest frac_bits (up to 15 for int16, 31 for int32) that holds the largest absolute value of the float tensor
+uint8_t fixed_frac_bits_for(tensor_t *input, tensor_type_t type);
+
+// Linear. weight: int16 (out_features x in_features), bias: int32 (out_features) or NULL, each with its own frac_bits.
+// The weight is also packed into a contiguous int16 array (2 bytes per weight) for the kernel.
+typedef struct {
+    tensor_t *weight;
+    tensor_t *bias;
+    int16_t *packed_weight;
+} fixed_linear_t;
+
+fixed_linear_t *fixed_linear_create(tensor_t *weight, tensor_t *bias);
+// Quantize a float linear: weight to int16 and bias to int32, with frac_bits from their largest absolute values
+fixed_linear_t *fixed_linear_from_float(linear_t *linear_weight);
+void fixed_linear_free(fixed_linear_t *linear_weight, uint8_t deep);
+// input: int16 or int32 (batch_size x in_features). output: int16 or int32 (batch_size x out_features) with frac_bits.
+// int16 x int16 products are accumulated in int64 (int32 inputs too), so the sum does not overflow,
+// and the accumulator is shifted to the output Q format once. The bias is added with saturation.
+tensor_t *fixed_linear(tensor_t *input, fixed_linear_t *linear_weight, tensor_type_t type, uint8_t frac_bits);
+tensor_t *fixed_linear_out(tensor_t *input, fixed_linear_t *linear_weight, tensor_t *output);
+
+// Batch norm folded to an integer multiply-shift: output = ((input * multiplier[c]) >> shift[c]) + offset[c].
+// multiplier: int16 (channels), each channel in its own Q format (multiplier_frac_bits[c], up to 31; multiplier->frac_bits
+// is not used), so channels with small and large coefficients keep the same precision.
+// offset: int32 (channels) in the output Q format (offset->frac_bits).
+// shift[c] follows from the frac_bits of the input, multiplier_frac_bits[c] and the output.
+typedef struct {
+    tensor_t *multiplier;
+    uint8_t *multiplier_frac_bits;
+    tensor_t *offset;
+} fixed_batch_norm_t;
+
+fixed_batch_norm_t *fixed_batch_norm_from_float(batch_norm_t *batch_norm_weight, uint8_t out_frac_bits);
+void fixed_batch_norm_free(fixed_batch_norm_t *batch_norm_weight);
+// input: int16 or int32, 2D (batch_size x channels) or 4D (batch_size x channels x height x width).
+// output: same shape, int16 or int32, with the frac_bits of the offset.
+tensor_t *fixed_batch_norm(tensor_t *input, fixed_batch_norm_t *batch_norm_weight, tensor_type_t type);
+tensor_t *fixed_batch_norm_out(tensor_t *input, fixed_batch_norm_t *batch_norm_weight, tensor_t *output);
+
+#endif // _OP_FIXED_H
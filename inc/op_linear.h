@@ -11,5 +11,29 @@ typedef struct {
 linear_t *linear_create(tensor_t *weight, tensor_t *bias);
 void linear_free(linear_t *linear, uint8_t deep);
 tensor_t *linear(tensor_t *input, linear_t *linear_weight);
+tensor_t *linear_out(tensor_t *input, linear_t *linear_weight, tensor_t *output);
+
+// Kernel variants of linear_out for float32. Chosen per shape by the autotuner (autotune.h).
+typedef enum {
+    LINEAR_ALGO_DIRECT,     // linear_out: one dot product at a time, single thread. Any type and transpose.
+    LINEAR_ALGO_GEMV,       // One input row at a time, 8 partial sums per dot product. Weight rows split across threads.
+    LINEAR_ALGO_TILED       // tile_rows input rows packed together, so each weight value is loaded once per tile
+} linear_algo_t;
+
+#define LINEAR_MAX_TILE_ROWS 8
+
+typedef struct {
+    linear_algo_t algo;
+    uint32_t tile_rows;     // LINEAR_ALGO_TILED: 2 to LINEAR_MAX_TILE_ROWS. Ignored by the others.
+    uint32_t threads;       // Number of threads (at most parallel_get_num_threads()). Ignored by LINEAR_ALGO_DIRECT.
+} linear_config_t;
+
+// Same as linear_out with the given kernel. GEMV and TILED need float32 tensors that are not transposed,
+// otherwise LINEAR_ALGO_DIRECT is used.
+// config->threads ranges run, at most one per weight row.
+// TILED packs the input into a buffer of the calling thread (tile_rows x in_features floats per tile), kept for the
+// next calls. linear_free_pack frees it, ex. before the thread exits.
+tensor_t *linear_out_config(tensor_t *input, linear_t *linear_weight, tensor_t *output, linear_config_t *config);
+void linear_free_pack();
 
 #endif // _OP_LINEAR_H
\ No newline at end of file
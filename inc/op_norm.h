@@ -3,6 +3,9 @@
 
 #include "tensor.h"
 
+#define NORM_PARALLEL_THRESHOLD 65536   // Number of elements above which layer_norm / group_norm are multithreaded
+#define NORM_CHUNK 256                  // Elements per statistics pass (contiguous float buffer). Multiple of 8.
+
 typedef struct {
     tensor_t *mean;
     tensor_t *var;
@@ -14,6 +17,47 @@ typedef struct {
 batch_norm_t *batch_norm_create(tensor_t *mean, tensor_t *var, tensor_t *epsilon, tensor_t *gamma, tensor_t *beta);
 void batch_free(batch_norm_t *batch_norm, uint8_t deep);
 
+tensor_t *batch_norm_fold(batch_norm_t *batch_norm_weight);
+
+tensor_t *batch_norm_1d(tensor_t *input, batch_norm_t *batch_norm_weight);
+tensor_t *batch_norm_1d_out(tensor_t *input, batch_norm_t *batch_norm_weight, tensor_t *output);
 tensor_t *batch_norm_2d(tensor_t *input, batch_norm_t *batch_norm_weight);
+tensor_t *batch_norm_2d_out(tensor_t *input, batch_norm_t *batch_norm_weight, tensor_t *output);
+
+// LayerNorm and GroupNorm compute mean and variance of each input at runtime (no running statistics).
+// The statistics are computed in one pass (chunked Welford, merged with Chan's formula), then the
+// normalize-scale-shift pass writes the output. Rows (groups) are multithreaded.
+typedef struct {
+    uint32_t normalized_size;   // Number of elements of the normalized trailing axes (ex. 768 for LayerNorm(768))
+    float epsilon;
+    tensor_t *gamma;            // (normalized_size) or NULL (no affine)
+    tensor_t *beta;             // (normalized_size) or NULL
+} layer_norm_t;
+
+typedef struct {
+    uint32_t num_groups;
+    uint32_t num_channels;
+    float epsilon;
+    tensor_t *gamma;            // 1D tensor (channels) or NULL (no affine)
+    tensor_t *beta;             // 1D tensor (channels) or NULL
+} group_norm_t;
+
+// epsilon: 1e-5 in PyTorch
+layer_norm_t *layer_norm_create(uint32_t normalized_size, tensor_t *gamma, tensor_t *beta, float epsilon);
+void layer_norm_free(layer_norm_t *layer_norm, uint8_t deep);
+group_norm_t *group_norm_create(uint32_t num_groups, uint32_t num_channels, tensor_t *gamma, tensor_t *beta, float epsilon);
+void group_norm_free(group_norm_t *group_norm, uint8_t deep);
+
+// output = (input - mean) / sqrt(var + epsilon) * gamma + beta, over the trailing axes.
+// input: (..., normalized axes). The product of the trailing axes must be normalized_size.
+// output: same shape as input. output can be the input itself (in-place). float32 only.
+tensor_t *layer_norm(tensor_t *input, layer_norm_t *layer_norm_weight);
+tensor_t *layer_norm_out(tensor_t *input, layer_norm_t *layer_norm_weight, tensor_t *output);
+
+// Statistics over each (batch, group), gamma and beta per channel.
+// input: (batch_size x channels x ...), 2D to 4D. channels must be divisible by num_groups.
+// output: same shape as input. output can be the input itself (in-place). float32 only.
+tensor_t *group_norm(tensor_t *input, group_norm_t *group_norm_weight);
+tensor_t *group_norm_out(tensor_t *input, group_norm_t *group_norm_weight, tensor_t *output);
 
 #endif // _OP_NORM_H
\ No newline at end of file
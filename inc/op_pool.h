@@ -0,0 +1,35 @@
+#ifndef _OP_POOL_H
+#define _OP_POOL_H
+
+#include "tensor.h"
+
+#define POOL_PARALLEL_THRESHOLD 65536   // Number of window reads above which the op is multithreaded
+#define POOL_CHUNK 1024                 // Floats in the row buffer of a thread. Maximum kernel_size.
+
+typedef struct {
+    uint32_t kernel_h;
+    uint32_t kernel_w;
+    uint32_t stride_h;
+    uint32_t stride_w;
+    uint32_t padding_h;
+    uint32_t padding_w;
+} pool2d_t;
+
+pool2d_t *pool2d_create(uint32_t kernel_size, uint32_t stride, uint32_t padding);
+void pool2d_free(pool2d_t *pool);
+
+// input: 4D tensor (batch_size x channels x height x width)
+// output: 4D tensor (batch_size x channels x out_height x out_width)
+// out_height = (height + 2 * padding - kernel_size) / stride + 1
+tensor_t *max_pool_2d(tensor_t *input, pool2d_t *pool);
+tensor_t *max_pool_2d_out(tensor_t *input, pool2d_t *pool, tensor_t *output);
+tensor_t *avg_pool_2d(tensor_t *input, pool2d_t *pool);
+tensor_t *avg_pool_2d_out(tensor_t *input, pool2d_t *pool, tensor_t *output);
+
+// input: 4D tensor (batch_size x channels x height x width)
+// output: 4D tensor (batch_size x channels x 1 x 1). Same as AdaptiveAvgPool2d(1) of PyTorch.
+// output can be the input itself (in-place).
+tensor_t *global_avg_pool_2d(tensor_t *input);
+tensor_t *global_avg_pool_2d_out(tensor_t *input, tensor_t *output);
+
+#endif // _OP_POOL_H
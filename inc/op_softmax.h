@@ -0,0 +1,46 @@
+#ifndef _OP_SOFTMAX_H
+#define _OP_SOFTMAX_H
+
+#include "tensor.h"
+#include "op_linear.h"
+
+#define SOFTMAX_PARALLEL_THRESHOLD 65536   // Number of elements above which the op is multithreaded
+#define SOFTMAX_CHUNK 256                  // Elements per exp pass (contiguous float buffer). Multiple of 8.
+#define LINEAR_HEAD_ROWS 4                 // Rows that share one pass over the weight matrix
+#define LINEAR_HEAD_MIN_CLASSES 2048       // Minimum number of classes per thread in the fused heads
+
+// Softmax over the last axis, computed as exp(x - max) / sum(exp(x - max)).
+// input: 1D tensor (classes) or 2D tensor (batch_size x classes). float32 only.
+// output: same shape as input. output can be the input itself (in-place).
+// exp is fast_expf (see fast_math.h), max relative error 2^-22.
+tensor_t *softmax(tensor_t *input);
+tensor_t *softmax_out(tensor_t *input, tensor_t *output);
+// log(softmax(x)) = x - max - log(sum(exp(x - max))). Does not underflow to -inf for small probabilities.
+tensor_t *log_softmax(tensor_t *input);
+tensor_t *log_softmax_out(tensor_t *input, tensor_t *output);
+
+// Index of the largest value over the last axis. The first index wins on ties.
+// input: 1D tensor (classes) or 2D tensor (batch_size x classes). float32 only.
+// output: 1D int64 tensor (batch_size). 1 for 1D input.
+tensor_t *argmax(tensor_t *input);
+tensor_t *argmax_out(tensor_t *input, tensor_t *output);
+
+// k largest values over the last axis, sorted in descending order. The lower index wins on ties.
+// Returns values: 2D float32 tensor (batch_size x k). *indices is set to a new 2D int64 tensor (batch_size x k).
+tensor_t *topk(tensor_t *input, uint32_t k, tensor_t **indices);
+tensor_t *topk_out(tensor_t *input, uint32_t k, tensor_t *values, tensor_t *indices);
+
+// Fused classifier heads. The logits of linear(input) are reduced while they are computed,
+// so the (batch_size x classes) logit / probability tensor is never allocated.
+// input: 1D tensor (in_features) or 2D tensor (batch_size x in_features). float32 only.
+
+// argmax(linear(input)). output: 1D int64 tensor (batch_size).
+tensor_t *linear_argmax(tensor_t *input, linear_t *linear_weight);
+tensor_t *linear_argmax_out(tensor_t *input, linear_t *linear_weight, tensor_t *output);
+// topk(softmax(linear(input)), k). The values are softmax probabilities over all classes,
+// normalized with an online (running max) sum of exp.
+// Returns values: 2D float32 tensor (batch_size x k). *indices is set to a new 2D int64 tensor (batch_size x k).
+tensor_t *linear_topk(tensor_t *input, linear_t *linear_weight, uint32_t k, tensor_t **indices);
+tensor_t *linear_topk_out(tensor_t *input, linear_t *linear_weight, uint32_t k, tensor_t *values, tensor_t *indices);
+
+#endif // _OP_SOFTMAX_H
@@ -0,0 +1,75 @@
+#ifndef _OP_SPARSE_H
+#define _OP_SPARSE_H
+
+#include "tensor.h"
+#include "op_linear.h"
+
+#define SPARSE_TILE_ROWS 4                  // Input rows (batch) computed together, so each weight block is loaded once per tile
+#define SPARSE_PARALLEL_THRESHOLD 65536     // Number of multiply-adds above which the op is multithreaded
+
+typedef enum {
+    SPARSE_CSR,         // Compressed sparse row, one value per non-zero
+    SPARSE_BLOCK_1X4,   // 1 row x 4 columns blocks
+    SPARSE_BLOCK_4X4    // 4 rows x 4 columns blocks
+} sparse_format_t;
+
+// Block-sparse row (BSR) weight of a linear layer. CSR is the 1x1 block case.
+// A block is stored if any of its weights has |w| > threshold. The other weights of a stored block are kept as they are.
+// All the arrays are tensors, so they are counted by tensor_global_data_memory.
+typedef struct {
+    sparse_format_t format;
+    uint32_t out_features;
+    uint32_t in_features;
+    uint32_t block_rows;        // 1 or 4
+    uint32_t block_cols;        // 1 or 4
+    uint32_t num_blocks;
+    tensor_t *row_ptr;          // int32 (out_features / block_rows + 1). Blocks of block row i: [row_ptr[i], row_ptr[i + 1])
+    tensor_t *col_index;        // int32 (num_blocks). First column of each block
+    tensor_t *values;           // float32 (num_blocks x block_rows x block_cols), row-major in each block
+    tensor_t *bias;             // float32 (out_features) or NULL. Copied from the dense linear_t
+} sparse_linear_t;
+
+// Build from a dense linear_t (float32). The dense linear_t is not changed and can be freed after this.
+sparse_linear_t *sparse_linear_create(linear_t *linear_weight, sparse_format_t format, float threshold);
+void sparse_linear_free(sparse_linear_t *sparse);
+
+// Stored values / (out_features x in_features). 1.0 is dense.
+float sparse_linear_density(sparse_linear_t *sparse);
+// Same density, measured on a dense linear_t without building the sparse weight.
+float sparse_measure_density(linear_t *linear_weight, sparse_format_t format, float threshold);
+
+// output = input * weight.T + bias. Same as linear().
+// input: 1D tensor (in_features) or 2D tensor (batch_size x in_features). float32 only.
+// output: 2D tensor (batch_size x out_features). batch_size 1 is SpMV, larger is SpMM.
+tensor_t *sparse_linear(tensor_t *input, sparse_linear_t *sparse);
+// The input is packed into a buffer of the calling thread, kept for the next calls. sparse_free_pack frees it,
+// ex. before the thread exits.
+tensor_t *sparse_linear_out(tensor_t *input, sparse_linear_t *sparse, tensor_t *output);
+void sparse_free_pack();
+
+// Dispatcher. The density of the weight is measured at create time.
+// SpMV (batch_size 1) and SpMM have their own crossover density. The sparse weight is built when the density is below
+// either of them, and each run uses sparse or dense by the batch size of the input. Dense runs use linear_tuned_out.
+typedef struct {
+    linear_t *dense;            // If sparse is not NULL, the caller can free the dense linear_t and set this to NULL.
+                                // Then sparse is always used. With both NULL, the runs fail (return NULL).
+    sparse_linear_t *sparse;    // NULL: dense is always used
+    float density;              // Measured density
+    uint8_t use_sparse[2];      // [0]: SpMV, [1]: SpMM
+} sparse_dispatch_t;
+
+// Crossover density of each format, for SpMV (batch_size 1) or SpMM (batch_size > 1): the density below which the
+// sparse weight is faster than the best dense kernel (autotune_linear_config) with the same number of threads.
+// The defaults were measured on x86-64 (example11). sparse_calibrate_crossover measures it on the running machine
+// for the given layer size and sets it.
+float sparse_get_crossover_density(sparse_format_t format, uint32_t batch_size);
+void sparse_set_crossover_density(sparse_format_t format, uint32_t batch_size, float density);
+float sparse_calibrate_crossover(sparse_format_t format, uint32_t out_features, uint32_t in_features, uint32_t batch_size);
+
+sparse_dispatch_t *sparse_dispatch_create(linear_t *linear_weight, sparse_format_t format, float threshold);
+// deep: 0 - free only sparse_dispatch_t (and its sparse weight), 1 - also free the dense linear_t and its weight, bias
+void sparse_dispatch_free(sparse_dispatch_t *dispatch, uint8_t deep);
+tensor_t *sparse_dispatch_linear(tensor_t *input, sparse_dispatch_t *dispatch);
+tensor_t *sparse_dispatch_linear_out(tensor_t *input, sparse_dispatch_t *dispatch, tensor_t *output);
+
+#endif // _OP_SPARSE_H
@@ -0,0 +1,44 @@
+/*
+Author: agent
+Created: 2026.10.19
+Copyright 2026
+
+This file is a header file for the parallel loop.
+parallel_for splits [0, n) into contiguous ranges and runs them on worker threads (pthread).
+The workers are a persistent pool: they are created by the first loop that needs them and wait for the next loops,
+so a loop costs a wake-up instead of a thread creation. The calling thread runs ranges too.
+parallel_for can be called by several threads at once (ex. sessions, pipeline stages) and inside a range.
+On targets without pthread (ex. STM32), or when RES_C_NO_THREADS is defined, the loop runs on the calling thread.
+*/
+#ifndef _PARALLEL_H
+#define _PARALLEL_H
+
+#include <stdint.h>
+
+#if !defined(RES_C_NO_THREADS) && (defined(__linux__) || defined(__APPLE__))
+#define PARALLEL_USE_PTHREAD 1
+#else
+#define PARALLEL_USE_PTHREAD 0
+#endif
+
+#define PARALLEL_MAX_THREADS 64
+
+// Body of the loop. Runs [begin, end) of the range.
+typedef void (*parallel_fn_t)(void *ctx, uint32_t begin, uint32_t end);
+
+// Number of threads used by parallel_for. Default: number of online CPUs (1 without pthread).
+void parallel_set_num_threads(uint32_t num_threads);
+uint32_t parallel_get_num_threads();
+
+// Run fn over [0, n). Each thread gets at least min_chunk iterations, so small loops run on the calling thread.
+void parallel_for(uint32_t n, uint32_t min_chunk, parallel_fn_t fn, void *ctx);
+
+// Run fn over [0, n) in exactly min(num_threads, n) ranges of nearly equal size, one per thread
+// (ex. a configuration measured by the autotuner). Not limited by parallel_get_num_threads().
+void parallel_for_threads(uint32_t n, uint32_t num_threads, parallel_fn_t fn, void *ctx);
+
+// Stop and join the workers, ex. before unloading. The next loop creates them again.
+// Must not be called while a loop runs.
+void parallel_free_workers();
+
+#endif // _PARALLEL_H
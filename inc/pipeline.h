@@ -0,0 +1,93 @@
+/*
+Author: agent
+Created: 2026.10.19
+Copyright 2026
+
+This file is a header file for the layer pipeline.
+For a stream of frames (ex. sensor data), the groups of a model are split into stages, and every stage runs on
+its own thread (pinned to a core on Linux). While stage 1 works on frame n, stage 0 already works on frame n + 1,
+so the frames per second are bound by the slowest stage instead of the whole model.
+- the stages are balanced by the measured cost of every group of the plan: contiguous groups are assigned so that
+  the most expensive stage is as cheap as possible. Without fusion every layer is a group, which gives the finest split.
+- the frames are depth preallocated slots (a session each, with its own input copy), so a run does not allocate.
+  A slot goes from stage to stage through lock-free single-producer / single-consumer rings of slot indices.
+- pipeline_push copies a frame in and pipeline_pop copies the oldest finished frame out (frames stay in order).
+  push waits while all the slots are in use, pop waits until the oldest frame is done.
+  A single thread may push and another thread may pop.
+Without pthread (ex. STM32) pipeline_push runs the whole model on the calling thread.
+*/
+#ifndef _PIPELINE_H
+#define _PIPELINE_H
+
+#include "tensor.h"
+#include "model.h"
+#include "parallel.h"
+#if PARALLEL_USE_PTHREAD
+#include <pthread.h>
+#endif
+
+#define PIPELINE_MAX_STAGES 16
+#define PIPELINE_MEASURE_REPEAT 5   // Runs of each group when measuring the costs. The fastest run is used.
+#define PIPELINE_PIN_CORES 1        // 1 - pin stage s to core s (modulo the number of cores), Linux only
+
+// Single-producer / single-consumer ring of slot indices. head is written only by the consumer,
+// tail only by the producer, and they are on separate cache lines.
+typedef struct {
+    uint32_t head;
+    uint8_t pad_head[60];
+    uint32_t tail;
+    uint8_t pad_tail[60];
+    uint32_t capacity;      // Power of 2
+    uint32_t *slots;
+} pipeline_ring_t;
+
+typedef struct {
+    session_t *session;
+    tensor_t *input;        // Copy of the pushed frame
+    tensor_t *output;       // Output of the last group, owned by the session
+    uint8_t failed;
+} pipeline_frame_t;
+
+struct pipeline;
+
+typedef struct {
+    struct pipeline *pipeline;
+    uint32_t index;
+    uint32_t first;         // Groups [first, end) of the plan
+    uint32_t end;
+    double cost_ms;         // Sum of the measured costs of the groups
+    int32_t core;           // Core the thread is pinned to, -1 if it is not pinned
+#if PARALLEL_USE_PTHREAD
+    pthread_t thread;
+#endif
+} pipeline_stage_t;
+
+typedef struct pipeline {
+    model_t *model;
+    uint32_t num_stages;
+    pipeline_stage_t stages[PIPELINE_MAX_STAGES];
+    uint32_t depth;
+    pipeline_frame_t *frames;
+    pipeline_ring_t free_slots;                 // Pop -> push
+    pipeline_ring_t rings[PIPELINE_MAX_STAGES + 1];  // rings[s]: input of stage s, rings[num_stages]: finished frames
+    uint32_t stop;
+} pipeline_t;
+
+// Measured cost (ms) of every group of the model for the input shape. costs has executor->num_groups elements.
+// Returns 0 on success, -1 on error.
+int pipeline_measure_costs(model_t *model, uint32_t ndim, uint32_t *shape, double *costs);
+// Split the groups into num_stages contiguous ranges that minimize the largest sum of costs.
+// ends[s]: end group (exclusive) of stage s. Returns the cost of the most expensive stage.
+double pipeline_partition(double *costs, uint32_t num_groups, uint32_t num_stages, uint32_t *ends);
+
+// Pipeline of the model for frames of the input shape (ndim x shape). The costs are measured and the stages are started.
+// num_stages is reduced to the number of groups. depth: number of frame slots (at least num_stages to keep every stage busy).
+// The pipeline holds a reference to the model.
+pipeline_t *pipeline_create(model_t *model, uint32_t ndim, uint32_t *shape, uint32_t num_stages, uint32_t depth);
+void pipeline_free(pipeline_t *pipeline);
+
+// Returns 0 on success, -1 on error (pipeline_pop: the model failed on the frame).
+int pipeline_push(pipeline_t *pipeline, tensor_t *input);
+int pipeline_pop(pipeline_t *pipeline, tensor_t *output);
+
+#endif // _PIPELINE_H
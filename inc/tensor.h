@@ -40,12 +40,15 @@ typedef struct {
     uint32_t *transpose;    // Transpose index. The original index is the key, and the value is the new index.
     tensor_data_t *data;
     uint8_t is_data_owner;  // If the data is the owner, it should be freed.
+    uint8_t frac_bits;      // Q format of fixed-point data (int16 / int32): value = data / 2^frac_bits. ex) Q15: 15. 0 by default
+    uint8_t is_data_malloc; // Owned data: 1 - plain malloc (default allocation policy), 0 - alloc_data with a header (alloc.h)
 } tensor_t;
 
 // Get memory functions
 uint64_t tensor_get_data_memory(tensor_t *tensor);
 uint64_t tensor_get_global_data_memory();
 uint64_t tensor_get_global_data_peak_memory();
+void tensor_reset_global_data_peak_memory();
 
 // Create and free functions for each tensor type
 tensor_t *tensor_create(tensor_type_t type, uint32_t ndim, uint32_t *shape, void *data);
@@ -68,6 +71,12 @@ tensor_t *tensor_alloc_data_addr(tensor_t *tensor, tensor_data_t *data_addr);
 // uint32_t tensor_convert_5d_index_to_1d_index(tensor_t *tensor, uint32_t i, uint32_t j, uint32_t k, uint32_t l, uint32_t m);
 uint32_t tensor_convert_nd_to_1d_index(tensor_t *tensor, uint32_t *indices);
 
+// Returns 1 if the tensor is not transposed (row-major data can be accessed directly).
+uint8_t tensor_is_contiguous(tensor_t *tensor);
+
+// Stride (in elements) of each axis, following the transpose. data[sum(index[i] * strides[i])] is the element.
+void tensor_get_strides(tensor_t *tensor, uint32_t *strides);
+
 // Print
 void tensor_print_data(tensor_t *tensor);
 void tensor_print_shape(tensor_t *tensor);
@@ -79,6 +88,7 @@ void tensor_print_global_data_peak_memory();
 // Shape transformation
 tensor_t *tensor_unsqueeze(tensor_t *tensor, uint32_t axis);
 tensor_t *tensor_squeeze(tensor_t *tensor, uint32_t axis);
+tensor_t *tensor_row_view(tensor_t *tensor, tensor_t *view, uint32_t *shape, uint32_t *transpose);
 tensor_t *tensor_transpose(tensor_t *tensor, uint32_t axis1, uint32_t axis2);
 tensor_t *tensor_reshape(tensor_t *tensor, uint32_t ndim, uint32_t *shape);
 #endif // _TENSOR_H
\ No newline at end of file
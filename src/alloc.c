@@ -0,0 +1,311 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     // MAP_HUGETLB, MADV_HUGEPAGE
+#endif
+#include "alloc.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tensor.h"
+
+#if ALLOC_USE_MMAP
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+#if defined(__GNUC__)
+#define ALLOC_THREAD_LOCAL __thread
+#else
+#define ALLOC_THREAD_LOCAL
+#endif
+
+// mbind modes (linux/mempolicy.h). The syscall is used directly, so libnuma is not needed.
+#define ALLOC_MPOL_BIND 2
+#define ALLOC_MPOL_INTERLEAVE 3
+
+#define ALLOC_MAGIC 0x616c6c63u     // "allc"
+
+// Stored in the ALLOC_HEADER_SIZE bytes before the data
+typedef struct {
+    void *base;                 // Start of the malloc block or of the mapping
+    uint64_t map_bytes;         // Length of the mapping, 0 for malloc
+    uint32_t magic;
+    uint8_t kind;
+    uint8_t numa;
+    uint16_t node;
+} alloc_header_t;
+
+static alloc_policy_t alloc_policy = {ALLOC_PAGE_DEFAULT, ALLOC_NUMA_DEFAULT, 0, 0};
+
+// alloc_replica_create allocates the copies with a bind policy for the calling thread only,
+// so other threads creating tensors meanwhile keep the global policy.
+static ALLOC_THREAD_LOCAL const alloc_policy_t *alloc_thread_policy = (const alloc_policy_t *) NULL;
+
+static uint32_t alloc_nodes = 0;        // 0: not read yet
+
+alloc_policy_t alloc_default_policy() {
+    alloc_policy_t policy = {ALLOC_PAGE_DEFAULT, ALLOC_NUMA_DEFAULT, 0, 0};
+    return policy;
+}
+
+void alloc_set_policy(alloc_policy_t *policy) {
+    alloc_policy = (policy != (alloc_policy_t *) NULL) ? *policy : alloc_default_policy();
+}
+
+alloc_policy_t alloc_get_policy() {
+    return alloc_policy;
+}
+
+const char *alloc_kind_name(alloc_kind_t kind) {
+    switch (kind) {
+        case ALLOC_KIND_MALLOC:     return "malloc";
+        case ALLOC_KIND_ALIGNED:    return "aligned";
+        case ALLOC_KIND_MAP:        return "4K pages";
+        case ALLOC_KIND_HUGETLB:    return "hugetlb";
+        case ALLOC_KIND_THP:        return "THP";
+        default:                    return "unknown";
+    }
+}
+
+uint32_t alloc_num_nodes() {
+    if (alloc_nodes != 0) return alloc_nodes;
+    uint32_t nodes = 1;
+#if ALLOC_USE_MMAP
+    // ex) "0", "0-1", "0,2-3": the count is the highest node + 1
+    FILE *file = fopen("/sys/devices/system/node/online", "r");
+    if (file != (FILE *) NULL) {
+        char line[256];
+        if (fgets(line, sizeof(line), file) != (char *) NULL) {
+            uint32_t value = 0, highest = 0, digits = 0;
+            for (char *c = line; ; c++) {
+                if (*c >= '0' && *c <= '9') {
+                    value = value * 10 + (uint32_t)(*c - '0');
+                    digits++;
+                    continue;
+                }
+                if (digits > 0 && value > highest) highest = value;
+                value = 0;
+                digits = 0;
+                if (*c == '\0') break;
+            }
+            nodes = highest + 1;
+        }
+        fclose(file);
+    }
+    if (nodes > ALLOC_MAX_NODES) nodes = ALLOC_MAX_NODES;
+#endif
+    alloc_nodes = nodes;
+    return nodes;
+}
+
+uint32_t alloc_current_node() {
+#if ALLOC_USE_MMAP && defined(SYS_getcpu)
+    unsigned int cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0 && node < alloc_num_nodes()) return node;
+#endif
+    return 0;
+}
+
+// Write the header before data. base is the malloc block or the mapping.
+static void *alloc_finish(void *base, uint8_t *data, uint64_t map_bytes, alloc_kind_t kind, alloc_numa_t numa, uint32_t node) {
+    alloc_header_t *header = (alloc_header_t *)(data - ALLOC_HEADER_SIZE);
+    header->base = base;
+    header->map_bytes = map_bytes;
+    header->magic = ALLOC_MAGIC;
+    header->kind = (uint8_t)kind;
+    header->numa = (uint8_t)numa;
+    header->node = (uint16_t)node;
+    return data;
+}
+
+// 64-byte aligned malloc
+static void *alloc_aligned(uint64_t bytes) {
+    uint8_t *base = (uint8_t *)malloc(bytes + ALLOC_HEADER_SIZE + ALLOC_ALIGNMENT - 1);
+    if (base == (uint8_t *) NULL) return NULL;
+    uint8_t *data = (uint8_t *)(((uintptr_t)base + ALLOC_HEADER_SIZE + ALLOC_ALIGNMENT - 1) & ~(uintptr_t)(ALLOC_ALIGNMENT - 1));
+    return alloc_finish(base, data, 0, ALLOC_KIND_ALIGNED, ALLOC_NUMA_DEFAULT, 0);
+}
+
+#if ALLOC_USE_MMAP
+static int alloc_thp_available() {
+    static int available = -1;      // -1: not read yet
+    if (available >= 0) return available;
+    int result = 0;
+    FILE *file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (file != (FILE *) NULL) {
+        char line[128];
+        if (fgets(line, sizeof(line), file) != (char *) NULL) {
+            result = (strstr(line, "[never]") == (char *) NULL);
+        }
+        fclose(file);
+    }
+    available = result;
+    return result;
+}
+
+// Place the pages before they are touched. Returns the policy that was applied.
+static alloc_numa_t alloc_mbind(void *addr, uint64_t bytes, const alloc_policy_t *policy) {
+#if defined(SYS_mbind)
+    const uint32_t nodes = alloc_num_nodes();
+    unsigned long mask[ALLOC_MAX_NODES / (8 * sizeof(unsigned long))];
+    memset(mask, 0, sizeof(mask));
+    if (policy->numa == ALLOC_NUMA_INTERLEAVE) {
+        for (uint32_t n = 0; n < nodes; n++) mask[n / (8 * sizeof(unsigned long))] |= 1ul << (n % (8 * sizeof(unsigned long)));
+    } else {
+        mask[policy->node / (8 * sizeof(unsigned long))] |= 1ul << (policy->node % (8 * sizeof(unsigned long)));
+    }
+    const int mode = (policy->numa == ALLOC_NUMA_INTERLEAVE) ? ALLOC_MPOL_INTERLEAVE : ALLOC_MPOL_BIND;
+    // maxnode is the number of bits + 1 (the kernel reads maxnode - 1 bits)
+    if (syscall(SYS_mbind, addr, (unsigned long)bytes, mode, mask, (unsigned long)ALLOC_MAX_NODES + 1, 0) == 0) {
+        return policy->numa;
+    }
+#endif
+    return ALLOC_NUMA_DEFAULT;
+}
+
+// Own pages: [header page][data ...]. The data starts at a page (huge pages: 2MB) boundary.
+static void *alloc_map(uint64_t bytes, const alloc_policy_t *policy) {
+    const uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    alloc_kind_t kind = ALLOC_KIND_MAP;
+    uint8_t *base = (uint8_t *)MAP_FAILED;
+    uint8_t *data = (uint8_t *) NULL;
+    uint64_t map_bytes = 0;
+
+#if defined(MAP_HUGETLB)
+    if (policy->page == ALLOC_PAGE_HUGE) {
+        // Reserved huge pages. The header takes the first page of the first huge page.
+        map_bytes = (bytes + page + ALLOC_HUGE_PAGE_SIZE - 1) / ALLOC_HUGE_PAGE_SIZE * ALLOC_HUGE_PAGE_SIZE;
+        base = (uint8_t *)mmap(NULL, map_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (base != (uint8_t *)MAP_FAILED) {
+            kind = ALLOC_KIND_HUGETLB;
+            data = base + page;
+        }
+    }
+#endif
+#if defined(MADV_HUGEPAGE)
+    if (base == (uint8_t *)MAP_FAILED && policy->page == ALLOC_PAGE_HUGE && alloc_thp_available()) {
+        // Transparent huge pages back 2MB aligned ranges: map 2MB more and start the data at a 2MB boundary
+        map_bytes = bytes + page + ALLOC_HUGE_PAGE_SIZE;
+        base = (uint8_t *)mmap(NULL, map_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base != (uint8_t *)MAP_FAILED) {
+            data = (uint8_t *)(((uintptr_t)base + page + ALLOC_HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(ALLOC_HUGE_PAGE_SIZE - 1));
+            kind = (madvise(base, map_bytes, MADV_HUGEPAGE) == 0) ? ALLOC_KIND_THP : ALLOC_KIND_MAP;
+        }
+    }
+#endif
+    if (base == (uint8_t *)MAP_FAILED) {
+        map_bytes = bytes + page;
+        base = (uint8_t *)mmap(NULL, map_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == (uint8_t *)MAP_FAILED) return NULL;
+        kind = ALLOC_KIND_MAP;
+        data = base + page;
+    }
+
+    // A node that is not online (ex. a policy for a dual-socket host on a single-socket one): first touch
+    alloc_numa_t numa = ALLOC_NUMA_DEFAULT;
+    if (policy->numa == ALLOC_NUMA_INTERLEAVE || (policy->numa == ALLOC_NUMA_BIND && policy->node < alloc_num_nodes())) {
+        numa = alloc_mbind(base, map_bytes, policy);
+    }
+    return alloc_finish(base, data, map_bytes, kind, numa, (numa == ALLOC_NUMA_BIND) ? policy->node : 0);
+}
+#endif
+
+void *alloc_data(uint64_t bytes, uint8_t *is_malloc) {
+    const alloc_policy_t *policy = (alloc_thread_policy != (alloc_policy_t *) NULL) ? alloc_thread_policy : &alloc_policy;
+    if (bytes < policy->min_bytes || (policy->page == ALLOC_PAGE_DEFAULT && policy->numa == ALLOC_NUMA_DEFAULT)) {
+        // No header, so the default policy costs nothing (a 1-element tensor stays 8 bytes on a MCU)
+        *is_malloc = 1;
+        return malloc(bytes);
+    }
+    *is_malloc = 0;
+#if ALLOC_USE_MMAP
+    if (policy->page != ALLOC_PAGE_ALIGNED || policy->numa != ALLOC_NUMA_DEFAULT) {
+        void *data = alloc_map(bytes, policy);
+        if (data != NULL) return data;
+    }
+#endif
+    return alloc_aligned(bytes);
+}
+
+static alloc_header_t *alloc_get_header(void *data) {
+    alloc_header_t *header = (alloc_header_t *)((uint8_t *)data - ALLOC_HEADER_SIZE);
+    if (header->magic != ALLOC_MAGIC) {
+        printf("[%s][%s][%d] Error: data was not allocated by alloc_data\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    return header;
+}
+
+void alloc_free(void *data) {
+    if (data == NULL) return;
+    alloc_header_t *header = alloc_get_header(data);
+    if (header == (alloc_header_t *) NULL) return;
+    header->magic = 0;
+#if ALLOC_USE_MMAP
+    if (header->map_bytes != 0) {
+        munmap(header->base, header->map_bytes);
+        return;
+    }
+#endif
+    free(header->base);
+}
+
+alloc_info_t alloc_get_info(tensor_t *tensor) {
+    alloc_info_t info = {ALLOC_KIND_MALLOC, ALLOC_NUMA_DEFAULT, 0};
+    if (!tensor->is_data_owner || tensor->is_data_malloc) return info;
+    alloc_header_t *header = alloc_get_header(tensor->data);
+    if (header != (alloc_header_t *) NULL) {
+        info.kind = (alloc_kind_t)header->kind;
+        info.numa = (alloc_numa_t)header->numa;
+        info.node = header->node;
+    }
+    return info;
+}
+
+alloc_replica_t *alloc_replica_create(tensor_t *tensor) {
+    if (!tensor_is_contiguous(tensor)) {
+        printf("[%s][%s][%d] Error: tensor must not be transposed\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    const uint32_t nodes = alloc_num_nodes();
+    alloc_replica_t *replica = (alloc_replica_t *)malloc(sizeof(alloc_replica_t));
+    replica->num_nodes = nodes;
+    replica->tensors = (tensor_t **)calloc(nodes, sizeof(tensor_t *));
+
+    alloc_policy_t policy = alloc_policy;
+    policy.page = (alloc_policy.page == ALLOC_PAGE_HUGE) ? ALLOC_PAGE_HUGE : ALLOC_PAGE_MAP;
+    policy.numa = ALLOC_NUMA_BIND;
+    policy.min_bytes = 0;
+    alloc_thread_policy = &policy;
+    for (uint32_t n = 0; n < nodes; n++) {
+        policy.node = n;
+        replica->tensors[n] = tensor_create(tensor->type, tensor->ndim, tensor->shape, (void *)0);
+        if (replica->tensors[n] == (tensor_t *) NULL || replica->tensors[n]->data == (tensor_data_t *) NULL) {
+            printf("[%s][%s][%d] Error: failed to allocate the copy of node %d\r\n", __FILE__, __func__, __LINE__, n);
+            alloc_thread_policy = (const alloc_policy_t *) NULL;
+            alloc_replica_free(replica);
+            return NULL;
+        }
+        tensor_data_set(replica->tensors[n], tensor->data);     // First touch by this thread: the pages are already bound
+        replica->tensors[n]->frac_bits = tensor->frac_bits;
+    }
+    alloc_thread_policy = (const alloc_policy_t *) NULL;
+    return replica;
+}
+
+tensor_t *alloc_replica_local(alloc_replica_t *replica) {
+    return replica->tensors[alloc_current_node() % replica->num_nodes];
+}
+
+void alloc_replica_free(alloc_replica_t *replica) {
+    for (uint32_t n = 0; n < replica->num_nodes; n++) {
+        if (replica->tensors[n] != (tensor_t *) NULL) tensor_free(replica->tensors[n]);
+    }
+    free(replica->tensors);
+    free(replica);
+}
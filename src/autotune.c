@@ -0,0 +1,258 @@
+#include "autotune.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tensor.h"
+#include "op_linear.h"
+#include "parallel.h"
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+#define AUTOTUNE_NAME_SIZE 16
+
+typedef struct {
+    char op[AUTOTUNE_NAME_SIZE];
+    tensor_type_t type;
+    uint32_t shape[3];
+    uint32_t threads;           // parallel_get_num_threads() when it was tuned
+    linear_config_t config;
+    float ms;
+} autotune_entry_t;
+
+static autotune_mode_t autotune_mode = AUTOTUNE_CACHED;
+static autotune_entry_t autotune_entries[AUTOTUNE_MAX_ENTRIES];
+static uint32_t autotune_num_entries = 0;
+static autotune_stats_t autotune_stats = {0, 0, 0, 0, 0.0};
+
+static const char *autotune_type_names[] = {"int16", "int32", "int64", "float32", "float64"};
+static const char *autotune_algo_names[] = {"direct", "gemv", "tiled"};
+
+void autotune_set_mode(autotune_mode_t mode) {
+    autotune_mode = mode;
+}
+
+autotune_mode_t autotune_get_mode() {
+    return autotune_mode;
+}
+
+void autotune_clear() {
+    autotune_num_entries = 0;
+}
+
+uint32_t autotune_get_num_entries() {
+    return autotune_num_entries;
+}
+
+void autotune_get_stats(autotune_stats_t *stats) {
+    *stats = autotune_stats;
+}
+
+void autotune_reset_stats() {
+    memset(&autotune_stats, 0, sizeof(autotune_stats));
+}
+
+static autotune_entry_t *autotune_find(const char *op, tensor_type_t type, uint32_t *shape, uint32_t threads) {
+    for (uint32_t i = 0; i < autotune_num_entries; i++) {
+        autotune_entry_t *entry = &autotune_entries[i];
+        if (entry->type == type && entry->threads == threads && memcmp(entry->shape, shape, sizeof(entry->shape)) == 0 && strcmp(entry->op, op) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void autotune_store(const char *op, tensor_type_t type, uint32_t *shape, uint32_t threads, linear_config_t config, float ms) {
+    autotune_entry_t *entry = autotune_find(op, type, shape, threads);
+    if (entry == (autotune_entry_t *) NULL) {
+        if (autotune_num_entries == AUTOTUNE_MAX_ENTRIES) {
+            printf("[%s][%s][%d] Error: the cache is full (%d entries)\r\n", __FILE__, __func__, __LINE__, AUTOTUNE_MAX_ENTRIES);
+            return;
+        }
+        entry = &autotune_entries[autotune_num_entries++];
+    }
+    snprintf(entry->op, sizeof(entry->op), "%s", op);
+    entry->type = type;
+    memcpy(entry->shape, shape, sizeof(entry->shape));
+    entry->threads = threads;
+    entry->config = config;
+    entry->ms = ms;
+}
+
+int autotune_load(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == (FILE *) NULL) {
+        return -1;
+    }
+    char line[256], op[AUTOTUNE_NAME_SIZE], type[AUTOTUNE_NAME_SIZE], algo[AUTOTUNE_NAME_SIZE];
+    uint32_t shape[3], threads, tile_rows, config_threads;
+    float ms;
+    int count = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (sscanf(line, "%15s %15s %u %u %u %u %15s %u %u %f", op, type, &shape[0], &shape[1], &shape[2], &threads, algo, &tile_rows, &config_threads, &ms) != 10) {
+            printf("[%s][%s][%d] Error: invalid line in %s: %s\r\n", __FILE__, __func__, __LINE__, path, line);
+            continue;
+        }
+        int type_index = -1, algo_index = -1;
+        for (int i = 0; i < 5; i++) if (strcmp(type, autotune_type_names[i]) == 0) type_index = i;
+        for (int i = 0; i < 3; i++) if (strcmp(algo, autotune_algo_names[i]) == 0) algo_index = i;
+        if (type_index < 0 || algo_index < 0 || (algo_index == LINEAR_ALGO_TILED && (tile_rows < 2 || tile_rows > LINEAR_MAX_TILE_ROWS))) {
+            printf("[%s][%s][%d] Error: invalid entry in %s: %s\r\n", __FILE__, __func__, __LINE__, path, line);
+            continue;
+        }
+        linear_config_t config = {(linear_algo_t)algo_index, tile_rows, config_threads};
+        autotune_store(op, (tensor_type_t)type_index, shape, threads, config, ms);
+        count++;
+    }
+    fclose(file);
+    return count;
+}
+
+int autotune_save(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == (FILE *) NULL) {
+        printf("[%s][%s][%d] Error: cannot open %s\r\n", __FILE__, __func__, __LINE__, path);
+        return -1;
+    }
+    fprintf(file, "# Res.C_model autotune cache\n");
+    fprintf(file, "# op type shape0 shape1 shape2 threads algo tile_rows threads_used ms\n");
+    for (uint32_t i = 0; i < autotune_num_entries; i++) {
+        autotune_entry_t *entry = &autotune_entries[i];
+        fprintf(file, "%s %s %u %u %u %u %s %u %u %.4f\n", entry->op, autotune_type_names[entry->type],
+                entry->shape[0], entry->shape[1], entry->shape[2], entry->threads,
+                autotune_algo_names[entry->config.algo], entry->config.tile_rows, entry->config.threads, entry->ms);
+    }
+    return (fclose(file) == 0) ? 0 : -1;
+}
+
+static double autotune_now_ms() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+linear_config_t autotune_linear_heuristic(uint32_t batch_size, uint32_t in_features, uint32_t out_features) {
+    // GEMV for a single row, otherwise tiles as large as the batch (up to 8).
+    // One thread per AUTOTUNE_PARALLEL_THRESHOLD multiply-adds.
+    linear_config_t config;
+    if (batch_size <= 1) {
+        config.algo = LINEAR_ALGO_GEMV;
+        config.tile_rows = 1;
+    } else {
+        config.algo = LINEAR_ALGO_TILED;
+        config.tile_rows = (batch_size >= 8) ? 8 : (batch_size >= 4) ? 4 : 2;
+    }
+    const uint64_t work = (uint64_t)batch_size * in_features * out_features;
+    uint64_t threads = work / AUTOTUNE_PARALLEL_THRESHOLD;
+    const uint32_t max_threads = parallel_get_num_threads();
+    if (threads > max_threads) threads = max_threads;
+    if (threads > out_features) threads = out_features;
+    config.threads = (threads > 0) ? (uint32_t)threads : 1;
+    return config;
+}
+
+static double autotune_linear_time(tensor_t *input, linear_t *linear_weight, tensor_t *output, linear_config_t *config) {
+    linear_out_config(input, linear_weight, output, config);     // Warm up
+    double best = 1e30;
+    for (int r = 0; r < AUTOTUNE_REPEAT; r++) {
+        double start = autotune_now_ms();
+        linear_out_config(input, linear_weight, output, config);
+        double ms = autotune_now_ms() - start;
+        if (ms < best) best = ms;
+    }
+    autotune_stats.candidates++;
+    return best;
+}
+
+static linear_config_t autotune_linear_tune(tensor_t *input, linear_t *linear_weight, tensor_t *output, float *best_ms) {
+    // Candidates: direct, GEMV and tiles of 2, 4, 8 rows (not larger than needed for the batch),
+    // each with 1, 2, 4, ... threads and the maximum.
+    const uint32_t batch_size = input->shape[0];
+    const uint32_t out_features = linear_weight->weight->shape[0];
+    const uint32_t max_threads = parallel_get_num_threads();
+    uint32_t thread_counts[16];
+    uint32_t num_thread_counts = 0;
+    for (uint32_t t = 1; t < max_threads && t <= out_features && num_thread_counts < 15; t *= 2) thread_counts[num_thread_counts++] = t;
+    thread_counts[num_thread_counts++] = (max_threads < out_features) ? max_threads : out_features;
+
+    linear_config_t best = {LINEAR_ALGO_DIRECT, 1, 1};
+    *best_ms = (float)autotune_linear_time(input, linear_weight, output, &best);
+    for (uint32_t algo = LINEAR_ALGO_GEMV; algo <= LINEAR_ALGO_TILED; algo++) {
+        for (uint32_t tile_rows = 2; tile_rows <= LINEAR_MAX_TILE_ROWS; tile_rows *= 2) {
+            if (algo == LINEAR_ALGO_GEMV && tile_rows > 2) break;
+            if (algo == LINEAR_ALGO_TILED && tile_rows / 2 >= batch_size) break;
+            for (uint32_t t = 0; t < num_thread_counts; t++) {
+                linear_config_t config = {(linear_algo_t)algo, (algo == LINEAR_ALGO_TILED) ? tile_rows : 1, thread_counts[t]};
+                double ms = autotune_linear_time(input, linear_weight, output, &config);
+                if (ms < *best_ms) {
+                    *best_ms = (float)ms;
+                    best = config;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+linear_config_t autotune_linear_config(tensor_t *input, linear_t *linear_weight, tensor_t *output) {
+    linear_config_t direct = {LINEAR_ALGO_DIRECT, 1, 1};
+    tensor_t *weight = linear_weight->weight;
+    if (input->ndim != 2 || weight->ndim != 2 || input->type != TENSOR_FLOAT32 || !tensor_is_contiguous(input) || !tensor_is_contiguous(weight)) {
+        return direct;     // Only the direct kernel supports these
+    }
+    const uint32_t threads = parallel_get_num_threads();
+    uint32_t shape[3] = {input->shape[0], input->shape[1], weight->shape[0]};
+    autotune_stats.lookups++;
+
+    if (autotune_mode != AUTOTUNE_OFF) {
+        autotune_entry_t *entry = autotune_find("linear", input->type, shape, threads);
+        if (entry != (autotune_entry_t *) NULL) {
+            autotune_stats.hits++;
+            return entry->config;
+        }
+    }
+    if (autotune_mode != AUTOTUNE_ON) {
+        return autotune_linear_heuristic(shape[0], shape[1], shape[2]);
+    }
+
+    double start = autotune_now_ms();
+    float ms;
+    linear_config_t config = autotune_linear_tune(input, linear_weight, output, &ms);
+    autotune_store("linear", input->type, shape, threads, config, ms);
+    autotune_stats.tuned++;
+    autotune_stats.tuning_ms += autotune_now_ms() - start;
+    return config;
+}
+
+tensor_t *linear_tuned(tensor_t *input, linear_t *linear_weight) {
+    tensor_t row;       // (1 x n) view of a 1D input, so the caller's tensor is not changed
+    uint32_t row_shape[2], row_transpose[2];
+    if (input->ndim == 1)   input = tensor_row_view(input, &row, row_shape, row_transpose);
+    if (input->ndim != 2 || linear_weight->weight->ndim != 2) {
+        printf("[%s][%s][%d] Error: input and weight must be 2D tensors\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    tensor_t *output = tensor_create(input->type, 2, (uint32_t[]){input->shape[0], linear_weight->weight->shape[0]}, (void *)0);
+    if (linear_tuned_out(input, linear_weight, output) == (tensor_t *) NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *linear_tuned_out(tensor_t *input, linear_t *linear_weight, tensor_t *output) {
+    tensor_t row;       // (1 x n) view of a 1D input, so the caller's tensor is not changed
+    uint32_t row_shape[2], row_transpose[2];
+    if (input->ndim == 1)   input = tensor_row_view(input, &row, row_shape, row_transpose);
+    if (input->ndim != 2 || output->ndim != 2 || linear_weight->weight->ndim != 2 ||
+        input->shape[1] != linear_weight->weight->shape[1] || output->shape[0] != input->shape[0] || output->shape[1] != linear_weight->weight->shape[0]) {
+        printf("[%s][%s][%d] Error: input (batch_size x in_features), output (batch_size x out_features) do not match the weight\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    linear_config_t config = autotune_linear_config(input, linear_weight, output);
+    return linear_out_config(input, linear_weight, output, &config);
+}
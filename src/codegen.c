@@ -0,0 +1,565 @@
+#include "codegen.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "tensor.h"
+#include "op_linear.h"
+#include "op_norm.h"
+#include "op_pool.h"
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+#define CODEGEN_VALUES_PER_LINE 8
+#define CODEGEN_LANES 8     // Accumulators of the generated dot product (vectorized by the compiler). The sum of the lanes is written for 8.
+
+typedef enum {
+    CODEGEN_INPUT,      // input argument of <name>_infer
+    CODEGEN_OUTPUT,     // output argument of <name>_infer
+    CODEGEN_PING,       // First half of the ping-pong area of the activation buffer
+    CODEGEN_PONG,       // Second half
+    CODEGEN_KEPT        // Kept area of the activation buffer (outputs used by a residual add)
+} codegen_place_t;
+
+typedef struct {
+    codegen_place_t place;
+    uint32_t offset;    // Offset in the kept area (CODEGEN_KEPT)
+} codegen_loc_t;
+
+// A kernel runs the main layer first and applies the layers (first, last) in its epilogue.
+typedef struct {
+    uint32_t first;
+    uint32_t last;
+    uint8_t fold;       // 1: the batch_norm_1d at first + 1 is folded into the weight of the linear at first
+    uint8_t alias;      // 1: no code (flatten), the output is the input
+    codegen_loc_t src;
+    codegen_loc_t dst;
+} codegen_kernel_t;
+
+typedef struct {
+    executor_t *executor;
+    const char *name;
+    FILE *file;
+    uint32_t *ndims;                        // ndims[l], shapes[l]: input of layer l. [num_layers]: output of the executor
+    uint32_t (*shapes)[EXECUTOR_MAX_NDIM];
+    uint8_t *keep_output;                   // keep_output[l + 1]: the output of layer l is used by a residual add
+    codegen_loc_t *saved;                   // saved[l + 1]: location of the kept output of layer l. [0]: input
+    codegen_kernel_t *kernels;
+    uint32_t num_kernels;
+    uint32_t ping_size;                     // Floats of the ping-pong halves
+    uint32_t pong_size;
+    uint32_t kept_size;                     // Floats of the kept area
+    uint64_t weight_bytes;
+} codegen_ctx_t;
+
+static uint32_t codegen_numel(uint32_t ndim, uint32_t *shape) {
+    uint32_t numel = 1;
+    for (uint32_t i = 0; i < ndim; i++) numel *= shape[i];
+    return numel;
+}
+
+static float codegen_get(tensor_t *tensor, uint32_t index) {
+    // Element index in the logical (possibly transposed) order
+    if (tensor_is_contiguous(tensor)) return tensor->data[index].float32;
+    uint32_t indices[EXECUTOR_MAX_NDIM];
+    for (int i = (int)tensor->ndim - 1; i >= 0; i--) {
+        indices[i] = index % tensor->shape[i];
+        index /= tensor->shape[i];
+    }
+    return tensor->data[tensor_convert_nd_to_1d_index(tensor, indices)].float32;
+}
+
+static int codegen_check_tensor(tensor_t *tensor, uint32_t layer) {
+    if (tensor == (tensor_t *) NULL) return 0;
+    if (tensor->type != TENSOR_FLOAT32 || tensor->ndim > EXECUTOR_MAX_NDIM) {
+        printf("[%s][%s][%d] Error: tensors of layer %d must be float32\r\n", __FILE__, __func__, __LINE__, layer);
+        return -1;
+    }
+    for (uint32_t i = 0; i < tensor->num_elements; i++) {
+        if (!isfinite(tensor->data[i].float32)) {
+            printf("[%s][%s][%d] Error: layer %d has a value that is not finite\r\n", __FILE__, __func__, __LINE__, layer);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int codegen_check_layers(executor_t *executor) {
+    for (uint32_t l = 0; l < executor->num_layers; l++) {
+        layer_t *layer = &executor->layers[l];
+        if (layer->type == LAYER_LINEAR) {
+            linear_t *linear_weight = (linear_t *)layer->op;
+            if (codegen_check_tensor(linear_weight->weight, l) != 0 || codegen_check_tensor(linear_weight->bias, l) != 0) return -1;
+        } else if (layer->type == LAYER_BATCH_NORM_1D || layer->type == LAYER_BATCH_NORM_2D) {
+            batch_norm_t *batch_norm_weight = (batch_norm_t *)layer->op;
+            if (codegen_check_tensor(batch_norm_weight->mean, l) != 0 || codegen_check_tensor(batch_norm_weight->var, l) != 0 ||
+                codegen_check_tensor(batch_norm_weight->epsilon, l) != 0 || codegen_check_tensor(batch_norm_weight->gamma, l) != 0 ||
+                codegen_check_tensor(batch_norm_weight->beta, l) != 0) return -1;
+        }
+    }
+    return 0;
+}
+
+static uint8_t codegen_is_epilogue(layer_type_t type) {
+    return type == LAYER_BATCH_NORM_1D || type == LAYER_BATCH_NORM_2D || type == LAYER_RELU || type == LAYER_RESIDUAL_ADD;
+}
+
+// Split the layers into kernels and place their outputs in the activation buffer.
+static void codegen_plan(codegen_ctx_t *ctx) {
+    executor_t *executor = ctx->executor;
+    const uint32_t num_layers = executor->num_layers;
+    codegen_loc_t cur = {CODEGEN_INPUT, 0};
+    ctx->saved[0] = cur;
+    ctx->num_kernels = 0;
+    ctx->ping_size = 0;
+    ctx->pong_size = 0;
+    ctx->kept_size = 0;
+
+    uint32_t l = 0;
+    while (l < num_layers) {
+        codegen_kernel_t *kernel = &ctx->kernels[ctx->num_kernels++];
+        kernel->first = l;
+        kernel->fold = 0;
+        kernel->alias = 0;
+        uint32_t j = l + 1;
+        if (executor->layers[l].type != LAYER_FLATTEN) {
+            // A kept output must be stored, so the epilogue ends at the layer whose output is kept.
+            while (j < num_layers && !ctx->keep_output[j] && codegen_is_epilogue(executor->layers[j].type)) j++;
+            kernel->fold = (executor->layers[l].type == LAYER_LINEAR && j > l + 1 && executor->layers[l + 1].type == LAYER_BATCH_NORM_1D);
+        }
+        kernel->last = j;
+
+        const uint32_t end = j - 1;
+        const uint32_t size = codegen_numel(ctx->ndims[j], ctx->shapes[j]);
+        kernel->src = cur;
+        if (executor->layers[l].type == LAYER_FLATTEN && end + 1 < num_layers && !ctx->keep_output[end + 1]) {
+            kernel->alias = 1;      // Same data, only the shape is changed
+            kernel->dst = cur;
+        } else if (end + 1 == num_layers) {
+            kernel->dst.place = CODEGEN_OUTPUT;
+            kernel->dst.offset = 0;
+        } else if (ctx->keep_output[end + 1]) {
+            kernel->dst.place = CODEGEN_KEPT;
+            kernel->dst.offset = ctx->kept_size;
+            ctx->kept_size += size;
+        } else {
+            kernel->dst.place = (cur.place == CODEGEN_PING) ? CODEGEN_PONG : CODEGEN_PING;
+            kernel->dst.offset = 0;
+            uint32_t *half = (kernel->dst.place == CODEGEN_PING) ? &ctx->ping_size : &ctx->pong_size;
+            if (size > *half) *half = size;
+        }
+        cur = kernel->dst;
+        if (ctx->keep_output[end + 1]) ctx->saved[end + 1] = cur;
+        l = j;
+    }
+    if (num_layers == 0) {
+        // Empty chain: copy the input to the output
+        codegen_kernel_t *kernel = &ctx->kernels[ctx->num_kernels++];
+        kernel->first = 0;
+        kernel->last = 0;
+        kernel->fold = 0;
+        kernel->alias = 0;
+        kernel->src = cur;
+        kernel->dst.place = CODEGEN_OUTPUT;
+        kernel->dst.offset = 0;
+    }
+}
+
+static void codegen_pointer(codegen_ctx_t *ctx, codegen_loc_t loc, char *buffer, size_t size) {
+    switch (loc.place) {
+        case CODEGEN_INPUT:
+            snprintf(buffer, size, "input");
+            break;
+        case CODEGEN_OUTPUT:
+            snprintf(buffer, size, "output");
+            break;
+        case CODEGEN_PING:
+            snprintf(buffer, size, "%s_activation", ctx->name);
+            break;
+        case CODEGEN_PONG:
+            snprintf(buffer, size, "%s_activation + %u", ctx->name, ctx->ping_size);
+            break;
+        default:
+            snprintf(buffer, size, "%s_activation + %u", ctx->name, ctx->ping_size + ctx->pong_size + loc.offset);
+            break;
+    }
+}
+
+static void codegen_shape(FILE *file, uint32_t ndim, uint32_t *shape) {
+    fprintf(file, "(");
+    for (uint32_t i = 0; i < ndim; i++) fprintf(file, (i == 0) ? "%u" : " x %u", shape[i]);
+    fprintf(file, ")");
+}
+
+static void codegen_array(codegen_ctx_t *ctx, const char *kind, uint32_t layer, const float *values, uint32_t count) {
+    // The values are written with 9 significant digits, so they are read back exactly.
+    fprintf(ctx->file, "static const float %s_%s%u[%u] = {\n", ctx->name, kind, layer, count);
+    for (uint32_t i = 0; i < count; i++) {
+        if (i % CODEGEN_VALUES_PER_LINE == 0) fprintf(ctx->file, "    ");
+        fprintf(ctx->file, "%.8ef%s", values[i], (i + 1 == count) ? "\n" : (i % CODEGEN_VALUES_PER_LINE == CODEGEN_VALUES_PER_LINE - 1) ? ",\n" : ", ");
+    }
+    fprintf(ctx->file, "};\n\n");
+    ctx->weight_bytes += (uint64_t)count * sizeof(float);
+}
+
+static void codegen_constants(codegen_ctx_t *ctx, codegen_kernel_t *kernel) {
+    executor_t *executor = ctx->executor;
+    if (kernel->last == 0) return;
+    if (executor->layers[kernel->first].type == LAYER_LINEAR) {
+        linear_t *linear_weight = (linear_t *)executor->layers[kernel->first].op;
+        const uint32_t out_features = linear_weight->weight->shape[0];
+        const uint32_t in_features = linear_weight->weight->shape[1];
+        tensor_t *folded = kernel->fold ? batch_norm_fold((batch_norm_t *)executor->layers[kernel->first + 1].op) : (tensor_t *) NULL;
+        float *values = (float *)malloc((size_t)out_features * in_features * sizeof(float));
+        for (uint32_t j = 0; j < out_features; j++) {
+            const float scale = folded ? folded->data[j].float32 : 1.0f;
+            for (uint32_t k = 0; k < in_features; k++) {
+                values[j * in_features + k] = codegen_get(linear_weight->weight, j * in_features + k) * scale;
+            }
+        }
+        codegen_array(ctx, "weight", kernel->first, values, out_features * in_features);
+        if (linear_weight->bias != (tensor_t *) NULL || folded) {
+            for (uint32_t j = 0; j < out_features; j++) {
+                const float bias = (linear_weight->bias != (tensor_t *) NULL) ? codegen_get(linear_weight->bias, j) : 0.0f;
+                values[j] = folded ? bias * folded->data[j].float32 + folded->data[out_features + j].float32 : bias;
+            }
+            codegen_array(ctx, "bias", kernel->first, values, out_features);
+        }
+        free(values);
+        if (folded) tensor_free(folded);
+    }
+    for (uint32_t l = kernel->first + kernel->fold; l < kernel->last; l++) {
+        if (executor->layers[l].type != LAYER_BATCH_NORM_1D && executor->layers[l].type != LAYER_BATCH_NORM_2D) continue;
+        if (l == kernel->first + 1 && kernel->fold) continue;
+        tensor_t *folded = batch_norm_fold((batch_norm_t *)executor->layers[l].op);
+        const uint32_t channels = folded->shape[1];
+        float *values = (float *)malloc(2 * channels * sizeof(float));
+        for (uint32_t c = 0; c < 2 * channels; c++) values[c] = folded->data[c].float32;
+        codegen_array(ctx, "scale", l, values, channels);
+        codegen_array(ctx, "shift", l, values + channels, channels);
+        free(values);
+        tensor_free(folded);
+    }
+}
+
+// Apply the layers [begin, kernel->last) to the value v. channel and index are C expressions.
+static void codegen_epilogue(codegen_ctx_t *ctx, codegen_kernel_t *kernel, uint32_t begin, const char *indent, const char *channel, const char *index) {
+    for (uint32_t l = begin; l < kernel->last; l++) {
+        switch (ctx->executor->layers[l].type) {
+            case LAYER_RELU:
+                fprintf(ctx->file, "%sv = (v > 0.0f) ? v : 0.0f;\n", indent);
+                break;
+            case LAYER_RESIDUAL_ADD:
+                fprintf(ctx->file, "%sv += skip%u[%s];\n", indent, l, index);
+                break;
+            case LAYER_BATCH_NORM_1D:
+            case LAYER_BATCH_NORM_2D:
+                if (l == kernel->first + 1 && kernel->fold) break;
+                fprintf(ctx->file, "%sv = v * %s_scale%u[%s] + %s_shift%u[%s];\n", indent, ctx->name, l, channel, ctx->name, l, channel);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void codegen_linear(codegen_ctx_t *ctx, codegen_kernel_t *kernel) {
+    linear_t *linear_weight = (linear_t *)ctx->executor->layers[kernel->first].op;
+    FILE *file = ctx->file;
+    const char *name = ctx->name;
+    const uint32_t l = kernel->first;
+    const uint32_t batch_size = ctx->shapes[l][0];
+    const uint32_t out_features = linear_weight->weight->shape[0];
+    const uint32_t in_features = linear_weight->weight->shape[1];
+    const uint32_t lanes = (in_features >= CODEGEN_LANES) ? CODEGEN_LANES : 1;
+    const uint32_t main_end = in_features - in_features % lanes;
+    char index[64];
+    snprintf(index, sizeof(index), "i * %u + j", out_features);
+
+    // The weight row is the outer loop, so it is read once for all the batch rows (from the cache).
+    fprintf(file, "    for (int j = 0; j < %u; j++) {\n", out_features);
+    fprintf(file, "        const float *w = %s_weight%u + j * %u;\n", name, l, in_features);
+    fprintf(file, "        for (int i = 0; i < %u; i++) {\n", batch_size);
+    fprintf(file, "            const float *xi = x + i * %u;\n", in_features);
+    if (lanes > 1) {
+        fprintf(file, "            float acc[%u] = {0.0f};\n", lanes);
+        fprintf(file, "            for (int k = 0; k < %u; k += %u) {\n", main_end, lanes);
+        fprintf(file, "                for (int t = 0; t < %u; t++) acc[t] += xi[k + t] * w[k + t];\n", lanes);
+        fprintf(file, "            }\n");
+        fprintf(file, "            float v = ((acc[0] + acc[4]) + (acc[1] + acc[5])) + ((acc[2] + acc[6]) + (acc[3] + acc[7]));\n");
+    } else {
+        fprintf(file, "            float v = 0.0f;\n");
+    }
+    if (main_end < in_features) {
+        fprintf(file, "            for (int k = %u; k < %u; k++) v += xi[k] * w[k];\n", main_end, in_features);
+    }
+    if (linear_weight->bias != (tensor_t *) NULL || kernel->fold) {
+        fprintf(file, "            v += %s_bias%u[j];\n", name, l);
+    }
+    codegen_epilogue(ctx, kernel, l + 1, "            ", "j", index);
+    fprintf(file, "            y[%s] = v;\n", index);
+    fprintf(file, "        }\n");
+    fprintf(file, "    }\n");
+}
+
+static void codegen_pointwise(codegen_ctx_t *ctx, codegen_kernel_t *kernel) {
+    // The data is seen as (outer x channels x inner), the channel is the axis 1.
+    FILE *file = ctx->file;
+    const uint32_t l = kernel->first;
+    const uint32_t ndim = ctx->ndims[l];
+    const uint32_t outer = ctx->shapes[l][0];
+    const uint32_t channels = (ndim >= 2) ? ctx->shapes[l][1] : 1;
+    const uint32_t inner = codegen_numel(ndim, ctx->shapes[l]) / (outer * channels);
+    char index[64];
+    snprintf(index, sizeof(index), "(n * %u + c) * %u + k", channels, inner);
+
+    fprintf(file, "    for (int n = 0; n < %u; n++) {\n", outer);
+    fprintf(file, "        for (int c = 0; c < %u; c++) {\n", channels);
+    fprintf(file, "            for (int k = 0; k < %u; k++) {\n", inner);
+    fprintf(file, "                float v = x[%s];\n", index);
+    codegen_epilogue(ctx, kernel, l, "                ", "c", index);
+    fprintf(file, "                y[%s] = v;\n", index);
+    fprintf(file, "            }\n");
+    fprintf(file, "        }\n");
+    fprintf(file, "    }\n");
+}
+
+static void codegen_pool(codegen_ctx_t *ctx, codegen_kernel_t *kernel) {
+    FILE *file = ctx->file;
+    const uint32_t l = kernel->first;
+    const uint8_t max = (ctx->executor->layers[l].type == LAYER_MAX_POOL_2D);
+    pool2d_t *pool = (pool2d_t *)ctx->executor->layers[l].op;
+    uint32_t *in_shape = ctx->shapes[l];
+    uint32_t *out_shape = ctx->shapes[l + 1];
+    const uint32_t channels = in_shape[1], height = in_shape[2], width = in_shape[3];
+    const uint32_t out_height = out_shape[2], out_width = out_shape[3];
+    const uint8_t padding = (pool->padding_h > 0 || pool->padding_w > 0);
+    char index[64], channel[32];
+    snprintf(index, sizeof(index), "(p * %u + oh) * %u + ow", out_height, out_width);
+    snprintf(channel, sizeof(channel), "p %% %u", channels);
+
+    fprintf(file, "    for (int p = 0; p < %u; p++) {\n", in_shape[0] * channels);
+    fprintf(file, "        const float *xp = x + p * %u;\n", height * width);
+    fprintf(file, "        for (int oh = 0; oh < %u; oh++) {\n", out_height);
+    fprintf(file, "            for (int ow = 0; ow < %u; ow++) {\n", out_width);
+    fprintf(file, "                const int h0 = oh * %u - %u, w0 = ow * %u - %u;\n", pool->stride_h, pool->padding_h, pool->stride_w, pool->padding_w);
+    fprintf(file, "                float v = %s;\n", max ? "-3.40282347e+38f" : "0.0f");
+    fprintf(file, "                for (int i = 0; i < %u; i++) {\n", pool->kernel_h);
+    if (padding) fprintf(file, "                    if (h0 + i < 0 || h0 + i >= %u) continue;\n", height);
+    fprintf(file, "                    for (int j = 0; j < %u; j++) {\n", pool->kernel_w);
+    if (padding) fprintf(file, "                        if (w0 + j < 0 || w0 + j >= %u) continue;\n", width);
+    fprintf(file, "                        const float t = xp[(h0 + i) * %u + w0 + j];\n", width);
+    fprintf(file, max ? "                        v = (t > v) ? t : v;\n" : "                        v += t;\n");
+    fprintf(file, "                    }\n");
+    fprintf(file, "                }\n");
+    if (!max) fprintf(file, "                v *= %.8ef;\n", 1.0f / (float)(pool->kernel_h * pool->kernel_w));   // count_include_pad=True
+    codegen_epilogue(ctx, kernel, l + 1, "                ", channel, index);
+    fprintf(file, "                y[%s] = v;\n", index);
+    fprintf(file, "            }\n");
+    fprintf(file, "        }\n");
+    fprintf(file, "    }\n");
+}
+
+static void codegen_global_avg_pool(codegen_ctx_t *ctx, codegen_kernel_t *kernel) {
+    FILE *file = ctx->file;
+    const uint32_t l = kernel->first;
+    uint32_t *in_shape = ctx->shapes[l];
+    const uint32_t inner = in_shape[2] * in_shape[3];
+    char channel[32];
+    snprintf(channel, sizeof(channel), "p %% %u", in_shape[1]);
+
+    fprintf(file, "    for (int p = 0; p < %u; p++) {\n", in_shape[0] * in_shape[1]);
+    fprintf(file, "        float v = 0.0f;\n");
+    fprintf(file, "        for (int k = 0; k < %u; k++) v += x[p * %u + k];\n", inner, inner);
+    fprintf(file, "        v /= %u.0f;\n", inner);
+    codegen_epilogue(ctx, kernel, l + 1, "        ", channel, "p");
+    fprintf(file, "        y[p] = v;\n");
+    fprintf(file, "    }\n");
+}
+
+static void codegen_kernel(codegen_ctx_t *ctx, codegen_kernel_t *kernel) {
+    executor_t *executor = ctx->executor;
+    FILE *file = ctx->file;
+    const uint32_t l = kernel->first;
+
+    // Comment: layers and shapes
+    fprintf(file, "// Layer %u", l);
+    if (kernel->last > l + 1) fprintf(file, "-%u", kernel->last - 1);
+    fprintf(file, ": ");
+    const char *names[] = {"linear", "batch_norm_1d", "batch_norm_2d", "relu", "residual add", "max_pool_2d", "avg_pool_2d", "global_avg_pool_2d", "flatten"};
+    for (uint32_t i = l; i < kernel->last; i++) {
+        fprintf(file, "%s%s%s", (i == l) ? "" : ", ", names[executor->layers[i].type], (i == l + 1 && kernel->fold) ? " (folded)" : "");
+    }
+    if (kernel->last == 0) fprintf(file, "copy");
+    fprintf(file, ", ");
+    codegen_shape(file, ctx->ndims[l], ctx->shapes[l]);
+    fprintf(file, " -> ");
+    codegen_shape(file, ctx->ndims[kernel->last], ctx->shapes[kernel->last]);
+    fprintf(file, "\n");
+
+    fprintf(file, "static void %s_layer%u(const float *restrict x, float *restrict y", ctx->name, l);
+    for (uint32_t i = l; i < kernel->last; i++) {
+        if (executor->layers[i].type == LAYER_RESIDUAL_ADD) fprintf(file, ", const float *restrict skip%u", i);
+    }
+    fprintf(file, ") {\n");
+    switch ((kernel->last == 0) ? LAYER_FLATTEN : executor->layers[l].type) {
+        case LAYER_LINEAR:
+            codegen_linear(ctx, kernel);
+            break;
+        case LAYER_MAX_POOL_2D:
+        case LAYER_AVG_POOL_2D:
+            codegen_pool(ctx, kernel);
+            break;
+        case LAYER_GLOBAL_AVG_POOL_2D:
+            codegen_global_avg_pool(ctx, kernel);
+            break;
+        case LAYER_FLATTEN: {
+            // Flatten (or an empty chain) whose output has to be stored: copy
+            const uint32_t size = codegen_numel(ctx->ndims[l], ctx->shapes[l]);
+            fprintf(file, "    for (int k = 0; k < %u; k++) y[k] = x[k];\n", size);
+            break;
+        }
+        default:
+            codegen_pointwise(ctx, kernel);
+            break;
+    }
+    fprintf(file, "}\n\n");
+}
+
+static void codegen_write(codegen_ctx_t *ctx) {
+    executor_t *executor = ctx->executor;
+    FILE *file = ctx->file;
+    const char *name = ctx->name;
+    const uint32_t num_layers = executor->num_layers;
+    const uint32_t input_size = codegen_numel(ctx->ndims[0], ctx->shapes[0]);
+    const uint32_t output_size = codegen_numel(ctx->ndims[num_layers], ctx->shapes[num_layers]);
+    const uint32_t activation_size = ctx->ping_size + ctx->pong_size + ctx->kept_size;
+    char macro[64];
+    size_t length = strlen(name);
+    for (size_t i = 0; i <= length; i++) macro[i] = (char)toupper((unsigned char)name[i]);
+
+    fprintf(file, "/*\n    Generated by codegen_emit (Res.C_model). Do not edit.\n\n    input ");
+    codegen_shape(file, ctx->ndims[0], ctx->shapes[0]);
+    fprintf(file, " -> output ");
+    codegen_shape(file, ctx->ndims[num_layers], ctx->shapes[num_layers]);
+    fprintf(file, ", float32\n    void %s_infer(const float *input, float *output);\n*/\n\n", name);
+    fprintf(file, "#define %s_INPUT_SIZE %u\n", macro, input_size);
+    fprintf(file, "#define %s_OUTPUT_SIZE %u\n", macro, output_size);
+    fprintf(file, "#define %s_ACTIVATION_SIZE %u\n\n", macro, activation_size);
+
+    ctx->weight_bytes = 0;
+    for (uint32_t k = 0; k < ctx->num_kernels; k++) codegen_constants(ctx, &ctx->kernels[k]);
+    fprintf(file, "static float %s_activation[%u];\n\n", name, activation_size > 0 ? activation_size : 1);
+
+    for (uint32_t k = 0; k < ctx->num_kernels; k++) {
+        if (!ctx->kernels[k].alias) codegen_kernel(ctx, &ctx->kernels[k]);
+    }
+
+    fprintf(file, "void %s_infer(const float *input, float *output) {\n", name);
+    char src[96], dst[96], skip[96];
+    for (uint32_t k = 0; k < ctx->num_kernels; k++) {
+        codegen_kernel_t *kernel = &ctx->kernels[k];
+        if (kernel->alias) continue;
+        codegen_pointer(ctx, kernel->src, src, sizeof(src));
+        codegen_pointer(ctx, kernel->dst, dst, sizeof(dst));
+        fprintf(file, "    %s_layer%u(%s, %s", name, kernel->first, src, dst);
+        for (uint32_t i = kernel->first; i < kernel->last; i++) {
+            if (executor->layers[i].type != LAYER_RESIDUAL_ADD) continue;
+            codegen_pointer(ctx, ctx->saved[((residual_t *)executor->layers[i].op)->source + 1], skip, sizeof(skip));
+            fprintf(file, ", %s", skip);
+        }
+        fprintf(file, ");\n");
+    }
+    fprintf(file, "}\n");
+}
+
+int codegen_emit(executor_t *executor, uint32_t ndim, uint32_t *shape, const char *name, FILE *file, codegen_info_t *info) {
+    if (ndim == 0 || ndim > EXECUTOR_MAX_NDIM) {
+        printf("[%s][%s][%d] Error: input ndim must be in [1, %d]\r\n", __FILE__, __func__, __LINE__, EXECUTOR_MAX_NDIM);
+        return -1;
+    }
+    size_t length = strlen(name);
+    uint8_t valid = (length > 0 && length < 32 && !isdigit((unsigned char)name[0]));
+    for (size_t i = 0; i < length; i++) {
+        if (!isalnum((unsigned char)name[i]) && name[i] != '_') valid = 0;
+    }
+    if (!valid) {
+        printf("[%s][%s][%d] Error: name must be a C identifier shorter than 32 characters\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    if (codegen_check_layers(executor) != 0) {
+        return -1;
+    }
+
+    const uint32_t num_layers = executor->num_layers;
+    codegen_ctx_t ctx;
+    ctx.executor = executor;
+    ctx.name = name;
+    ctx.file = file;
+    ctx.ndims = (uint32_t *)malloc((num_layers + 1) * sizeof(uint32_t));
+    ctx.shapes = (uint32_t (*)[EXECUTOR_MAX_NDIM])malloc((num_layers + 1) * sizeof(*ctx.shapes));
+    ctx.keep_output = (uint8_t *)calloc(num_layers + 1, sizeof(uint8_t));
+    ctx.saved = (codegen_loc_t *)calloc(num_layers + 1, sizeof(codegen_loc_t));
+    ctx.kernels = (codegen_kernel_t *)malloc((num_layers + 1) * sizeof(codegen_kernel_t));
+
+    // Shapes of every layer. A 1D input is (1 x features), same as executor_run.
+    int result = 0;
+    if (ndim == 1) {
+        ctx.ndims[0] = 2;
+        ctx.shapes[0][0] = 1;
+        ctx.shapes[0][1] = shape[0];
+    } else {
+        ctx.ndims[0] = ndim;
+        memcpy(ctx.shapes[0], shape, ndim * sizeof(uint32_t));
+    }
+    for (uint32_t l = 0; l < num_layers && result == 0; l++) {
+        if (executor_infer_layer_shape(executor, l, ctx.ndims[l], ctx.shapes[l], &ctx.ndims[l + 1], ctx.shapes[l + 1]) != 0) {
+            printf("[%s][%s][%d] Error: shape mismatch at layer %d\r\n", __FILE__, __func__, __LINE__, l);
+            result = -1;
+        }
+    }
+    for (uint32_t l = 0; l < num_layers && result == 0; l++) {
+        if (executor->layers[l].type != LAYER_RESIDUAL_ADD) continue;
+        const int32_t source = ((residual_t *)executor->layers[l].op)->source;
+        ctx.keep_output[source + 1] = 1;
+        if (source + 1 > (int32_t)l || codegen_numel(ctx.ndims[source + 1], ctx.shapes[source + 1]) != codegen_numel(ctx.ndims[l], ctx.shapes[l])) {
+            printf("[%s][%s][%d] Error: residual add at layer %d must add an earlier output of the same size\r\n", __FILE__, __func__, __LINE__, l);
+            result = -1;
+        }
+    }
+
+    if (result == 0) {
+        codegen_plan(&ctx);
+        codegen_write(&ctx);
+        if (info != (codegen_info_t *) NULL) {
+            info->input_size = codegen_numel(ctx.ndims[0], ctx.shapes[0]);
+            info->output_size = codegen_numel(ctx.ndims[num_layers], ctx.shapes[num_layers]);
+            info->num_kernels = 0;
+            for (uint32_t k = 0; k < ctx.num_kernels; k++) info->num_kernels += !ctx.kernels[k].alias;
+            info->weight_bytes = ctx.weight_bytes;
+            info->activation_bytes = (uint64_t)(ctx.ping_size + ctx.pong_size + ctx.kept_size) * sizeof(float);
+        }
+    }
+    free(ctx.ndims);
+    free(ctx.shapes);
+    free(ctx.keep_output);
+    free(ctx.saved);
+    free(ctx.kernels);
+    return result;
+}
+
+int codegen_emit_file(executor_t *executor, uint32_t ndim, uint32_t *shape, const char *name, const char *path, codegen_info_t *info) {
+    FILE *file = fopen(path, "w");
+    if (file == (FILE *) NULL) {
+        printf("[%s][%s][%d] Error: cannot open %s\r\n", __FILE__, __func__, __LINE__, path);
+        return -1;
+    }
+    int result = codegen_emit(executor, ndim, shape, name, file, info);
+    if (fclose(file) != 0) result = -1;
+    if (result != 0) remove(path);
+    return result;
+}
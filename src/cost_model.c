@@ -0,0 +1,258 @@
+#include "cost_model.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tensor.h"
+#include "executor.h"
+#include "op_linear.h"
+#include "op_activation.h"
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+#define COST_ELEMENT_BYTES sizeof(tensor_data_t)    // Bytes moved per element
+#define COST_MEMORY_BYTES sizeof(float)             // Bytes per float32 element, as tensor_get_data_memory
+
+static const char *cost_layer_names[] = {"linear", "batch_norm_1d", "batch_norm_2d", "relu", "residual_add",
+                                         "max_pool_2d", "avg_pool_2d", "global_avg_pool", "flatten"};
+
+static double cost_now_ms() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static uint64_t cost_numel(uint32_t ndim, uint32_t *shape) {
+    uint64_t numel = 1;
+    for (uint32_t i = 0; i < ndim; i++) numel *= shape[i];
+    return numel;
+}
+
+static uint64_t cost_tensor_bytes(tensor_t *tensor) {
+    return (tensor != (tensor_t *) NULL) ? tensor_get_data_memory(tensor) : 0;
+}
+
+machine_profile_t cost_model_default_profile() {
+    machine_profile_t profile = {0.2, 0.4, 5.0};
+    return profile;
+}
+
+// Fastest of COST_MODEL_CALIBRATE_REPEAT runs of count calls, in ms per call
+static double cost_time_linear(tensor_t *input, linear_t *linear_weight, tensor_t *output, uint32_t count) {
+    double best = 1e30;
+    linear_out(input, linear_weight, output);   // Warm up
+    for (int r = 0; r < COST_MODEL_CALIBRATE_REPEAT; r++) {
+        double start = cost_now_ms();
+        for (uint32_t i = 0; i < count; i++) linear_out(input, linear_weight, output);
+        double ms = (cost_now_ms() - start) / count;
+        if (ms < best) best = ms;
+    }
+    return best;
+}
+
+static double cost_time_relu(tensor_t *input, tensor_t *output, uint32_t count) {
+    double best = 1e30;
+    relu_out(input, output);
+    for (int r = 0; r < COST_MODEL_CALIBRATE_REPEAT; r++) {
+        double start = cost_now_ms();
+        for (uint32_t i = 0; i < count; i++) relu_out(input, output);
+        double ms = (cost_now_ms() - start) / count;
+        if (ms < best) best = ms;
+    }
+    return best;
+}
+
+int cost_model_calibrate(machine_profile_t *profile) {
+    // Peak FLOP/s: (64 x 256) x (256 x 256)^T, the operands stay in cache
+    const uint32_t batch_size = 64, features = 256;
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){batch_size, features}, (void *)0);
+    tensor_t *weight = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){features, features}, (void *)0);
+    tensor_t *output = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){batch_size, features}, (void *)0);
+    for (uint32_t i = 0; i < input->num_elements; i++) input->data[i].float32 = (float)(i % 7) * 0.1f;
+    for (uint32_t i = 0; i < weight->num_elements; i++) weight->data[i].float32 = (float)(i % 5) * 0.01f;
+    linear_t *linear_weight = linear_create(weight, NULL);
+    double ms = cost_time_linear(input, linear_weight, output, 4);
+    profile->peak_gflops = 2.0 * batch_size * features * features / (ms * 1e6);
+    linear_free(linear_weight, 1);
+    tensor_free(input);
+    tensor_free(output);
+
+    // Bandwidth: relu over 2M elements (read and write), larger than the caches
+    const uint32_t num_elements = 2 * 1024 * 1024;
+    input = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){num_elements}, (void *)0);
+    output = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){num_elements}, (void *)0);
+    for (uint32_t i = 0; i < num_elements; i++) input->data[i].float32 = (float)(i % 3) - 1.0f;
+    ms = cost_time_relu(input, output, 1);
+    profile->bandwidth_gbps = 2.0 * num_elements * COST_ELEMENT_BYTES / (ms * 1e6);
+    tensor_free(input);
+    tensor_free(output);
+
+    // Overhead: relu of a single element
+    input = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){1}, (void *)0);
+    input->data[0].float32 = 1.0f;
+    profile->overhead_us = cost_time_relu(input, input, 1000) * 1e3;
+    tensor_free(input);
+    return (profile->peak_gflops > 0.0 && profile->bandwidth_gbps > 0.0) ? 0 : -1;
+}
+
+static uint64_t cost_activation_peak(executor_t *executor, uint64_t *output_bytes, uint64_t *temp_bytes, cost_plan_t plan) {
+    // output_bytes[g], temp_bytes[g]: output and temporary buffer of group g
+    uint64_t peak = 0;
+    if (plan == COST_PLAN_EXECUTOR_RUN) {
+        // alive: kept outputs and the current intermediate. A flatten reshapes an intermediate in-place,
+        // or is a view of the input or of a kept output.
+        uint64_t alive = 0, cur_bytes = 0;
+        uint8_t cur_owned = 0;
+        for (uint32_t g = 0; g < executor->num_groups; g++) {
+            layer_group_t *group = &executor->groups[g];
+            const uint32_t last = group->first + group->count - 1;
+            if (executor->layers[group->first].type == LAYER_FLATTEN) {
+                if (!cur_owned) cur_bytes = 0;
+                continue;
+            }
+            if (alive + output_bytes[g] + temp_bytes[g] > peak) peak = alive + output_bytes[g] + temp_bytes[g];
+            alive += output_bytes[g];
+            if (cur_owned) alive -= cur_bytes;
+            cur_owned = !executor->keep_output[last + 1];
+            cur_bytes = output_bytes[g];
+        }
+        return peak;
+    }
+
+    // Session: the same buffers as session_create (scratch included)
+    uint64_t buffers[2] = {0, 0};
+    int32_t cur_location = -1;  // -1: input, 0 / 1: ping-pong, 2: kept
+    for (uint32_t g = 0; g < executor->num_groups; g++) {
+        layer_group_t *group = &executor->groups[g];
+        const uint32_t last = group->first + group->count - 1;
+        if (executor->keep_output[last + 1]) {
+            peak += output_bytes[g];
+            cur_location = 2;
+        } else if (executor->layers[group->first].type != LAYER_FLATTEN || cur_location < 0) {
+            cur_location = (cur_location == 0) ? 1 : 0;
+            if (output_bytes[g] > buffers[cur_location]) buffers[cur_location] = output_bytes[g];
+        }
+    }
+    return peak + buffers[0] + buffers[1] + 2 * (uint64_t)executor->scratch_elements * COST_MEMORY_BYTES;
+}
+
+int cost_model_estimate(executor_t *executor, uint32_t ndim, uint32_t *shape, cost_plan_t plan, machine_profile_t *profile, model_cost_t *cost) {
+    if (ndim == 0 || ndim > EXECUTOR_MAX_NDIM || profile->peak_gflops <= 0.0 || profile->bandwidth_gbps <= 0.0) {
+        printf("[%s][%s][%d] Error: ndim must be 1 to %d and the profile must be positive\r\n", __FILE__, __func__, __LINE__, EXECUTOR_MAX_NDIM);
+        return -1;
+    }
+    executor_prepare(executor);
+    memset(cost, 0, sizeof(model_cost_t));
+    cost->num_layers = executor->num_layers;
+    cost->layers = (layer_cost_t *)calloc(executor->num_layers + 1, sizeof(layer_cost_t));
+    uint64_t output_bytes[executor->num_groups + 1];
+    uint64_t temp_bytes[executor->num_groups + 1];
+
+    uint32_t cur_ndim = ndim;
+    uint32_t cur_shape[EXECUTOR_MAX_NDIM];
+    memcpy(cur_shape, shape, ndim * sizeof(uint32_t));
+    for (uint32_t g = 0; g < executor->num_groups; g++) {
+        layer_group_t *group = &executor->groups[g];
+        const uint32_t last = group->first + group->count - 1;
+        temp_bytes[g] = 2 * (uint64_t)group->scratch_elements * COST_MEMORY_BYTES;   // Scratch of a fused linear group
+        for (uint32_t l = group->first; l <= last; l++) {
+            layer_t *layer = &executor->layers[l];
+            layer_cost_t *layer_cost = &cost->layers[l];
+            uint32_t next_ndim;
+            uint32_t next_shape[EXECUTOR_MAX_NDIM];
+            if (executor_infer_layer_shape(executor, l, cur_ndim, cur_shape, &next_ndim, next_shape) != 0) {
+                printf("[%s][%s][%d] Error: shape mismatch at layer %d\r\n", __FILE__, __func__, __LINE__, l);
+                cost_model_free(cost);
+                return -1;
+            }
+            const uint64_t in_elements = cost_numel(cur_ndim, cur_shape);
+            const uint64_t out_elements = cost_numel(next_ndim, next_shape);
+            uint64_t read_elements = 0;     // Weights and skip connections
+            layer_cost->type = layer->type;
+            layer_cost->group = g;
+            switch (layer->type) {
+                case LAYER_LINEAR: {
+                    linear_t *linear_weight = (linear_t *)layer->op;
+                    const uint64_t weight_elements = linear_weight->weight->num_elements;
+                    const uint64_t bias_elements = (linear_weight->bias != (tensor_t *) NULL) ? linear_weight->bias->num_elements : 0;
+                    layer_cost->flops = 2 * (out_elements / linear_weight->weight->shape[0]) * weight_elements + ((bias_elements > 0) ? out_elements : 0);
+                    layer_cost->weight_bytes = cost_tensor_bytes(linear_weight->weight) + cost_tensor_bytes(linear_weight->bias);
+                    read_elements = weight_elements + bias_elements;
+                    break;
+                }
+                case LAYER_BATCH_NORM_1D:
+                case LAYER_BATCH_NORM_2D: {
+                    batch_norm_t *batch_norm_weight = (batch_norm_t *)layer->op;
+                    const uint64_t channels = batch_norm_weight->mean->shape[0];
+                    layer_cost->flops = 2 * in_elements;
+                    layer_cost->weight_bytes = cost_tensor_bytes(batch_norm_weight->mean) + cost_tensor_bytes(batch_norm_weight->var) +
+                                               cost_tensor_bytes(batch_norm_weight->epsilon) + cost_tensor_bytes(batch_norm_weight->gamma) +
+                                               cost_tensor_bytes(batch_norm_weight->beta) + cost_tensor_bytes(executor->folded[l]);
+                    read_elements = 2 * channels;   // Folded coefficient and bias (by the plan)
+                    break;
+                }
+                case LAYER_RELU:
+                    layer_cost->flops = in_elements;
+                    break;
+                case LAYER_RESIDUAL_ADD:
+                    layer_cost->flops = in_elements;
+                    read_elements = in_elements;
+                    break;
+                case LAYER_MAX_POOL_2D:
+                case LAYER_AVG_POOL_2D: {
+                    pool2d_t *pool = (pool2d_t *)layer->op;
+                    layer_cost->flops = out_elements * pool->kernel_h * pool->kernel_w;
+                    break;
+                }
+                case LAYER_GLOBAL_AVG_POOL_2D:
+                    layer_cost->flops = in_elements;
+                    break;
+                default:    // Flatten: only the shape
+                    break;
+            }
+            if (layer->type != LAYER_FLATTEN) {
+                layer_cost->bytes = (read_elements + ((l == group->first) ? in_elements : 0) + ((l == last) ? out_elements : 0)) * COST_ELEMENT_BYTES;
+            }
+            layer_cost->output_bytes = out_elements * COST_MEMORY_BYTES;
+            layer_cost->intensity = (layer_cost->bytes > 0) ? (double)layer_cost->flops / layer_cost->bytes : 0.0;
+            const double compute_ms = layer_cost->flops / (profile->peak_gflops * 1e6);
+            const double memory_ms = layer_cost->bytes / (profile->bandwidth_gbps * 1e6);
+            layer_cost->memory_bound = (memory_ms > compute_ms);
+            layer_cost->predicted_ms = layer_cost->memory_bound ? memory_ms : compute_ms;
+            if (l == group->first && layer->type != LAYER_FLATTEN) layer_cost->predicted_ms += profile->overhead_us * 1e-3;
+
+            cost->flops += layer_cost->flops;
+            cost->bytes += layer_cost->bytes;
+            cost->weight_bytes += layer_cost->weight_bytes;
+            cost->predicted_ms += layer_cost->predicted_ms;
+            cur_ndim = next_ndim;
+            memcpy(cur_shape, next_shape, next_ndim * sizeof(uint32_t));
+        }
+        output_bytes[g] = cost_numel(cur_ndim, cur_shape) * COST_MEMORY_BYTES;
+    }
+    cost->intensity = (cost->bytes > 0) ? (double)cost->flops / cost->bytes : 0.0;
+    cost->activation_peak = cost_activation_peak(executor, output_bytes, temp_bytes, plan);
+    return 0;
+}
+
+void cost_model_free(model_cost_t *cost) {
+    if (cost->layers != (layer_cost_t *) NULL) free(cost->layers);
+    cost->layers = (layer_cost_t *) NULL;
+    cost->num_layers = 0;
+}
+
+void cost_model_print(model_cost_t *cost) {
+    printf("layer  type             group        FLOPs        bytes  FLOP/B      weights  predicted ms\r\n");
+    for (uint32_t l = 0; l < cost->num_layers; l++) {
+        layer_cost_t *layer_cost = &cost->layers[l];
+        printf("%5d  %-15s  %5d  %11" PRIu64 "  %11" PRIu64 "  %6.2f  %11" PRIu64 "  %12.4f %s\r\n", l, cost_layer_names[layer_cost->type], layer_cost->group,
+               layer_cost->flops, layer_cost->bytes, layer_cost->intensity, layer_cost->weight_bytes, layer_cost->predicted_ms,
+               (layer_cost->flops == 0 && layer_cost->bytes == 0) ? "" : (layer_cost->memory_bound ? "(memory)" : "(compute)"));
+    }
+    printf("total                       %11" PRIu64 "  %11" PRIu64 "  %6.2f  %11" PRIu64 "  %12.4f\r\n", cost->flops, cost->bytes, cost->intensity, cost->weight_bytes, cost->predicted_ms);
+    printf("activation peak: %" PRIu64 " bytes, weights + activations: %" PRIu64 " bytes\r\n", cost->activation_peak, cost->weight_bytes + cost->activation_peak);
+}
@@ -0,0 +1,862 @@
+#include "executor.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tensor.h"
+#include "op_elementwise.h"
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+executor_t *executor_create() {
+    executor_t *executor = (executor_t *)malloc(sizeof(executor_t));
+    executor->num_layers = 0;
+    executor->capacity = 4;
+    executor->layers = (layer_t *)malloc(executor->capacity * sizeof(layer_t));
+    executor->fusion = 0;
+    executor->plan_ready = 0;
+    executor->num_groups = 0;
+    executor->groups = (layer_group_t *) NULL;
+    executor->folded = (tensor_t **) NULL;
+    executor->keep_output = (uint8_t *) NULL;
+    executor->saved = (tensor_t **) NULL;
+    executor->scratch[0] = (tensor_t *) NULL;
+    executor->scratch[1] = (tensor_t *) NULL;
+    executor->scratch_elements = 0;
+    executor->activation_bytes = 0;
+    return executor;
+}
+
+static void executor_free_plan(executor_t *executor) {
+    if (executor->folded != (tensor_t **) NULL) {
+        for (int i = 0; i < executor->num_layers; i++) {
+            if (executor->folded[i] != (tensor_t *) NULL) tensor_free(executor->folded[i]);
+        }
+        free(executor->folded);
+        executor->folded = (tensor_t **) NULL;
+    }
+    if (executor->groups != (layer_group_t *) NULL) {
+        free(executor->groups);
+        executor->groups = (layer_group_t *) NULL;
+    }
+    if (executor->keep_output != (uint8_t *) NULL) {
+        free(executor->keep_output);
+        executor->keep_output = (uint8_t *) NULL;
+    }
+    executor->num_groups = 0;
+    executor->scratch_elements = 0;
+    executor->plan_ready = 0;
+}
+
+void executor_free(executor_t *executor, uint8_t deep) {
+    // deep: 0 - free only executor_t, 1 - free executor_t and the ops of the layers (with their weights)
+    executor_free_plan(executor);
+    for (int i = 0; i < executor->num_layers; i++) {
+        if (executor->layers[i].type == LAYER_RESIDUAL_ADD) free(executor->layers[i].op);     // Owned by the executor
+    }
+    if (deep != 0) {
+        for (int i = 0; i < executor->num_layers; i++) {
+            layer_t *layer = &executor->layers[i];
+            switch (layer->type) {
+                case LAYER_LINEAR:
+                    linear_free((linear_t *)layer->op, 1);
+                    break;
+                case LAYER_BATCH_NORM_1D:
+                case LAYER_BATCH_NORM_2D:
+                    batch_free((batch_norm_t *)layer->op, 1);
+                    break;
+                case LAYER_MAX_POOL_2D:
+                case LAYER_AVG_POOL_2D:
+                    pool2d_free((pool2d_t *)layer->op);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    free(executor->layers);
+    free(executor);
+}
+
+static executor_t *executor_add_layer(executor_t *executor, layer_type_t type, void *op) {
+    executor_free_plan(executor);
+    if (executor->num_layers == executor->capacity) {
+        executor->capacity *= 2;
+        executor->layers = (layer_t *)realloc(executor->layers, executor->capacity * sizeof(layer_t));
+    }
+    executor->layers[executor->num_layers].type = type;
+    executor->layers[executor->num_layers].op = op;
+    executor->num_layers++;
+    return executor;
+}
+
+executor_t *executor_add_linear(executor_t *executor, linear_t *linear_weight) {
+    if (linear_weight == (linear_t *) NULL) {
+        printf("[%s][%s][%d] Error: linear_weight is NULL\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    return executor_add_layer(executor, LAYER_LINEAR, linear_weight);
+}
+
+executor_t *executor_add_batch_norm_1d(executor_t *executor, batch_norm_t *batch_norm_weight) {
+    if (batch_norm_weight == (batch_norm_t *) NULL) {
+        printf("[%s][%s][%d] Error: batch_norm_weight is NULL\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    return executor_add_layer(executor, LAYER_BATCH_NORM_1D, batch_norm_weight);
+}
+
+executor_t *executor_add_batch_norm_2d(executor_t *executor, batch_norm_t *batch_norm_weight) {
+    if (batch_norm_weight == (batch_norm_t *) NULL) {
+        printf("[%s][%s][%d] Error: batch_norm_weight is NULL\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    return executor_add_layer(executor, LAYER_BATCH_NORM_2D, batch_norm_weight);
+}
+
+executor_t *executor_add_relu(executor_t *executor) {
+    return executor_add_layer(executor, LAYER_RELU, NULL);
+}
+
+executor_t *executor_add_residual(executor_t *executor, int32_t source) {
+    // output = previous output + output of layer source (-1: input of the executor)
+    if (source < -1 || source >= (int32_t)executor->num_layers) {
+        printf("[%s][%s][%d] Error: source must be in [-1, %d)\r\n", __FILE__, __func__, __LINE__, executor->num_layers);
+        return NULL;
+    }
+    residual_t *residual = (residual_t *)malloc(sizeof(residual_t));
+    residual->source = source;
+    return executor_add_layer(executor, LAYER_RESIDUAL_ADD, residual);
+}
+
+executor_t *executor_add_max_pool_2d(executor_t *executor, pool2d_t *pool) {
+    if (pool == (pool2d_t *) NULL) {
+        printf("[%s][%s][%d] Error: pool is NULL\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    return executor_add_layer(executor, LAYER_MAX_POOL_2D, pool);
+}
+
+executor_t *executor_add_avg_pool_2d(executor_t *executor, pool2d_t *pool) {
+    if (pool == (pool2d_t *) NULL) {
+        printf("[%s][%s][%d] Error: pool is NULL\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    return executor_add_layer(executor, LAYER_AVG_POOL_2D, pool);
+}
+
+executor_t *executor_add_global_avg_pool_2d(executor_t *executor) {
+    return executor_add_layer(executor, LAYER_GLOBAL_AVG_POOL_2D, NULL);
+}
+
+executor_t *executor_add_flatten(executor_t *executor) {
+    return executor_add_layer(executor, LAYER_FLATTEN, NULL);
+}
+
+void executor_set_fusion(executor_t *executor, uint8_t fusion) {
+    executor_free_plan(executor);
+    executor->fusion = fusion;
+}
+
+static uint8_t layer_is_pointwise(layer_type_t type) {
+    return type == LAYER_BATCH_NORM_1D || type == LAYER_BATCH_NORM_2D || type == LAYER_RELU || type == LAYER_RESIDUAL_ADD;
+}
+
+// Linear layers can be fused only when the weight can be read row by row.
+static uint8_t layer_is_fusable_linear(layer_t *layer) {
+    if (layer->type != LAYER_LINEAR) return 0;
+    linear_t *linear_weight = (linear_t *)layer->op;
+    return linear_weight->weight->type == TENSOR_FLOAT32 && tensor_is_contiguous(linear_weight->weight);
+}
+
+// Rows of a fused linear group go through scratch buffers between its linear layers: EXECUTOR_FUSE_ROWS rows of the
+// largest output of the linear layers before the last one.
+static uint32_t group_scratch_elements(executor_t *executor, uint32_t first, uint32_t end) {
+    if (end - first < 2 || executor->layers[first].type != LAYER_LINEAR) return 0;
+    uint32_t max_features = 0;
+    uint32_t features = 0;      // Output of the previous linear layer
+    for (uint32_t l = first; l < end; l++) {
+        if (executor->layers[l].type != LAYER_LINEAR) continue;
+        if (features > max_features) max_features = features;
+        features = ((linear_t *)executor->layers[l].op)->weight->shape[0];
+    }
+    return EXECUTOR_FUSE_ROWS * max_features;
+}
+
+static void executor_plan(executor_t *executor) {
+    // Split the layers into groups. Without fusion, every layer is a group by itself.
+    if (executor->plan_ready) return;
+    executor_free_plan(executor);
+
+    executor->groups = (layer_group_t *)malloc((executor->num_layers + 1) * sizeof(layer_group_t));
+    executor->folded = (tensor_t **)malloc((executor->num_layers + 1) * sizeof(tensor_t *));
+    for (int i = 0; i < executor->num_layers; i++) executor->folded[i] = (tensor_t *) NULL;
+    executor->keep_output = (uint8_t *)calloc(executor->num_layers + 1, sizeof(uint8_t));
+    for (int i = 0; i < executor->num_layers; i++) {
+        if (executor->layers[i].type == LAYER_RESIDUAL_ADD) {
+            executor->keep_output[((residual_t *)executor->layers[i].op)->source + 1] = 1;
+        }
+    }
+
+    // A kept output must be stored, so a group ends at the layer whose output is kept.
+    uint32_t i = 0;
+    while (i < executor->num_layers) {
+        layer_t *layer = &executor->layers[i];
+        uint32_t j = i + 1;
+        if (executor->fusion) {
+            if (layer_is_fusable_linear(layer)) {
+                // linear -> (batch_norm_1d | relu | residual add | linear)*
+                while (j < executor->num_layers && !executor->keep_output[j]) {
+                    layer_type_t type = executor->layers[j].type;
+                    if (!layer_is_fusable_linear(&executor->layers[j]) && type != LAYER_BATCH_NORM_1D && type != LAYER_RELU && type != LAYER_RESIDUAL_ADD) break;
+                    j++;
+                }
+            } else if (layer_is_pointwise(layer->type)) {
+                // (batch_norm_1d/2d | relu | residual add)+ -> global_avg_pool_2d?
+                while (j < executor->num_layers && !executor->keep_output[j] && layer_is_pointwise(executor->layers[j].type)) j++;
+                if (j < executor->num_layers && !executor->keep_output[j] && executor->layers[j].type == LAYER_GLOBAL_AVG_POOL_2D) j++;
+            }
+        }
+        // Batch norm is folded once here, so a run does not fold (allocate) it
+        for (uint32_t k = i; k < j; k++) {
+            if (executor->layers[k].type == LAYER_BATCH_NORM_1D || executor->layers[k].type == LAYER_BATCH_NORM_2D) {
+                executor->folded[k] = batch_norm_fold((batch_norm_t *)executor->layers[k].op);
+            }
+        }
+        layer_group_t *group = &executor->groups[executor->num_groups];
+        group->first = i;
+        group->count = j - i;
+        group->scratch_elements = group_scratch_elements(executor, i, j);
+        if (group->scratch_elements > executor->scratch_elements) executor->scratch_elements = group->scratch_elements;
+        executor->num_groups++;
+        i = j;
+    }
+    executor->plan_ready = 1;
+}
+
+// Output shape of a single layer. Returns 0 on success, -1 on error.
+static int layer_infer_shape(layer_t *layer, uint32_t ndim, uint32_t *shape, uint32_t *out_ndim, uint32_t *out_shape) {
+    switch (layer->type) {
+        case LAYER_LINEAR: {
+            linear_t *linear_weight = (linear_t *)layer->op;
+            uint32_t batch_size = (ndim == 1) ? 1 : shape[0];
+            uint32_t in_features = shape[ndim - 1];
+            if (ndim > 2 || in_features != linear_weight->weight->shape[1]) {
+                printf("[%s][%s][%d] Error: linear input must be (batch_size x %d)\r\n", __FILE__, __func__, __LINE__, linear_weight->weight->shape[1]);
+                return -1;
+            }
+            *out_ndim = 2;
+            out_shape[0] = batch_size;
+            out_shape[1] = linear_weight->weight->shape[0];
+            return 0;
+        }
+        case LAYER_BATCH_NORM_1D: {
+            batch_norm_t *batch_norm_weight = (batch_norm_t *)layer->op;
+            if (ndim != 2 || shape[1] != batch_norm_weight->mean->shape[0]) {
+                printf("[%s][%s][%d] Error: batch_norm_1d input must be (batch_size x %d)\r\n", __FILE__, __func__, __LINE__, batch_norm_weight->mean->shape[0]);
+                return -1;
+            }
+            *out_ndim = ndim;
+            memcpy(out_shape, shape, ndim * sizeof(uint32_t));
+            return 0;
+        }
+        case LAYER_BATCH_NORM_2D: {
+            batch_norm_t *batch_norm_weight = (batch_norm_t *)layer->op;
+            if (ndim != 4 || shape[1] != batch_norm_weight->mean->shape[0]) {
+                printf("[%s][%s][%d] Error: batch_norm_2d input must be (batch_size x %d x height x width)\r\n", __FILE__, __func__, __LINE__, batch_norm_weight->mean->shape[0]);
+                return -1;
+            }
+            *out_ndim = ndim;
+            memcpy(out_shape, shape, ndim * sizeof(uint32_t));
+            return 0;
+        }
+        case LAYER_RELU:
+        case LAYER_RESIDUAL_ADD:    // The kept output must have the same shape (checked when it runs)
+            *out_ndim = ndim;
+            memcpy(out_shape, shape, ndim * sizeof(uint32_t));
+            return 0;
+        case LAYER_MAX_POOL_2D:
+        case LAYER_AVG_POOL_2D: {
+            pool2d_t *pool = (pool2d_t *)layer->op;
+            if (ndim != 4 || shape[2] + 2 * pool->padding_h < pool->kernel_h || shape[3] + 2 * pool->padding_w < pool->kernel_w) {
+                printf("[%s][%s][%d] Error: pooling input must be (batch_size x channels x height x width) larger than the kernel\r\n", __FILE__, __func__, __LINE__);
+                return -1;
+            }
+            *out_ndim = 4;
+            out_shape[0] = shape[0];
+            out_shape[1] = shape[1];
+            out_shape[2] = (shape[2] + 2 * pool->padding_h - pool->kernel_h) / pool->stride_h + 1;
+            out_shape[3] = (shape[3] + 2 * pool->padding_w - pool->kernel_w) / pool->stride_w + 1;
+            return 0;
+        }
+        case LAYER_GLOBAL_AVG_POOL_2D:
+            if (ndim != 4) {
+                printf("[%s][%s][%d] Error: global_avg_pool_2d input must be (batch_size x channels x height x width)\r\n", __FILE__, __func__, __LINE__);
+                return -1;
+            }
+            *out_ndim = 4;
+            out_shape[0] = shape[0];
+            out_shape[1] = shape[1];
+            out_shape[2] = 1;
+            out_shape[3] = 1;
+            return 0;
+        case LAYER_FLATTEN: {
+            uint32_t features = 1;
+            for (int i = 1; i < ndim; i++) features *= shape[i];
+            *out_ndim = 2;
+            out_shape[0] = shape[0];
+            out_shape[1] = features;
+            return 0;
+        }
+        default:
+            printf("[%s][%s][%d] Error: Unknown layer type\r\n", __FILE__, __func__, __LINE__);
+            return -1;
+    }
+}
+
+static int group_infer_shape(executor_t *executor, layer_group_t *group, uint32_t ndim, uint32_t *shape, uint32_t *out_ndim, uint32_t *out_shape) {
+    uint32_t cur_ndim = ndim;
+    uint32_t cur_shape[EXECUTOR_MAX_NDIM];
+    memcpy(cur_shape, shape, ndim * sizeof(uint32_t));
+    for (uint32_t i = group->first; i < group->first + group->count; i++) {
+        uint32_t next_ndim;
+        uint32_t next_shape[EXECUTOR_MAX_NDIM];
+        if (layer_infer_shape(&executor->layers[i], cur_ndim, cur_shape, &next_ndim, next_shape) != 0) {
+            printf("[%s][%s][%d] Error: shape mismatch at layer %d\r\n", __FILE__, __func__, __LINE__, i);
+            return -1;
+        }
+        cur_ndim = next_ndim;
+        memcpy(cur_shape, next_shape, next_ndim * sizeof(uint32_t));
+    }
+    *out_ndim = cur_ndim;
+    memcpy(out_shape, cur_shape, cur_ndim * sizeof(uint32_t));
+    return 0;
+}
+
+int executor_infer_shape(executor_t *executor, uint32_t ndim, uint32_t *shape, uint32_t *out_ndim, uint32_t *out_shape) {
+    if (ndim > EXECUTOR_MAX_NDIM) {
+        printf("[%s][%s][%d] Error: input ndim must be less than or equal to %d\r\n", __FILE__, __func__, __LINE__, EXECUTOR_MAX_NDIM);
+        return -1;
+    }
+    layer_group_t all = {0, executor->num_layers};
+    return group_infer_shape(executor, &all, ndim, shape, out_ndim, out_shape);
+}
+
+int executor_infer_layer_shape(executor_t *executor, uint32_t layer, uint32_t ndim, uint32_t *shape, uint32_t *out_ndim, uint32_t *out_shape) {
+    if (layer >= executor->num_layers || ndim > EXECUTOR_MAX_NDIM) {
+        printf("[%s][%s][%d] Error: layer must be less than %d and ndim less than or equal to %d\r\n", __FILE__, __func__, __LINE__, executor->num_layers, EXECUTOR_MAX_NDIM);
+        return -1;
+    }
+    return layer_infer_shape(&executor->layers[layer], ndim, shape, out_ndim, out_shape);
+}
+
+static inline tensor_t *residual_skip(executor_t *executor, uint32_t layer) {
+    return executor->saved[((residual_t *)executor->layers[layer].op)->source + 1];
+}
+
+// Apply the point-wise layers [first, last) of a fused group to a single value of the given channel.
+// index is the position of the value in the output of the layers (for the residual add).
+static inline float fused_epilogue(executor_t *executor, uint32_t first, uint32_t last, uint32_t channel, uint32_t index, float value) {
+    for (uint32_t l = first; l < last; l++) {
+        if (executor->layers[l].type == LAYER_RELU) {
+            value = (value > 0.0f) ? value : 0.0f;
+        } else if (executor->layers[l].type == LAYER_RESIDUAL_ADD) {
+            value += residual_skip(executor, l)->data[index].float32;
+        } else {    // Folded batch norm
+            const tensor_t *folded = executor->folded[l];
+            value = value * folded->data[channel].float32 + folded->data[folded->shape[1] + channel].float32;
+        }
+    }
+    return value;
+}
+
+static tensor_t *fused_pointwise_out(executor_t *executor, layer_group_t *group, tensor_t *input, tensor_t *output) {
+    // Single pass over the data. The input is seen as (outer x channels x inner).
+    // Each chunk of EXECUTOR_FUSE_CHUNK elements goes through all the layers while it is in the cache.
+    // If the group ends with global_avg_pool_2d, the chunks are summed instead of being stored.
+    uint32_t last = group->first + group->count;
+    const uint8_t pool = (executor->layers[last - 1].type == LAYER_GLOBAL_AVG_POOL_2D);
+    if (pool) last--;
+    const uint32_t channels = (input->ndim >= 2) ? input->shape[1] : 1;
+    const uint32_t outer = (input->ndim >= 1) ? input->shape[0] : 1;
+    const uint32_t inner = input->num_elements / (outer * channels);
+    tensor_data_t chunk[EXECUTOR_FUSE_CHUNK];
+
+    for (uint32_t n = 0; n < outer; n++) {
+        for (uint32_t c = 0; c < channels; c++) {
+            const tensor_data_t *x = input->data + (n * channels + c) * inner;
+            tensor_data_t *y = output->data + (n * channels + c) * inner;
+            if (inner == 1) {
+                float value = fused_epilogue(executor, group->first, last, c, n * channels + c, x[0].float32);
+                output->data[n * channels + c].float32 = value;
+                continue;
+            }
+            float sum = 0.0f;
+            for (uint32_t k0 = 0; k0 < inner; k0 += EXECUTOR_FUSE_CHUNK) {
+                const uint32_t len = (inner - k0 < EXECUTOR_FUSE_CHUNK) ? inner - k0 : EXECUTOR_FUSE_CHUNK;
+                const tensor_data_t *src = x + k0;
+                tensor_data_t *dst = pool ? chunk : y + k0;
+                for (uint32_t l = group->first; l < last; l++) {
+                    if (executor->layers[l].type == LAYER_RELU) {
+                        for (uint32_t k = 0; k < len; k++) {
+                            dst[k].float32 = (src[k].float32 > 0.0f) ? src[k].float32 : 0.0f;
+                        }
+                    } else if (executor->layers[l].type == LAYER_RESIDUAL_ADD) {
+                        const tensor_data_t *skip = residual_skip(executor, l)->data + (n * channels + c) * inner + k0;
+                        for (uint32_t k = 0; k < len; k++) {
+                            dst[k].float32 = src[k].float32 + skip[k].float32;
+                        }
+                    } else {
+                        const tensor_t *folded = executor->folded[l];
+                        const float coefficient = folded->data[c].float32;
+                        const float shift = folded->data[folded->shape[1] + c].float32;
+                        for (uint32_t k = 0; k < len; k++) {
+                            dst[k].float32 = src[k].float32 * coefficient + shift;
+                        }
+                    }
+                    src = dst;
+                }
+                if (pool) {
+                    for (uint32_t k = 0; k < len; k++) {
+                        sum += chunk[k].float32;
+                    }
+                }
+            }
+            if (pool) {
+                // The plane (n, c) is already read, so the result can be written over the input (in-place)
+                output->data[n * channels + c].float32 = sum / (float)inner;
+            }
+        }
+    }
+    return output;
+}
+
+static tensor_t *fused_linear_out(executor_t *executor, layer_group_t *group, tensor_t *input, tensor_t *output) {
+    // Depth-first: EXECUTOR_FUSE_ROWS rows of the input go through all the layers of the group
+    // before the next rows are read. The intermediate rows stay in two small scratch buffers,
+    // the ones of the executor (session) or allocated for this run.
+    const uint32_t last = group->first + group->count;
+    const uint32_t batch_size = input->shape[0];
+
+    uint32_t last_linear = group->first;
+    for (uint32_t l = group->first; l < last; l++) {
+        if (executor->layers[l].type == LAYER_LINEAR) last_linear = l;
+    }
+    tensor_t *scratch_tensors[2] = {executor->scratch[0], executor->scratch[1]};
+    const uint8_t own_scratch = (group->scratch_elements > 0 && (scratch_tensors[0] == (tensor_t *) NULL || scratch_tensors[1] == (tensor_t *) NULL ||
+                                 scratch_tensors[0]->num_elements < group->scratch_elements || scratch_tensors[1]->num_elements < group->scratch_elements));
+    if (own_scratch) {
+        for (int i = 0; i < 2; i++) {
+            scratch_tensors[i] = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){group->scratch_elements}, (void *)0);
+        }
+    }
+    tensor_data_t *scratch[2];
+    scratch[0] = (scratch_tensors[0] != (tensor_t *) NULL) ? scratch_tensors[0]->data : (tensor_data_t *) NULL;
+    scratch[1] = (scratch_tensors[1] != (tensor_t *) NULL) ? scratch_tensors[1]->data : (tensor_data_t *) NULL;
+
+    for (uint32_t r0 = 0; r0 < batch_size; r0 += EXECUTOR_FUSE_ROWS) {
+        const uint32_t rows = (batch_size - r0 < EXECUTOR_FUSE_ROWS) ? batch_size - r0 : EXECUTOR_FUSE_ROWS;
+        const tensor_data_t *src = input->data + r0 * input->shape[1];
+        uint32_t in_features = input->shape[1];
+        int toggle = 0;
+
+        uint32_t l = group->first;
+        while (l < last) {
+            // linear followed by its epilogue [l + 1, epilogue_end)
+            linear_t *linear_weight = (linear_t *)executor->layers[l].op;
+            const tensor_data_t *weight = linear_weight->weight->data;
+            const tensor_t *bias = linear_weight->bias;
+            const uint32_t out_features = linear_weight->weight->shape[0];
+            uint32_t epilogue_end = l + 1;
+            while (epilogue_end < last && executor->layers[epilogue_end].type != LAYER_LINEAR) epilogue_end++;
+
+            tensor_data_t *dst = (l == last_linear) ? output->data + r0 * out_features : scratch[toggle];
+            for (uint32_t j = 0; j < out_features; j++) {
+                // Each weight row is loaded once for all the rows of the tile
+                const tensor_data_t *w = weight + j * in_features;
+                float sum[EXECUTOR_FUSE_ROWS] = {0.0f};
+                if (rows == EXECUTOR_FUSE_ROWS) {
+                    for (uint32_t k = 0; k < in_features; k++) {
+                        const float wk = w[k].float32;
+                        for (uint32_t i = 0; i < EXECUTOR_FUSE_ROWS; i++) {
+                            sum[i] += src[i * in_features + k].float32 * wk;
+                        }
+                    }
+                } else {
+                    for (uint32_t i = 0; i < rows; i++) {
+                        for (uint32_t k = 0; k < in_features; k++) {
+                            sum[i] += src[i * in_features + k].float32 * w[k].float32;
+                        }
+                    }
+                }
+                for (uint32_t i = 0; i < rows; i++) {
+                    if (bias != (tensor_t *) NULL) sum[i] += bias->data[j].float32;
+                    dst[i * out_features + j].float32 = fused_epilogue(executor, l + 1, epilogue_end, j, (r0 + i) * out_features + j, sum[i]);
+                }
+            }
+            src = dst;
+            in_features = out_features;
+            toggle = 1 - toggle;
+            l = epilogue_end;
+        }
+    }
+
+    if (own_scratch) {
+        tensor_free(scratch_tensors[0]);
+        tensor_free(scratch_tensors[1]);
+    }
+    return output;
+}
+
+// A single batch norm runs with the batch norm folded by the plan when the tensors are plain float32 of its shape.
+// Otherwise batch_norm_1d_out / batch_norm_2d_out (folded at each call) run and check the tensors.
+static uint8_t group_can_use_folded(executor_t *executor, layer_group_t *group, tensor_t *input, tensor_t *output, uint32_t ndim) {
+    const tensor_t *folded = executor->folded[group->first];
+    return folded != (tensor_t *) NULL && input->type == TENSOR_FLOAT32 && output->type == TENSOR_FLOAT32 &&
+           input->ndim == ndim && output->ndim == ndim && output->num_elements == input->num_elements &&
+           input->shape[1] == folded->shape[1] && tensor_is_contiguous(input) && tensor_is_contiguous(output);
+}
+
+// Run a group of layers. output must have the output shape of the group. For point-wise groups output can be input.
+static tensor_t *group_run_out(executor_t *executor, layer_group_t *group, tensor_t *input, tensor_t *output) {
+    layer_t *layer = &executor->layers[group->first];
+    if (group->count == 1) {
+        switch (layer->type) {
+            case LAYER_LINEAR:
+                return linear_out(input, (linear_t *)layer->op, output);
+            case LAYER_BATCH_NORM_1D:
+                if (group_can_use_folded(executor, group, input, output, 2)) return fused_pointwise_out(executor, group, input, output);
+                return batch_norm_1d_out(input, (batch_norm_t *)layer->op, output);
+            case LAYER_BATCH_NORM_2D:
+                if (group_can_use_folded(executor, group, input, output, 4)) return fused_pointwise_out(executor, group, input, output);
+                return batch_norm_2d_out(input, (batch_norm_t *)layer->op, output);
+            case LAYER_RELU:
+                return relu_out(input, output);
+            case LAYER_RESIDUAL_ADD:
+                return elementwise_out(ELEMENTWISE_ADD, input, residual_skip(executor, group->first), output);
+            case LAYER_MAX_POOL_2D:
+                return max_pool_2d_out(input, (pool2d_t *)layer->op, output);
+            case LAYER_AVG_POOL_2D:
+                return avg_pool_2d_out(input, (pool2d_t *)layer->op, output);
+            case LAYER_GLOBAL_AVG_POOL_2D:
+                return global_avg_pool_2d_out(input, output);
+            default:
+                printf("[%s][%s][%d] Error: Unknown layer type\r\n", __FILE__, __func__, __LINE__);
+                return NULL;
+        }
+    }
+
+    if (input->type != TENSOR_FLOAT32) {
+        printf("[%s][%s][%d] Error: fused layers support only float32\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (!tensor_is_contiguous(input) || !tensor_is_contiguous(output)) {
+        printf("[%s][%s][%d] Error: fused layers require non-transposed tensors\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    for (uint32_t l = group->first; l < group->first + group->count; l++) {
+        if (executor->layers[l].type != LAYER_RESIDUAL_ADD) continue;
+        tensor_t *skip = residual_skip(executor, l);
+        uint32_t out_ndim;
+        uint32_t out_shape[EXECUTOR_MAX_NDIM];
+        layer_group_t before = {group->first, l - group->first};
+        if (group_infer_shape(executor, &before, input->ndim, input->shape, &out_ndim, out_shape) != 0) {
+            return NULL;
+        }
+        uint32_t num_elements = 1;
+        for (int i = 0; i < out_ndim; i++) num_elements *= out_shape[i];
+        if (skip->num_elements != num_elements || !tensor_is_contiguous(skip) || skip->type != TENSOR_FLOAT32) {
+            printf("[%s][%s][%d] Error: residual add of layer %d must have a non-transposed float32 input of the same shape\r\n", __FILE__, __func__, __LINE__, l);
+            return NULL;
+        }
+    }
+    if (layer->type == LAYER_LINEAR) {
+        return fused_linear_out(executor, group, input, output);
+    }
+    return fused_pointwise_out(executor, group, input, output);
+}
+
+void executor_prepare(executor_t *executor) {
+    executor_plan(executor);
+}
+
+tensor_t *executor_run_group_out(executor_t *executor, uint32_t group, tensor_t *input, tensor_t *output) {
+    if (!executor->plan_ready || group >= executor->num_groups) {
+        printf("[%s][%s][%d] Error: group must be less than the number of groups of the prepared plan\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    // The kernels of a fused group take the sizes from the tensors, so the shapes are checked here.
+    // A 1D input is a (1 x n) row, like executor_run.
+    tensor_t row;
+    uint32_t row_shape[2], row_transpose[2];
+    if (input->ndim == 1) input = tensor_row_view(input, &row, row_shape, row_transpose);
+    if (input->ndim > EXECUTOR_MAX_NDIM) {
+        printf("[%s][%s][%d] Error: input ndim must be less than or equal to %d\r\n", __FILE__, __func__, __LINE__, EXECUTOR_MAX_NDIM);
+        return NULL;
+    }
+    uint32_t out_ndim;
+    uint32_t out_shape[EXECUTOR_MAX_NDIM];
+    if (group_infer_shape(executor, &executor->groups[group], input->ndim, input->shape, &out_ndim, out_shape) != 0) {
+        return NULL;
+    }
+    uint8_t match = (output->ndim == out_ndim);
+    for (uint32_t i = 0; match && i < out_ndim; i++) {
+        if (output->shape[i] != out_shape[i]) match = 0;
+    }
+    if (!match) {
+        printf("[%s][%s][%d] Error: output must have the output shape of group %d\r\n", __FILE__, __func__, __LINE__, group);
+        return NULL;
+    }
+    if (executor->layers[executor->groups[group].first].type == LAYER_FLATTEN) {
+        if (output->data != input->data) tensor_data_set(output, input->data);
+        return output;
+    }
+    return group_run_out(executor, &executor->groups[group], input, output);
+}
+
+// Point-wise layers and global_avg_pool_2d can write their output over their input. The other layers cannot.
+static uint8_t group_needs_new_buffer(executor_t *executor, layer_group_t *group) {
+    for (uint32_t i = group->first; i < group->first + group->count; i++) {
+        layer_type_t type = executor->layers[i].type;
+        if (type == LAYER_LINEAR || type == LAYER_MAX_POOL_2D || type == LAYER_AVG_POOL_2D) return 1;
+    }
+    return 0;
+}
+
+static uint8_t executor_is_saved(executor_t *executor, tensor_t *tensor) {
+    for (int i = 0; i <= executor->num_layers; i++) {
+        if (executor->saved[i] == tensor) return 1;
+    }
+    return 0;
+}
+
+// Free the kept outputs (except keep and the executor input) and the saved array.
+static void executor_release_saved(executor_t *executor, tensor_t *input, tensor_t *keep) {
+    for (int i = 0; i <= executor->num_layers; i++) {
+        if (executor->saved[i] != (tensor_t *) NULL && executor->saved[i] != input && executor->saved[i] != keep) {
+            tensor_free(executor->saved[i]);
+        }
+    }
+    free(executor->saved);
+    executor->saved = (tensor_t **) NULL;
+}
+
+tensor_t *executor_run(executor_t *executor, tensor_t *input) {
+    // Run the whole chain on the whole input. Each intermediate tensor is freed as soon as the next group is done,
+    // except the outputs kept for a residual add, which are freed at the end.
+    // The input is not freed.
+    executor_plan(executor);
+    executor->activation_bytes = 0;
+
+    tensor_t row;       // (1 x n) view of a 1D input, so the caller's tensor is not changed
+    uint32_t row_shape[2], row_transpose[2];
+    if (input->ndim == 1)   input = tensor_row_view(input, &row, row_shape, row_transpose);
+    executor->saved = (tensor_t **)calloc(executor->num_layers + 1, sizeof(tensor_t *));
+    if (executor->keep_output[0]) executor->saved[0] = input;
+
+    tensor_t *cur = input;
+    for (int g = 0; g < executor->num_groups; g++) {
+        layer_group_t *group = &executor->groups[g];
+        uint32_t last = group->first + group->count - 1;
+        uint32_t out_ndim;
+        uint32_t out_shape[EXECUTOR_MAX_NDIM];
+        tensor_t *next;
+        if (group_infer_shape(executor, group, cur->ndim, cur->shape, &out_ndim, out_shape) != 0) {
+            next = NULL;
+        } else if (executor->layers[group->first].type == LAYER_FLATTEN) {
+            if (cur != input && !executor_is_saved(executor, cur)) {
+                next = tensor_reshape(cur, out_ndim, out_shape);    // Intermediate tensor can be reshaped in-place
+            } else if (!tensor_is_contiguous(cur)) {
+                printf("[%s][%s][%d] Error: flatten requires a non-transposed input\r\n", __FILE__, __func__, __LINE__);
+                next = NULL;
+            } else {
+                next = tensor_create(cur->type, out_ndim, out_shape, cur->data);    // View of the input (or kept) data
+            }
+        } else {
+            next = tensor_create(cur->type, out_ndim, out_shape, (void *)0);
+            if (group_run_out(executor, group, cur, next) == (tensor_t *) NULL) {
+                tensor_free(next);
+                next = NULL;
+            } else {
+                executor->activation_bytes += tensor_get_data_memory(next);
+            }
+        }
+
+        if (next == (tensor_t *) NULL) {
+            printf("[%s][%s][%d] Error: layer %d failed\r\n", __FILE__, __func__, __LINE__, group->first);
+            if (cur != input && !executor_is_saved(executor, cur)) tensor_free(cur);
+            executor_release_saved(executor, input, NULL);
+            return NULL;
+        }
+        if (next != cur && cur != input && !executor_is_saved(executor, cur) && next->data != cur->data) tensor_free(cur);
+        cur = next;
+        if (executor->keep_output[last + 1]) executor->saved[last + 1] = cur;
+    }
+
+    tensor_t *output = cur;
+    if (!cur->is_data_owner || cur == input) {
+        // Nothing is computed (empty chain or flatten only). Return a copy so the caller always owns the output.
+        output = tensor_create(input->type, cur->ndim, cur->shape, (void *)0);
+        tensor_data_set(output, cur->data);
+        if (cur != input && !executor_is_saved(executor, cur)) tensor_free(cur);
+    }
+    executor_release_saved(executor, input, output);
+    return output;
+}
+
+int executor_run_tiled(executor_t *executor, tensor_type_t type, uint32_t ndim, uint32_t *shape, uint32_t tile_size,
+                       executor_reader_t reader, executor_sink_t sink, void *ctx) {
+    // Run the chain tile by tile.
+    // If every layer is point-wise (batch_norm_2d, relu, residual add), the 4D input is tiled along the height (spatial tiling),
+    // otherwise it is tiled along the batch (batch tiling).
+    // Only two tile-sized buffers are allocated. Point-wise layers run in-place, so they do not need the second buffer.
+    // Outputs kept for a residual add are copied into their own tile-sized buffer.
+    if (tile_size == 0) {
+        printf("[%s][%s][%d] Error: tile_size must be greater than 0\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    if (ndim > EXECUTOR_MAX_NDIM) {
+        printf("[%s][%s][%d] Error: input ndim must be less than or equal to %d\r\n", __FILE__, __func__, __LINE__, EXECUTOR_MAX_NDIM);
+        return -1;
+    }
+    executor_plan(executor);
+    executor->activation_bytes = 0;
+
+    uint8_t spatial = (ndim == 4);
+    for (int i = 0; i < executor->num_layers; i++) {
+        layer_type_t layer_type = executor->layers[i].type;
+        if (layer_type != LAYER_BATCH_NORM_2D && layer_type != LAYER_RELU && layer_type != LAYER_RESIDUAL_ADD) spatial = 0;
+    }
+
+    // Shape of a full tile
+    uint32_t tile_shape[EXECUTOR_MAX_NDIM];
+    memcpy(tile_shape, shape, ndim * sizeof(uint32_t));
+    uint32_t num_steps;     // Number of tiles along the tiled axis, for a single batch item when spatial
+    if (spatial) {
+        tile_shape[0] = 1;
+        tile_shape[2] = (tile_size < shape[2]) ? tile_size : shape[2];
+        num_steps = (shape[2] + tile_shape[2] - 1) / tile_shape[2];
+    } else {
+        tile_shape[0] = (tile_size < shape[0]) ? tile_size : shape[0];
+        num_steps = (shape[0] + tile_shape[0] - 1) / tile_shape[0];
+    }
+
+    // Size of the working buffers: the largest activation of a full tile
+    uint32_t stage_elements[executor->num_layers + 1];     // [l + 1]: output of layer l, [0]: input
+    uint32_t max_elements = 1;
+    uint32_t cur_ndim = ndim;
+    uint32_t cur_shape[EXECUTOR_MAX_NDIM];
+    memcpy(cur_shape, tile_shape, ndim * sizeof(uint32_t));
+    for (int i = 0; i < ndim; i++) max_elements *= cur_shape[i];
+    stage_elements[0] = max_elements;
+    for (int i = 0; i < executor->num_layers; i++) {
+        uint32_t next_ndim;
+        uint32_t next_shape[EXECUTOR_MAX_NDIM];
+        if (layer_infer_shape(&executor->layers[i], cur_ndim, cur_shape, &next_ndim, next_shape) != 0) {
+            printf("[%s][%s][%d] Error: shape mismatch at layer %d\r\n", __FILE__, __func__, __LINE__, i);
+            return -1;
+        }
+        uint32_t num_elements = 1;
+        for (int j = 0; j < next_ndim; j++) num_elements *= next_shape[j];
+        if (num_elements > max_elements) max_elements = num_elements;
+        stage_elements[i + 1] = num_elements;
+        cur_ndim = next_ndim;
+        memcpy(cur_shape, next_shape, next_ndim * sizeof(uint32_t));
+    }
+
+    tensor_t *buffers[2];
+    buffers[0] = tensor_create(type, 1, (uint32_t[]){max_elements}, (void *)0);
+    buffers[1] = spatial ? NULL : tensor_create(type, 1, (uint32_t[]){max_elements}, (void *)0);
+    tensor_t *saved_buffers[executor->num_layers + 1];
+    for (int i = 0; i <= executor->num_layers; i++) {
+        saved_buffers[i] = executor->keep_output[i] ? tensor_create(type, 1, (uint32_t[]){stage_elements[i]}, (void *)0) : NULL;
+    }
+    executor->saved = (tensor_t **)calloc(executor->num_layers + 1, sizeof(tensor_t *));
+
+    int status = 0;
+    uint32_t num_batches = spatial ? shape[0] : 1;
+    for (uint32_t n = 0; n < num_batches && status == 0; n++) {
+        for (uint32_t step = 0; step < num_steps && status == 0; step++) {
+            executor_tile_t region;
+            memcpy(cur_shape, tile_shape, ndim * sizeof(uint32_t));
+            if (spatial) {
+                region.batch_offset = n;
+                region.row_offset = step * tile_shape[2];
+                if (region.row_offset + cur_shape[2] > shape[2]) cur_shape[2] = shape[2] - region.row_offset;
+            } else {
+                region.batch_offset = step * tile_shape[0];
+                region.row_offset = 0;
+                if (region.batch_offset + cur_shape[0] > shape[0]) cur_shape[0] = shape[0] - region.batch_offset;
+            }
+            cur_ndim = ndim;
+
+            int cur_buffer = 0;
+            tensor_t *cur = tensor_create(type, cur_ndim, cur_shape, buffers[cur_buffer]->data);
+            if (reader(ctx, cur, &region) != 0) {
+                printf("[%s][%s][%d] Error: reader failed\r\n", __FILE__, __func__, __LINE__);
+                tensor_free(cur);
+                status = -1;
+                break;
+            }
+            if (executor->keep_output[0]) {
+                executor->saved[0] = tensor_create(type, cur_ndim, cur_shape, saved_buffers[0]->data);
+                memcpy(executor->saved[0]->data, cur->data, cur->num_elements * sizeof(tensor_data_t));
+            }
+
+            for (int g = 0; g < executor->num_groups; g++) {
+                layer_group_t *group = &executor->groups[g];
+                uint32_t last = group->first + group->count - 1;
+                uint32_t next_ndim;
+                uint32_t next_shape[EXECUTOR_MAX_NDIM];
+                group_infer_shape(executor, group, cur_ndim, cur_shape, &next_ndim, next_shape);
+
+                int next_buffer = group_needs_new_buffer(executor, group) ? 1 - cur_buffer : cur_buffer;
+                tensor_t *next = tensor_create(type, next_ndim, next_shape, buffers[next_buffer]->data);
+                tensor_t *result = next;
+                if (executor->layers[group->first].type != LAYER_FLATTEN) {     // Flatten only changes the shape
+                    result = group_run_out(executor, group, cur, next);
+                    executor->activation_bytes += tensor_get_data_memory(next);
+                }
+                tensor_free(cur);
+                if (result == (tensor_t *) NULL) {
+                    printf("[%s][%s][%d] Error: layer %d failed\r\n", __FILE__, __func__, __LINE__, group->first);
+                    tensor_free(next);
+                    cur = NULL;
+                    status = -1;
+                    break;
+                }
+                cur = next;
+                cur_buffer = next_buffer;
+                cur_ndim = next_ndim;
+                memcpy(cur_shape, next_shape, next_ndim * sizeof(uint32_t));
+                if (executor->keep_output[last + 1]) {
+                    executor->saved[last + 1] = tensor_create(type, cur_ndim, cur_shape, saved_buffers[last + 1]->data);
+                    memcpy(executor->saved[last + 1]->data, cur->data, cur->num_elements * sizeof(tensor_data_t));
+                }
+            }
+
+            if (cur != (tensor_t *) NULL) {
+                if (sink(ctx, cur, &region) != 0) {
+                    printf("[%s][%s][%d] Error: sink failed\r\n", __FILE__, __func__, __LINE__);
+                    status = -1;
+                }
+                tensor_free(cur);
+            }
+            for (int i = 0; i <= executor->num_layers; i++) {     // Views of the saved buffers
+                if (executor->saved[i] != (tensor_t *) NULL) tensor_free(executor->saved[i]);
+                executor->saved[i] = (tensor_t *) NULL;
+            }
+        }
+    }
+
+    free(executor->saved);
+    executor->saved = (tensor_t **) NULL;
+    for (int i = 0; i <= executor->num_layers; i++) {
+        if (saved_buffers[i] != (tensor_t *) NULL) tensor_free(saved_buffers[i]);
+    }
+    tensor_free(buffers[0]);
+    if (buffers[1] != (tensor_t *) NULL) tensor_free(buffers[1]);
+    return status;
+}
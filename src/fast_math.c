@@ -0,0 +1,94 @@
+#include "fast_math.h"
+#include <stdint.h>
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+#define FAST_MATH_BLOCK 64      // Elements per block. A loop with a constant trip count is vectorized without an epilogue.
+
+// tanh(i / 32) for i = 0 .. 256
+const float fast_math_tanh_table[FAST_MATH_TANH_TABLE_SIZE + 1] = {
+    0.0f, 0.0312398314f, 0.0624187467f, 0.093476304f, 0.124353002f, 0.15499073f, 0.1853332f, 0.21532634f,
+    0.244918662f, 0.274061589f, 0.302709729f, 0.330821117f, 0.358357398f, 0.385283966f, 0.411570056f, 0.437188785f,
+    0.462117157f, 0.486336017f, 0.509829974f, 0.532587286f, 0.554599722f, 0.575862391f, 0.596373555f, 0.616134427f,
+    0.635148952f, 0.653423588f, 0.670967074f, 0.687790205f, 0.703905604f, 0.719327501f, 0.73407152f, 0.74815447f,
+    0.761594156f, 0.774409187f, 0.786618812f, 0.798242755f, 0.80930107f, 0.819814012f, 0.82980191f, 0.839285062f,
+    0.84828364f, 0.856817601f, 0.864906618f, 0.872570011f, 0.8798267f, 0.886695149f, 0.89319334f, 0.899338735f,
+    0.905148254f, 0.910638259f, 0.915824544f, 0.920722322f, 0.925346225f, 0.929710307f, 0.933828043f, 0.937712339f,
+    0.941375538f, 0.944829436f, 0.948085286f, 0.95115382f, 0.95404526f, 0.956769334f, 0.959335293f, 0.961751926f,
+    0.96402758f, 0.966170173f, 0.968187217f, 0.970085827f, 0.971872746f, 0.973554356f, 0.975136698f, 0.976625484f,
+    0.978026115f, 0.979343695f, 0.980583047f, 0.981748725f, 0.982845029f, 0.983876017f, 0.984845517f, 0.985757143f,
+    0.986614298f, 0.987420196f, 0.988177862f, 0.988890151f, 0.989559749f, 0.990189189f, 0.990780856f, 0.991336996f,
+    0.991859725f, 0.992351033f, 0.992812795f, 0.993246775f, 0.993654634f, 0.994037935f, 0.994398146f, 0.994736652f,
+    0.995054754f, 0.995353675f, 0.995634567f, 0.995898513f, 0.996146531f, 0.996379578f, 0.996598555f, 0.996804309f,
+    0.996997635f, 0.997179283f, 0.997349955f, 0.997510313f, 0.997660979f, 0.997802538f, 0.997935538f, 0.998060496f,
+    0.998177898f, 0.998288199f, 0.998391828f, 0.998489189f, 0.998580659f, 0.998666595f, 0.998747332f, 0.998823182f,
+    0.998894443f, 0.99896139f, 0.999024286f, 0.999083374f, 0.999138886f, 0.999191037f, 0.999240031f, 0.999286059f,
+    0.9993293f, 0.999369923f, 0.999408086f, 0.999443938f, 0.999477619f, 0.999509261f, 0.999538987f, 0.999566912f,
+    0.999593146f, 0.999617791f, 0.999640944f, 0.999662694f, 0.999683128f, 0.999702323f, 0.999720356f, 0.999737296f,
+    0.999753211f, 0.999768161f, 0.999782206f, 0.9997954f, 0.999807795f, 0.999819439f, 0.999830378f, 0.999840654f,
+    0.999850308f, 0.999859376f, 0.999867896f, 0.999875899f, 0.999883417f, 0.99989048f, 0.999897116f, 0.999903349f,
+    0.999909204f, 0.999914705f, 0.999919873f, 0.999924727f, 0.999929287f, 0.999933572f, 0.999937596f, 0.999941377f,
+    0.999944929f, 0.999948265f, 0.9999514f, 0.999954344f, 0.99995711f, 0.999959709f, 0.99996215f, 0.999964443f,
+    0.999966597f, 0.999968621f, 0.999970522f, 0.999972308f, 0.999973986f, 0.999975562f, 0.999977042f, 0.999978433f,
+    0.99997974f, 0.999980967f, 0.999982121f, 0.999983204f, 0.999984221f, 0.999985177f, 0.999986075f, 0.999986919f,
+    0.999987712f, 0.999988456f, 0.999989156f, 0.999989813f, 0.99999043f, 0.99999101f, 0.999991554f, 0.999992066f,
+    0.999992547f, 0.999992998f, 0.999993423f, 0.999993821f, 0.999994195f, 0.999994547f, 0.999994877f, 0.999995188f,
+    0.999995479f, 0.999995753f, 0.999996011f, 0.999996252f, 0.999996479f, 0.999996693f, 0.999996893f, 0.999997081f,
+    0.999997258f, 0.999997424f, 0.99999758f, 0.999997727f, 0.999997865f, 0.999997994f, 0.999998116f, 0.99999823f,
+    0.999998337f, 0.999998438f, 0.999998532f, 0.999998621f, 0.999998705f, 0.999998783f, 0.999998857f, 0.999998926f,
+    0.999998991f, 0.999999052f, 0.99999911f, 0.999999164f, 0.999999214f, 0.999999262f, 0.999999307f, 0.999999349f,
+    0.999999388f, 0.999999425f, 0.99999946f, 0.999999493f, 0.999999524f, 0.999999552f, 0.99999958f, 0.999999605f,
+    0.999999629f, 0.999999651f, 0.999999673f, 0.999999692f, 0.999999711f, 0.999999729f, 0.999999745f, 0.99999976f,
+    0.999999775f
+};
+
+// output = f(input), block by block. The block is copied into a local buffer: the buffer does not alias input or
+// output, so the loop over it is vectorized without a run-time overlap check (input and output may be the same).
+// The block is addressed by pointers: with uint32_t i + j, gcc can not prove the accesses are contiguous (wrap around).
+#define FAST_MATH_APPLY(f, input, output, n) \
+    do { \
+        float buf[FAST_MATH_BLOCK]; \
+        uint32_t i = 0; \
+        for (; i + FAST_MATH_BLOCK <= (n); i += FAST_MATH_BLOCK) { \
+            const float *src = (input) + i; \
+            float *dst = (output) + i; \
+            for (uint32_t j = 0; j < FAST_MATH_BLOCK; j++) buf[j] = src[j]; \
+            for (uint32_t j = 0; j < FAST_MATH_BLOCK; j++) buf[j] = f(buf[j]); \
+            for (uint32_t j = 0; j < FAST_MATH_BLOCK; j++) dst[j] = buf[j]; \
+        } \
+        for (; i < (n); i++) (output)[i] = f((input)[i]); \
+    } while (0)
+
+void fast_math_exp(const float *input, float *output, uint32_t n, fast_math_tier_t tier) {
+    if (tier == FAST_MATH_APPROX) {
+        FAST_MATH_APPLY(fast_expf_approx, input, output, n);
+    } else {
+        FAST_MATH_APPLY(fast_expf, input, output, n);
+    }
+}
+
+void fast_math_tanh(const float *input, float *output, uint32_t n, fast_math_tier_t tier) {
+    if (tier == FAST_MATH_APPROX) {
+        FAST_MATH_APPLY(fast_tanhf_approx, input, output, n);
+    } else {
+        FAST_MATH_APPLY(fast_tanhf, input, output, n);
+    }
+}
+
+void fast_math_sigmoid(const float *input, float *output, uint32_t n, fast_math_tier_t tier) {
+    if (tier == FAST_MATH_APPROX) {
+        FAST_MATH_APPLY(fast_sigmoidf_approx, input, output, n);
+    } else {
+        FAST_MATH_APPLY(fast_sigmoidf, input, output, n);
+    }
+}
+
+void fast_math_rsqrt(const float *input, float *output, uint32_t n, fast_math_tier_t tier) {
+    if (tier == FAST_MATH_APPROX) {
+        FAST_MATH_APPLY(fast_rsqrtf_approx, input, output, n);
+    } else {
+        FAST_MATH_APPLY(fast_rsqrtf, input, output, n);
+    }
+}
@@ -0,0 +1,223 @@
+#include "model.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tensor.h"
+#include "executor.h"
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+#if defined(__GNUC__)
+#define MODEL_REFCOUNT_ADD(counter, value) __atomic_add_fetch(&(counter), (value), __ATOMIC_ACQ_REL)
+#define MODEL_REFCOUNT_SUB(counter, value) __atomic_sub_fetch(&(counter), (value), __ATOMIC_ACQ_REL)
+#define MODEL_REFCOUNT_LOAD(counter) __atomic_load_n(&(counter), __ATOMIC_ACQUIRE)
+#else
+#define MODEL_REFCOUNT_ADD(counter, value) ((counter) += (value))
+#define MODEL_REFCOUNT_SUB(counter, value) ((counter) -= (value))
+#define MODEL_REFCOUNT_LOAD(counter) (counter)
+#endif
+
+// Location of the output of a group
+#define SESSION_INPUT -1    // The input of the session (only a flatten view of it)
+#define SESSION_KEPT 2      // Buffer of its own, kept for a residual add
+
+static uint64_t model_tensor_bytes(tensor_t *tensor) {
+    return (tensor != (tensor_t *) NULL) ? tensor_get_data_memory(tensor) : 0;
+}
+
+model_t *model_create(executor_t *executor, uint8_t own) {
+    if (executor == (executor_t *) NULL) {
+        printf("[%s][%s][%d] Error: executor is NULL\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    executor_prepare(executor);
+    model_t *model = (model_t *)malloc(sizeof(model_t));
+    model->executor = executor;
+    model->own = own;
+    model->refcount = 1;
+    model->weight_bytes = 0;
+    for (uint32_t l = 0; l < executor->num_layers; l++) {
+        layer_t *layer = &executor->layers[l];
+        if (layer->type == LAYER_LINEAR) {
+            linear_t *linear_weight = (linear_t *)layer->op;
+            model->weight_bytes += model_tensor_bytes(linear_weight->weight) + model_tensor_bytes(linear_weight->bias);
+        } else if (layer->type == LAYER_BATCH_NORM_1D || layer->type == LAYER_BATCH_NORM_2D) {
+            batch_norm_t *batch_norm_weight = (batch_norm_t *)layer->op;
+            model->weight_bytes += model_tensor_bytes(batch_norm_weight->mean) + model_tensor_bytes(batch_norm_weight->var) +
+                                   model_tensor_bytes(batch_norm_weight->epsilon) + model_tensor_bytes(batch_norm_weight->gamma) +
+                                   model_tensor_bytes(batch_norm_weight->beta);
+        }
+        model->weight_bytes += model_tensor_bytes(executor->folded[l]);
+    }
+    return model;
+}
+
+model_t *model_retain(model_t *model) {
+    MODEL_REFCOUNT_ADD(model->refcount, 1);
+    return model;
+}
+
+void model_release(model_t *model) {
+    if (model == (model_t *) NULL) return;
+    if (MODEL_REFCOUNT_SUB(model->refcount, 1) != 0) return;
+    if (model->own) executor_free(model->executor, 1);
+    free(model);
+}
+
+uint32_t model_get_refcount(model_t *model) {
+    return MODEL_REFCOUNT_LOAD(model->refcount);
+}
+
+session_t *session_create(model_t *model, uint32_t ndim, uint32_t *shape) {
+    // Plan the activations for the input shape. The output of a group goes to:
+    // - its own buffer if it is kept for a residual add,
+    // - the buffer of its input if it is a flatten (a view with the new shape),
+    // - otherwise the ping-pong buffer that does not hold its input.
+    // Each ping-pong buffer is as large as the largest output written to it.
+    if (model == (model_t *) NULL || ndim == 0 || ndim > EXECUTOR_MAX_NDIM) {
+        printf("[%s][%s][%d] Error: model must not be NULL and ndim must be 1 to %d\r\n", __FILE__, __func__, __LINE__, EXECUTOR_MAX_NDIM);
+        return NULL;
+    }
+    executor_t *executor = model->executor;
+    const uint32_t num_groups = executor->num_groups;
+    session_t *session = (session_t *)calloc(1, sizeof(session_t));
+    session->model = model_retain(model);
+    session->executor = *executor;
+    session->executor.saved = (tensor_t **)calloc(executor->num_layers + 1, sizeof(tensor_t *));
+    session->kept = (tensor_t **)calloc(executor->num_layers + 1, sizeof(tensor_t *));
+    session->outputs = (tensor_t **)calloc(num_groups + 1, sizeof(tensor_t *));
+    session->input_ndim = ndim;
+    memcpy(session->input_shape, shape, ndim * sizeof(uint32_t));
+
+    uint32_t out_ndim[num_groups + 1];
+    uint32_t out_shape[num_groups + 1][EXECUTOR_MAX_NDIM];
+    int32_t location[num_groups + 1];
+    uint8_t view[num_groups + 1];       // 1 - flatten view of the previous output
+    uint32_t buffer_elements[2] = {0, 0};
+    uint32_t cur_ndim = ndim;
+    uint32_t cur_shape[EXECUTOR_MAX_NDIM];
+    memcpy(cur_shape, shape, ndim * sizeof(uint32_t));
+    if (ndim == 1) {
+        // (1 x n) row view of the input (session_run_groups)
+        cur_ndim = 2;
+        cur_shape[0] = 1;
+        cur_shape[1] = shape[0];
+    }
+    int32_t cur_location = SESSION_INPUT;
+    for (uint32_t g = 0; g < num_groups; g++) {
+        layer_group_t *group = &executor->groups[g];
+        const uint32_t last = group->first + group->count - 1;
+        for (uint32_t l = group->first; l <= last; l++) {
+            uint32_t next_ndim;
+            uint32_t next_shape[EXECUTOR_MAX_NDIM];
+            if (executor_infer_layer_shape(executor, l, cur_ndim, cur_shape, &next_ndim, next_shape) != 0) {
+                printf("[%s][%s][%d] Error: shape mismatch at layer %d\r\n", __FILE__, __func__, __LINE__, l);
+                session_free(session);
+                return NULL;
+            }
+            cur_ndim = next_ndim;
+            memcpy(cur_shape, next_shape, next_ndim * sizeof(uint32_t));
+        }
+        uint32_t num_elements = 1;
+        for (uint32_t i = 0; i < cur_ndim; i++) num_elements *= cur_shape[i];
+        view[g] = 0;
+        if (executor->keep_output[last + 1]) {
+            location[g] = SESSION_KEPT;
+            session->kept[last + 1] = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){num_elements}, (void *)0);
+        } else if (executor->layers[group->first].type == LAYER_FLATTEN && cur_location != SESSION_INPUT) {
+            location[g] = cur_location;
+            view[g] = 1;
+        } else {
+            location[g] = (cur_location == 0) ? 1 : 0;
+            if (num_elements > buffer_elements[location[g]]) buffer_elements[location[g]] = num_elements;
+        }
+        out_ndim[g] = cur_ndim;
+        memcpy(out_shape[g], cur_shape, cur_ndim * sizeof(uint32_t));
+        cur_location = location[g];
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (buffer_elements[i] > 0) {
+            session->buffers[i] = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){buffer_elements[i]}, (void *)0);
+            session->activation_bytes += tensor_get_data_memory(session->buffers[i]);
+        }
+        // Scratch of the fused linear groups, so a run does not allocate it
+        if (executor->scratch_elements > 0) {
+            session->executor.scratch[i] = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){executor->scratch_elements}, (void *)0);
+            session->activation_bytes += tensor_get_data_memory(session->executor.scratch[i]);
+        }
+    }
+    for (uint32_t g = 0; g < num_groups; g++) {
+        layer_group_t *group = &executor->groups[g];
+        const uint32_t last = group->first + group->count - 1;
+        tensor_data_t *data;
+        if (view[g]) {
+            data = session->outputs[g - 1]->data;
+        } else if (location[g] == SESSION_KEPT) {
+            data = session->kept[last + 1]->data;
+            session->activation_bytes += tensor_get_data_memory(session->kept[last + 1]);
+        } else {
+            data = session->buffers[location[g]]->data;
+        }
+        session->outputs[g] = tensor_create(TENSOR_FLOAT32, out_ndim[g], out_shape[g], data);
+        if (executor->keep_output[last + 1]) session->executor.saved[last + 1] = session->outputs[g];
+    }
+    return session;
+}
+
+void session_free(session_t *session) {
+    if (session == (session_t *) NULL) return;
+    for (uint32_t g = 0; g < session->executor.num_groups; g++) {
+        if (session->outputs[g] != (tensor_t *) NULL) tensor_free(session->outputs[g]);
+    }
+    for (uint32_t i = 0; i <= session->executor.num_layers; i++) {
+        if (session->kept[i] != (tensor_t *) NULL) tensor_free(session->kept[i]);
+    }
+    for (int i = 0; i < 2; i++) {
+        if (session->buffers[i] != (tensor_t *) NULL) tensor_free(session->buffers[i]);
+        if (session->executor.scratch[i] != (tensor_t *) NULL) tensor_free(session->executor.scratch[i]);
+    }
+    free(session->outputs);
+    free(session->kept);
+    free(session->executor.saved);
+    model_release(session->model);
+    free(session);
+}
+
+tensor_t *session_run(session_t *session, tensor_t *input) {
+    return session_run_groups(session, input, 0, session->executor.num_groups);
+}
+
+tensor_t *session_run_groups(session_t *session, tensor_t *input, uint32_t first, uint32_t end) {
+    executor_t *executor = &session->executor;
+    if (first >= end || end > executor->num_groups) {
+        printf("[%s][%s][%d] Error: groups [%d, %d) must be a non-empty range of the %d groups\r\n", __FILE__, __func__, __LINE__, first, end, executor->num_groups);
+        return NULL;
+    }
+    if (first == 0) {
+        uint8_t match = (input->ndim == session->input_ndim && input->type == TENSOR_FLOAT32);
+        for (uint32_t i = 0; match && i < input->ndim; i++) {
+            if (input->shape[i] != session->input_shape[i]) match = 0;
+        }
+        if (!match) {
+            printf("[%s][%s][%d] Error: input must be a float32 tensor of the session shape\r\n", __FILE__, __func__, __LINE__);
+            return NULL;
+        }
+        // Kept by the session, so a later run of the next groups (pipeline) can still read it as saved[0]
+        if (input->ndim == 1) input = tensor_row_view(input, &session->input_row, session->input_row_shape, session->input_row_transpose);
+        if (executor->keep_output[0]) executor->saved[0] = input;
+    }
+
+    tensor_t *cur = (first == 0) ? input : session->outputs[first - 1];
+    for (uint32_t g = first; g < end; g++) {
+        if (executor_run_group_out(executor, g, cur, session->outputs[g]) == (tensor_t *) NULL) {
+            printf("[%s][%s][%d] Error: group %d failed\r\n", __FILE__, __func__, __LINE__, g);
+            return NULL;
+        }
+        cur = session->outputs[g];
+    }
+    return cur;
+}
@@ -0,0 +1,60 @@
+#include "op_activation.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "tensor.h"
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+tensor_t *relu(tensor_t *input) {
+    // output = max(input, 0)
+    tensor_t *output = tensor_create(input->type, input->ndim, input->shape, (void *)0);
+
+    if (relu_out(input, output) == NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *relu_out(tensor_t *input, tensor_t *output) {
+    if (output->num_elements != input->num_elements || output->type != input->type) {
+        printf("[%s][%s][%d] Error: output tensor must have the same shape and type as input tensor\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (!tensor_is_contiguous(input) || !tensor_is_contiguous(output)) {
+        printf("[%s][%s][%d] Error: input and output must not be transposed\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+
+    switch (input->type) {
+        case TENSOR_INT16:      // Fixed-point (op_fixed.h): the output keeps the Q format
+            for (int i = 0; i < input->num_elements; i++) {
+                output->data[i].int16 = (input->data[i].int16 > 0) ? input->data[i].int16 : 0;
+            }
+            output->frac_bits = input->frac_bits;
+            break;
+        case TENSOR_INT32:
+            for (int i = 0; i < input->num_elements; i++) {
+                output->data[i].int32 = (input->data[i].int32 > 0) ? input->data[i].int32 : 0;
+            }
+            output->frac_bits = input->frac_bits;
+            break;
+        case TENSOR_INT64:
+            for (int i = 0; i < input->num_elements; i++) {
+                output->data[i].int64 = (input->data[i].int64 > 0) ? input->data[i].int64 : 0;
+            }
+            break;
+        case TENSOR_FLOAT32:
+            for (int i = 0; i < input->num_elements; i++) {
+                output->data[i].float32 = (input->data[i].float32 > 0.0f) ? input->data[i].float32 : 0.0f;
+            }
+            break;
+        default:
+            printf("[%s][%s][%d] Error: Un-supported tensor type. Supported tensor types are int16, int32, int64 or float32\r\n", __FILE__, __func__, __LINE__);
+            return NULL;
+    }
+    return output;
+}
@@ -0,0 +1,257 @@
+#include "op_elementwise.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "tensor.h"
+#include "parallel.h"
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+// Strided view of the three operands over the output shape.
+// Broadcast axes have stride 0. Axes that are contiguous in all three operands are merged,
+// so the innermost loop is as long as possible.
+typedef struct {
+    elementwise_op_t op;
+    tensor_type_t type;
+    uint32_t ndim;
+    uint32_t shape[ELEMENTWISE_MAX_NDIM];
+    uint32_t stride_a[ELEMENTWISE_MAX_NDIM];
+    uint32_t stride_b[ELEMENTWISE_MAX_NDIM];
+    uint32_t stride_out[ELEMENTWISE_MAX_NDIM];
+    const tensor_data_t *a;
+    const tensor_data_t *b;
+    tensor_data_t *out;
+} elementwise_plan_t;
+
+static int elementwise_broadcast_shape(tensor_t *a, tensor_t *b, uint32_t *ndim, uint32_t *shape) {
+    *ndim = (a->ndim > b->ndim) ? a->ndim : b->ndim;
+    if (*ndim > ELEMENTWISE_MAX_NDIM) {
+        printf("[%s][%s][%d] Error: ndim must be less than or equal to %d\r\n", __FILE__, __func__, __LINE__, ELEMENTWISE_MAX_NDIM);
+        return -1;
+    }
+    for (int i = 0; i < *ndim; i++) {
+        int ia = i - (int)(*ndim - a->ndim);
+        int ib = i - (int)(*ndim - b->ndim);
+        uint32_t sa = (ia >= 0) ? a->shape[ia] : 1;
+        uint32_t sb = (ib >= 0) ? b->shape[ib] : 1;
+        if (sa != sb && sa != 1 && sb != 1) {
+            printf("[%s][%s][%d] Error: shapes can not be broadcast at axis %d (%d vs %d)\r\n", __FILE__, __func__, __LINE__, i, sa, sb);
+            return -1;
+        }
+        shape[i] = (sa > sb) ? sa : sb;
+    }
+    return 0;
+}
+
+static void elementwise_operand_strides(tensor_t *tensor, uint32_t ndim, uint32_t *strides) {
+    uint32_t own_strides[ELEMENTWISE_MAX_NDIM];
+    tensor_get_strides(tensor, own_strides);
+    for (int i = 0; i < ndim; i++) {
+        int it = i - (int)(ndim - tensor->ndim);
+        strides[i] = (it >= 0 && tensor->shape[it] != 1) ? own_strides[it] : 0;
+    }
+}
+
+static void elementwise_make_plan(elementwise_plan_t *plan, elementwise_op_t op, tensor_t *a, tensor_t *b, tensor_t *output) {
+    uint32_t ndim = output->ndim;
+    uint32_t stride_a[ELEMENTWISE_MAX_NDIM], stride_b[ELEMENTWISE_MAX_NDIM], stride_out[ELEMENTWISE_MAX_NDIM];
+    elementwise_operand_strides(a, ndim, stride_a);
+    elementwise_operand_strides(b, ndim, stride_b);
+    tensor_get_strides(output, stride_out);
+
+    plan->op = op;
+    plan->type = output->type;
+    plan->a = a->data;
+    plan->b = b->data;
+    plan->out = output->data;
+
+    // Merge axes from the innermost one. Size-1 axes are dropped.
+    plan->ndim = 0;
+    for (int i = ndim - 1; i >= 0; i--) {
+        if (output->shape[i] == 1) continue;
+        if (plan->ndim > 0) {
+            uint32_t last = plan->ndim - 1;
+            if (stride_a[i] == plan->stride_a[last] * plan->shape[last] &&
+                stride_b[i] == plan->stride_b[last] * plan->shape[last] &&
+                stride_out[i] == plan->stride_out[last] * plan->shape[last]) {
+                plan->shape[last] *= output->shape[i];
+                continue;
+            }
+        }
+        plan->shape[plan->ndim] = output->shape[i];
+        plan->stride_a[plan->ndim] = stride_a[i];
+        plan->stride_b[plan->ndim] = stride_b[i];
+        plan->stride_out[plan->ndim] = stride_out[i];
+        plan->ndim++;
+    }
+    if (plan->ndim == 0) {  // Single element
+        plan->shape[0] = 1;
+        plan->stride_a[0] = plan->stride_b[0] = plan->stride_out[0] = 1;
+        plan->ndim = 1;
+    }
+    // The axes are stored from the innermost one (axis 0 is the innermost).
+}
+
+// Inner loop. The common stride patterns have their own loops so the compiler can vectorize them.
+#define ELEMENTWISE_INNER(TYPE, FIELD, EXPR)                                                \
+    if (sa == 1 && sb == 1 && so == 1) {                                                    \
+        for (uint32_t k = 0; k < n; k++) {                                                  \
+            out[k].FIELD = EXPR(a[k].FIELD, b[k].FIELD);                                    \
+        }                                                                                   \
+    } else if (sa == 1 && sb == 0 && so == 1) {                                             \
+        const TYPE vb = b[0].FIELD;                                                         \
+        for (uint32_t k = 0; k < n; k++) {                                                  \
+            out[k].FIELD = EXPR(a[k].FIELD, vb);                                            \
+        }                                                                                   \
+    } else if (sa == 0 && sb == 1 && so == 1) {                                             \
+        const TYPE va = a[0].FIELD;                                                         \
+        for (uint32_t k = 0; k < n; k++) {                                                  \
+            out[k].FIELD = EXPR(va, b[k].FIELD);                                            \
+        }                                                                                   \
+    } else {                                                                                \
+        for (uint32_t k = 0; k < n; k++) {                                                  \
+            out[k * so].FIELD = EXPR(a[k * sa].FIELD, b[k * sb].FIELD);                     \
+        }                                                                                   \
+    }
+
+#define ELEMENTWISE_EXPR_ADD(x, y) ((x) + (y))
+#define ELEMENTWISE_EXPR_SUB(x, y) ((x) - (y))
+#define ELEMENTWISE_EXPR_MUL(x, y) ((x) * (y))
+#define ELEMENTWISE_EXPR_MAX(x, y) (((x) > (y)) ? (x) : (y))
+#define ELEMENTWISE_EXPR_MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+static void elementwise_inner(elementwise_op_t op, tensor_type_t type, uint32_t n,
+                              const tensor_data_t *a, uint32_t sa, const tensor_data_t *b, uint32_t sb, tensor_data_t *out, uint32_t so) {
+    if (type == TENSOR_FLOAT32) {
+        switch (op) {
+            case ELEMENTWISE_ADD: ELEMENTWISE_INNER(float, float32, ELEMENTWISE_EXPR_ADD) break;
+            case ELEMENTWISE_SUB: ELEMENTWISE_INNER(float, float32, ELEMENTWISE_EXPR_SUB) break;
+            case ELEMENTWISE_MUL: ELEMENTWISE_INNER(float, float32, ELEMENTWISE_EXPR_MUL) break;
+            case ELEMENTWISE_MAX: ELEMENTWISE_INNER(float, float32, ELEMENTWISE_EXPR_MAX) break;
+            case ELEMENTWISE_MIN: ELEMENTWISE_INNER(float, float32, ELEMENTWISE_EXPR_MIN) break;
+        }
+    } else {
+        switch (op) {
+            case ELEMENTWISE_ADD: ELEMENTWISE_INNER(int64_t, int64, ELEMENTWISE_EXPR_ADD) break;
+            case ELEMENTWISE_SUB: ELEMENTWISE_INNER(int64_t, int64, ELEMENTWISE_EXPR_SUB) break;
+            case ELEMENTWISE_MUL: ELEMENTWISE_INNER(int64_t, int64, ELEMENTWISE_EXPR_MUL) break;
+            case ELEMENTWISE_MAX: ELEMENTWISE_INNER(int64_t, int64, ELEMENTWISE_EXPR_MAX) break;
+            case ELEMENTWISE_MIN: ELEMENTWISE_INNER(int64_t, int64, ELEMENTWISE_EXPR_MIN) break;
+        }
+    }
+}
+
+// Run the flat output range [begin, end).
+static void elementwise_range(void *ctx, uint32_t begin, uint32_t end) {
+    elementwise_plan_t *plan = (elementwise_plan_t *)ctx;
+    uint32_t index[ELEMENTWISE_MAX_NDIM];
+    uint32_t offset_a = 0, offset_b = 0, offset_out = 0;
+    uint32_t rest = begin;
+    for (int i = 0; i < plan->ndim; i++) {
+        index[i] = rest % plan->shape[i];
+        rest /= plan->shape[i];
+        offset_a += index[i] * plan->stride_a[i];
+        offset_b += index[i] * plan->stride_b[i];
+        offset_out += index[i] * plan->stride_out[i];
+    }
+
+    uint32_t position = begin;
+    while (position < end) {
+        uint32_t n = plan->shape[0] - index[0];
+        if (n > end - position) n = end - position;
+        elementwise_inner(plan->op, plan->type, n, plan->a + offset_a, plan->stride_a[0], plan->b + offset_b, plan->stride_b[0], plan->out + offset_out, plan->stride_out[0]);
+        position += n;
+
+        // Advance the index by n (carry into the outer axes)
+        index[0] += n;
+        offset_a += n * plan->stride_a[0];
+        offset_b += n * plan->stride_b[0];
+        offset_out += n * plan->stride_out[0];
+        for (int i = 0; i < plan->ndim - 1 && index[i] == plan->shape[i]; i++) {
+            index[i] = 0;
+            offset_a -= plan->shape[i] * plan->stride_a[i];
+            offset_b -= plan->shape[i] * plan->stride_b[i];
+            offset_out -= plan->shape[i] * plan->stride_out[i];
+            index[i + 1]++;
+            offset_a += plan->stride_a[i + 1];
+            offset_b += plan->stride_b[i + 1];
+            offset_out += plan->stride_out[i + 1];
+        }
+    }
+}
+
+tensor_t *elementwise(elementwise_op_t op, tensor_t *a, tensor_t *b) {
+    uint32_t ndim;
+    uint32_t shape[ELEMENTWISE_MAX_NDIM];
+    if (elementwise_broadcast_shape(a, b, &ndim, shape) != 0) {
+        return NULL;
+    }
+    tensor_t *output = tensor_create(a->type, ndim, shape, (void *)0);
+
+    if (elementwise_out(op, a, b, output) == NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *elementwise_out(elementwise_op_t op, tensor_t *a, tensor_t *b, tensor_t *output) {
+    uint32_t ndim;
+    uint32_t shape[ELEMENTWISE_MAX_NDIM];
+    if (elementwise_broadcast_shape(a, b, &ndim, shape) != 0) {
+        return NULL;
+    }
+    if (output->ndim != ndim) {
+        printf("[%s][%s][%d] Error: output tensor must be %dD tensor\r\n", __FILE__, __func__, __LINE__, ndim);
+        return NULL;
+    }
+    for (int i = 0; i < ndim; i++) {
+        if (output->shape[i] != shape[i]) {
+            printf("[%s][%s][%d] Error: output shape[%d] must be %d\r\n", __FILE__, __func__, __LINE__, i, shape[i]);
+            return NULL;
+        }
+    }
+    if (a->type != b->type || a->type != output->type) {
+        printf("[%s][%s][%d] Error: a, b, and output must have the same type\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (a->type != TENSOR_FLOAT32 && a->type != TENSOR_INT64) {
+        printf("[%s][%s][%d] Error: Un-supported tensor type. Supported tensor types are int64 or float32\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+
+    elementwise_plan_t plan;
+    elementwise_make_plan(&plan, op, a, b, output);
+    if (output->num_elements >= ELEMENTWISE_PARALLEL_THRESHOLD) {
+        parallel_for(output->num_elements, ELEMENTWISE_PARALLEL_THRESHOLD / 4, elementwise_range, &plan);
+    } else {
+        elementwise_range(&plan, 0, output->num_elements);
+    }
+    return output;
+}
+
+tensor_t *elementwise_add(tensor_t *a, tensor_t *b) {
+    return elementwise(ELEMENTWISE_ADD, a, b);
+}
+
+tensor_t *elementwise_sub(tensor_t *a, tensor_t *b) {
+    return elementwise(ELEMENTWISE_SUB, a, b);
+}
+
+tensor_t *elementwise_mul(tensor_t *a, tensor_t *b) {
+    return elementwise(ELEMENTWISE_MUL, a, b);
+}
+
+tensor_t *elementwise_max(tensor_t *a, tensor_t *b) {
+    return elementwise(ELEMENTWISE_MAX, a, b);
+}
+
+tensor_t *elementwise_min(tensor_t *a, tensor_t *b) {
+    return elementwise(ELEMENTWISE_MIN, a, b);
+}
+
+tensor_t *elementwise_add_inplace(tensor_t *a, tensor_t *b) {
+    return elementwise_out(ELEMENTWISE_ADD, a, b, a);
+}
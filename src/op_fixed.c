@@ -0,0 +1,308 @@
+#include "op_fixed.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include "tensor.h"
+#include "op_linear.h"
+#include "op_norm.h"
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+static inline uint8_t fixed_is_fixed_type(tensor_type_t type) {
+    return type == TENSOR_INT16 || type == TENSOR_INT32;
+}
+
+// value * 2^-shift rounded to nearest (shift > 0), or value * 2^-shift saturated to int64 (shift < 0)
+static inline int64_t fixed_shift(int64_t value, int32_t shift) {
+    if (shift > 0) return (value >> shift) + ((value >> (shift - 1)) & 1);     // + 0.5 without overflow near INT64_MAX
+    if (shift < 0) {
+        if (value > (INT64_MAX >> -shift)) return INT64_MAX;
+        if (value < (INT64_MIN >> -shift)) return INT64_MIN;
+        return value * ((int64_t)1 << -shift);
+    }
+    return value;
+}
+
+// a + b saturated to int64
+static inline int64_t fixed_add(int64_t a, int64_t b) {
+    if (b > 0 && a > INT64_MAX - b) return INT64_MAX;
+    if (b < 0 && a < INT64_MIN - b) return INT64_MIN;
+    return a + b;
+}
+
+static inline void fixed_store(tensor_data_t *dst, tensor_type_t type, int64_t value) {
+    if (type == TENSOR_INT16) {
+        dst->int16 = (int16_t)((value > INT16_MAX) ? INT16_MAX : (value < INT16_MIN) ? INT16_MIN : value);
+    } else {
+        dst->int32 = (int32_t)((value > INT32_MAX) ? INT32_MAX : (value < INT32_MIN) ? INT32_MIN : value);
+    }
+}
+
+static inline int64_t fixed_load(const tensor_data_t *src, tensor_type_t type) {
+    return (type == TENSOR_INT16) ? src->int16 : src->int32;
+}
+
+tensor_t *fixed_from_float(tensor_t *input, tensor_type_t type, uint8_t frac_bits) {
+    tensor_t *output = tensor_create(type, input->ndim, input->shape, (void *)0);
+    output->frac_bits = frac_bits;
+    if (fixed_from_float_out(input, output) == (tensor_t *) NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *fixed_from_float_out(tensor_t *input, tensor_t *output) {
+    if (input->type != TENSOR_FLOAT32 || !fixed_is_fixed_type(output->type) || input->num_elements != output->num_elements) {
+        printf("[%s][%s][%d] Error: input must be float32 and output int16 or int32 with the same number of elements\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (!tensor_is_contiguous(input) || !tensor_is_contiguous(output)) {
+        printf("[%s][%s][%d] Error: input and output must not be transposed\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    const double scale = ldexp(1.0, output->frac_bits);
+    for (uint32_t i = 0; i < input->num_elements; i++) {
+        double value = floor((double)input->data[i].float32 * scale + 0.5);
+        if (value > (double)INT32_MAX) value = (double)INT32_MAX;
+        if (value < (double)INT32_MIN) value = (double)INT32_MIN;
+        fixed_store(&output->data[i], output->type, (int64_t)value);
+    }
+    return output;
+}
+
+tensor_t *fixed_to_float(tensor_t *input) {
+    tensor_t *output = tensor_create(TENSOR_FLOAT32, input->ndim, input->shape, (void *)0);
+    if (fixed_to_float_out(input, output) == (tensor_t *) NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *fixed_to_float_out(tensor_t *input, tensor_t *output) {
+    if (!fixed_is_fixed_type(input->type) || output->type != TENSOR_FLOAT32 || input->num_elements != output->num_elements) {
+        printf("[%s][%s][%d] Error: input must be int16 or int32 and output float32 with the same number of elements\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (!tensor_is_contiguous(input) || !tensor_is_contiguous(output)) {
+        printf("[%s][%s][%d] Error: input and output must not be transposed\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    const double scale = ldexp(1.0, -(int)input->frac_bits);
+    for (uint32_t i = 0; i < input->num_elements; i++) {
+        output->data[i].float32 = (float)((double)fixed_load(&input->data[i], input->type) * scale);
+    }
+    return output;
+}
+
+// Largest frac_bits, up to max_frac_bits, with max_abs * 2^frac_bits in max_value after rounding
+static uint8_t fixed_frac_bits_for_value(double max_abs, double max_value, uint8_t max_frac_bits) {
+    uint8_t frac_bits = max_frac_bits;
+    while (frac_bits > 0 && floor(max_abs * ldexp(1.0, frac_bits) + 0.5) > max_value) frac_bits--;
+    return frac_bits;
+}
+
+uint8_t fixed_frac_bits_for(tensor_t *input, tensor_type_t type) {
+    const uint8_t max_frac_bits = (type == TENSOR_INT16) ? 15 : 31;
+    const double max_value = (type == TENSOR_INT16) ? (double)INT16_MAX : (double)INT32_MAX;
+    double max_abs = 0.0;
+    for (uint32_t i = 0; i < input->num_elements; i++) {
+        double value = fabs((double)input->data[i].float32);
+        if (value > max_abs) max_abs = value;
+    }
+    return fixed_frac_bits_for_value(max_abs, max_value, max_frac_bits);
+}
+
+fixed_linear_t *fixed_linear_create(tensor_t *weight, tensor_t *bias) {
+    // weight: 2D int16 tensor (out_features x in_features)
+    // bias: 1D int32 tensor   (out_features) or NULL
+    if (weight->ndim != 2 || weight->type != TENSOR_INT16 || !tensor_is_contiguous(weight)) {
+        printf("[%s][%s][%d] Error: weight must be a non-transposed 2D int16 tensor\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (bias != (tensor_t *) NULL && (bias->ndim != 1 || bias->type != TENSOR_INT32 || bias->shape[0] != weight->shape[0])) {
+        printf("[%s][%s][%d] Error: bias must be a 1D int32 tensor (out_features)\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    fixed_linear_t *linear = (fixed_linear_t *)malloc(sizeof(fixed_linear_t));
+    linear->weight = weight;
+    linear->bias = bias;
+    linear->packed_weight = (int16_t *)malloc(weight->num_elements * sizeof(int16_t));
+    for (uint32_t i = 0; i < weight->num_elements; i++) linear->packed_weight[i] = weight->data[i].int16;
+    return linear;
+}
+
+fixed_linear_t *fixed_linear_from_float(linear_t *linear_weight) {
+    tensor_t *weight = linear_weight->weight;
+    tensor_t *bias = linear_weight->bias;
+    if (weight->type != TENSOR_FLOAT32) {
+        printf("[%s][%s][%d] Error: linear must be float32\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    tensor_t *fixed_weight = fixed_from_float(weight, TENSOR_INT16, fixed_frac_bits_for(weight, TENSOR_INT16));
+    tensor_t *fixed_bias = (bias != (tensor_t *) NULL) ? fixed_from_float(bias, TENSOR_INT32, fixed_frac_bits_for(bias, TENSOR_INT32)) : NULL;
+    fixed_linear_t *linear = (fixed_weight != (tensor_t *) NULL) ? fixed_linear_create(fixed_weight, fixed_bias) : NULL;
+    if (linear == (fixed_linear_t *) NULL) {
+        if (fixed_weight != (tensor_t *) NULL) tensor_free(fixed_weight);
+        if (fixed_bias != (tensor_t *) NULL) tensor_free(fixed_bias);
+        return NULL;
+    }
+    return linear;
+}
+
+void fixed_linear_free(fixed_linear_t *linear, uint8_t deep) {
+    // deep: 0 - free only fixed_linear_t (and the packed weight), 1 - free weight, bias too
+    if (deep != 0) {
+        if (linear->weight != (tensor_t *) NULL) tensor_free(linear->weight);
+        if (linear->bias != (tensor_t *) NULL) tensor_free(linear->bias);
+    }
+    free(linear->packed_weight);
+    free(linear);
+}
+
+tensor_t *fixed_linear(tensor_t *input, fixed_linear_t *linear_weight, tensor_type_t type, uint8_t frac_bits) {
+    if (input->ndim != 2) {
+        printf("[%s][%s][%d] Error: input must be a 2D tensor\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    tensor_t *output = tensor_create(type, 2, (uint32_t[]){input->shape[0], linear_weight->weight->shape[0]}, (void *)0);
+    output->frac_bits = frac_bits;
+    if (fixed_linear_out(input, linear_weight, output) == (tensor_t *) NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *fixed_linear_out(tensor_t *input, fixed_linear_t *linear_weight, tensor_t *output) {
+    // output[b][j] = (sum_k input[b][k] * weight[j][k] + bias[j]) >> (input Q + weight Q - output Q)
+    tensor_t *weight = linear_weight->weight;
+    tensor_t *bias = linear_weight->bias;
+    if (input->ndim != 2 || output->ndim != 2 || input->shape[1] != weight->shape[1] ||
+        output->shape[0] != input->shape[0] || output->shape[1] != weight->shape[0]) {
+        printf("[%s][%s][%d] Error: input (batch_size x in_features), output (batch_size x out_features) do not match the weight\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (!fixed_is_fixed_type(input->type) || !fixed_is_fixed_type(output->type)) {
+        printf("[%s][%s][%d] Error: input and output must be int16 or int32\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (!tensor_is_contiguous(input) || !tensor_is_contiguous(output)) {
+        printf("[%s][%s][%d] Error: input and output must not be transposed\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    const uint32_t batch_size = input->shape[0];
+    const uint32_t in_features = input->shape[1];
+    const uint32_t out_features = weight->shape[0];
+    const int32_t acc_frac_bits = input->frac_bits + weight->frac_bits;
+    const int32_t shift = acc_frac_bits - output->frac_bits;
+
+    // The input row is packed into a contiguous array, so the products are read like the packed weight
+    int16_t *row16 = (int16_t *)malloc(in_features * sizeof(int16_t));
+    int32_t *row32 = (int32_t *)malloc(in_features * sizeof(int32_t));
+    for (uint32_t b = 0; b < batch_size; b++) {
+        const tensor_data_t *x = input->data + b * in_features;
+        if (input->type == TENSOR_INT16) {
+            for (uint32_t k = 0; k < in_features; k++) row16[k] = x[k].int16;
+        } else {
+            for (uint32_t k = 0; k < in_features; k++) row32[k] = x[k].int32;
+        }
+        for (uint32_t j = 0; j < out_features; j++) {
+            const int16_t *w = linear_weight->packed_weight + j * in_features;
+            int64_t acc = 0;
+            if (input->type == TENSOR_INT16) {
+                for (uint32_t k = 0; k < in_features; k++) acc += (int32_t)row16[k] * w[k];
+            } else {
+                for (uint32_t k = 0; k < in_features; k++) acc += (int64_t)row32[k] * w[k];
+            }
+            // The bias aligned to the accumulator can saturate (bias Q < accumulator Q), so the add saturates too,
+            // and a saturated sum saturates the output instead of being shifted
+            if (bias != (tensor_t *) NULL) acc = fixed_add(acc, fixed_shift(bias->data[j].int32, (int32_t)bias->frac_bits - acc_frac_bits));
+            if (acc != INT64_MAX && acc != INT64_MIN) acc = fixed_shift(acc, shift);
+            fixed_store(&output->data[b * out_features + j], output->type, acc);
+        }
+    }
+    free(row16);
+    free(row32);
+    return output;
+}
+
+fixed_batch_norm_t *fixed_batch_norm_from_float(batch_norm_t *batch_norm_weight, uint8_t out_frac_bits) {
+    // Fold to output = input * coefficient + bias (batch_norm_fold), then
+    // multiplier[c] = coefficient[c] in int16 with the largest frac_bits (up to FIXED_Q31) that holds it,
+    // so a small coefficient keeps 15 significant bits, offset = bias in the output Q format.
+    tensor_t *folded = batch_norm_fold(batch_norm_weight);
+    if (folded == (tensor_t *) NULL) {
+        return NULL;
+    }
+    const uint32_t channels = folded->shape[1];
+    tensor_t *bias = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){channels}, folded->data + channels);
+    fixed_batch_norm_t *batch_norm = (fixed_batch_norm_t *)malloc(sizeof(fixed_batch_norm_t));
+    batch_norm->multiplier = tensor_create(TENSOR_INT16, 1, (uint32_t[]){channels}, (void *)0);
+    batch_norm->multiplier_frac_bits = (uint8_t *)malloc(channels * sizeof(uint8_t));
+    for (uint32_t c = 0; c < channels; c++) {
+        const double coefficient = (double)folded->data[c].float32;
+        const uint8_t frac_bits = fixed_frac_bits_for_value(fabs(coefficient), (double)INT16_MAX, FIXED_Q31);
+        batch_norm->multiplier_frac_bits[c] = frac_bits;
+        fixed_store(&batch_norm->multiplier->data[c], TENSOR_INT16, (int64_t)floor(coefficient * ldexp(1.0, frac_bits) + 0.5));
+    }
+    batch_norm->offset = fixed_from_float(bias, TENSOR_INT32, out_frac_bits);
+    tensor_free(bias);
+    tensor_free(folded);
+    return batch_norm;
+}
+
+void fixed_batch_norm_free(fixed_batch_norm_t *batch_norm) {
+    tensor_free(batch_norm->multiplier);
+    tensor_free(batch_norm->offset);
+    free(batch_norm->multiplier_frac_bits);
+    free(batch_norm);
+}
+
+tensor_t *fixed_batch_norm(tensor_t *input, fixed_batch_norm_t *batch_norm_weight, tensor_type_t type) {
+    tensor_t *output = tensor_create(type, input->ndim, input->shape, (void *)0);
+    if (fixed_batch_norm_out(input, batch_norm_weight, output) == (tensor_t *) NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *fixed_batch_norm_out(tensor_t *input, fixed_batch_norm_t *batch_norm_weight, tensor_t *output) {
+    // Channel axis is 1. inner: number of elements of a channel plane (1 for 2D)
+    const tensor_t *multiplier = batch_norm_weight->multiplier;
+    const tensor_t *offset = batch_norm_weight->offset;
+    if ((input->ndim != 2 && input->ndim != 4) || input->shape[1] != multiplier->shape[0] || output->num_elements != input->num_elements) {
+        printf("[%s][%s][%d] Error: input must be (batch_size x %d) or (batch_size x %d x height x width), output the same size\r\n", __FILE__, __func__, __LINE__, multiplier->shape[0], multiplier->shape[0]);
+        return NULL;
+    }
+    if (!fixed_is_fixed_type(input->type) || !fixed_is_fixed_type(output->type)) {
+        printf("[%s][%s][%d] Error: input and output must be int16 or int32\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (!tensor_is_contiguous(input) || !tensor_is_contiguous(output)) {
+        printf("[%s][%s][%d] Error: input and output must not be transposed\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    const uint32_t channels = input->shape[1];
+    const uint32_t inner = (input->ndim == 4) ? input->shape[2] * input->shape[3] : 1;
+    const uint32_t batch_size = input->shape[0];
+    const tensor_type_t in_type = input->type;
+    output->frac_bits = offset->frac_bits;
+    for (uint32_t n = 0; n < batch_size; n++) {
+        for (uint32_t c = 0; c < channels; c++) {
+            const int64_t m = multiplier->data[c].int16;
+            const int64_t o = offset->data[c].int32;
+            const int32_t shift = (int32_t)input->frac_bits + batch_norm_weight->multiplier_frac_bits[c] - offset->frac_bits;
+            const uint32_t base = (n * channels + c) * inner;
+            for (uint32_t i = 0; i < inner; i++) {
+                fixed_store(&output->data[base + i], output->type, fixed_add(fixed_shift(fixed_load(&input->data[base + i], in_type) * m, shift), o));
+            }
+        }
+    }
+    return output;
+}
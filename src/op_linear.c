@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include "tensor.h"
+#include "parallel.h"
 
 #ifndef NULL
 #define NULL 0
@@ -53,81 +54,137 @@ void linear_free(linear_t *linear, uint8_t deep) {
     free(linear);
 }
 
-tensor_t *linear(tensor_t *input, linear_t *linear_weight) {
-    // output = input * weight.T + bias
-    // input: 2D tensor or 1D tensor    (batch_size x in_features)
-    // weight: 2D tensor    (out_features x in_features)
-    // bias: 1D tensor      (out_features)
-    // output: 2D tensor    (batch_size x out_features)
-    
-    // Check shape
+static int linear_check(tensor_t *input, linear_t *linear_weight) {
     tensor_t *weight = linear_weight->weight;
     tensor_t *bias = linear_weight->bias;
 
-    if (input->ndim == 1)   input = tensor_unsqueeze(input, 0);
     if (input->ndim != 2) {
         printf("[%s][%s][%d] Error: input tensor must be 2D tensor\r\n", __FILE__, __func__, __LINE__);
-        return NULL;
+        return -1;
     }
     if (weight->ndim != 2) {
         printf("[%s][%s][%d] Error: weight tensor must be 2D tensor\r\n", __FILE__, __func__, __LINE__);
-        return NULL;
+        return -1;
     }
     if (input->shape[1] != weight->shape[1]) {
         printf("[%s][%s][%d] Error: input shape[1] must be equal to weight shape[1]\r\n", __FILE__, __func__, __LINE__);
-        return NULL;
+        return -1;
     }
     if (bias != (tensor_t *) NULL) {
         if (bias->ndim != 1) {
             printf("[%s][%s][%d] Error: bias tensor must be 1D tensor\r\n", __FILE__, __func__, __LINE__);
-            return NULL;
+            return -1;
         }
         if (weight->shape[0] != bias->shape[0]) {
             printf("[%s][%s][%d] Error: weight shape[0] must be equal to bias shape[0]\r\n", __FILE__, __func__, __LINE__);
-            return NULL;
+            return -1;
         }
     }
 
     // Type check
-    if (input->type != weight->type || input->type != bias->type) {
+    if (input->type != weight->type || (bias != (tensor_t *) NULL && input->type != bias->type)) {
         printf("[%s][%s][%d] Error: input, weight, and bias must have the same type\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    return 0;
+}
+
+tensor_t *linear(tensor_t *input, linear_t *linear_weight) {
+    // output = input * weight.T + bias
+    // input: 2D tensor or 1D tensor    (batch_size x in_features)
+    // weight: 2D tensor    (out_features x in_features)
+    // bias: 1D tensor      (out_features)
+    // output: 2D tensor    (batch_size x out_features)
+    
+    tensor_t row;       // (1 x n) view of a 1D input, so the caller's tensor is not changed
+    uint32_t row_shape[2], row_transpose[2];
+    if (input->ndim == 1)   input = tensor_row_view(input, &row, row_shape, row_transpose);
+    if (linear_check(input, linear_weight) != 0) {
         return NULL;
     }
 
     // Allocate output tensor
-    uint32_t shape[] = {input->shape[0], weight->shape[0]};
+    uint32_t shape[] = {input->shape[0], linear_weight->weight->shape[0]};
     tensor_t *output = tensor_create(input->type, 2, shape, (void *)0);
 
+    if (linear_out(input, linear_weight, output) == NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *linear_out(tensor_t *input, linear_t *linear_weight, tensor_t *output) {
+    // Same as linear(), but the result is written into the given output tensor (batch_size x out_features).
+    // Useful when the output buffer is reused (ex. tiled execution).
+    tensor_t *weight = linear_weight->weight;
+    tensor_t *bias = linear_weight->bias;
+
+    tensor_t row;       // (1 x n) view of a 1D input, so the caller's tensor is not changed
+    uint32_t row_shape[2], row_transpose[2];
+    if (input->ndim == 1)   input = tensor_row_view(input, &row, row_shape, row_transpose);
+    if (linear_check(input, linear_weight) != 0) {
+        return NULL;
+    }
+    if (output->ndim != 2 || output->shape[0] != input->shape[0] || output->shape[1] != weight->shape[0]) {
+        printf("[%s][%s][%d] Error: output tensor must be 2D tensor (batch_size x out_features)\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (output->type != input->type) {
+        printf("[%s][%s][%d] Error: input and output must have the same type\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+
     // Calculate
     const tensor_data_t *input_data = input->data;
     const tensor_data_t *weight_data = weight->data;
+    const uint8_t contiguous = tensor_is_contiguous(input) && tensor_is_contiguous(weight) && tensor_is_contiguous(output);
+    const uint32_t batch_size = input->shape[0];
+    const uint32_t in_features = input->shape[1];
+    const uint32_t out_features = weight->shape[0];
 
     switch (input->type) {
         case TENSOR_INT64:
-        for (int i = 0; i < input->shape[0]; i++) {
-            for (int j = 0; j < weight->shape[0]; j++) {
+        for (int i = 0; i < batch_size; i++) {
+            for (int j = 0; j < out_features; j++) {
                 tensor_data_t sum = (tensor_data_t){.int64 = 0};
-                for (int k = 0; k < input->shape[1]; k++) {
-                    sum.int64 += input_data[tensor_convert_nd_to_1d_index(input, (uint32_t[]){i, k})].int64 * weight_data[tensor_convert_nd_to_1d_index(weight, (uint32_t[]){j, k})].int64;
+                if (contiguous) {
+                    const tensor_data_t *x = input_data + i * in_features;
+                    const tensor_data_t *w = weight_data + j * in_features;
+                    for (int k = 0; k < in_features; k++) {
+                        sum.int64 += x[k].int64 * w[k].int64;
+                    }
+                } else {
+                    for (int k = 0; k < in_features; k++) {
+                        sum.int64 += input_data[tensor_convert_nd_to_1d_index(input, (uint32_t[]){i, k})].int64 * weight_data[tensor_convert_nd_to_1d_index(weight, (uint32_t[]){j, k})].int64;
+                    }
                 }
                 if (bias != (tensor_t *) NULL) {
                     sum.int64 += bias->data[j].int64;
                 }
-                output->data[tensor_convert_nd_to_1d_index(output, (uint32_t[]){i, j})] = sum;
+                output->data[contiguous ? i * out_features + j : tensor_convert_nd_to_1d_index(output, (uint32_t[]){i, j})] = sum;
             }
         }
         break;
         case TENSOR_FLOAT32:
-        for (int i = 0; i < input->shape[0]; i++) {
-            for (int j = 0; j < weight->shape[0]; j++) {
+        for (int i = 0; i < batch_size; i++) {
+            for (int j = 0; j < out_features; j++) {
                 tensor_data_t sum = (tensor_data_t){.float32 = 0};
-                for (int k = 0; k < input->shape[1]; k++) {
-                    sum.float32 += input_data[tensor_convert_nd_to_1d_index(input, (uint32_t[]){i, k})].float32 * weight_data[tensor_convert_nd_to_1d_index(weight, (uint32_t[]){j, k})].float32;
+                if (contiguous) {
+                    const tensor_data_t *x = input_data + i * in_features;
+                    const tensor_data_t *w = weight_data + j * in_features;
+                    for (int k = 0; k < in_features; k++) {
+                        sum.float32 += x[k].float32 * w[k].float32;
+                    }
+                } else {
+                    for (int k = 0; k < in_features; k++) {
+                        sum.float32 += input_data[tensor_convert_nd_to_1d_index(input, (uint32_t[]){i, k})].float32 * weight_data[tensor_convert_nd_to_1d_index(weight, (uint32_t[]){j, k})].float32;
+                    }
                 }
                 if (bias != (tensor_t *) NULL) {
                     sum.float32 += bias->data[j].float32;
                 }
-                output->data[tensor_convert_nd_to_1d_index(output, (uint32_t[]){i, j})] = sum;
+                output->data[contiguous ? i * out_features + j : tensor_convert_nd_to_1d_index(output, (uint32_t[]){i, j})] = sum;
             }
         }
         break;
@@ -148,3 +205,158 @@ tensor_t *linear(tensor_t *input, linear_t *linear_weight) {
 
     return output;
 }
+
+typedef struct {
+    const tensor_data_t *input;
+    const tensor_data_t *weight;
+    const tensor_data_t *bias;
+    tensor_data_t *output;
+    const float *packed;        // LINEAR_ALGO_TILED: (tiles x in_features x tile_rows)
+    uint32_t batch_size;
+    uint32_t in_features;
+    uint32_t out_features;
+    uint32_t tile_rows;
+} linear_kernel_ctx_t;
+
+static void linear_gemv_range(void *ctx, uint32_t begin, uint32_t end) {
+    // Weight rows [begin, end). The 8 partial sums are independent, so the adds are not serialized.
+    linear_kernel_ctx_t *c = (linear_kernel_ctx_t *)ctx;
+    const uint32_t in_features = c->in_features;
+    const uint32_t main_end = in_features - in_features % 8;
+    for (uint32_t i = 0; i < c->batch_size; i++) {
+        const tensor_data_t *x = c->input + i * in_features;
+        for (uint32_t j = begin; j < end; j++) {
+            const tensor_data_t *w = c->weight + j * in_features;
+            float acc[8] = {0.0f};
+            for (uint32_t k = 0; k < main_end; k += 8) {
+                for (uint32_t t = 0; t < 8; t++) acc[t] += x[k + t].float32 * w[k + t].float32;
+            }
+            float sum = ((acc[0] + acc[4]) + (acc[1] + acc[5])) + ((acc[2] + acc[6]) + (acc[3] + acc[7]));
+            for (uint32_t k = main_end; k < in_features; k++) sum += x[k].float32 * w[k].float32;
+            if (c->bias != (tensor_data_t *) NULL) sum += c->bias[j].float32;
+            c->output[i * c->out_features + j].float32 = sum;
+        }
+    }
+}
+
+// Packed input of LINEAR_ALGO_TILED. One buffer per thread, grown to the largest pack and reused by the next calls,
+// so a run does not allocate. linear_free_pack releases the buffer of the calling thread.
+#if defined(__GNUC__)
+#define LINEAR_THREAD_LOCAL __thread
+#else
+#define LINEAR_THREAD_LOCAL
+#endif
+static LINEAR_THREAD_LOCAL float *linear_pack = (float *) NULL;
+static LINEAR_THREAD_LOCAL size_t linear_pack_size = 0;
+
+static float *linear_get_pack(size_t size) {
+    if (size > linear_pack_size) {
+        float *pack = (float *)realloc(linear_pack, size * sizeof(float));
+        if (pack == (float *) NULL) return NULL;
+        linear_pack = pack;
+        linear_pack_size = size;
+    }
+    return linear_pack;
+}
+
+void linear_free_pack() {
+    free(linear_pack);
+    linear_pack = (float *) NULL;
+    linear_pack_size = 0;
+}
+
+static inline void linear_tile_dot(const float *xp, const tensor_data_t *w, uint32_t in_features, uint32_t tile_rows, float *acc) {
+    // Local sums (not through acc), so they stay in registers
+    float sum[LINEAR_MAX_TILE_ROWS] = {0.0f};
+    for (uint32_t k = 0; k < in_features; k++, xp += tile_rows) {
+        const float wk = w[k].float32;
+        for (uint32_t r = 0; r < tile_rows; r++) sum[r] += xp[r] * wk;
+    }
+    for (uint32_t r = 0; r < tile_rows; r++) acc[r] = sum[r];
+}
+
+static void linear_tiled_range(void *ctx, uint32_t begin, uint32_t end) {
+    // Weight rows [begin, end) for every tile of tile_rows input rows. The tile is interleaved
+    // (in_features x tile_rows), so the loop over the rows of the tile is contiguous and vectorized.
+    linear_kernel_ctx_t *c = (linear_kernel_ctx_t *)ctx;
+    const uint32_t in_features = c->in_features;
+    const uint32_t tile_rows = c->tile_rows;
+    const uint32_t tiles = (c->batch_size + tile_rows - 1) / tile_rows;
+    for (uint32_t tile = 0; tile < tiles; tile++) {
+        const float *xp = c->packed + (size_t)tile * in_features * tile_rows;
+        const uint32_t rows = (c->batch_size - tile * tile_rows < tile_rows) ? c->batch_size - tile * tile_rows : tile_rows;
+        for (uint32_t j = begin; j < end; j++) {
+            const tensor_data_t *w = c->weight + j * in_features;
+            float acc[LINEAR_MAX_TILE_ROWS] = {0.0f};
+            // Constant tile sizes, so the loop over the rows is unrolled into vector operations
+            switch (tile_rows) {
+                case 2: linear_tile_dot(xp, w, in_features, 2, acc); break;
+                case 4: linear_tile_dot(xp, w, in_features, 4, acc); break;
+                case 8: linear_tile_dot(xp, w, in_features, 8, acc); break;
+                default: linear_tile_dot(xp, w, in_features, tile_rows, acc); break;
+            }
+            const float bias = (c->bias != (tensor_data_t *) NULL) ? c->bias[j].float32 : 0.0f;
+            for (uint32_t r = 0; r < rows; r++) {
+                c->output[(tile * tile_rows + r) * c->out_features + j].float32 = acc[r] + bias;
+            }
+        }
+    }
+}
+
+tensor_t *linear_out_config(tensor_t *input, linear_t *linear_weight, tensor_t *output, linear_config_t *config) {
+    tensor_t row;       // (1 x n) view of a 1D input, so the caller's tensor is not changed
+    uint32_t row_shape[2], row_transpose[2];
+    if (input->ndim == 1)   input = tensor_row_view(input, &row, row_shape, row_transpose);
+    if (config->algo == LINEAR_ALGO_DIRECT || input->type != TENSOR_FLOAT32 || !tensor_is_contiguous(input) ||
+        !tensor_is_contiguous(linear_weight->weight) || !tensor_is_contiguous(output)) {
+        return linear_out(input, linear_weight, output);
+    }
+    if (linear_check(input, linear_weight) != 0) {
+        return NULL;
+    }
+    if (output->ndim != 2 || output->shape[0] != input->shape[0] || output->shape[1] != linear_weight->weight->shape[0] || output->type != input->type) {
+        printf("[%s][%s][%d] Error: output tensor must be 2D tensor (batch_size x out_features) of the input type\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (config->algo == LINEAR_ALGO_TILED && (config->tile_rows < 2 || config->tile_rows > LINEAR_MAX_TILE_ROWS)) {
+        printf("[%s][%s][%d] Error: tile_rows must be in [2, %d]\r\n", __FILE__, __func__, __LINE__, LINEAR_MAX_TILE_ROWS);
+        return NULL;
+    }
+
+    linear_kernel_ctx_t ctx;
+    ctx.input = input->data;
+    ctx.weight = linear_weight->weight->data;
+    ctx.bias = (linear_weight->bias != (tensor_t *) NULL) ? linear_weight->bias->data : (tensor_data_t *) NULL;
+    ctx.output = output->data;
+    ctx.packed = (float *) NULL;
+    ctx.batch_size = input->shape[0];
+    ctx.in_features = input->shape[1];
+    ctx.out_features = linear_weight->weight->shape[0];
+    ctx.tile_rows = config->tile_rows;
+
+    // The weight rows are split into exactly config->threads ranges, the configuration the autotuner measured
+    const uint32_t threads = (config->threads > 0) ? config->threads : 1;
+    if (config->algo == LINEAR_ALGO_TILED) {
+        const uint32_t tiles = (ctx.batch_size + ctx.tile_rows - 1) / ctx.tile_rows;
+        float *packed = linear_get_pack((size_t)tiles * ctx.in_features * ctx.tile_rows);
+        if (packed == (float *) NULL) {
+            printf("[%s][%s][%d] Error: failed to allocate the packed input (%d x %d)\r\n", __FILE__, __func__, __LINE__, tiles * ctx.tile_rows, ctx.in_features);
+            return NULL;
+        }
+        for (uint32_t i = 0; i < tiles * ctx.tile_rows; i++) {
+            // Rows past the batch pad the last tile with zeros
+            float *dst = packed + (size_t)(i / ctx.tile_rows) * ctx.in_features * ctx.tile_rows + i % ctx.tile_rows;
+            if (i < ctx.batch_size) {
+                const tensor_data_t *src = input->data + i * ctx.in_features;
+                for (uint32_t k = 0; k < ctx.in_features; k++) dst[k * ctx.tile_rows] = src[k].float32;
+            } else {
+                for (uint32_t k = 0; k < ctx.in_features; k++) dst[k * ctx.tile_rows] = 0.0f;
+            }
+        }
+        ctx.packed = packed;
+        parallel_for_threads(ctx.out_features, threads, linear_tiled_range, &ctx);
+    } else {
+        parallel_for_threads(ctx.out_features, threads, linear_gemv_range, &ctx);
+    }
+    return output;
+}
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include "tensor.h"
+#include "parallel.h"
 
 #ifndef NULL
 #define NULL 0
@@ -19,7 +20,8 @@ batch_norm_t *batch_norm_create(tensor_t *mean, tensor_t *var, tensor_t *epsilon
     // output: 4D tensor    (batch_size x channels x height x width)
     
     // Type check
-    if (mean->type != var->type || mean->type != epsilon->type || mean->type != gamma->type || mean->type != beta->type) {
+    // epsilon can be NULL (default epsilon of PyTorch, 1e-5)
+    if (mean->type != var->type || (epsilon != (tensor_t *) NULL && mean->type != epsilon->type) || mean->type != gamma->type || mean->type != beta->type) {
         printf("[%s][%s][%d] Error: mean, var, epsilon, gamma, and beta must have the same type (float32)\r\n", __FILE__, __func__, __LINE__);
         return NULL;
     }
@@ -31,6 +33,8 @@ batch_norm_t *batch_norm_create(tensor_t *mean, tensor_t *var, tensor_t *epsilon
     batch_norm_weight->epsilon = epsilon;
     batch_norm_weight->gamma = gamma;
     batch_norm_weight->beta = beta;
+
+    return batch_norm_weight;
 }
 
 void batch_free(batch_norm_t *batch_norm, uint8_t deep) {
@@ -61,6 +65,87 @@ void batch_free(batch_norm_t *batch_norm, uint8_t deep) {
     free(batch_norm);
 }
 
+tensor_t *batch_norm_fold(batch_norm_t *batch_norm_weight) {
+    // Fold the batch norm into a per-channel multiply-add: output = input * coefficient + bias
+    // coefficient = gamma / sqrt(var + epsilon)
+    // bias = beta - mean * coefficient
+    // output: 2D tensor    (2 x channels). Row 0 is coefficient, row 1 is bias.
+    tensor_t *mean = batch_norm_weight->mean;
+    tensor_t *var = batch_norm_weight->var;
+    tensor_t *epsilon = batch_norm_weight->epsilon;
+    tensor_t *gamma = batch_norm_weight->gamma;
+    tensor_t *beta = batch_norm_weight->beta;
+
+    if (mean->type != TENSOR_FLOAT32) {
+        printf("[%s][%s][%d] Error: batch norm must be float32\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+
+    uint32_t channels = mean->shape[0];
+    tensor_t *folded = tensor_create(mean->type, 2, (uint32_t[]){2, channels}, (void *)0);
+    tensor_data_t *input_coefficient = folded->data;
+    tensor_data_t *bias = folded->data + channels;
+    for (int i = 0; i < channels; i++) {
+        float eps = (epsilon != (tensor_t *) NULL) ? epsilon->data[i].float32 : 1e-5f;   // default epsilon PyTorch
+        input_coefficient[i].float32 = 1.0f / sqrtf(var->data[i].float32 + eps) * gamma->data[i].float32;  // 1 / sqrt(var + epsilon) * gamma. libm, so var + epsilon 0 gives inf
+        bias[i].float32 = -mean->data[i].float32 * input_coefficient[i].float32 + beta->data[i].float32;    // -mean / sqrt(var + epsilon) * gamma + beta
+    }
+    return folded;
+}
+
+tensor_t *batch_norm_1d(tensor_t *input, batch_norm_t *batch_norm_weight) {
+    // output = (input - mean) / sqrt(var + epsilon) * gamma + beta
+    // input: 2D tensor    (batch_size x channels). ex) output of linear
+    // output: 2D tensor    (batch_size x channels)
+    // All the types must be float32
+    if (input->ndim != 2) {
+        printf("[%s][%s][%d] Error: input tensor must be 2D tensor\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    tensor_t *output = tensor_create(input->type, input->ndim, input->shape, (void *)0);
+
+    if (batch_norm_1d_out(input, batch_norm_weight, output) == NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *batch_norm_1d_out(tensor_t *input, batch_norm_t *batch_norm_weight, tensor_t *output) {
+    // Same as batch_norm_1d(), but the result is written into the given output tensor (same shape as input).
+    // output can be the input itself (in-place).
+    if (input->ndim != 2 || output->ndim != 2 || output->num_elements != input->num_elements) {
+        printf("[%s][%s][%d] Error: input and output must be 2D tensors of the same shape\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (input->shape[1] != batch_norm_weight->mean->shape[0]) {
+        printf("[%s][%s][%d] Error: input shape[1] must be equal to the number of channels\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (input->type != TENSOR_FLOAT32 || output->type != TENSOR_FLOAT32) {
+        printf("[%s][%s][%d] Error: input and output must be float32\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+
+    tensor_t *folded = batch_norm_fold(batch_norm_weight);
+    if (folded == (tensor_t *) NULL) {
+        return NULL;
+    }
+    const uint32_t channels = input->shape[1];
+    const tensor_data_t *input_coefficient = folded->data;
+    const tensor_data_t *bias = folded->data + channels;
+    for (int i = 0; i < input->shape[0]; i++) {
+        for (int c = 0; c < channels; c++) {
+            uint32_t in_index = tensor_convert_nd_to_1d_index(input, (uint32_t[]){i, c});
+            uint32_t out_index = tensor_convert_nd_to_1d_index(output, (uint32_t[]){i, c});
+            output->data[out_index].float32 = input->data[in_index].float32 * input_coefficient[c].float32 + bias[c].float32;
+        }
+    }
+    tensor_free(folded);
+
+    return output;
+}
+
 tensor_t *batch_norm_2d(tensor_t *input, batch_norm_t *batch_norm_weight) {
     // output = (input - mean) / sqrt(var + epsilon) * gamma + beta
     // input: 4D tensor    (batch_size x channels x height x width)
@@ -72,25 +157,38 @@ tensor_t *batch_norm_2d(tensor_t *input, batch_norm_t *batch_norm_weight) {
     // output: 4D tensor    (batch_size x channels x height x width)
     // All the types must be float32
     
+    if (input->ndim != 4) {
+        printf("[%s][%s][%d] Error: input tensor must be 4D tensor\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    tensor_t *output = tensor_create(input->type, input->ndim, input->shape, (void *)0);
+
+    if (batch_norm_2d_out(input, batch_norm_weight, output) == NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *batch_norm_2d_out(tensor_t *input, batch_norm_t *batch_norm_weight, tensor_t *output) {
+    // Same as batch_norm_2d(), but the result is written into the given output tensor (same shape as input).
+    // output can be the input itself (in-place).
+
     tensor_t *mean = batch_norm_weight->mean;
     tensor_t *var = batch_norm_weight->var;
     tensor_t *epsilon = batch_norm_weight->epsilon;
     tensor_t *gamma = batch_norm_weight->gamma;
     tensor_t *beta = batch_norm_weight->beta;
-    tensor_t *output = tensor_create(input->type, input->ndim, input->shape, (void *)0);
 
-    if (epsilon == (tensor_t *) NULL) { // epsilon is not given
-        epsilon = tensor_create(input->type, 1, (uint32_t[]){mean->shape[0]}, (void *)0);
-        for (int i = 0; i < epsilon->num_elements; i++) {
-            epsilon->data[i].float32 = 1e-5f;   // default epsilon PyTorch
-        }
-    }
-    
     // Check shape
     if (input->ndim != 4) {
         printf("[%s][%s][%d] Error: input tensor must be 4D tensor\r\n", __FILE__, __func__, __LINE__);
         return NULL;
     }
+    if (output->ndim != 4 || output->num_elements != input->num_elements) {
+        printf("[%s][%s][%d] Error: output tensor must have the same shape as input tensor\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
     if (mean->ndim != 1) {
         printf("[%s][%s][%d] Error: mean tensor must be 1D tensor\r\n", __FILE__, __func__, __LINE__);
         return NULL;
@@ -99,7 +197,7 @@ tensor_t *batch_norm_2d(tensor_t *input, batch_norm_t *batch_norm_weight) {
         printf("[%s][%s][%d] Error: var tensor must be 1D tensor\r\n", __FILE__, __func__, __LINE__);
         return NULL;
     }
-    if (epsilon->ndim != 1) {
+    if (epsilon != (tensor_t *) NULL && epsilon->ndim != 1) {
         printf("[%s][%s][%d] Error: epsilon tensor must be 1D tensor\r\n", __FILE__, __func__, __LINE__);
         return NULL;
     }
@@ -113,30 +211,384 @@ tensor_t *batch_norm_2d(tensor_t *input, batch_norm_t *batch_norm_weight) {
     }
 
     // Type check
-    if (input->type != mean->type || input->type != var->type || input->type != epsilon->type || input->type != gamma->type || input->type != beta->type) {
+    if (input->type != mean->type || input->type != var->type || (epsilon != (tensor_t *) NULL && input->type != epsilon->type) || input->type != gamma->type || input->type != beta->type || input->type != output->type) {
         printf("[%s][%s][%d] Error: input, mean, var, epsilon, gamma, and beta must have the same type (float32)\r\n", __FILE__, __func__, __LINE__);
         return NULL;
     }
 
-    tensor_t *input_coefficient = tensor_create(input->type, 1, (uint32_t[]){input->shape[1]}, (void *)0);
-    tensor_t *bias = tensor_create(input->type, 1, (uint32_t[]){input->shape[1]}, (void *)0);
-    for (int i = 0; i < input_coefficient->num_elements; i++) {
-        input_coefficient->data[i].float32 = 1.0f / sqrt(var->data[i].float32 + epsilon->data[i].float32) * gamma->data[i].float32; // 1 / sqrt(var + epsilon) * gamma
-        bias->data[i].float32 = -mean->data[i].float32 * input_coefficient->data[i].float32 + beta->data[i].float32;    // -mean / sqrt(var + epsilon) * gamma + beta
+    tensor_t *folded = batch_norm_fold(batch_norm_weight);
+    if (folded == (tensor_t *) NULL) {
+        return NULL;
     }
+    const tensor_data_t *input_coefficient = folded->data;
+    const tensor_data_t *bias = folded->data + folded->shape[1];
 
-    for (int c = 0; c < input->shape[1]; c++) {
+    if (tensor_is_contiguous(input) && tensor_is_contiguous(output)) {
+        // Each (batch, channel) plane is a contiguous run of height * width elements.
+        const uint32_t plane = input->shape[2] * input->shape[3];
         for (int i = 0; i < input->shape[0]; i++) {
-            for (int j = 0; j < input->shape[2]; j++) {
-                for (int k = 0; k < input->shape[3]; k++) {
-                    output->data[tensor_convert_nd_to_1d_index(output, (uint32_t[]){i, c, j, k})].float32 = input->data[tensor_convert_nd_to_1d_index(input, (uint32_t[]){i, c, j, k})].float32 * input_coefficient->data[c].float32 + bias->data[c].float32;
+            for (int c = 0; c < input->shape[1]; c++) {
+                const float coefficient = input_coefficient[c].float32;
+                const float shift = bias[c].float32;
+                const tensor_data_t *x = input->data + (i * input->shape[1] + c) * plane;
+                tensor_data_t *y = output->data + (i * input->shape[1] + c) * plane;
+                for (int k = 0; k < plane; k++) {
+                    y[k].float32 = x[k].float32 * coefficient + shift;
+                }
+            }
+        }
+    } else {
+        for (int c = 0; c < input->shape[1]; c++) {
+            for (int i = 0; i < input->shape[0]; i++) {
+                for (int j = 0; j < input->shape[2]; j++) {
+                    for (int k = 0; k < input->shape[3]; k++) {
+                        output->data[tensor_convert_nd_to_1d_index(output, (uint32_t[]){i, c, j, k})].float32 = input->data[tensor_convert_nd_to_1d_index(input, (uint32_t[]){i, c, j, k})].float32 * input_coefficient[c].float32 + bias[c].float32;
+                    }
                 }
             }
         }
     }
 
-    tensor_free(input_coefficient);
-    tensor_free(bias);
+    tensor_free(folded);
 
     return output;
-}
\ No newline at end of file
+}
+
+layer_norm_t *layer_norm_create(uint32_t normalized_size, tensor_t *gamma, tensor_t *beta, float epsilon) {
+    // gamma: tensor    (normalized shape) or NULL
+    // beta: tensor     (normalized shape) or NULL
+    if (normalized_size == 0) {
+        printf("[%s][%s][%d] Error: normalized_size must be greater than 0\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if ((gamma != (tensor_t *) NULL && (gamma->type != TENSOR_FLOAT32 || gamma->num_elements != normalized_size)) ||
+        (beta != (tensor_t *) NULL && (beta->type != TENSOR_FLOAT32 || beta->num_elements != normalized_size))) {
+        printf("[%s][%s][%d] Error: gamma and beta must be float32 tensors of normalized_size elements\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+
+    layer_norm_t *layer_norm_weight = (layer_norm_t *)malloc(sizeof(layer_norm_t));
+    layer_norm_weight->normalized_size = normalized_size;
+    layer_norm_weight->epsilon = epsilon;
+    layer_norm_weight->gamma = gamma;
+    layer_norm_weight->beta = beta;
+    return layer_norm_weight;
+}
+
+void layer_norm_free(layer_norm_t *layer_norm, uint8_t deep) {
+    // deep: 0 - free only layer_norm_t, 1 - free layer_norm_t and gamma, beta
+    if (deep != 0) {
+        if (layer_norm->gamma != (tensor_t *) NULL) {
+            tensor_free(layer_norm->gamma);
+        }
+        if (layer_norm->beta != (tensor_t *) NULL) {
+            tensor_free(layer_norm->beta);
+        }
+    } else {
+        layer_norm->gamma = (tensor_t *) NULL;
+        layer_norm->beta = (tensor_t *) NULL;
+    }
+    free(layer_norm);
+}
+
+group_norm_t *group_norm_create(uint32_t num_groups, uint32_t num_channels, tensor_t *gamma, tensor_t *beta, float epsilon) {
+    // gamma: 1D tensor (channels) or NULL
+    // beta: 1D tensor  (channels) or NULL
+    if (num_groups == 0 || num_channels % num_groups != 0) {
+        printf("[%s][%s][%d] Error: num_channels must be divisible by num_groups\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if ((gamma != (tensor_t *) NULL && (gamma->type != TENSOR_FLOAT32 || gamma->ndim != 1 || gamma->shape[0] != num_channels)) ||
+        (beta != (tensor_t *) NULL && (beta->type != TENSOR_FLOAT32 || beta->ndim != 1 || beta->shape[0] != num_channels))) {
+        printf("[%s][%s][%d] Error: gamma and beta must be 1D float32 tensors (channels)\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+
+    group_norm_t *group_norm_weight = (group_norm_t *)malloc(sizeof(group_norm_t));
+    group_norm_weight->num_groups = num_groups;
+    group_norm_weight->num_channels = num_channels;
+    group_norm_weight->epsilon = epsilon;
+    group_norm_weight->gamma = gamma;
+    group_norm_weight->beta = beta;
+    return group_norm_weight;
+}
+
+void group_norm_free(group_norm_t *group_norm, uint8_t deep) {
+    // deep: 0 - free only group_norm_t, 1 - free group_norm_t and gamma, beta
+    if (deep != 0) {
+        if (group_norm->gamma != (tensor_t *) NULL) {
+            tensor_free(group_norm->gamma);
+        }
+        if (group_norm->beta != (tensor_t *) NULL) {
+            tensor_free(group_norm->beta);
+        }
+    } else {
+        group_norm->gamma = (tensor_t *) NULL;
+        group_norm->beta = (tensor_t *) NULL;
+    }
+    free(group_norm);
+}
+
+#define NORM_MAX_NDIM 8
+
+// Flat (row-major) element access of a possibly transposed tensor
+typedef struct {
+    tensor_data_t *data;
+    uint8_t contiguous;
+    uint32_t ndim;
+    uint32_t shape[NORM_MAX_NDIM];
+    uint32_t strides[NORM_MAX_NDIM];
+} norm_view_t;
+
+static int norm_get_view(tensor_t *tensor, norm_view_t *view) {
+    if (tensor->ndim > NORM_MAX_NDIM) {
+        printf("[%s][%s][%d] Error: tensor must have at most %d dimensions\r\n", __FILE__, __func__, __LINE__, NORM_MAX_NDIM);
+        return -1;
+    }
+    view->data = tensor->data;
+    view->contiguous = tensor_is_contiguous(tensor);
+    view->ndim = tensor->ndim;
+    tensor_get_strides(tensor, view->strides);
+    for (uint32_t d = 0; d < tensor->ndim; d++) view->shape[d] = tensor->shape[d];
+    return 0;
+}
+
+static inline uint32_t norm_view_offset(const norm_view_t *view, uint32_t flat) {
+    if (view->contiguous) return flat;
+    uint32_t offset = 0;
+    for (int32_t d = view->ndim - 1; d >= 0; d--) {
+        offset += (flat % view->shape[d]) * view->strides[d];
+        flat /= view->shape[d];
+    }
+    return offset;
+}
+
+// Mean and sum of squared deviations (M2) of the elements seen so far.
+// count is an integer: a float count is inexact above 2^24 elements, which skews the merge weights.
+typedef struct {
+    uint64_t count;
+    float mean;
+    float m2;
+} norm_moments_t;
+
+// Adds the moments of the n floats in buf (Chan's parallel formula).
+// Per chunk, the mean and M2 are computed over the buffer in cache, in 8 independent lanes (vectorized).
+// buf must have room for n rounded up to a multiple of 8.
+static void norm_moments_add_chunk(norm_moments_t *moments, float *buf, uint32_t n) {
+    const uint32_t padded = (n + 7) / 8 * 8;
+    float lane[8] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    for (uint32_t j = n; j < padded; j++) buf[j] = 0.0f;
+    for (uint32_t j = 0; j < padded; j += 8) {
+        for (uint32_t l = 0; l < 8; l++) lane[l] += buf[j + l];
+    }
+    const float mean = (((lane[0] + lane[1]) + (lane[2] + lane[3])) + ((lane[4] + lane[5]) + (lane[6] + lane[7]))) / n;
+
+    // Padding equal to the mean adds nothing to M2
+    for (uint32_t j = n; j < padded; j++) buf[j] = mean;
+    for (uint32_t l = 0; l < 8; l++) lane[l] = 0.0f;
+    for (uint32_t j = 0; j < padded; j += 8) {
+        for (uint32_t l = 0; l < 8; l++) lane[l] += (buf[j + l] - mean) * (buf[j + l] - mean);
+    }
+    const float m2 = ((lane[0] + lane[1]) + (lane[2] + lane[3])) + ((lane[4] + lane[5]) + (lane[6] + lane[7]));
+
+    const uint64_t total = moments->count + n;
+    const float delta = mean - moments->mean;
+    moments->mean += delta * (float)((double)n / total);
+    moments->m2 += m2 + delta * delta * (float)((double)moments->count * n / total);
+    moments->count = total;
+}
+
+// Moments of the flat range [begin, begin + n) of the view
+static norm_moments_t norm_moments(const norm_view_t *view, uint32_t begin, uint32_t n) {
+    norm_moments_t moments = {0, 0.0f, 0.0f};
+    float buf[NORM_CHUNK];
+    for (uint32_t c = 0; c < n; c += NORM_CHUNK) {
+        const uint32_t size = (n - c < NORM_CHUNK) ? n - c : NORM_CHUNK;
+        if (view->contiguous) {
+            const tensor_data_t *x = view->data + begin + c;
+            for (uint32_t j = 0; j < size; j++) buf[j] = x[j].float32;
+        } else {
+            for (uint32_t j = 0; j < size; j++) buf[j] = view->data[norm_view_offset(view, begin + c + j)].float32;
+        }
+        norm_moments_add_chunk(&moments, buf, size);
+    }
+    return moments;
+}
+
+typedef struct {
+    norm_view_t in;
+    norm_view_t out;
+    uint32_t size;              // Elements per row (layer norm) or per group (group norm)
+    uint32_t channel_size;      // Group norm: elements per channel. Layer norm: 1 (gamma / beta per element)
+    uint32_t channels;          // Group norm: channels per group
+    uint32_t num_groups;        // Group norm: groups per batch item
+    float epsilon;
+    const tensor_data_t *gamma;
+    const tensor_data_t *beta;
+} norm_ctx_t;
+
+// Layer norm: one row is the normalized trailing axes
+static void layer_norm_range(void *arg, uint32_t begin, uint32_t end) {
+    norm_ctx_t *ctx = (norm_ctx_t *)arg;
+    const uint32_t n = ctx->size;
+
+    for (uint32_t r = begin; r < end; r++) {
+        const norm_moments_t moments = norm_moments(&ctx->in, r * n, n);
+        const float rstd = 1.0f / sqrtf(moments.m2 / n + ctx->epsilon);
+        const float shift = -moments.mean * rstd;
+
+        if (ctx->in.contiguous && ctx->out.contiguous) {
+            const tensor_data_t *x = ctx->in.data + r * n;
+            tensor_data_t *y = ctx->out.data + r * n;
+            if (ctx->gamma != (tensor_data_t *) NULL && ctx->beta != (tensor_data_t *) NULL) {
+                for (uint32_t j = 0; j < n; j++) y[j].float32 = (x[j].float32 * rstd + shift) * ctx->gamma[j].float32 + ctx->beta[j].float32;
+            } else {
+                for (uint32_t j = 0; j < n; j++) {
+                    float value = x[j].float32 * rstd + shift;
+                    if (ctx->gamma != (tensor_data_t *) NULL) value *= ctx->gamma[j].float32;
+                    if (ctx->beta != (tensor_data_t *) NULL) value += ctx->beta[j].float32;
+                    y[j].float32 = value;
+                }
+            }
+        } else {
+            for (uint32_t j = 0; j < n; j++) {
+                float value = ctx->in.data[norm_view_offset(&ctx->in, r * n + j)].float32 * rstd + shift;
+                if (ctx->gamma != (tensor_data_t *) NULL) value *= ctx->gamma[j].float32;
+                if (ctx->beta != (tensor_data_t *) NULL) value += ctx->beta[j].float32;
+                ctx->out.data[norm_view_offset(&ctx->out, r * n + j)].float32 = value;
+            }
+        }
+    }
+}
+
+// Group norm: one row is a (batch, group), the channels of the group are contiguous in the flat order
+static void group_norm_range(void *arg, uint32_t begin, uint32_t end) {
+    norm_ctx_t *ctx = (norm_ctx_t *)arg;
+    const uint32_t n = ctx->size;
+
+    for (uint32_t r = begin; r < end; r++) {
+        const norm_moments_t moments = norm_moments(&ctx->in, r * n, n);
+        const float rstd = 1.0f / sqrtf(moments.m2 / n + ctx->epsilon);
+
+        for (uint32_t c = 0; c < ctx->channels; c++) {
+            // Per channel: y = x * scale + shift
+            const uint32_t channel = (r % ctx->num_groups) * ctx->channels + c;
+            const float gamma = (ctx->gamma != (tensor_data_t *) NULL) ? ctx->gamma[channel].float32 : 1.0f;
+            const float beta = (ctx->beta != (tensor_data_t *) NULL) ? ctx->beta[channel].float32 : 0.0f;
+            const float scale = rstd * gamma;
+            const float shift = beta - moments.mean * scale;
+            const uint32_t first = r * n + c * ctx->channel_size;
+
+            if (ctx->in.contiguous && ctx->out.contiguous) {
+                const tensor_data_t *x = ctx->in.data + first;
+                tensor_data_t *y = ctx->out.data + first;
+                for (uint32_t k = 0; k < ctx->channel_size; k++) y[k].float32 = x[k].float32 * scale + shift;
+            } else {
+                for (uint32_t k = 0; k < ctx->channel_size; k++) {
+                    ctx->out.data[norm_view_offset(&ctx->out, first + k)].float32 = ctx->in.data[norm_view_offset(&ctx->in, first + k)].float32 * scale + shift;
+                }
+            }
+        }
+    }
+}
+
+static int norm_check_output(tensor_t *input, tensor_t *output) {
+    if (input->type != TENSOR_FLOAT32 || output->type != TENSOR_FLOAT32) {
+        printf("[%s][%s][%d] Error: input and output must be float32\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    if (input->ndim != output->ndim) {
+        printf("[%s][%s][%d] Error: output tensor must have the same shape as input tensor\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    for (uint32_t d = 0; d < input->ndim; d++) {
+        if (input->shape[d] != output->shape[d]) {
+            printf("[%s][%s][%d] Error: output tensor must have the same shape as input tensor\r\n", __FILE__, __func__, __LINE__);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+tensor_t *layer_norm(tensor_t *input, layer_norm_t *layer_norm_weight) {
+    tensor_t *output = tensor_create(input->type, input->ndim, input->shape, (void *)0);
+    if (layer_norm_out(input, layer_norm_weight, output) == NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *layer_norm_out(tensor_t *input, layer_norm_t *layer_norm_weight, tensor_t *output) {
+    // Same as layer_norm(), but the result is written into the given output tensor (same shape as input).
+    if (norm_check_output(input, output) != 0) {
+        return NULL;
+    }
+    // The normalized axes are the trailing axes whose sizes multiply to normalized_size
+    uint32_t size = 1;
+    for (int32_t d = input->ndim - 1; d >= 0 && size < layer_norm_weight->normalized_size; d--) {
+        size *= input->shape[d];
+    }
+    if (size != layer_norm_weight->normalized_size) {
+        printf("[%s][%s][%d] Error: the trailing axes of input must have normalized_size (%d) elements\r\n", __FILE__, __func__, __LINE__, layer_norm_weight->normalized_size);
+        return NULL;
+    }
+
+    norm_ctx_t ctx;
+    if (norm_get_view(input, &ctx.in) != 0 || norm_get_view(output, &ctx.out) != 0) {
+        return NULL;
+    }
+    ctx.size = size;
+    ctx.channel_size = 1;
+    ctx.channels = size;
+    ctx.num_groups = 1;
+    ctx.epsilon = layer_norm_weight->epsilon;
+    ctx.gamma = (layer_norm_weight->gamma != (tensor_t *) NULL) ? layer_norm_weight->gamma->data : (tensor_data_t *) NULL;
+    ctx.beta = (layer_norm_weight->beta != (tensor_t *) NULL) ? layer_norm_weight->beta->data : (tensor_data_t *) NULL;
+
+    parallel_for(input->num_elements / size, NORM_PARALLEL_THRESHOLD / size + 1, layer_norm_range, &ctx);
+    return output;
+}
+
+tensor_t *group_norm(tensor_t *input, group_norm_t *group_norm_weight) {
+    tensor_t *output = tensor_create(input->type, input->ndim, input->shape, (void *)0);
+    if (group_norm_out(input, group_norm_weight, output) == NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *group_norm_out(tensor_t *input, group_norm_t *group_norm_weight, tensor_t *output) {
+    // Same as group_norm(), but the result is written into the given output tensor (same shape as input).
+    if (input->ndim < 2) {
+        printf("[%s][%s][%d] Error: input tensor must be (batch_size x channels x ...)\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (input->shape[1] != group_norm_weight->num_channels) {
+        printf("[%s][%s][%d] Error: input shape[1] must be equal to the number of channels\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (norm_check_output(input, output) != 0) {
+        return NULL;
+    }
+
+    norm_ctx_t ctx;
+    if (norm_get_view(input, &ctx.in) != 0 || norm_get_view(output, &ctx.out) != 0) {
+        return NULL;
+    }
+    ctx.channel_size = 1;
+    for (uint32_t d = 2; d < input->ndim; d++) ctx.channel_size *= input->shape[d];
+    ctx.channels = group_norm_weight->num_channels / group_norm_weight->num_groups;
+    ctx.size = ctx.channels * ctx.channel_size;
+    ctx.num_groups = group_norm_weight->num_groups;
+    ctx.epsilon = group_norm_weight->epsilon;
+    ctx.gamma = (group_norm_weight->gamma != (tensor_t *) NULL) ? group_norm_weight->gamma->data : (tensor_data_t *) NULL;
+    ctx.beta = (group_norm_weight->beta != (tensor_t *) NULL) ? group_norm_weight->beta->data : (tensor_data_t *) NULL;
+    if (ctx.size == 0) {
+        return output;
+    }
+
+    parallel_for(input->shape[0] * ctx.num_groups, NORM_PARALLEL_THRESHOLD / ctx.size + 1, group_norm_range, &ctx);
+    return output;
+}
@@ -0,0 +1,261 @@
+#include "op_pool.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <float.h>
+#include "tensor.h"
+#include "parallel.h"
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+typedef enum {
+    POOL_MAX,
+    POOL_AVG
+} pool_mode_t;
+
+pool2d_t *pool2d_create(uint32_t kernel_size, uint32_t stride, uint32_t padding) {
+    // Same as nn.MaxPool2d(kernel_size, stride, padding) or nn.AvgPool2d(kernel_size, stride, padding) of PyTorch.
+    // stride 0 means stride = kernel_size (default of PyTorch).
+    if (kernel_size == 0) {
+        printf("[%s][%s][%d] Error: kernel_size must be greater than 0\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (kernel_size > POOL_CHUNK) {
+        printf("[%s][%s][%d] Error: kernel_size must be at most %d (use global_avg_pool_2d for a whole plane)\r\n", __FILE__, __func__, __LINE__, POOL_CHUNK);
+        return NULL;
+    }
+    if (stride == 0) stride = kernel_size;
+    if (padding * 2 > kernel_size) {
+        printf("[%s][%s][%d] Error: padding must be at most half of kernel_size\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+
+    pool2d_t *pool = (pool2d_t *)malloc(sizeof(pool2d_t));
+    pool->kernel_h = kernel_size;
+    pool->kernel_w = kernel_size;
+    pool->stride_h = stride;
+    pool->stride_w = stride;
+    pool->padding_h = padding;
+    pool->padding_w = padding;
+    return pool;
+}
+
+void pool2d_free(pool2d_t *pool) {
+    free(pool);
+}
+
+static int pool2d_output_shape(tensor_t *input, pool2d_t *pool, uint32_t *shape) {
+    if (input->ndim != 4) {
+        printf("[%s][%s][%d] Error: input tensor must be 4D tensor\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    if (input->shape[2] + 2 * pool->padding_h < pool->kernel_h || input->shape[3] + 2 * pool->padding_w < pool->kernel_w) {
+        printf("[%s][%s][%d] Error: kernel is larger than the padded input\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    shape[0] = input->shape[0];
+    shape[1] = input->shape[1];
+    shape[2] = (input->shape[2] + 2 * pool->padding_h - pool->kernel_h) / pool->stride_h + 1;
+    shape[3] = (input->shape[3] + 2 * pool->padding_w - pool->kernel_w) / pool->stride_w + 1;
+    return 0;
+}
+
+// Pool a single (height x width) plane, a chunk of output columns at a time.
+// Max and average pooling are separable: the kh rows of the window are first reduced into a contiguous float buffer
+// (buf[j] = max or sum of the rows at column c0 + j), then each output is the reduction of kw consecutive values of buf.
+// The row loops run over contiguous floats and are vectorized, loops over tensor_data_t (8 bytes per float) are not.
+// Padded rows do not change the max or the sum, so only the rows inside the input are reduced. Padded columns are
+// -FLT_MAX (max) or 0 (average, count_include_pad=True as PyTorch).
+static void pool2d_plane(const tensor_data_t *x, tensor_data_t *y, uint32_t height, uint32_t width,
+                         uint32_t out_height, uint32_t out_width, pool2d_t *pool, pool_mode_t mode, float *buf) {
+    const uint32_t kh = pool->kernel_h, kw = pool->kernel_w;
+    const uint32_t sh = pool->stride_h, sw = pool->stride_w;
+    const uint32_t ph = pool->padding_h, pw = pool->padding_w;
+    const float inv_area = 1.0f / (float)(kh * kw);
+    const float pad = (mode == POOL_MAX) ? -FLT_MAX : 0.0f;
+    const uint32_t chunk_outputs = (POOL_CHUNK - kw) / sw + 1;     // Output columns whose windows fit in buf
+
+    for (uint32_t oh = 0; oh < out_height; oh++) {
+        const int32_t h0 = (int32_t)(oh * sh) - (int32_t)ph;
+        const uint32_t row_begin = (h0 > 0) ? (uint32_t)h0 : 0;
+        const uint32_t row_end = (h0 + (int32_t)kh < (int32_t)height) ? (uint32_t)(h0 + (int32_t)kh) : height;
+        for (uint32_t ow0 = 0; ow0 < out_width; ow0 += chunk_outputs) {
+            const uint32_t outputs = (out_width - ow0 < chunk_outputs) ? out_width - ow0 : chunk_outputs;
+            const int32_t c0 = (int32_t)(ow0 * sw) - (int32_t)pw;
+            const uint32_t n = (outputs - 1) * sw + kw;
+            // buf[j] is input column c0 + j. [j_begin, j_end) is inside the input.
+            const uint32_t j_begin = (c0 < 0) ? (uint32_t)(-c0) : 0;
+            const uint32_t j_end = (c0 + (int32_t)n < (int32_t)width) ? n : (uint32_t)((int32_t)width - c0);
+            for (uint32_t j = 0; j < j_begin; j++) buf[j] = pad;
+            for (uint32_t j = j_end; j < n; j++) buf[j] = pad;
+
+            // Rows of the window inside the input, from column c0 + j_begin
+            const uint32_t len = j_end - j_begin;
+            float *dst = buf + j_begin;
+            const tensor_data_t *src = x + row_begin * width + (c0 + (int32_t)j_begin);
+            for (uint32_t j = 0; j < len; j++) dst[j] = src[j].float32;
+            for (uint32_t i = row_begin + 1; i < row_end; i++) {
+                src = x + i * width + (c0 + (int32_t)j_begin);
+                if (mode == POOL_MAX) {
+                    for (uint32_t j = 0; j < len; j++) dst[j] = (src[j].float32 > dst[j]) ? src[j].float32 : dst[j];
+                } else {
+                    for (uint32_t j = 0; j < len; j++) dst[j] += src[j].float32;
+                }
+            }
+
+            tensor_data_t *out = y + oh * out_width + ow0;
+            for (uint32_t o = 0; o < outputs; o++) {
+                const float *window = buf + o * sw;
+                float result = window[0];
+                if (mode == POOL_MAX) {
+                    for (uint32_t j = 1; j < kw; j++) result = (window[j] > result) ? window[j] : result;
+                    out[o].float32 = result;
+                } else {
+                    for (uint32_t j = 1; j < kw; j++) result += window[j];
+                    out[o].float32 = result * inv_area;
+                }
+            }
+        }
+    }
+}
+
+typedef struct {
+    tensor_t *input;
+    tensor_t *output;
+    pool2d_t *pool;
+    pool_mode_t mode;
+} pool2d_ctx_t;
+
+static void pool2d_range(void *arg, uint32_t begin, uint32_t end) {
+    pool2d_ctx_t *ctx = (pool2d_ctx_t *)arg;
+    const uint32_t height = ctx->input->shape[2], width = ctx->input->shape[3];
+    const uint32_t out_height = ctx->output->shape[2], out_width = ctx->output->shape[3];
+    float buf[POOL_CHUNK];
+    for (uint32_t p = begin; p < end; p++) {
+        pool2d_plane(ctx->input->data + p * height * width, ctx->output->data + p * out_height * out_width,
+                     height, width, out_height, out_width, ctx->pool, ctx->mode, buf);
+    }
+}
+
+static tensor_t *pool2d_out(tensor_t *input, pool2d_t *pool, tensor_t *output, pool_mode_t mode) {
+    uint32_t shape[4];
+    if (pool2d_output_shape(input, pool, shape) != 0) {
+        return NULL;
+    }
+    if (output->ndim != 4 || output->shape[0] != shape[0] || output->shape[1] != shape[1] || output->shape[2] != shape[2] || output->shape[3] != shape[3]) {
+        printf("[%s][%s][%d] Error: output tensor must be (%d x %d x %d x %d)\r\n", __FILE__, __func__, __LINE__, shape[0], shape[1], shape[2], shape[3]);
+        return NULL;
+    }
+    if (input->type != TENSOR_FLOAT32 || output->type != TENSOR_FLOAT32) {
+        printf("[%s][%s][%d] Error: input and output must be float32\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (!tensor_is_contiguous(input) || !tensor_is_contiguous(output)) {
+        printf("[%s][%s][%d] Error: input and output must not be transposed\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+
+    // The N x C planes are split across the threads
+    pool2d_ctx_t ctx = {input, output, pool, mode};
+    const uint64_t plane_work = (uint64_t)shape[2] * shape[3] * pool->kernel_h * pool->kernel_w + 1;
+    parallel_for(shape[0] * shape[1], (uint32_t)(POOL_PARALLEL_THRESHOLD / plane_work) + 1, pool2d_range, &ctx);
+    return output;
+}
+
+static tensor_t *pool2d(tensor_t *input, pool2d_t *pool, pool_mode_t mode) {
+    uint32_t shape[4];
+    if (pool2d_output_shape(input, pool, shape) != 0) {
+        return NULL;
+    }
+    tensor_t *output = tensor_create(input->type, 4, shape, (void *)0);
+
+    if (pool2d_out(input, pool, output, mode) == NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *max_pool_2d(tensor_t *input, pool2d_t *pool) {
+    return pool2d(input, pool, POOL_MAX);
+}
+
+tensor_t *max_pool_2d_out(tensor_t *input, pool2d_t *pool, tensor_t *output) {
+    return pool2d_out(input, pool, output, POOL_MAX);
+}
+
+tensor_t *avg_pool_2d(tensor_t *input, pool2d_t *pool) {
+    return pool2d(input, pool, POOL_AVG);
+}
+
+tensor_t *avg_pool_2d_out(tensor_t *input, pool2d_t *pool, tensor_t *output) {
+    return pool2d_out(input, pool, output, POOL_AVG);
+}
+
+// Each plane is summed with 4 independent accumulators, so the additions do not wait for each other.
+// The sum reads each value once and is bound by memory: packing the plane into a float buffer first measured slower.
+static void global_avg_pool_range(void *arg, uint32_t begin, uint32_t end) {
+    pool2d_ctx_t *ctx = (pool2d_ctx_t *)arg;
+    const uint32_t plane = ctx->input->shape[2] * ctx->input->shape[3];
+    const float inv_plane = 1.0f / (float)plane;
+    for (uint32_t p = begin; p < end; p++) {
+        const tensor_data_t *x = ctx->input->data + p * plane;
+        float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+        uint32_t k = 0;
+        for (; k + 4 <= plane; k += 4) {
+            sum0 += x[k].float32;
+            sum1 += x[k + 1].float32;
+            sum2 += x[k + 2].float32;
+            sum3 += x[k + 3].float32;
+        }
+        for (; k < plane; k++) {
+            sum0 += x[k].float32;
+        }
+        ctx->output->data[p].float32 = ((sum0 + sum1) + (sum2 + sum3)) * inv_plane;
+    }
+}
+
+tensor_t *global_avg_pool_2d(tensor_t *input) {
+    if (input->ndim != 4) {
+        printf("[%s][%s][%d] Error: input tensor must be 4D tensor\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    tensor_t *output = tensor_create(input->type, 4, (uint32_t[]){input->shape[0], input->shape[1], 1, 1}, (void *)0);
+
+    if (global_avg_pool_2d_out(input, output) == NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *global_avg_pool_2d_out(tensor_t *input, tensor_t *output) {
+    if (input->ndim != 4) {
+        printf("[%s][%s][%d] Error: input tensor must be 4D tensor\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (output->num_elements != input->shape[0] * input->shape[1]) {
+        printf("[%s][%s][%d] Error: output tensor must be (%d x %d x 1 x 1)\r\n", __FILE__, __func__, __LINE__, input->shape[0], input->shape[1]);
+        return NULL;
+    }
+    if (input->type != TENSOR_FLOAT32 || output->type != TENSOR_FLOAT32) {
+        printf("[%s][%s][%d] Error: input and output must be float32\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (!tensor_is_contiguous(input)) {
+        printf("[%s][%s][%d] Error: input must not be transposed\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+
+    // The planes are split across the threads.
+    // In-place, output p is an element of input plane p / plane <= p. Planes run in order read that plane completely
+    // before output p is written, planes on other threads may not, so in-place runs on the calling thread.
+    pool2d_ctx_t ctx = {input, output, NULL, POOL_AVG};
+    const uint32_t plane = input->shape[2] * input->shape[3];
+    const uint32_t planes = input->shape[0] * input->shape[1];
+    const uint32_t min_chunk = (output->data == input->data) ? planes + 1 : POOL_PARALLEL_THRESHOLD / (plane + 1) + 1;
+    parallel_for(planes, min_chunk, global_avg_pool_range, &ctx);
+    return output;
+}
@@ -0,0 +1,598 @@
+#include "op_softmax.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include "tensor.h"
+#include "fast_math.h"
+#include "parallel.h"
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+// 1D (classes) and 2D (batch_size x classes) tensors are both handled as rows x cols.
+typedef struct {
+    tensor_data_t *data;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t row_stride;
+    uint32_t col_stride;
+} softmax_view_t;
+
+static int softmax_get_view(tensor_t *tensor, const char *name, softmax_view_t *view) {
+    if (tensor->ndim != 1 && tensor->ndim != 2) {
+        printf("[%s][%s][%d] Error: %s tensor must be 1D or 2D tensor\r\n", __FILE__, __func__, __LINE__, name);
+        return -1;
+    }
+    uint32_t strides[2];
+    tensor_get_strides(tensor, strides);
+    view->data = tensor->data;
+    if (tensor->ndim == 1) {
+        view->rows = 1;
+        view->cols = tensor->shape[0];
+        view->row_stride = 0;
+        view->col_stride = strides[0];
+    } else {
+        view->rows = tensor->shape[0];
+        view->cols = tensor->shape[1];
+        view->row_stride = strides[0];
+        view->col_stride = strides[1];
+    }
+    return 0;
+}
+
+static float softmax_row_max(const tensor_data_t *x, uint32_t stride, uint32_t n) {
+    float m0 = -INFINITY, m1 = -INFINITY, m2 = -INFINITY, m3 = -INFINITY;
+    uint32_t j = 0;
+    if (stride == 1) {
+        for (; j + 4 <= n; j += 4) {
+            m0 = (x[j].float32 > m0) ? x[j].float32 : m0;
+            m1 = (x[j + 1].float32 > m1) ? x[j + 1].float32 : m1;
+            m2 = (x[j + 2].float32 > m2) ? x[j + 2].float32 : m2;
+            m3 = (x[j + 3].float32 > m3) ? x[j + 3].float32 : m3;
+        }
+    }
+    for (; j < n; j++) {
+        m0 = (x[j * stride].float32 > m0) ? x[j * stride].float32 : m0;
+    }
+    m0 = (m1 > m0) ? m1 : m0;
+    m2 = (m3 > m2) ? m3 : m2;
+    return (m2 > m0) ? m2 : m0;
+}
+
+// buf = exp(x - max) for n <= SOFTMAX_CHUNK elements. Returns sum(buf).
+// x is copied into a contiguous float buffer first: the exp and sum loops over buf are vectorized,
+// loops over tensor_data_t (8 bytes per float) are not.
+static float softmax_chunk_exp(const tensor_data_t *x, uint32_t stride, uint32_t n, float max, float *buf) {
+    for (uint32_t j = 0; j < n; j++) buf[j] = x[j * stride].float32;
+    if (n == SOFTMAX_CHUNK) {
+        for (uint32_t j = 0; j < SOFTMAX_CHUNK; j++) buf[j] = fast_expf(buf[j] - max);
+    } else {
+        for (uint32_t j = 0; j < n; j++) buf[j] = fast_expf(buf[j] - max);
+        for (uint32_t j = n; j < (n + 7) / 8 * 8; j++) buf[j] = 0.0f;
+    }
+    float sum[8] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    for (uint32_t j = 0; j < n; j += 8) {
+        for (uint32_t l = 0; l < 8; l++) sum[l] += buf[j + l];
+    }
+    return ((sum[0] + sum[1]) + (sum[2] + sum[3])) + ((sum[4] + sum[5]) + (sum[6] + sum[7]));
+}
+
+typedef struct {
+    softmax_view_t in;
+    softmax_view_t out;
+    uint8_t log;
+} softmax_ctx_t;
+
+static void softmax_range(void *arg, uint32_t begin, uint32_t end) {
+    softmax_ctx_t *ctx = (softmax_ctx_t *)arg;
+    const uint32_t n = ctx->in.cols;
+    const uint32_t xs = ctx->in.col_stride;
+    const uint32_t ys = ctx->out.col_stride;
+    float buf[SOFTMAX_CHUNK];
+
+    for (uint32_t i = begin; i < end; i++) {
+        const tensor_data_t *x = ctx->in.data + i * ctx->in.row_stride;
+        tensor_data_t *y = ctx->out.data + i * ctx->out.row_stride;
+        const float max = softmax_row_max(x, xs, n);
+
+        // x is read before y is written at the same index, so x == y (in-place) is safe.
+        float sum = 0.0f;
+        for (uint32_t c = 0; c < n; c += SOFTMAX_CHUNK) {
+            const uint32_t size = (n - c < SOFTMAX_CHUNK) ? n - c : SOFTMAX_CHUNK;
+            sum += softmax_chunk_exp(x + c * xs, xs, size, max, buf);
+            if (!ctx->log) {
+                for (uint32_t j = 0; j < size; j++) y[(c + j) * ys].float32 = buf[j];
+            }
+        }
+
+        if (ctx->log) {
+            const float log_sum = max + logf(sum);
+            for (uint32_t j = 0; j < n; j++) y[j * ys].float32 = x[j * xs].float32 - log_sum;
+        } else {
+            const float scale = 1.0f / sum;
+            for (uint32_t j = 0; j < n; j++) y[j * ys].float32 *= scale;
+        }
+    }
+}
+
+static tensor_t *softmax_run(tensor_t *input, tensor_t *output, uint8_t log) {
+    softmax_ctx_t ctx;
+    if (softmax_get_view(input, "input", &ctx.in) != 0 || softmax_get_view(output, "output", &ctx.out) != 0) {
+        return NULL;
+    }
+    if (input->type != TENSOR_FLOAT32 || output->type != TENSOR_FLOAT32) {
+        printf("[%s][%s][%d] Error: Un-supported tensor type. Supported tensor type is float32\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (ctx.in.rows != ctx.out.rows || ctx.in.cols != ctx.out.cols) {
+        printf("[%s][%s][%d] Error: input and output must have the same shape\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    ctx.log = log;
+
+    const uint32_t cols = (ctx.in.cols > 0) ? ctx.in.cols : 1;
+    parallel_for(ctx.in.rows, SOFTMAX_PARALLEL_THRESHOLD / cols + 1, softmax_range, &ctx);
+    return output;
+}
+
+tensor_t *softmax(tensor_t *input) {
+    tensor_t *output = tensor_create(input->type, input->ndim, input->shape, (void *)0);
+    if (softmax_out(input, output) == NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *softmax_out(tensor_t *input, tensor_t *output) {
+    return softmax_run(input, output, 0);
+}
+
+tensor_t *log_softmax(tensor_t *input) {
+    tensor_t *output = tensor_create(input->type, input->ndim, input->shape, (void *)0);
+    if (log_softmax_out(input, output) == NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *log_softmax_out(tensor_t *input, tensor_t *output) {
+    return softmax_run(input, output, 1);
+}
+
+tensor_t *argmax(tensor_t *input) {
+    uint32_t shape[] = {(input->ndim == 2) ? input->shape[0] : 1};
+    tensor_t *output = tensor_create(TENSOR_INT64, 1, shape, (void *)0);
+    if (argmax_out(input, output) == NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *argmax_out(tensor_t *input, tensor_t *output) {
+    softmax_view_t in;
+    if (softmax_get_view(input, "input", &in) != 0) {
+        return NULL;
+    }
+    if (input->type != TENSOR_FLOAT32) {
+        printf("[%s][%s][%d] Error: Un-supported tensor type. Supported tensor type is float32\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (in.cols == 0) {
+        printf("[%s][%s][%d] Error: input tensor must have at least one class\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (output->type != TENSOR_INT64 || output->ndim != 1 || output->shape[0] != in.rows) {
+        printf("[%s][%s][%d] Error: output tensor must be 1D int64 tensor (batch_size)\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < in.rows; i++) {
+        const tensor_data_t *x = in.data + i * in.row_stride;
+        const uint32_t stride = in.col_stride;
+        // 4 lanes, lane l sees j = l (mod 4). Strict '>' keeps the first index of each lane.
+        float best[4] = {-INFINITY, -INFINITY, -INFINITY, -INFINITY};
+        uint32_t index[4] = {0, 1, 2, 3};
+        uint32_t j = 0;
+        if (stride == 1) {
+            for (; j + 4 <= in.cols; j += 4) {
+                for (uint32_t l = 0; l < 4; l++) {
+                    if (x[j + l].float32 > best[l]) {
+                        best[l] = x[j + l].float32;
+                        index[l] = j + l;
+                    }
+                }
+            }
+        }
+        uint32_t result = (j > 0) ? index[0] : j;
+        float result_value = (j > 0) ? best[0] : -INFINITY;
+        for (uint32_t l = 1; l < 4 && j > 0; l++) {
+            if (best[l] > result_value || (best[l] == result_value && index[l] < result)) {
+                result_value = best[l];
+                result = index[l];
+            }
+        }
+        for (; j < in.cols; j++) {
+            if (x[j * stride].float32 > result_value || j == 0) {
+                result_value = x[j * stride].float32;
+                result = j;
+            }
+        }
+        output->data[tensor_convert_nd_to_1d_index(output, (uint32_t[]){i})].int64 = result;
+    }
+    return output;
+}
+
+// Min-heap of the k largest values. The root is the smallest kept value.
+// On equal values the larger index is treated as smaller, so the lower index is kept.
+typedef struct {
+    float *value;
+    uint32_t *index;
+    uint32_t size;
+    uint32_t k;
+} topk_heap_t;
+
+static inline uint8_t topk_heap_less(const topk_heap_t *heap, uint32_t a, uint32_t b) {
+    return heap->value[a] < heap->value[b] || (heap->value[a] == heap->value[b] && heap->index[a] > heap->index[b]);
+}
+
+static inline void topk_heap_swap(topk_heap_t *heap, uint32_t a, uint32_t b) {
+    float value = heap->value[a];
+    uint32_t index = heap->index[a];
+    heap->value[a] = heap->value[b];
+    heap->index[a] = heap->index[b];
+    heap->value[b] = value;
+    heap->index[b] = index;
+}
+
+static void topk_heap_sift_down(topk_heap_t *heap, uint32_t i, uint32_t size) {
+    while (1) {
+        uint32_t smallest = i;
+        uint32_t left = 2 * i + 1;
+        uint32_t right = 2 * i + 2;
+        if (left < size && topk_heap_less(heap, left, smallest)) smallest = left;
+        if (right < size && topk_heap_less(heap, right, smallest)) smallest = right;
+        if (smallest == i) return;
+        topk_heap_swap(heap, i, smallest);
+        i = smallest;
+    }
+}
+
+static inline void topk_heap_push(topk_heap_t *heap, float value, uint32_t index) {
+    if (heap->size < heap->k) {
+        uint32_t i = heap->size++;
+        heap->value[i] = value;
+        heap->index[i] = index;
+        while (i > 0 && topk_heap_less(heap, i, (i - 1) / 2)) {
+            topk_heap_swap(heap, i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+    } else if (value > heap->value[0] || (value == heap->value[0] && index < heap->index[0])) {
+        heap->value[0] = value;
+        heap->index[0] = index;
+        topk_heap_sift_down(heap, 0, heap->size);
+    }
+}
+
+// Sorts the kept values in descending order (in place). The heap is no longer a heap after this.
+static void topk_heap_sort(topk_heap_t *heap) {
+    for (uint32_t end = heap->size; end > 1; end--) {
+        topk_heap_swap(heap, 0, end - 1);
+        topk_heap_sift_down(heap, 0, end - 1);
+    }
+}
+
+static int topk_check_outputs(uint32_t rows, uint32_t cols, uint32_t k, tensor_t *values, tensor_t *indices) {
+    if (k == 0 || k > cols) {
+        printf("[%s][%s][%d] Error: k must be in [1, %d]\r\n", __FILE__, __func__, __LINE__, cols);
+        return -1;
+    }
+    if (values->type != TENSOR_FLOAT32 || values->ndim != 2 || values->shape[0] != rows || values->shape[1] != k) {
+        printf("[%s][%s][%d] Error: values tensor must be 2D float32 tensor (batch_size x k)\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    if (indices->type != TENSOR_INT64 || indices->ndim != 2 || indices->shape[0] != rows || indices->shape[1] != k) {
+        printf("[%s][%s][%d] Error: indices tensor must be 2D int64 tensor (batch_size x k)\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    return 0;
+}
+
+tensor_t *topk(tensor_t *input, uint32_t k, tensor_t **indices) {
+    uint32_t shape[] = {(input->ndim == 2) ? input->shape[0] : 1, k};
+    tensor_t *values = tensor_create(TENSOR_FLOAT32, 2, shape, (void *)0);
+    *indices = tensor_create(TENSOR_INT64, 2, shape, (void *)0);
+    if (topk_out(input, k, values, *indices) == NULL) {
+        tensor_free(values);
+        tensor_free(*indices);
+        *indices = (tensor_t *) NULL;
+        return NULL;
+    }
+    return values;
+}
+
+tensor_t *topk_out(tensor_t *input, uint32_t k, tensor_t *values, tensor_t *indices) {
+    softmax_view_t in;
+    if (softmax_get_view(input, "input", &in) != 0) {
+        return NULL;
+    }
+    if (input->type != TENSOR_FLOAT32) {
+        printf("[%s][%s][%d] Error: Un-supported tensor type. Supported tensor type is float32\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (topk_check_outputs(in.rows, in.cols, k, values, indices) != 0) {
+        return NULL;
+    }
+
+    topk_heap_t heap;
+    heap.value = (float *)malloc(k * sizeof(float));
+    heap.index = (uint32_t *)malloc(k * sizeof(uint32_t));
+    heap.k = k;
+    for (uint32_t i = 0; i < in.rows; i++) {
+        const tensor_data_t *x = in.data + i * in.row_stride;
+        heap.size = 0;
+        for (uint32_t j = 0; j < in.cols; j++) {
+            topk_heap_push(&heap, x[j * in.col_stride].float32, j);
+        }
+        topk_heap_sort(&heap);
+        for (uint32_t j = 0; j < k; j++) {
+            values->data[tensor_convert_nd_to_1d_index(values, (uint32_t[]){i, j})].float32 = heap.value[j];
+            indices->data[tensor_convert_nd_to_1d_index(indices, (uint32_t[]){i, j})].int64 = heap.index[j];
+        }
+    }
+    free(heap.value);
+    free(heap.index);
+    return values;
+}
+
+// Fused linear -> argmax / top-k.
+// The classes are split into partitions, and the rows into tiles of LINEAR_HEAD_ROWS.
+// Each (partition, row) keeps its own running max / sum of exp and top-k heap, merged after the parallel loop.
+typedef struct {
+    softmax_view_t in;
+    tensor_data_t *weight;
+    uint32_t weight_strides[2];
+    tensor_data_t *bias;
+    uint32_t bias_stride;
+    uint32_t in_features;
+    uint32_t classes;
+    uint32_t partitions;
+    uint32_t row_tiles;
+    uint32_t k;
+    uint8_t normalize;      // 1: keep the running softmax normalizer (top-k probabilities), 0: raw logits (argmax)
+    float *max;             // [partition * rows + row]
+    float *sum;             // [partition * rows + row]
+    topk_heap_t *heaps;     // [partition * rows + row]
+} linear_head_ctx_t;
+
+static inline float linear_head_dot(const tensor_data_t *x, uint32_t x_stride, const tensor_data_t *w, uint32_t w_stride, uint32_t n) {
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    uint32_t k = 0;
+    if (x_stride == 1 && w_stride == 1) {
+        for (; k + 4 <= n; k += 4) {
+            s0 += x[k].float32 * w[k].float32;
+            s1 += x[k + 1].float32 * w[k + 1].float32;
+            s2 += x[k + 2].float32 * w[k + 2].float32;
+            s3 += x[k + 3].float32 * w[k + 3].float32;
+        }
+    }
+    for (; k < n; k++) {
+        s0 += x[k * x_stride].float32 * w[k * w_stride].float32;
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+static void linear_head_range(void *arg, uint32_t begin, uint32_t end) {
+    linear_head_ctx_t *ctx = (linear_head_ctx_t *)arg;
+    const uint32_t rows = ctx->in.rows;
+
+    for (uint32_t unit = begin; unit < end; unit++) {
+        const uint32_t partition = unit % ctx->partitions;
+        const uint32_t row_begin = (unit / ctx->partitions) * LINEAR_HEAD_ROWS;
+        const uint32_t row_end = (row_begin + LINEAR_HEAD_ROWS < rows) ? row_begin + LINEAR_HEAD_ROWS : rows;
+        const uint32_t class_begin = (uint32_t)((uint64_t)ctx->classes * partition / ctx->partitions);
+        const uint32_t class_end = (uint32_t)((uint64_t)ctx->classes * (partition + 1) / ctx->partitions);
+
+        // Each weight row is loaded once for the whole row tile.
+        for (uint32_t j = class_begin; j < class_end; j++) {
+            const tensor_data_t *w = ctx->weight + j * ctx->weight_strides[0];
+            const float b = (ctx->bias != (tensor_data_t *) NULL) ? ctx->bias[j * ctx->bias_stride].float32 : 0.0f;
+            for (uint32_t i = row_begin; i < row_end; i++) {
+                const float logit = linear_head_dot(ctx->in.data + i * ctx->in.row_stride, ctx->in.col_stride, w, ctx->weight_strides[1], ctx->in_features) + b;
+                const uint32_t state = partition * rows + i;
+                if (ctx->normalize) {
+                    // Online normalizer: sum is relative to the running max, rescaled when the max grows.
+                    if (logit > ctx->max[state]) {
+                        ctx->sum[state] = ctx->sum[state] * fast_expf(ctx->max[state] - logit) + 1.0f;
+                        ctx->max[state] = logit;
+                    } else {
+                        ctx->sum[state] += fast_expf(logit - ctx->max[state]);
+                    }
+                }
+                topk_heap_push(&ctx->heaps[state], logit, j);
+            }
+        }
+    }
+}
+
+static int linear_head_check(tensor_t *input, linear_t *linear_weight) {
+    tensor_t *weight = linear_weight->weight;
+    tensor_t *bias = linear_weight->bias;
+
+    if (input->ndim != 1 && input->ndim != 2) {
+        printf("[%s][%s][%d] Error: input tensor must be 1D or 2D tensor\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    if (weight->ndim != 2) {
+        printf("[%s][%s][%d] Error: weight tensor must be 2D tensor\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    if (input->shape[input->ndim - 1] != weight->shape[1]) {
+        printf("[%s][%s][%d] Error: input in_features must be equal to weight shape[1]\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    if (weight->shape[0] == 0) {
+        printf("[%s][%s][%d] Error: weight tensor must have at least one class\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    if (bias != (tensor_t *) NULL && (bias->ndim != 1 || bias->shape[0] != weight->shape[0])) {
+        printf("[%s][%s][%d] Error: bias tensor must be 1D tensor (out_features)\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    if (input->type != TENSOR_FLOAT32 || weight->type != TENSOR_FLOAT32 || (bias != (tensor_t *) NULL && bias->type != TENSOR_FLOAT32)) {
+        printf("[%s][%s][%d] Error: Un-supported tensor type. Supported tensor type is float32\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    return 0;
+}
+
+// Runs the fused head. Results are written as (values, indices) per row.
+// argmax: values == NULL, indices is the 1D argmax output.
+static int linear_head_run(tensor_t *input, linear_t *linear_weight, uint32_t k, uint8_t normalize, tensor_t *values, tensor_t *indices) {
+    linear_head_ctx_t ctx;
+    softmax_get_view(input, "input", &ctx.in);
+    tensor_t *weight = linear_weight->weight;
+    tensor_get_strides(weight, ctx.weight_strides);
+    ctx.weight = weight->data;
+    ctx.bias = (tensor_data_t *) NULL;
+    ctx.bias_stride = 0;
+    if (linear_weight->bias != (tensor_t *) NULL) {
+        uint32_t bias_strides[1];
+        tensor_get_strides(linear_weight->bias, bias_strides);
+        ctx.bias = linear_weight->bias->data;
+        ctx.bias_stride = bias_strides[0];
+    }
+    ctx.in_features = weight->shape[1];
+    ctx.classes = weight->shape[0];
+    ctx.k = k;
+    ctx.normalize = normalize;
+
+    const uint32_t rows = ctx.in.rows;
+    uint32_t partitions = ctx.classes / LINEAR_HEAD_MIN_CLASSES;
+    if (partitions > parallel_get_num_threads()) partitions = parallel_get_num_threads();
+    if (partitions == 0) partitions = 1;
+    ctx.partitions = partitions;
+    ctx.row_tiles = (rows + LINEAR_HEAD_ROWS - 1) / LINEAR_HEAD_ROWS;
+
+    const uint32_t states = partitions * rows;
+    ctx.max = (float *)malloc(states * sizeof(float));
+    ctx.sum = (float *)malloc(states * sizeof(float));
+    ctx.heaps = (topk_heap_t *)malloc(states * sizeof(topk_heap_t));
+    float *heap_values = (float *)malloc((size_t)states * k * sizeof(float));
+    uint32_t *heap_indices = (uint32_t *)malloc((size_t)states * k * sizeof(uint32_t));
+    if (ctx.max == NULL || ctx.sum == NULL || ctx.heaps == NULL || heap_values == NULL || heap_indices == NULL) {
+        printf("[%s][%s][%d] Error: failed to allocate the top-k state\r\n", __FILE__, __func__, __LINE__);
+        free(ctx.max);
+        free(ctx.sum);
+        free(ctx.heaps);
+        free(heap_values);
+        free(heap_indices);
+        return -1;
+    }
+    for (uint32_t s = 0; s < states; s++) {
+        ctx.max[s] = -INFINITY;
+        ctx.sum[s] = 0.0f;
+        ctx.heaps[s].value = heap_values + (size_t)s * k;
+        ctx.heaps[s].index = heap_indices + (size_t)s * k;
+        ctx.heaps[s].size = 0;
+        ctx.heaps[s].k = k;
+    }
+
+    // Threads get at least SOFTMAX_PARALLEL_THRESHOLD multiply-adds.
+    const uint64_t unit_work = (uint64_t)LINEAR_HEAD_ROWS * (ctx.classes / partitions + 1) * (ctx.in_features + 1);
+    const uint32_t min_chunk = (unit_work >= SOFTMAX_PARALLEL_THRESHOLD) ? 1 : (uint32_t)(SOFTMAX_PARALLEL_THRESHOLD / unit_work) + 1;
+    parallel_for(ctx.row_tiles * partitions, min_chunk, linear_head_range, &ctx);
+
+    // Merge the partitions into partition 0
+    for (uint32_t i = 0; i < rows; i++) {
+        topk_heap_t *heap = &ctx.heaps[i];
+        float max = ctx.max[i];
+        for (uint32_t p = 1; p < partitions; p++) {
+            max = (ctx.max[p * rows + i] > max) ? ctx.max[p * rows + i] : max;
+        }
+        float sum = 0.0f;
+        for (uint32_t p = 0; p < partitions; p++) {
+            const uint32_t state = p * rows + i;
+            if (ctx.sum[state] > 0.0f) sum += ctx.sum[state] * fast_expf(ctx.max[state] - max);
+            if (p == 0) continue;
+            for (uint32_t h = 0; h < ctx.heaps[state].size; h++) {
+                topk_heap_push(heap, ctx.heaps[state].value[h], ctx.heaps[state].index[h]);
+            }
+        }
+        topk_heap_sort(heap);
+
+        if (values == (tensor_t *) NULL) {
+            indices->data[tensor_convert_nd_to_1d_index(indices, (uint32_t[]){i})].int64 = heap->index[0];
+            continue;
+        }
+        const float scale = normalize ? 1.0f / sum : 1.0f;
+        for (uint32_t j = 0; j < k; j++) {
+            const float value = normalize ? fast_expf(heap->value[j] - max) * scale : heap->value[j];
+            values->data[tensor_convert_nd_to_1d_index(values, (uint32_t[]){i, j})].float32 = value;
+            indices->data[tensor_convert_nd_to_1d_index(indices, (uint32_t[]){i, j})].int64 = heap->index[j];
+        }
+    }
+
+    free(ctx.max);
+    free(ctx.sum);
+    free(ctx.heaps);
+    free(heap_values);
+    free(heap_indices);
+    return 0;
+}
+
+tensor_t *linear_argmax(tensor_t *input, linear_t *linear_weight) {
+    uint32_t shape[] = {(input->ndim == 2) ? input->shape[0] : 1};
+    tensor_t *output = tensor_create(TENSOR_INT64, 1, shape, (void *)0);
+    if (linear_argmax_out(input, linear_weight, output) == NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *linear_argmax_out(tensor_t *input, linear_t *linear_weight, tensor_t *output) {
+    if (linear_head_check(input, linear_weight) != 0) {
+        return NULL;
+    }
+    const uint32_t rows = (input->ndim == 2) ? input->shape[0] : 1;
+    if (output->type != TENSOR_INT64 || output->ndim != 1 || output->shape[0] != rows) {
+        printf("[%s][%s][%d] Error: output tensor must be 1D int64 tensor (batch_size)\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (linear_head_run(input, linear_weight, 1, 0, (tensor_t *) NULL, output) != 0) {
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *linear_topk(tensor_t *input, linear_t *linear_weight, uint32_t k, tensor_t **indices) {
+    uint32_t shape[] = {(input->ndim == 2) ? input->shape[0] : 1, k};
+    tensor_t *values = tensor_create(TENSOR_FLOAT32, 2, shape, (void *)0);
+    *indices = tensor_create(TENSOR_INT64, 2, shape, (void *)0);
+    if (linear_topk_out(input, linear_weight, k, values, *indices) == NULL) {
+        tensor_free(values);
+        tensor_free(*indices);
+        *indices = (tensor_t *) NULL;
+        return NULL;
+    }
+    return values;
+}
+
+tensor_t *linear_topk_out(tensor_t *input, linear_t *linear_weight, uint32_t k, tensor_t *values, tensor_t *indices) {
+    if (linear_head_check(input, linear_weight) != 0) {
+        return NULL;
+    }
+    const uint32_t rows = (input->ndim == 2) ? input->shape[0] : 1;
+    if (topk_check_outputs(rows, linear_weight->weight->shape[0], k, values, indices) != 0) {
+        return NULL;
+    }
+    if (linear_head_run(input, linear_weight, k, 1, values, indices) != 0) {
+        return NULL;
+    }
+    return values;
+}
@@ -0,0 +1,440 @@
+#include "op_sparse.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "tensor.h"
+#include "parallel.h"
+#include "autotune.h"
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+#define SPARSE_CALIBRATE_REPEAT 5
+
+// Density below which the sparse weight is faster than the best dense kernel (autotune_linear_config, same threads),
+// [format][0: SpMV (batch 1), 1: SpMM]. Measured with example11 (x86-64, gcc -O2, 1024 x 1024).
+static float sparse_crossover_density[3][2] = {
+    {0.55f, 0.45f}, // CSR
+    {0.55f, 0.45f}, // 1x4
+    {0.50f, 0.40f}  // 4x4
+};
+
+static void sparse_block_size(sparse_format_t format, uint32_t *block_rows, uint32_t *block_cols) {
+    *block_rows = (format == SPARSE_BLOCK_4X4) ? 4 : 1;
+    *block_cols = (format == SPARSE_CSR) ? 1 : 4;
+}
+
+// 1 if any weight of the block at (row, col) has |w| > threshold. The block is cut at the matrix border.
+static uint8_t sparse_block_is_kept(tensor_t *weight, const uint32_t *strides, uint32_t row, uint32_t col, uint32_t block_rows, uint32_t block_cols, float threshold) {
+    for (uint32_t r = row; r < row + block_rows && r < weight->shape[0]; r++) {
+        for (uint32_t c = col; c < col + block_cols && c < weight->shape[1]; c++) {
+            if (fabsf(weight->data[r * strides[0] + c * strides[1]].float32) > threshold) return 1;
+        }
+    }
+    return 0;
+}
+
+static int sparse_check_dense(linear_t *linear_weight) {
+    if (linear_weight->weight->ndim != 2) {
+        printf("[%s][%s][%d] Error: weight tensor must be 2D tensor\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    if (linear_weight->weight->type != TENSOR_FLOAT32 || (linear_weight->bias != (tensor_t *) NULL && linear_weight->bias->type != TENSOR_FLOAT32)) {
+        printf("[%s][%s][%d] Error: Un-supported tensor type. Supported tensor type is float32\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    return 0;
+}
+
+float sparse_measure_density(linear_t *linear_weight, sparse_format_t format, float threshold) {
+    if (sparse_check_dense(linear_weight) != 0) {
+        return -1.0f;
+    }
+    tensor_t *weight = linear_weight->weight;
+    uint32_t strides[2], block_rows, block_cols;
+    tensor_get_strides(weight, strides);
+    sparse_block_size(format, &block_rows, &block_cols);
+
+    uint64_t blocks = 0;
+    for (uint32_t row = 0; row < weight->shape[0]; row += block_rows) {
+        for (uint32_t col = 0; col < weight->shape[1]; col += block_cols) {
+            blocks += sparse_block_is_kept(weight, strides, row, col, block_rows, block_cols, threshold);
+        }
+    }
+    if (weight->num_elements == 0) return 0.0f;
+    return (float)((double)blocks * block_rows * block_cols / weight->num_elements);
+}
+
+sparse_linear_t *sparse_linear_create(linear_t *linear_weight, sparse_format_t format, float threshold) {
+    // weight: 2D tensor    (out_features x in_features)
+    // bias: 1D tensor      (out_features) or NULL
+    if (sparse_check_dense(linear_weight) != 0) {
+        return NULL;
+    }
+    if (format != SPARSE_CSR && format != SPARSE_BLOCK_1X4 && format != SPARSE_BLOCK_4X4) {
+        printf("[%s][%s][%d] Error: Unknown sparse format\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    tensor_t *weight = linear_weight->weight;
+    uint32_t strides[2];
+    tensor_get_strides(weight, strides);
+
+    sparse_linear_t *sparse = (sparse_linear_t *)malloc(sizeof(sparse_linear_t));
+    sparse->format = format;
+    sparse->out_features = weight->shape[0];
+    sparse->in_features = weight->shape[1];
+    sparse_block_size(format, &sparse->block_rows, &sparse->block_cols);
+    const uint32_t block_rows = sparse->block_rows;
+    const uint32_t block_cols = sparse->block_cols;
+    const uint32_t num_block_rows = (sparse->out_features + block_rows - 1) / block_rows;
+
+    // Count the blocks of each block row
+    sparse->row_ptr = tensor_create(TENSOR_INT32, 1, (uint32_t[]){num_block_rows + 1}, (void *)0);
+    tensor_data_t *row_ptr = sparse->row_ptr->data;
+    row_ptr[0].int32 = 0;
+    for (uint32_t i = 0; i < num_block_rows; i++) {
+        int32_t count = 0;
+        for (uint32_t col = 0; col < sparse->in_features; col += block_cols) {
+            count += sparse_block_is_kept(weight, strides, i * block_rows, col, block_rows, block_cols, threshold);
+        }
+        row_ptr[i + 1].int32 = row_ptr[i].int32 + count;
+    }
+    sparse->num_blocks = row_ptr[num_block_rows].int32;
+
+    // Copy the blocks. Weights outside the matrix (border blocks) are 0.
+    sparse->col_index = tensor_create(TENSOR_INT32, 1, (uint32_t[]){sparse->num_blocks}, (void *)0);
+    sparse->values = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){sparse->num_blocks * block_rows * block_cols}, (void *)0);
+    uint32_t block = 0;
+    for (uint32_t i = 0; i < num_block_rows; i++) {
+        const uint32_t row = i * block_rows;
+        for (uint32_t col = 0; col < sparse->in_features; col += block_cols) {
+            if (!sparse_block_is_kept(weight, strides, row, col, block_rows, block_cols, threshold)) continue;
+            sparse->col_index->data[block].int32 = col;
+            tensor_data_t *values = sparse->values->data + block * block_rows * block_cols;
+            for (uint32_t r = 0; r < block_rows; r++) {
+                for (uint32_t c = 0; c < block_cols; c++) {
+                    const uint8_t inside = (row + r < sparse->out_features && col + c < sparse->in_features);
+                    values[r * block_cols + c].float32 = inside ? weight->data[(row + r) * strides[0] + (col + c) * strides[1]].float32 : 0.0f;
+                }
+            }
+            block++;
+        }
+    }
+
+    sparse->bias = (tensor_t *) NULL;
+    if (linear_weight->bias != (tensor_t *) NULL) {
+        sparse->bias = tensor_create(TENSOR_FLOAT32, 1, (uint32_t[]){sparse->out_features}, (void *)0);
+        for (uint32_t i = 0; i < sparse->out_features; i++) {
+            sparse->bias->data[i] = linear_weight->bias->data[tensor_convert_nd_to_1d_index(linear_weight->bias, (uint32_t[]){i})];
+        }
+    }
+    return sparse;
+}
+
+void sparse_linear_free(sparse_linear_t *sparse) {
+    tensor_free(sparse->row_ptr);
+    tensor_free(sparse->col_index);
+    tensor_free(sparse->values);
+    if (sparse->bias != (tensor_t *) NULL) {
+        tensor_free(sparse->bias);
+    }
+    free(sparse);
+}
+
+float sparse_linear_density(sparse_linear_t *sparse) {
+    const uint64_t dense = (uint64_t)sparse->out_features * sparse->in_features;
+    if (dense == 0) return 0.0f;
+    return (float)((double)sparse->num_blocks * sparse->block_rows * sparse->block_cols / dense);
+}
+
+typedef struct {
+    sparse_linear_t *sparse;
+    const float *packed;        // Input, (tiles x in_padded x SPARSE_TILE_ROWS). The rows of a tile are interleaved.
+    uint32_t in_padded;         // in_features rounded up to a multiple of 4 (zero padded)
+    uint32_t batch_size;
+    uint32_t tiles;
+    tensor_t *output;
+    uint32_t output_strides[2];
+} sparse_ctx_t;
+
+static inline void sparse_store(sparse_ctx_t *ctx, uint32_t row, uint32_t tile, const float *acc) {
+    if (row >= ctx->sparse->out_features) return;
+    const float bias = (ctx->sparse->bias != (tensor_t *) NULL) ? ctx->sparse->bias->data[row].float32 : 0.0f;
+    for (uint32_t b = 0; b < SPARSE_TILE_ROWS && tile * SPARSE_TILE_ROWS + b < ctx->batch_size; b++) {
+        ctx->output->data[(tile * SPARSE_TILE_ROWS + b) * ctx->output_strides[0] + row * ctx->output_strides[1]].float32 = acc[b] + bias;
+    }
+}
+
+// One block row for every input tile. R x C is the block size.
+// acc[r][b] += w[r][c] * x[col + c][b]. The b loop is over SPARSE_TILE_ROWS contiguous floats (vectorized).
+#define SPARSE_BLOCK_ROW(R, C)                                                                                  \
+    for (uint32_t t = 0; t < ctx->tiles; t++) {                                                                 \
+        float acc[R][SPARSE_TILE_ROWS] = {{0.0f}};                                                              \
+        const float *x_tile = ctx->packed + (size_t)t * ctx->in_padded * SPARSE_TILE_ROWS;                      \
+        for (int32_t p = row_ptr[i].int32; p < row_ptr[i + 1].int32; p++) {                                     \
+            const float *x = x_tile + col_index[p].int32 * SPARSE_TILE_ROWS;                                    \
+            const tensor_data_t *w = values + p * (R * C);                                                      \
+            for (uint32_t r = 0; r < R; r++) {                                                                  \
+                for (uint32_t c = 0; c < C; c++) {                                                              \
+                    const float weight = w[r * C + c].float32;                                                  \
+                    for (uint32_t b = 0; b < SPARSE_TILE_ROWS; b++) {                                           \
+                        acc[r][b] += weight * x[c * SPARSE_TILE_ROWS + b];                                      \
+                    }                                                                                           \
+                }                                                                                               \
+            }                                                                                                   \
+        }                                                                                                       \
+        for (uint32_t r = 0; r < R; r++) sparse_store(ctx, i * R + r, t, acc[r]);                               \
+    }
+
+static void sparse_range(void *arg, uint32_t begin, uint32_t end) {
+    sparse_ctx_t *ctx = (sparse_ctx_t *)arg;
+    const tensor_data_t *row_ptr = ctx->sparse->row_ptr->data;
+    const tensor_data_t *col_index = ctx->sparse->col_index->data;
+    const tensor_data_t *values = ctx->sparse->values->data;
+
+    for (uint32_t i = begin; i < end; i++) {
+        switch (ctx->sparse->format) {
+            case SPARSE_CSR:
+            SPARSE_BLOCK_ROW(1, 1)
+            break;
+            case SPARSE_BLOCK_1X4:
+            SPARSE_BLOCK_ROW(1, 4)
+            break;
+            case SPARSE_BLOCK_4X4:
+            SPARSE_BLOCK_ROW(4, 4)
+            break;
+        }
+    }
+}
+
+// Packed input. One buffer per thread, grown to the largest pack and reused by the next calls, so a run does not
+// allocate. sparse_free_pack releases the buffer of the calling thread.
+#if defined(__GNUC__)
+#define SPARSE_THREAD_LOCAL __thread
+#else
+#define SPARSE_THREAD_LOCAL
+#endif
+static SPARSE_THREAD_LOCAL float *sparse_pack = (float *) NULL;
+static SPARSE_THREAD_LOCAL size_t sparse_pack_size = 0;
+
+static float *sparse_get_pack(size_t size) {
+    if (size > sparse_pack_size) {
+        float *pack = (float *)realloc(sparse_pack, size * sizeof(float));
+        if (pack == (float *) NULL) return NULL;
+        sparse_pack = pack;
+        sparse_pack_size = size;
+    }
+    return sparse_pack;
+}
+
+void sparse_free_pack() {
+    free(sparse_pack);
+    sparse_pack = (float *) NULL;
+    sparse_pack_size = 0;
+}
+
+tensor_t *sparse_linear(tensor_t *input, sparse_linear_t *sparse) {
+    uint32_t shape[] = {(input->ndim == 2) ? input->shape[0] : 1, sparse->out_features};
+    tensor_t *output = tensor_create(TENSOR_FLOAT32, 2, shape, (void *)0);
+    if (sparse_linear_out(input, sparse, output) == NULL) {
+        tensor_free(output);
+        return NULL;
+    }
+    return output;
+}
+
+tensor_t *sparse_linear_out(tensor_t *input, sparse_linear_t *sparse, tensor_t *output) {
+    if (input->ndim != 1 && input->ndim != 2) {
+        printf("[%s][%s][%d] Error: input tensor must be 1D or 2D tensor\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (input->shape[input->ndim - 1] != sparse->in_features) {
+        printf("[%s][%s][%d] Error: input in_features must be equal to weight shape[1]\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    const uint32_t batch_size = (input->ndim == 2) ? input->shape[0] : 1;
+    if (output->ndim != 2 || output->shape[0] != batch_size || output->shape[1] != sparse->out_features) {
+        printf("[%s][%s][%d] Error: output tensor must be 2D tensor (batch_size x out_features)\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (input->type != TENSOR_FLOAT32 || output->type != TENSOR_FLOAT32) {
+        printf("[%s][%s][%d] Error: Un-supported tensor type. Supported tensor type is float32\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+
+    sparse_ctx_t ctx;
+    ctx.sparse = sparse;
+    ctx.in_padded = (sparse->in_features + 3) / 4 * 4;
+    ctx.batch_size = batch_size;
+    ctx.tiles = (batch_size + SPARSE_TILE_ROWS - 1) / SPARSE_TILE_ROWS;
+    ctx.output = output;
+    tensor_get_strides(output, ctx.output_strides);
+
+    // Pack the input once: (tile, column, row in tile). Missing rows and columns are 0.
+    const size_t packed_size = (size_t)ctx.tiles * ctx.in_padded * SPARSE_TILE_ROWS;
+    float *packed = sparse_get_pack(packed_size);
+    if (packed == (float *) NULL && packed_size > 0) {
+        printf("[%s][%s][%d] Error: failed to allocate the packed input\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    if (packed_size > 0) memset(packed, 0, packed_size * sizeof(float));
+    uint32_t input_strides[2];
+    tensor_get_strides(input, input_strides);
+    const uint32_t row_stride = (input->ndim == 2) ? input_strides[0] : 0;
+    const uint32_t col_stride = input_strides[input->ndim - 1];
+    for (uint32_t n = 0; n < batch_size; n++) {
+        float *dst = packed + (size_t)(n / SPARSE_TILE_ROWS) * ctx.in_padded * SPARSE_TILE_ROWS + n % SPARSE_TILE_ROWS;
+        const tensor_data_t *src = input->data + n * row_stride;
+        for (uint32_t k = 0; k < sparse->in_features; k++) {
+            dst[k * SPARSE_TILE_ROWS] = src[k * col_stride].float32;
+        }
+    }
+    ctx.packed = packed;
+
+    const uint32_t num_block_rows = sparse->row_ptr->num_elements - 1;
+    const uint64_t work = (uint64_t)sparse->num_blocks * sparse->block_rows * sparse->block_cols * ctx.tiles * SPARSE_TILE_ROWS;
+    const uint64_t work_per_row = work / (num_block_rows ? num_block_rows : 1) + 1;
+    parallel_for(num_block_rows, (uint32_t)(SPARSE_PARALLEL_THRESHOLD / work_per_row) + 1, sparse_range, &ctx);
+    return output;
+}
+
+float sparse_get_crossover_density(sparse_format_t format, uint32_t batch_size) {
+    return sparse_crossover_density[format][batch_size > 1];
+}
+
+void sparse_set_crossover_density(sparse_format_t format, uint32_t batch_size, float density) {
+    sparse_crossover_density[format][batch_size > 1] = density;
+}
+
+static double sparse_now_ms() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+float sparse_calibrate_crossover(sparse_format_t format, uint32_t out_features, uint32_t in_features, uint32_t batch_size) {
+    // Random block-structured weights at increasing density. The crossover is where sparse stops being faster.
+    uint32_t block_rows, block_cols;
+    sparse_block_size(format, &block_rows, &block_cols);
+    tensor_t *weight = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){out_features, in_features}, (void *)0);
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){batch_size, in_features}, (void *)0);
+    tensor_t *output = tensor_create(TENSOR_FLOAT32, 2, (uint32_t[]){batch_size, out_features}, (void *)0);
+    for (uint32_t i = 0; i < input->num_elements; i++) input->data[i].float32 = (float)(i % 17) / 17.0f;
+    linear_t *dense = linear_create(weight, (tensor_t *) NULL);
+    // The dense side is the best dense kernel for the shape (autotuner), on the same threads as the sparse one
+    linear_config_t config = autotune_linear_config(input, dense, output);
+
+    float crossover = 1.0f;
+    float previous_density = 0.0f;
+    double previous_ratio = 0.0;
+    for (uint32_t step = 1; step <= 20; step++) {
+        const float density = step * 0.05f;
+        for (uint32_t row = 0; row < out_features; row++) {
+            for (uint32_t col = 0; col < in_features; col++) {
+                const uint32_t block = (row / block_rows) * ((in_features + block_cols - 1) / block_cols) + col / block_cols;
+                const uint8_t kept = ((block * 2654435761u) >> 8) % 1000 < (uint32_t)(density * 1000.0f);
+                weight->data[row * in_features + col].float32 = kept ? 0.5f + (float)(col % 7) / 7.0f : 0.0f;
+            }
+        }
+        // Dense and sparse runs are interleaved, and the fastest of SPARSE_CALIBRATE_REPEAT runs is used.
+        sparse_linear_t *sparse = sparse_linear_create(dense, format, 0.0f);
+        double dense_ms = 1e30, sparse_ms = 1e30;
+        for (int r = 0; r < SPARSE_CALIBRATE_REPEAT; r++) {
+            double start = sparse_now_ms();
+            linear_out_config(input, dense, output, &config);
+            double ms = sparse_now_ms() - start;
+            if (ms < dense_ms) dense_ms = ms;
+
+            start = sparse_now_ms();
+            sparse_linear_out(input, sparse, output);
+            ms = sparse_now_ms() - start;
+            if (ms < sparse_ms) sparse_ms = ms;
+        }
+        const float measured = sparse_linear_density(sparse);
+        sparse_linear_free(sparse);
+
+        // Linear interpolation of the sparse / dense time ratio between the two densities around 1.0
+        const double ratio = sparse_ms / dense_ms;
+        if (ratio >= 1.0) {
+            crossover = (step == 1) ? 0.0f : (float)(previous_density + (measured - previous_density) * (1.0 - previous_ratio) / (ratio - previous_ratio));
+            break;
+        }
+        previous_density = measured;
+        previous_ratio = ratio;
+    }
+
+    linear_free(dense, 1);
+    tensor_free(input);
+    tensor_free(output);
+    sparse_set_crossover_density(format, batch_size, crossover);
+    return crossover;
+}
+
+sparse_dispatch_t *sparse_dispatch_create(linear_t *linear_weight, sparse_format_t format, float threshold) {
+    const float density = sparse_measure_density(linear_weight, format, threshold);
+    if (density < 0.0f) {
+        return NULL;
+    }
+    sparse_dispatch_t *dispatch = (sparse_dispatch_t *)malloc(sizeof(sparse_dispatch_t));
+    dispatch->dense = linear_weight;
+    dispatch->density = density;
+    dispatch->sparse = (sparse_linear_t *) NULL;
+    dispatch->use_sparse[0] = (density < sparse_get_crossover_density(format, 1));
+    dispatch->use_sparse[1] = (density < sparse_get_crossover_density(format, 2));
+    if (dispatch->use_sparse[0] || dispatch->use_sparse[1]) {
+        dispatch->sparse = sparse_linear_create(linear_weight, format, threshold);
+        if (dispatch->sparse == (sparse_linear_t *) NULL) {
+            free(dispatch);
+            return NULL;
+        }
+    }
+    return dispatch;
+}
+
+void sparse_dispatch_free(sparse_dispatch_t *dispatch, uint8_t deep) {
+    if (dispatch->sparse != (sparse_linear_t *) NULL) {
+        sparse_linear_free(dispatch->sparse);
+    }
+    if (deep != 0 && dispatch->dense != (linear_t *) NULL) {
+        linear_free(dispatch->dense, 1);
+    }
+    free(dispatch);
+}
+
+// The dense weight can be dropped only when the sparse weight was built
+static uint8_t sparse_dispatch_check(sparse_dispatch_t *dispatch) {
+    if (dispatch->dense == (linear_t *) NULL && dispatch->sparse == (sparse_linear_t *) NULL) {
+        printf("[%s][%s][%d] Error: dense is NULL, and the sparse weight was not built (density %f is above the crossover)\r\n", __FILE__, __func__, __LINE__, dispatch->density);
+        return 0;
+    }
+    return 1;
+}
+
+static uint8_t sparse_dispatch_is_sparse(tensor_t *input, sparse_dispatch_t *dispatch) {
+    const uint32_t batch_size = (input->ndim == 2) ? input->shape[0] : 1;
+    return dispatch->sparse != (sparse_linear_t *) NULL && (dispatch->use_sparse[batch_size > 1] || dispatch->dense == (linear_t *) NULL);
+}
+
+tensor_t *sparse_dispatch_linear(tensor_t *input, sparse_dispatch_t *dispatch) {
+    if (!sparse_dispatch_check(dispatch)) {
+        return NULL;
+    }
+    if (sparse_dispatch_is_sparse(input, dispatch)) {
+        return sparse_linear(input, dispatch->sparse);
+    }
+    return linear_tuned(input, dispatch->dense);
+}
+
+tensor_t *sparse_dispatch_linear_out(tensor_t *input, sparse_dispatch_t *dispatch, tensor_t *output) {
+    if (!sparse_dispatch_check(dispatch)) {
+        return NULL;
+    }
+    if (sparse_dispatch_is_sparse(input, dispatch)) {
+        return sparse_linear_out(input, dispatch->sparse, output);
+    }
+    return linear_tuned_out(input, dispatch->dense, output);
+}
@@ -0,0 +1,197 @@
+#include "parallel.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if PARALLEL_USE_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// Read and written with atomics: parallel_for can be called by several threads at once (ex. sessions, pipeline stages)
+#if defined(__GNUC__)
+#define PARALLEL_LOAD(value) __atomic_load_n(&(value), __ATOMIC_RELAXED)
+#define PARALLEL_STORE(value, new_value) __atomic_store_n(&(value), (new_value), __ATOMIC_RELAXED)
+#define PARALLEL_CAS(value, expected, new_value) __atomic_compare_exchange_n(&(value), &(expected), (new_value), 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#else
+#define PARALLEL_LOAD(value) (value)
+#define PARALLEL_STORE(value, new_value) ((value) = (new_value))
+#define PARALLEL_CAS(value, expected, new_value) ((value) = (new_value), 1)
+#endif
+
+static uint32_t parallel_num_threads = 0;  // 0: not initialized
+
+void parallel_set_num_threads(uint32_t num_threads) {
+    if (num_threads == 0) num_threads = 1;
+    if (num_threads > PARALLEL_MAX_THREADS) num_threads = PARALLEL_MAX_THREADS;
+    PARALLEL_STORE(parallel_num_threads, num_threads);
+}
+
+uint32_t parallel_get_num_threads() {
+    uint32_t num_threads = PARALLEL_LOAD(parallel_num_threads);
+    if (num_threads == 0) {
+#if PARALLEL_USE_PTHREAD
+        long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        uint32_t default_threads = (num_cpus > 0) ? (uint32_t)num_cpus : 1;
+        if (default_threads > PARALLEL_MAX_THREADS) default_threads = PARALLEL_MAX_THREADS;
+#else
+        uint32_t default_threads = 1;
+#endif
+        // Set only if still not initialized, so a concurrent parallel_set_num_threads is not overwritten
+        if (PARALLEL_CAS(parallel_num_threads, num_threads, default_threads)) num_threads = default_threads;
+    }
+    return num_threads;
+}
+
+#if PARALLEL_USE_PTHREAD
+// A parallel_run call: [0, n) in num_ranges ranges, taken one at a time by the workers and the calling thread.
+typedef struct parallel_job {
+    parallel_fn_t fn;
+    void *ctx;
+    uint32_t n;
+    uint32_t num_ranges;
+    uint8_t balanced;
+    uint32_t next_range;            // First range not taken yet
+    uint32_t pending;               // Ranges not finished yet
+    struct parallel_job *next;      // Queue of the jobs with ranges left
+} parallel_job_t;
+
+// Worker pool, shared by all the callers. The workers are created by the first calls that need them and are kept
+// until parallel_free_workers, so a call only wakes them up. All the fields are protected by parallel_mutex.
+static pthread_mutex_t parallel_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t parallel_work_cond = PTHREAD_COND_INITIALIZER;   // A job was queued, or the workers stop
+static pthread_cond_t parallel_done_cond = PTHREAD_COND_INITIALIZER;   // A range of a job finished
+static pthread_t parallel_workers[PARALLEL_MAX_THREADS];
+static uint32_t parallel_num_workers = 0;
+static uint8_t parallel_stopping = 0;
+static parallel_job_t *parallel_queue = (parallel_job_t *) NULL;   // A job per concurrent call at most
+
+// Range t: chunks of ceil(n / num_ranges), or balanced sizes
+static void parallel_job_range(const parallel_job_t *job, uint32_t t, uint32_t *begin, uint32_t *end) {
+    if (job->balanced) {
+        // Sizes differ by at most 1, so no range is empty when num_ranges <= n
+        *begin = (uint32_t)((uint64_t)t * job->n / job->num_ranges);
+        *end = (uint32_t)((uint64_t)(t + 1) * job->n / job->num_ranges);
+    } else {
+        const uint32_t chunk = (job->n + job->num_ranges - 1) / job->num_ranges;
+        *begin = (t * chunk < job->n) ? t * chunk : job->n;
+        *end = (t * chunk + chunk < job->n) ? t * chunk + chunk : job->n;
+    }
+}
+
+// Takes the next range of the job. parallel_mutex is held. The job leaves the queue with its last range.
+static uint32_t parallel_job_take(parallel_job_t *job) {
+    const uint32_t t = job->next_range++;
+    if (job->next_range == job->num_ranges) {
+        parallel_job_t **link = &parallel_queue;
+        while (*link != job) link = &(*link)->next;
+        *link = job->next;
+    }
+    return t;
+}
+
+// Runs range t of the job without parallel_mutex, then marks it finished. parallel_mutex is held before and after.
+static void parallel_job_run(parallel_job_t *job, uint32_t t) {
+    uint32_t begin, end;
+    parallel_job_range(job, t, &begin, &end);
+    pthread_mutex_unlock(&parallel_mutex);
+    if (begin < end) job->fn(job->ctx, begin, end);
+    pthread_mutex_lock(&parallel_mutex);
+    if (--job->pending == 0) pthread_cond_broadcast(&parallel_done_cond);
+}
+
+static void *parallel_worker(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&parallel_mutex);
+    while (1) {
+        while (parallel_queue == (parallel_job_t *) NULL && !parallel_stopping) {
+            pthread_cond_wait(&parallel_work_cond, &parallel_mutex);
+        }
+        if (parallel_queue == (parallel_job_t *) NULL) break;
+        parallel_job_t *job = parallel_queue;
+        parallel_job_run(job, parallel_job_take(job));
+    }
+    pthread_mutex_unlock(&parallel_mutex);
+    return NULL;
+}
+
+void parallel_free_workers() {
+    pthread_mutex_lock(&parallel_mutex);
+    parallel_stopping = 1;
+    pthread_cond_broadcast(&parallel_work_cond);
+    const uint32_t num_workers = parallel_num_workers;
+    pthread_mutex_unlock(&parallel_mutex);
+    for (uint32_t w = 0; w < num_workers; w++) {
+        pthread_join(parallel_workers[w], NULL);
+    }
+    pthread_mutex_lock(&parallel_mutex);
+    parallel_num_workers = 0;
+    parallel_stopping = 0;
+    pthread_mutex_unlock(&parallel_mutex);
+}
+#else
+void parallel_free_workers() {
+}
+#endif
+
+// Run [0, n) in num_threads ranges: chunks of ceil(n / num_threads), or balanced sizes.
+// The ranges are queued for the workers, and the calling thread takes them too until none is left. So the call
+// finishes even without free workers (ex. all busy with other calls, or parallel_for inside a range).
+static void parallel_run(uint32_t n, uint32_t num_threads, parallel_fn_t fn, void *ctx, uint8_t balanced) {
+#if PARALLEL_USE_PTHREAD
+    parallel_job_t job;
+    job.fn = fn;
+    job.ctx = ctx;
+    job.n = n;
+    job.num_ranges = num_threads;
+    job.balanced = balanced;
+    job.next_range = 0;
+    job.pending = num_threads;
+    job.next = (parallel_job_t *) NULL;
+
+    pthread_mutex_lock(&parallel_mutex);
+    // Workers for the other ranges. If a worker cannot be created, the calling thread runs more ranges.
+    while (parallel_num_workers + 1 < num_threads && !parallel_stopping) {
+        if (pthread_create(&parallel_workers[parallel_num_workers], NULL, parallel_worker, NULL) != 0) break;
+        parallel_num_workers++;
+    }
+    parallel_job_t **link = &parallel_queue;
+    while (*link != (parallel_job_t *) NULL) link = &(*link)->next;
+    *link = &job;
+    pthread_cond_broadcast(&parallel_work_cond);
+
+    while (job.next_range < job.num_ranges) {
+        parallel_job_run(&job, parallel_job_take(&job));
+    }
+    while (job.pending > 0) {
+        pthread_cond_wait(&parallel_done_cond, &parallel_mutex);
+    }
+    pthread_mutex_unlock(&parallel_mutex);
+#else
+    fn(ctx, 0, n);
+#endif
+}
+
+void parallel_for(uint32_t n, uint32_t min_chunk, parallel_fn_t fn, void *ctx) {
+    if (n == 0) return;
+    if (min_chunk == 0) min_chunk = 1;
+
+    uint32_t num_threads = parallel_get_num_threads();
+    if (num_threads > n / min_chunk) num_threads = n / min_chunk;
+    if (num_threads <= 1) {
+        fn(ctx, 0, n);
+        return;
+    }
+    parallel_run(n, num_threads, fn, ctx, 0);
+}
+
+void parallel_for_threads(uint32_t n, uint32_t num_threads, parallel_fn_t fn, void *ctx) {
+    if (n == 0) return;
+    if (num_threads > n) num_threads = n;
+    if (num_threads > PARALLEL_MAX_THREADS) num_threads = PARALLEL_MAX_THREADS;
+    if (num_threads <= 1) {
+        fn(ctx, 0, n);
+        return;
+    }
+    parallel_run(n, num_threads, fn, ctx, 1);
+}
@@ -0,0 +1,276 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     // pthread_setaffinity_np
+#endif
+#include "pipeline.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tensor.h"
+#include "model.h"
+#include "parallel.h"
+
+#if PARALLEL_USE_PTHREAD
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+#if defined(__GNUC__)
+#define PIPELINE_LOAD_ACQUIRE(value) __atomic_load_n(&(value), __ATOMIC_ACQUIRE)
+#define PIPELINE_STORE_RELEASE(value, new_value) __atomic_store_n(&(value), (new_value), __ATOMIC_RELEASE)
+#else
+#define PIPELINE_LOAD_ACQUIRE(value) (value)
+#define PIPELINE_STORE_RELEASE(value, new_value) ((value) = (new_value))
+#endif
+
+static double pipeline_now_ms() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Let the other stages run while waiting (they may share the core)
+static void pipeline_wait() {
+#if PARALLEL_USE_PTHREAD
+    sched_yield();
+#endif
+}
+
+static void pipeline_ring_init(pipeline_ring_t *ring, uint32_t min_capacity) {
+    memset(ring, 0, sizeof(pipeline_ring_t));
+    ring->capacity = 1;
+    while (ring->capacity < min_capacity) ring->capacity *= 2;
+    ring->slots = (uint32_t *)malloc(ring->capacity * sizeof(uint32_t));
+}
+
+// Producer side. Returns 1 on success, 0 if the ring is full.
+static int pipeline_ring_push(pipeline_ring_t *ring, uint32_t slot) {
+    const uint32_t tail = ring->tail;
+    if (tail - PIPELINE_LOAD_ACQUIRE(ring->head) == ring->capacity) return 0;
+    ring->slots[tail & (ring->capacity - 1)] = slot;
+    PIPELINE_STORE_RELEASE(ring->tail, tail + 1);
+    return 1;
+}
+
+// Consumer side. Returns 1 on success, 0 if the ring is empty.
+static int pipeline_ring_pop(pipeline_ring_t *ring, uint32_t *slot) {
+    const uint32_t head = ring->head;
+    if (head == PIPELINE_LOAD_ACQUIRE(ring->tail)) return 0;
+    *slot = ring->slots[head & (ring->capacity - 1)];
+    PIPELINE_STORE_RELEASE(ring->head, head + 1);
+    return 1;
+}
+
+int pipeline_measure_costs(model_t *model, uint32_t ndim, uint32_t *shape, double *costs) {
+    session_t *session = session_create(model, ndim, shape);
+    if (session == (session_t *) NULL) return -1;
+    tensor_t *input = tensor_create(TENSOR_FLOAT32, ndim, shape, (void *)0);
+    for (uint32_t i = 0; i < input->num_elements; i++) input->data[i].float32 = 0.0f;
+
+    int status = 0;
+    const uint32_t num_groups = model->executor->num_groups;
+    if (session_run(session, input) == (tensor_t *) NULL) status = -1;     // Warm up, and the inputs of every group
+    for (uint32_t g = 0; g < num_groups && status == 0; g++) {
+        costs[g] = 1e30;
+        for (int r = 0; r < PIPELINE_MEASURE_REPEAT; r++) {
+            double start = pipeline_now_ms();
+            if (session_run_groups(session, input, g, g + 1) == (tensor_t *) NULL) {
+                status = -1;
+                break;
+            }
+            double ms = pipeline_now_ms() - start;
+            if (ms < costs[g]) costs[g] = ms;
+        }
+    }
+    tensor_free(input);
+    session_free(session);
+    return status;
+}
+
+double pipeline_partition(double *costs, uint32_t num_groups, uint32_t num_stages, uint32_t *ends) {
+    // best[s][g]: the most expensive stage when the first g groups are split into s + 1 stages
+    // split[s][g]: first group of stage s in that split
+    if (num_stages > num_groups) num_stages = num_groups;
+    double prefix[num_groups + 1];
+    prefix[0] = 0.0;
+    for (uint32_t g = 0; g < num_groups; g++) prefix[g + 1] = prefix[g] + costs[g];
+    double best[num_stages][num_groups + 1];
+    uint32_t split[num_stages][num_groups + 1];
+    for (uint32_t g = 0; g <= num_groups; g++) {
+        best[0][g] = prefix[g];
+        split[0][g] = 0;
+    }
+    for (uint32_t s = 1; s < num_stages; s++) {
+        for (uint32_t g = 0; g <= num_groups; g++) {
+            best[s][g] = 1e300;     // Every stage has at least a group
+            split[s][g] = s;
+            for (uint32_t k = s; k < g; k++) {
+                const double stage = prefix[g] - prefix[k];
+                const double cost = (best[s - 1][k] > stage) ? best[s - 1][k] : stage;
+                if (cost < best[s][g]) {
+                    best[s][g] = cost;
+                    split[s][g] = k;
+                }
+            }
+        }
+    }
+    uint32_t end = num_groups;
+    for (int32_t s = num_stages - 1; s >= 0; s--) {
+        ends[s] = end;
+        end = split[s][end];
+    }
+    return best[num_stages - 1][num_groups];
+}
+
+#if PARALLEL_USE_PTHREAD
+static void *pipeline_stage_main(void *arg) {
+    pipeline_stage_t *stage = (pipeline_stage_t *)arg;
+    pipeline_t *pipeline = stage->pipeline;
+    pipeline_ring_t *in = &pipeline->rings[stage->index];
+    pipeline_ring_t *out = &pipeline->rings[stage->index + 1];
+    const uint8_t last = (stage->index == pipeline->num_stages - 1);
+    while (1) {
+        uint32_t slot;
+        if (!pipeline_ring_pop(in, &slot)) {
+            if (PIPELINE_LOAD_ACQUIRE(pipeline->stop)) break;
+            pipeline_wait();
+            continue;
+        }
+        pipeline_frame_t *frame = &pipeline->frames[slot];
+        if (!frame->failed) {
+            tensor_t *output = session_run_groups(frame->session, frame->input, stage->first, stage->end);
+            if (output == (tensor_t *) NULL) frame->failed = 1;
+            else if (last) frame->output = output;
+        }
+        while (!pipeline_ring_push(out, slot)) pipeline_wait();  // Not full: the rings hold all the slots
+    }
+    return NULL;
+}
+
+static void pipeline_pin(pipeline_stage_t *stage) {
+    stage->core = -1;
+#if PIPELINE_PIN_CORES && defined(__linux__)
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_cpus <= 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(stage->index % num_cpus, &set);
+    if (pthread_setaffinity_np(stage->thread, sizeof(cpu_set_t), &set) == 0) stage->core = stage->index % num_cpus;
+#endif
+}
+#endif
+
+pipeline_t *pipeline_create(model_t *model, uint32_t ndim, uint32_t *shape, uint32_t num_stages, uint32_t depth) {
+    if (model == (model_t *) NULL || model->executor->num_groups == 0 || num_stages == 0 || num_stages > PIPELINE_MAX_STAGES || depth == 0) {
+        printf("[%s][%s][%d] Error: model must have a layer, num_stages must be 1 to %d and depth greater than 0\r\n", __FILE__, __func__, __LINE__, PIPELINE_MAX_STAGES);
+        return NULL;
+    }
+    const uint32_t num_groups = model->executor->num_groups;
+    if (num_stages > num_groups) num_stages = num_groups;
+    double costs[num_groups];
+    if (pipeline_measure_costs(model, ndim, shape, costs) != 0) {
+        printf("[%s][%s][%d] Error: the model cannot run on the input shape\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    uint32_t ends[num_stages];
+    pipeline_partition(costs, num_groups, num_stages, ends);
+
+    pipeline_t *pipeline = (pipeline_t *)calloc(1, sizeof(pipeline_t));
+    pipeline->model = model_retain(model);
+    pipeline->num_stages = num_stages;
+    pipeline->depth = depth;
+    pipeline->frames = (pipeline_frame_t *)calloc(depth, sizeof(pipeline_frame_t));
+    pipeline_ring_init(&pipeline->free_slots, depth);
+    for (uint32_t s = 0; s <= num_stages; s++) pipeline_ring_init(&pipeline->rings[s], depth);
+    for (uint32_t i = 0; i < depth; i++) {
+        pipeline->frames[i].session = session_create(model, ndim, shape);
+        pipeline->frames[i].input = tensor_create(TENSOR_FLOAT32, ndim, shape, (void *)0);
+        pipeline_ring_push(&pipeline->free_slots, i);
+    }
+    for (uint32_t s = 0; s < num_stages; s++) {
+        pipeline_stage_t *stage = &pipeline->stages[s];
+        stage->pipeline = pipeline;
+        stage->index = s;
+        stage->first = (s == 0) ? 0 : ends[s - 1];
+        stage->end = ends[s];
+        stage->cost_ms = 0.0;
+        for (uint32_t g = stage->first; g < stage->end; g++) stage->cost_ms += costs[g];
+        stage->core = -1;
+    }
+#if PARALLEL_USE_PTHREAD
+    for (uint32_t s = 0; s < num_stages; s++) {
+        pipeline_stage_t *stage = &pipeline->stages[s];
+        if (pthread_create(&stage->thread, NULL, pipeline_stage_main, stage) != 0) {
+            printf("[%s][%s][%d] Error: cannot start the thread of stage %d\r\n", __FILE__, __func__, __LINE__, s);
+            pipeline->num_stages = s;   // Stop the started ones
+            pipeline_free(pipeline);
+            return NULL;
+        }
+        pipeline_pin(stage);
+    }
+#endif
+    return pipeline;
+}
+
+void pipeline_free(pipeline_t *pipeline) {
+    // The frames that are still in the pipeline are dropped.
+    if (pipeline == (pipeline_t *) NULL) return;
+    PIPELINE_STORE_RELEASE(pipeline->stop, 1);
+#if PARALLEL_USE_PTHREAD
+    for (uint32_t s = 0; s < pipeline->num_stages; s++) pthread_join(pipeline->stages[s].thread, NULL);
+#endif
+    for (uint32_t i = 0; i < pipeline->depth; i++) {
+        session_free(pipeline->frames[i].session);
+        tensor_free(pipeline->frames[i].input);
+    }
+    free(pipeline->frames);
+    free(pipeline->free_slots.slots);
+    for (uint32_t s = 0; s <= PIPELINE_MAX_STAGES; s++) {
+        if (pipeline->rings[s].slots != (uint32_t *) NULL) free(pipeline->rings[s].slots);
+    }
+    model_release(pipeline->model);
+    free(pipeline);
+}
+
+int pipeline_push(pipeline_t *pipeline, tensor_t *input) {
+    uint32_t slot;
+    pipeline_frame_t *frame = &pipeline->frames[0];
+    if (input->num_elements != frame->input->num_elements || input->type != TENSOR_FLOAT32) {
+        printf("[%s][%s][%d] Error: input must be a float32 tensor of the pipeline shape\r\n", __FILE__, __func__, __LINE__);
+        return -1;
+    }
+    while (!pipeline_ring_pop(&pipeline->free_slots, &slot)) pipeline_wait();
+    frame = &pipeline->frames[slot];
+    tensor_data_set(frame->input, input->data);
+    frame->failed = 0;
+    frame->output = (tensor_t *) NULL;
+#if PARALLEL_USE_PTHREAD
+    while (!pipeline_ring_push(&pipeline->rings[0], slot)) pipeline_wait();
+#else
+    frame->output = session_run(frame->session, frame->input);
+    if (frame->output == (tensor_t *) NULL) frame->failed = 1;
+    pipeline_ring_push(&pipeline->rings[pipeline->num_stages], slot);
+#endif
+    return 0;
+}
+
+int pipeline_pop(pipeline_t *pipeline, tensor_t *output) {
+    uint32_t slot;
+    while (!pipeline_ring_pop(&pipeline->rings[pipeline->num_stages], &slot)) pipeline_wait();
+    pipeline_frame_t *frame = &pipeline->frames[slot];
+    int status = 0;
+    if (frame->failed || frame->output->num_elements != output->num_elements) {
+        printf("[%s][%s][%d] Error: the frame failed or the output does not have the size of the model output\r\n", __FILE__, __func__, __LINE__);
+        status = -1;
+    } else {
+        tensor_data_set(output, frame->output->data);
+    }
+    pipeline_ring_push(&pipeline->free_slots, slot);
+    return status;
+}
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "alloc.h"
 
 #ifndef SWAP_int32_t
 #define SWAP_int32_t(a, b) {int tmp = a; a = b; b = tmp;}
@@ -10,6 +11,24 @@
 uint64_t tensor_global_data_memory = 0;  // Global variable to store the total memory allocated by tensor (bytes)
 uint64_t tensor_global_data_peak_memory = 0;    // Global variable to store the peak memory allocated by tensor (bytes)
 
+// The counters are updated atomically, so tensors can be created and freed by several threads (ex. sessions of a model).
+#if defined(__GNUC__)
+#define TENSOR_COUNTER_ADD(counter, value) __atomic_add_fetch(&(counter), (value), __ATOMIC_RELAXED)
+#define TENSOR_COUNTER_SUB(counter, value) __atomic_sub_fetch(&(counter), (value), __ATOMIC_RELAXED)
+#else
+#define TENSOR_COUNTER_ADD(counter, value) ((counter) += (value))
+#define TENSOR_COUNTER_SUB(counter, value) ((counter) -= (value))
+#endif
+
+static void tensor_update_peak_memory(uint64_t memory) {
+#if defined(__GNUC__)
+    uint64_t peak = __atomic_load_n(&tensor_global_data_peak_memory, __ATOMIC_RELAXED);
+    while (memory > peak && !__atomic_compare_exchange_n(&tensor_global_data_peak_memory, &peak, memory, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+#else
+    if (memory > tensor_global_data_peak_memory) tensor_global_data_peak_memory = memory;
+#endif
+}
+
 // Create and free functions for each tensor type
 uint64_t tensor_get_data_memory(tensor_t *tensor) {
     uint64_t memory = 0;
@@ -43,6 +62,11 @@ uint64_t tensor_get_global_data_peak_memory() {
     return tensor_global_data_peak_memory;
 }
 
+// Reset the peak to the current usage, so the peak of a single run can be measured.
+void tensor_reset_global_data_peak_memory() {
+    tensor_global_data_peak_memory = tensor_global_data_memory;
+}
+
 tensor_t *tensor_create(tensor_type_t type, uint32_t ndim, uint32_t *shape, void *data) {
     tensor_t *tensor = (tensor_t *)malloc(sizeof(tensor_t));
     tensor->type = type;
@@ -53,16 +77,15 @@ tensor_t *tensor_create(tensor_type_t type, uint32_t ndim, uint32_t *shape, void
     for (int i = 0; i < ndim; i++)  tensor->transpose[i] = i;
     tensor->num_elements = 1;
     for (int i = 0; i < ndim; i++)  tensor->num_elements *= shape[i];
+    tensor->frac_bits = 0;
+    tensor->is_data_malloc = 0;
     if ((void *) data != NULL) {
         tensor->data = (tensor_data_t *)data;
         tensor->is_data_owner = 0;
     } else {
-        tensor->data = (tensor_data_t *)malloc(tensor->num_elements * sizeof(tensor_data_t));
+        tensor->data = (tensor_data_t *)alloc_data((uint64_t)tensor->num_elements * sizeof(tensor_data_t), &tensor->is_data_malloc);   // Policy: alloc.h
         tensor->is_data_owner = 1;
-        tensor_global_data_memory += tensor_get_data_memory(tensor);
-        if (tensor_global_data_memory > tensor_global_data_peak_memory) {
-            tensor_global_data_peak_memory = tensor_global_data_memory;
-        }
+        tensor_update_peak_memory(TENSOR_COUNTER_ADD(tensor_global_data_memory, tensor_get_data_memory(tensor)));
     }
     return tensor;
 }
@@ -75,8 +98,9 @@ void tensor_free(tensor_t *tensor) {
     free(tensor->shape);
     free(tensor->transpose);
     if (tensor->is_data_owner)  {
-        free(tensor->data);
-        tensor_global_data_memory -= tensor_get_data_memory(tensor);
+        if (tensor->is_data_malloc) free(tensor->data);
+        else alloc_free(tensor->data);
+        TENSOR_COUNTER_SUB(tensor_global_data_memory, tensor_get_data_memory(tensor));
     }
     free(tensor);
 }
@@ -217,6 +241,28 @@ uint32_t tensor_convert_nd_to_1d_index(tensor_t *tensor, uint32_t *indics) {
     return index;
 }
 
+uint8_t tensor_is_contiguous(tensor_t *tensor) {
+    for (int i = 0; i < tensor->ndim; i++) {
+        if (tensor->transpose[i] != i) return 0;
+    }
+    return 1;
+}
+
+void tensor_get_strides(tensor_t *tensor, uint32_t *strides) {
+    // The data is stored in the original (not transposed) order.
+    // The original axis transpose[i] has the size shape[i].
+    uint32_t ndim = tensor->ndim;
+    uint32_t original_shape[ndim];
+    uint32_t original_strides[ndim];
+    for (int i = 0; i < ndim; i++) original_shape[tensor->transpose[i]] = tensor->shape[i];
+    uint32_t multiplier = 1;
+    for (int i = ndim - 1; i >= 0; i--) {
+        original_strides[i] = multiplier;
+        multiplier *= original_shape[i];
+    }
+    for (int i = 0; i < ndim; i++) strides[i] = original_strides[tensor->transpose[i]];
+}
+
 // Print
 void tensor_print_data(tensor_t *tensor) {
     uint32_t num_elements = tensor->num_elements;
@@ -286,18 +332,29 @@ tensor_t *tensor_unsqueeze(tensor_t *tensor, uint32_t axis) {
         printf("[%s][%s][%d] axis is out of range\r\n", __FILE__, __func__, __LINE__);
         return NULL;
     }
-    // Reallocate shape using realloc
+    // Reallocate shape and transpose using realloc.
+    // The new axis of size 1 is also the original axis `axis`, so the original axes from `axis` are renumbered.
     uint32_t *old_shape = (uint32_t *)malloc(tensor->ndim * sizeof(uint32_t));
+    uint32_t *old_transpose = (uint32_t *)malloc(tensor->ndim * sizeof(uint32_t));
     memcpy(old_shape, tensor->shape, tensor->ndim * sizeof(uint32_t));
+    memcpy(old_transpose, tensor->transpose, tensor->ndim * sizeof(uint32_t));
     tensor->shape = (uint32_t *)realloc(tensor->shape, (tensor->ndim + 1) * sizeof(uint32_t));
+    tensor->transpose = (uint32_t *)realloc(tensor->transpose, (tensor->ndim + 1) * sizeof(uint32_t));
     for (int i = tensor->ndim; i > axis; i--) {
         tensor->shape[i] = old_shape[i - 1];
     }
+    for (int i = 0; i <= tensor->ndim; i++) {
+        if (i == axis) continue;
+        const uint32_t original = old_transpose[(i < axis) ? i : i - 1];
+        tensor->transpose[i] = (original >= axis) ? original + 1 : original;
+    }
 
     tensor->shape[axis] = 1;
+    tensor->transpose[axis] = axis;
     tensor->ndim++;
 
     free(old_shape);
+    free(old_transpose);
     return tensor;
 }
 
@@ -311,20 +368,49 @@ tensor_t *tensor_squeeze(tensor_t *tensor, uint32_t axis) {
         printf("[%s][%s][%d] The shape at the axis is not 1\r\n", __FILE__, __func__, __LINE__);
         return NULL;
     }
-    // Reallocate shape using realloc
+    // Reallocate shape and transpose using realloc.
+    // The original axis of the removed axis is dropped, so the original axes after it are renumbered.
     uint32_t *old_shape = (uint32_t *)malloc(tensor->ndim * sizeof(uint32_t));
+    uint32_t *old_transpose = (uint32_t *)malloc(tensor->ndim * sizeof(uint32_t));
     memcpy(old_shape, tensor->shape, tensor->ndim * sizeof(uint32_t));
-    tensor->shape = (uint32_t *)realloc(tensor->shape, (tensor->ndim - 1) * sizeof(uint32_t));
+    memcpy(old_transpose, tensor->transpose, tensor->ndim * sizeof(uint32_t));
+    const uint32_t removed = old_transpose[axis];
     for (int i = axis; i < tensor->ndim - 1; i++) {
         tensor->shape[i] = old_shape[i + 1];
+        tensor->transpose[i] = old_transpose[i + 1];
     }
+    for (int i = 0; i < tensor->ndim - 1; i++) {
+        if (tensor->transpose[i] > removed) tensor->transpose[i]--;
+    }
+    tensor->shape = (uint32_t *)realloc(tensor->shape, (tensor->ndim - 1) * sizeof(uint32_t));
+    tensor->transpose = (uint32_t *)realloc(tensor->transpose, (tensor->ndim - 1) * sizeof(uint32_t));
 
     tensor->ndim--;
 
     free(old_shape);
+    free(old_transpose);
     return tensor;
 }
 
+// (1 x n) view of a 1D tensor without allocation. view, shape and transpose (2 elements each) are given by the
+// caller (ex. on the stack). The view shares the data, so the tensor is not changed. Do not free the view.
+tensor_t *tensor_row_view(tensor_t *tensor, tensor_t *view, uint32_t *shape, uint32_t *transpose) {
+    if (tensor->ndim != 1) {
+        printf("[%s][%s][%d] Error: tensor must be a 1D tensor\r\n", __FILE__, __func__, __LINE__);
+        return NULL;
+    }
+    *view = *tensor;
+    shape[0] = 1;
+    shape[1] = tensor->shape[0];
+    transpose[0] = 0;
+    transpose[1] = 1;
+    view->ndim = 2;
+    view->shape = shape;
+    view->transpose = transpose;
+    view->is_data_owner = 0;
+    return view;
+}
+
 // Tranpose.
 // Tranpose operation does not change the location of data in memory.
 // Instead, it changes the order of index to access the data.